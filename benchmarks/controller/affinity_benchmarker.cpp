@@ -0,0 +1,182 @@
+#include <praas/common/messages.hpp>
+#include <praas/process/controller/config.hpp>
+#include <praas/process/controller/controller.hpp>
+#include <praas/process/controller/remote.hpp>
+#include <praas/process/runtime/internal/buffer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+// Mixed-function workload: each batch invokes random functions, one per worker.
+// Every function walks its own table, which stays warm in the CPU caches only when
+// the worker keeps running the same function. We compare the time spent in functions
+// and the throughput of dispatching to any idle worker and to a worker with affinity.
+
+using namespace praas::process;
+
+struct Results : remote::Server {
+
+  std::mutex lock;
+  std::condition_variable cv;
+  size_t finished{};
+  std::vector<int64_t> function_ns;
+  size_t repeated{};
+
+  void poll(std::optional<std::string>) override {}
+
+  void invocation_result(
+      remote::RemoteType, std::optional<std::string_view>, std::string_view, int return_code,
+      runtime::internal::BufferAccessor<const char> payload
+  ) override
+  {
+    std::lock_guard<std::mutex> guard{lock};
+    if (return_code == 0 && payload.len >= 2 * sizeof(int64_t)) {
+      // NOLINTNEXTLINE
+      const auto* output = reinterpret_cast<const int64_t*>(payload.ptr);
+      function_ns.push_back(output[0]);
+      repeated += output[1];
+    }
+    ++finished;
+    cv.notify_one();
+  }
+
+  void put_message(std::string_view, std::string_view, runtime::internal::Buffer<char>&&) override
+  {
+  }
+
+  void invocation_request(
+      std::string_view, std::string_view, std::string_view, runtime::internal::Buffer<char>&&
+  ) override
+  {
+  }
+
+  void wait(size_t count)
+  {
+    std::unique_lock<std::mutex> guard{lock};
+    cv.wait(guard, [&]() { return finished >= count; });
+  }
+};
+
+struct Measurement {
+  double mean_function_us;
+  double median_function_us;
+  double invocations_per_second;
+  // Invocations executed by a worker whose previous invocation was the same function.
+  double warm_ratio;
+};
+
+Measurement
+run(config::Controller cfg, const std::vector<int>& sequence, int workers, int warmup_batches)
+{
+  Results results;
+  Controller controller{cfg};
+  controller.set_remote(&results);
+  std::thread controller_thread{&Controller::start, &controller};
+
+  runtime::internal::BufferPool<char> buffers{static_cast<size_t>(workers), 64};
+
+  size_t sent = 0;
+  auto send_batch = [&](size_t batch) {
+    for (int i = 0; i < workers; ++i) {
+
+      int function = sequence[(batch * workers + i) % sequence.size()];
+
+      praas::common::message::InvocationRequestData msg;
+      msg.function_name(fmt::format("working_set_{}", function));
+      msg.invocation_id(fmt::format("{}", sent++));
+
+      auto buf = buffers.retrieve_buffer(sizeof(int64_t));
+      buf.len = sizeof(int64_t);
+      msg.payload_size(buf.len);
+
+      controller.dataplane_message(std::move(msg.data_buffer()), std::move(buf));
+    }
+    results.wait(sent);
+  };
+
+  // Workers start and build the state of functions.
+  for (int batch = 0; batch < warmup_batches; ++batch) {
+    send_batch(batch);
+  }
+  {
+    std::lock_guard<std::mutex> guard{results.lock};
+    results.function_ns.clear();
+    results.repeated = 0;
+  }
+
+  size_t batches = sequence.size() / workers;
+  auto begin = std::chrono::steady_clock::now();
+  for (size_t batch = 0; batch < batches; ++batch) {
+    send_batch(batch);
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  controller.shutdown();
+  controller_thread.join();
+
+  std::vector<int64_t>& times = results.function_ns;
+  std::sort(times.begin(), times.end());
+  double sum = 0;
+  for (int64_t time : times) {
+    sum += time;
+  }
+
+  return Measurement{
+      sum / times.size() / 1000.0, times[times.size() / 2] / 1000.0,
+      batches * workers / std::chrono::duration<double>(end - begin).count(),
+      static_cast<double>(results.repeated) / times.size()};
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) {
+    spdlog::error("Usage: {} <praas-build-directory> [workers] [batches] [functions]", argv[0]);
+    return 1;
+  }
+  std::filesystem::path build_dir{argv[1]};
+  int workers = argc > 2 ? std::stoi(argv[2]) : 4;
+  int batches = argc > 3 ? std::stoi(argv[3]) : 2000;
+  int functions = argc > 4 ? std::stoi(argv[4]) : 4;
+
+  config::Controller cfg;
+  cfg.set_defaults();
+  cfg.function_workers = workers;
+  cfg.code.location = build_dir / "benchmarks" / "controller";
+  cfg.code.config_location = "affinity_functions.json";
+  cfg.deployment_location = build_dir / "process";
+
+  // Both policies see the same random mix of functions.
+  std::mt19937 generator{42};
+  std::uniform_int_distribution<int> distribution{0, functions - 1};
+  std::vector<int> sequence(static_cast<size_t>(batches) * workers);
+  for (int& function : sequence) {
+    function = distribution(generator);
+  }
+
+  spdlog::info("{} workers, {} batches, {} functions", workers, batches, functions);
+
+  for (auto policy : {config::Dispatch::Policy::ANY, config::Dispatch::Policy::AFFINITY}) {
+
+    cfg.dispatch.policy = policy;
+    auto result = run(cfg, sequence, workers, 10);
+
+    spdlog::info(
+        "{}: function time mean {:.1f} us, median {:.1f} us, {:.0f} invocations/s, "
+        "{:.1f}% on a warm worker",
+        policy == config::Dispatch::Policy::ANY ? "any" : "affinity", result.mean_function_us,
+        result.median_function_us, result.invocations_per_second, result.warm_ratio * 100
+    );
+  }
+
+  return 0;
+}
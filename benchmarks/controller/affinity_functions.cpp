@@ -0,0 +1,73 @@
+#include <praas/process/runtime/context.hpp>
+#include <praas/process/runtime/invocation.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+// Functions with private state built on first use, like caches and lookup tables
+// of real functions. Each of them walks its own table; the table stays in CPU caches
+// only when the worker keeps running the same function.
+
+constexpr size_t WORKING_SET_BYTES = 1024 * 1024;
+constexpr size_t STRIDE = 8;
+
+// Function executed previously by this worker.
+int last_function = -1;
+
+template <int Id>
+int working_set(praas::process::runtime::Context& context)
+{
+  auto begin = std::chrono::steady_clock::now();
+
+  thread_local std::vector<uint64_t> table = []() {
+    std::vector<uint64_t> data(WORKING_SET_BYTES / sizeof(uint64_t));
+    std::iota(data.begin(), data.end(), Id);
+    return data;
+  }();
+
+  uint64_t sum = 0;
+  for (size_t i = 0; i < table.size(); i += STRIDE) {
+    sum += table[i];
+  }
+
+  auto end = std::chrono::steady_clock::now();
+
+  // Time spent in the function, whether the worker ran it before,
+  // and the result to keep the loop alive.
+  auto& buf = context.get_output_buffer(3 * sizeof(int64_t));
+  auto* output = reinterpret_cast<int64_t*>(buf.ptr);
+  output[0] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+  output[1] = last_function == Id;
+  output[2] = static_cast<int64_t>(sum);
+  buf.len = 3 * sizeof(int64_t);
+
+  last_function = Id;
+
+  return 0;
+}
+
+extern "C" int
+working_set_0(praas::process::runtime::Invocation, praas::process::runtime::Context& context)
+{
+  return working_set<0>(context);
+}
+
+extern "C" int
+working_set_1(praas::process::runtime::Invocation, praas::process::runtime::Context& context)
+{
+  return working_set<1>(context);
+}
+
+extern "C" int
+working_set_2(praas::process::runtime::Invocation, praas::process::runtime::Context& context)
+{
+  return working_set<2>(context);
+}
+
+extern "C" int
+working_set_3(praas::process::runtime::Invocation, praas::process::runtime::Context& context)
+{
+  return working_set<3>(context);
+}
@@ -0,0 +1,85 @@
+#include <praas/process/controller/workers.hpp>
+#include <praas/process/runtime/internal/functions.hpp>
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+// Cost of enqueueing, dispatching and finishing invocations as the work queue grows.
+// The controller dispatches whenever a worker becomes idle, so the time per
+// operation should not depend on the number of queued invocations.
+
+using namespace praas::process;
+using namespace praas::process::runtime::internal;
+
+int main(int argc, char** argv)
+{
+  int functions_count = argc > 1 ? std::stoi(argv[1]) : 8;
+  int repetitions = argc > 2 ? std::stoi(argv[2]) : 5;
+  std::vector<size_t> depths{10, 100, 1000, 10000, 100000};
+
+  std::string config = R"({ "functions": { "cpp": {)";
+  for (int i = 0; i < functions_count; ++i) {
+    config += fmt::format(
+        R"({}"func_{}": {{ "code": {{ "module": "lib.so", "function": "f" }},)"
+        R"( "trigger": {{ "type": "direct", "nargs": 1 }} }})",
+        i > 0 ? "," : "", i
+    );
+  }
+  config += "} } }";
+
+  std::stringstream stream{config};
+  Functions functions;
+  functions.initialize(stream, Language::CPP);
+
+  std::vector<std::string> names;
+  for (int i = 0; i < functions_count; ++i) {
+    names.emplace_back(fmt::format("func_{}", i));
+  }
+
+  spdlog::info("{} functions, {} repetitions", functions_count, repetitions);
+
+  for (size_t depth : depths) {
+
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < depth; ++i) {
+      keys.emplace_back(fmt::format("{:016}", i));
+    }
+
+    double enqueue_ns = 0;
+    double dispatch_ns = 0;
+    for (int rep = 0; rep < repetitions; ++rep) {
+
+      WorkQueue queue{functions};
+
+      auto begin = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < depth; ++i) {
+        queue.add_payload(
+            names[i % names.size()], keys[i], Buffer<char>{}, InvocationSource::from_local()
+        );
+      }
+      auto end = std::chrono::steady_clock::now();
+      enqueue_ns += std::chrono::duration<double, std::nano>(end - begin).count();
+
+      // A worker finishes and immediately receives the next invocation.
+      begin = std::chrono::steady_clock::now();
+      while (Invocation* invoc = queue.next()) {
+        invoc->active = true;
+        queue.finish(std::string{invoc->req.invocation_id()});
+      }
+      end = std::chrono::steady_clock::now();
+      dispatch_ns += std::chrono::duration<double, std::nano>(end - begin).count();
+    }
+
+    spdlog::info(
+        "depth {}: enqueue {:.1f} ns/op, dispatch + finish {:.1f} ns/op", depth,
+        enqueue_ns / (depth * repetitions), dispatch_ns / (depth * repetitions)
+    );
+  }
+
+  return 0;
+}
@@ -0,0 +1,155 @@
+#include <praas/common/messages.hpp>
+#include <praas/process/controller/config.hpp>
+#include <praas/process/controller/controller.hpp>
+#include <praas/process/controller/remote.hpp>
+#include <praas/process/runtime/internal/buffer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+// Handoff of messages from the TCP server threads to a running controller.
+// Producers call Controller::dataplane_message like the server threads do, faster than
+// the controller can process them, so its queue stays full. Each message invokes an
+// unknown function, and the controller replies with an error without using workers.
+// We measure the throughput, and how long producers are blocked by the full queue.
+
+using namespace praas::process;
+
+struct Results : remote::Server {
+
+  std::mutex lock;
+  std::condition_variable cv;
+  size_t finished{};
+
+  void poll(std::optional<std::string>) override {}
+
+  void invocation_result(
+      remote::RemoteType, std::optional<std::string_view>, std::string_view, int,
+      runtime::internal::BufferAccessor<const char>
+  ) override
+  {
+    std::lock_guard<std::mutex> guard{lock};
+    ++finished;
+    cv.notify_one();
+  }
+
+  void put_message(std::string_view, std::string_view, runtime::internal::Buffer<char>&&) override
+  {
+  }
+
+  void invocation_request(
+      std::string_view, std::string_view, std::string_view, runtime::internal::Buffer<char>&&
+  ) override
+  {
+  }
+
+  void wait(size_t count)
+  {
+    std::unique_lock<std::mutex> guard{lock};
+    cv.wait(guard, [&]() { return finished >= count; });
+  }
+};
+
+struct Measurement {
+  double messages_per_second;
+  double median_push_us;
+  double p99_push_us;
+  double max_push_us;
+};
+
+Measurement run(const config::Controller& cfg, int producers, size_t messages)
+{
+  Results results;
+  Controller controller{cfg};
+  controller.set_remote(&results);
+  std::thread controller_thread{&Controller::start, &controller};
+
+  std::vector<std::vector<int64_t>> push_ns(producers);
+
+  auto begin = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < producers; ++i) {
+    threads.emplace_back([&controller, &times = push_ns[i], i, messages]() {
+      times.reserve(messages);
+      for (size_t j = 0; j < messages; ++j) {
+
+        praas::common::message::InvocationRequestData msg;
+        msg.function_name("unknown");
+        msg.invocation_id(fmt::format("{}-{}", i, j));
+
+        auto start = std::chrono::steady_clock::now();
+        controller.dataplane_message(std::move(msg.data_buffer()), {});
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+      }
+    });
+  }
+
+  results.wait(producers * messages);
+  auto end = std::chrono::steady_clock::now();
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  controller.shutdown();
+  controller_thread.join();
+
+  std::vector<int64_t> times;
+  for (auto& producer_times : push_ns) {
+    times.insert(times.end(), producer_times.begin(), producer_times.end());
+  }
+  std::sort(times.begin(), times.end());
+
+  return Measurement{
+      producers * messages / std::chrono::duration<double>(end - begin).count(),
+      times[times.size() / 2] / 1000.0, times[times.size() * 99 / 100] / 1000.0,
+      times.back() / 1000.0};
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) {
+    spdlog::error("Usage: {} <praas-build-directory> [messages] [repetitions]", argv[0]);
+    return 1;
+  }
+  std::filesystem::path build_dir{argv[1]};
+  size_t messages = argc > 2 ? std::stoul(argv[2]) : 100000;
+  int repetitions = argc > 3 ? std::stoi(argv[3]) : 3;
+
+  config::Controller cfg;
+  cfg.set_defaults();
+  cfg.function_workers = 1;
+  cfg.code.location = build_dir / "benchmarks" / "controller";
+  cfg.code.config_location = "affinity_functions.json";
+  cfg.deployment_location = build_dir / "process";
+
+  spdlog::info("{} messages per producer, {} repetitions", messages, repetitions);
+
+  for (int producers : {1, 2, 4, 8}) {
+    for (int i = 0; i < repetitions; ++i) {
+
+      // Every message is rejected with an error log.
+      spdlog::set_level(spdlog::level::off);
+      auto result = run(cfg, producers, messages);
+      spdlog::set_level(spdlog::level::info);
+
+      spdlog::info(
+          "{} producers: {:.0f} msg/s, push median {:.2f} us, p99 {:.2f} us, max {:.0f} us",
+          producers, result.messages_per_second, result.median_push_us, result.p99_push_us,
+          result.max_push_us
+      );
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,185 @@
+#include <praas/common/messages.hpp>
+#include <praas/process/controller/config.hpp>
+#include <praas/process/controller/controller.hpp>
+#include <praas/process/controller/remote.hpp>
+#include <praas/process/runtime/internal/buffer.hpp>
+#include <praas/process/runtime/internal/placement.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+// Invocations are sent one after another, and we measure the latency of each of them:
+// from handing the request to the controller, until the controller returns the result.
+// The same workload runs with threads scheduled freely by the kernel, and with the
+// controller and workers pinned to the given CPUs. Migrations show up as the variance
+// and the tail of latencies, and as the time spent in functions.
+
+using namespace praas::process;
+
+struct Results : remote::Server {
+
+  std::mutex lock;
+  std::condition_variable cv;
+  size_t finished{};
+  std::chrono::steady_clock::time_point end;
+  int64_t function_ns{};
+
+  void poll(std::optional<std::string>) override {}
+
+  void invocation_result(
+      remote::RemoteType, std::optional<std::string_view>, std::string_view, int return_code,
+      runtime::internal::BufferAccessor<const char> payload
+  ) override
+  {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> guard{lock};
+    if (return_code == 0 && payload.len >= sizeof(int64_t)) {
+      // NOLINTNEXTLINE
+      function_ns = *reinterpret_cast<const int64_t*>(payload.ptr);
+    }
+    end = now;
+    ++finished;
+    cv.notify_one();
+  }
+
+  void put_message(std::string_view, std::string_view, runtime::internal::Buffer<char>&&) override
+  {
+  }
+
+  void invocation_request(
+      std::string_view, std::string_view, std::string_view, runtime::internal::Buffer<char>&&
+  ) override
+  {
+  }
+
+  void wait(size_t count)
+  {
+    std::unique_lock<std::mutex> guard{lock};
+    cv.wait(guard, [&]() { return finished >= count; });
+  }
+};
+
+struct Measurement {
+  double mean_us;
+  double stddev_us;
+  double median_us;
+  double p99_us;
+  double max_us;
+  double mean_function_us;
+};
+
+Measurement run(const config::Controller& cfg, int invocations, int functions, int warmup)
+{
+  Results results;
+  Controller controller{cfg};
+  controller.set_remote(&results);
+  std::thread controller_thread{&Controller::start, &controller};
+
+  runtime::internal::BufferPool<char> buffers{1, 64};
+
+  std::vector<double> latencies;
+  double function_us = 0;
+  for (int i = 0; i < warmup + invocations; ++i) {
+
+    praas::common::message::InvocationRequestData msg;
+    msg.function_name(fmt::format("working_set_{}", i % functions));
+    msg.invocation_id(fmt::format("{}", i));
+
+    auto buf = buffers.retrieve_buffer(sizeof(int64_t));
+    buf.len = sizeof(int64_t);
+    msg.payload_size(buf.len);
+
+    auto begin = std::chrono::steady_clock::now();
+    controller.dataplane_message(std::move(msg.data_buffer()), std::move(buf));
+    results.wait(i + 1);
+
+    if (i >= warmup) {
+      std::lock_guard<std::mutex> guard{results.lock};
+      latencies.push_back(std::chrono::duration<double, std::micro>(results.end - begin).count());
+      function_us += results.function_ns / 1000.0;
+    }
+  }
+
+  controller.shutdown();
+  controller_thread.join();
+
+  std::sort(latencies.begin(), latencies.end());
+  double sum = 0;
+  for (double latency : latencies) {
+    sum += latency;
+  }
+  double mean = sum / latencies.size();
+  double variance = 0;
+  for (double latency : latencies) {
+    variance += (latency - mean) * (latency - mean);
+  }
+  variance /= latencies.size();
+
+  return Measurement{
+      mean,
+      std::sqrt(variance),
+      latencies[latencies.size() / 2],
+      latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)],
+      latencies.back(),
+      function_us / latencies.size()};
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 4) {
+    spdlog::error(
+        "Usage: {} <praas-build-directory> <controller-cpus> <worker-cpus> [workers] "
+        "[invocations] [functions] [local-memory]",
+        argv[0]
+    );
+    return 1;
+  }
+  std::filesystem::path build_dir{argv[1]};
+  auto controller_cpus = runtime::internal::CPUSet::parse(argv[2]);
+  auto worker_cpus = runtime::internal::CPUSet::parse(argv[3]);
+  int workers = argc > 4 ? std::stoi(argv[4]) : 2;
+  int invocations = argc > 5 ? std::stoi(argv[5]) : 10000;
+  int functions = argc > 6 ? std::stoi(argv[6]) : 2;
+  bool local_memory = argc > 7 ? std::string{argv[7]} == "1" : true;
+
+  config::Controller cfg;
+  cfg.set_defaults();
+  cfg.function_workers = workers;
+  cfg.code.location = build_dir / "benchmarks" / "controller";
+  cfg.code.config_location = "affinity_functions.json";
+  cfg.deployment_location = build_dir / "process";
+
+  spdlog::info(
+      "{} workers, {} invocations, {} functions, controller on CPUs {}, workers on CPUs {}",
+      workers, invocations, functions, controller_cpus.str(), worker_cpus.str()
+  );
+
+  for (bool pinned : {false, true}) {
+
+    if (pinned) {
+      cfg.placement.controller_cpus = controller_cpus;
+      cfg.placement.worker_cpus = worker_cpus;
+      cfg.placement.local_memory = local_memory;
+    }
+    auto result = run(cfg, invocations, functions, 100);
+
+    spdlog::info(
+        "{}: latency mean {:.1f} us, stddev {:.1f} us, median {:.1f} us, p99 {:.1f} us, "
+        "max {:.1f} us, function time mean {:.1f} us",
+        pinned ? "pinned" : "unpinned", result.mean_us, result.stddev_us, result.median_us,
+        result.p99_us, result.max_us, result.mean_function_us
+    );
+  }
+
+  return 0;
+}
@@ -0,0 +1,145 @@
+#include <praas/process/controller/controller.hpp>
+#include <praas/process/controller/mpsc_queue.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// Handoff of messages from the TCP server threads to the controller loop.
+// Producers push empty external messages, the consumer waits on an eventfd in epoll,
+// like the controller does. We compare the previous design (mutex + deque + one signal
+// per message) with the lock-free queue signalled only when the consumer is not awake yet.
+
+using Message = praas::process::Controller::ExternalMessage;
+
+struct MutexHandoff {
+
+  int event_fd;
+  std::mutex lock;
+  std::deque<Message> queue;
+
+  void push(Message&& msg)
+  {
+    {
+      std::lock_guard<std::mutex> guard{lock};
+      queue.push_back(std::move(msg));
+    }
+    uint64_t tmp = 1;
+    [[maybe_unused]] auto ret = write(event_fd, &tmp, sizeof(tmp));
+  }
+
+  size_t drain()
+  {
+    std::vector<Message> msgs;
+    {
+      std::lock_guard<std::mutex> guard{lock};
+      msgs.resize(queue.size());
+      for (auto& msg : msgs) {
+        msg = std::move(queue.front());
+        queue.pop_front();
+      }
+    }
+    return msgs.size();
+  }
+};
+
+struct MPSCHandoff {
+
+  int event_fd;
+  std::atomic<bool> notified{};
+  praas::process::MPSCQueue<Message> queue{4096};
+
+  void push(Message&& msg)
+  {
+    queue.push(std::move(msg));
+    if (!notified.exchange(true, std::memory_order_acq_rel)) {
+      uint64_t tmp = 1;
+      [[maybe_unused]] auto ret = write(event_fd, &tmp, sizeof(tmp));
+    }
+  }
+
+  size_t drain()
+  {
+    notified.exchange(false, std::memory_order_acq_rel);
+
+    size_t count = 0;
+    Message msg;
+    while (queue.try_pop(msg)) {
+      ++count;
+    }
+    queue.wake_producers();
+    return count;
+  }
+};
+
+template <typename Handoff>
+double run(int producers, size_t messages)
+{
+  Handoff handoff;
+  handoff.event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  int epoll_fd = epoll_create(1);
+
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLET;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, handoff.event_fd, &event);
+
+  auto begin = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < producers; ++i) {
+    threads.emplace_back([&handoff, messages]() {
+      for (size_t j = 0; j < messages; ++j) {
+        handoff.push(Message{});
+      }
+    });
+  }
+
+  size_t total = producers * messages;
+  size_t received = 0;
+  while (received < total) {
+
+    int events = epoll_wait(epoll_fd, &event, 1, 1000);
+    if (events > 0) {
+      uint64_t tmp;
+      [[maybe_unused]] auto ret = read(handoff.event_fd, &tmp, sizeof(tmp));
+      received += handoff.drain();
+    }
+  }
+
+  auto end = std::chrono::steady_clock::now();
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  close(epoll_fd);
+  close(handoff.event_fd);
+
+  return total / std::chrono::duration<double>(end - begin).count();
+}
+
+int main(int argc, char** argv)
+{
+  int producers = argc > 1 ? std::stoi(argv[1]) : 4;
+  size_t messages = argc > 2 ? std::stoul(argv[2]) : 1000000;
+  int repetitions = argc > 3 ? std::stoi(argv[3]) : 5;
+
+  spdlog::info("{} producers, {} messages each, {} repetitions", producers, messages, repetitions);
+
+  for (int i = 0; i < repetitions; ++i) {
+    double before = run<MutexHandoff>(producers, messages);
+    double after = run<MPSCHandoff>(producers, messages);
+    spdlog::info("mutex + deque: {:.0f} msg/s, mpsc: {:.0f} msg/s", before, after);
+  }
+
+  return 0;
+}
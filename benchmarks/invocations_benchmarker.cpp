@@ -1,6 +1,12 @@
+#include <praas/common/messages.hpp>
+#include <praas/common/util.hpp>
 #include <praas/sdk/process.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <map>
+#include <thread>
 
 #include <cereal/archives/json.hpp>
 #include <cereal/types/vector.hpp>
@@ -19,6 +25,10 @@ struct Config
 
   std::string output_file;
 
+  // One client per entry, sending concurrently with the given priority class.
+  std::vector<std::string> priorities;
+  int deadline_ms;
+
   template<typename Ar>
   void serialize(Ar & ar)
   {
@@ -30,6 +40,11 @@ struct Config
     ar(CEREAL_NVP(function_name));
 
     ar(CEREAL_NVP(output_file));
+
+    praas::common::util::cereal_load_optional(
+      ar, "priorities", priorities, std::vector<std::string>{"normal"}
+    );
+    praas::common::util::cereal_load_optional(ar, "deadline_ms", deadline_ms, 0);
   }
 
 };
@@ -50,15 +65,32 @@ int main(int argc, char** argv)
   spdlog::set_pattern("[%H:%M:%S:%f] [P %P] [T %t] [%l] %v ");
   spdlog::info("Executing PraaS benchmarker!");
 
-  praas::sdk::Process proc{cfg.process_address, cfg.process_port};
+  std::vector<praas::common::message::Priority> priorities;
+  for(const auto& name : cfg.priorities) {
+    auto priority = praas::common::message::parse_priority(name);
+    if(!priority.has_value()) {
+      spdlog::error("Unknown priority class {}", name);
+      return 1;
+    }
+    priorities.push_back(priority.value());
+  }
+
+  // Each client has its own connection - invocations of different classes compete for workers.
+  std::vector<praas::sdk::Process> clients;
+  clients.reserve(priorities.size());
+  for(size_t i = 0; i < priorities.size(); ++i) {
 
-  spdlog::error("Connecting to {}:{}", cfg.process_address, cfg.process_port);
-  if(!proc.connect())  {
-    spdlog::error("Could not connect to {}:{}", cfg.process_address, cfg.process_port);
-    return 1;
+    clients.emplace_back(cfg.process_address, cfg.process_port);
+
+    spdlog::info("Connecting to {}:{}", cfg.process_address, cfg.process_port);
+    if(!clients.back().connect())  {
+      spdlog::error("Could not connect to {}:{}", cfg.process_address, cfg.process_port);
+      return 1;
+    }
   }
 
-  std::vector< std::vector<long> > measurements;
+  // measurements[size][client][repetition]
+  std::vector< std::vector< std::vector<long> > > measurements;
 
   for(int size : cfg.sizes) {
 
@@ -68,33 +100,77 @@ int main(int argc, char** argv)
     for(int i = 0; i < size / 4; ++i)
       ((int*)buf.get())[i] = i + 1;
 
-    measurements.emplace_back();
-    for(int i = 0; i  < cfg.repetitions; ++i) {
+    measurements.emplace_back(clients.size());
 
-      auto begin = std::chrono::high_resolution_clock::now();
-      auto result = proc.invoke(cfg.function_name, "id", buf.get(), size);
-      auto end = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for(size_t c = 0; c < clients.size(); ++c) {
 
-      measurements.back().emplace_back(
-        std::chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count()
-      );
+      threads.emplace_back([&, c]() {
+
+        // Each client reads its own copy of the input.
+        std::unique_ptr<char[]> input{new char[size]};
+        std::copy_n(buf.get(), size, input.get());
+
+        auto& results = measurements.back()[c];
+        for(int i = 0; i  < cfg.repetitions; ++i) {
 
+          auto begin = std::chrono::high_resolution_clock::now();
+          auto result = clients[c].invoke(
+            cfg.function_name, fmt::format("c{}-{}", c, i), input.get(), size,
+            priorities[c], std::chrono::milliseconds{cfg.deadline_ms}
+          );
+          auto end = std::chrono::high_resolution_clock::now();
+
+          results.emplace_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end-begin).count()
+          );
+        }
+      });
+
+    }
+
+    for(auto& thread : threads)
+      thread.join();
+
+    // Latency percentiles of each priority class.
+    std::map<std::string, std::vector<long>> classes;
+    for(size_t c = 0; c < clients.size(); ++c) {
+      auto& times = classes[cfg.priorities[c]];
+      times.insert(times.end(), measurements.back()[c].begin(), measurements.back()[c].end());
+    }
+
+    for(auto& [name, times] : classes) {
+
+      std::sort(times.begin(), times.end());
+      auto percentile = [&times](double p) {
+        size_t idx = static_cast<size_t>(std::ceil(p * times.size()));
+        return times[std::clamp(idx, size_t{1}, times.size()) - 1] / 1000.0;
+      };
+
+      spdlog::info(
+        "Size {} class {}: {} invocations, p50 {:.2f} us, p99 {:.2f} us",
+        size, name, times.size(), percentile(0.5), percentile(0.99)
+      );
     }
 
   }
 
   std::ofstream out_file{cfg.output_file, std::ios::out};
-  out_file << "size, repetition, time" << '\n';
+  out_file << "size, priority, client, repetition, time" << '\n';
   for(int i = 0; i < measurements.size(); ++i) {
 
-    for(int j = 0; j < cfg.repetitions; ++j) {
-      out_file << cfg.sizes[i] << "," << j << "," << measurements[i][j] << '\n';
+    for(size_t c = 0; c < clients.size(); ++c) {
+      for(int j = 0; j < cfg.repetitions; ++j) {
+        out_file << cfg.sizes[i] << "," << cfg.priorities[c] << "," << c << "," << j << ","
+                 << measurements[i][c][j] << '\n';
+      }
     }
 
   }
   out_file.close();
 
-  proc.disconnect();
+  for(auto& client : clients)
+    client.disconnect();
 
   return 0;
 }
@@ -1,6 +1,7 @@
 #ifndef PRAAS_COMMON_APPLICATION_HPP
 #define PRAAS_COMMON_APPLICATION_HPP
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
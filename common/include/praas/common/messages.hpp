@@ -8,6 +8,7 @@
 #include <array>
 #include <cstring>
 #include <memory>
+#include <optional>
 #include <string>
 #include <variant>
 
@@ -52,7 +53,11 @@ namespace praas::common::message {
   // 16 bytes of invocation id
   // 32 bytes of function name
   // 8 bytes payload length
-  // 58 bytes
+  // 4 bytes of deadline in milliseconds, relative to arrival - 0 when there is none
+  // 1 byte of priority class
+  // 3 bytes of padding
+  // 4 bytes of timeout in milliseconds - 0 uses the function's default
+  // 70 bytes
 
   // Invocation response
   // 2 bytes of identifier: 4
@@ -71,6 +76,11 @@ namespace praas::common::message {
   // 2 bytes of identifier: 6
   // 2 bytes
 
+  // Invocation cancellation
+  // 2 bytes of identifier: 10
+  // 16 bytes of invocation id
+  // 18 bytes
+
   struct MessageConfig {
     static constexpr uint16_t BUF_SIZE = 70;
     static constexpr uint16_t HEADER_OFFSET = 6;
@@ -135,9 +145,39 @@ namespace praas::common::message {
     PROCESS_CLOSURE,
     APPLICATION_UPDATE,
     PUT_MESSAGE,
+    INVOCATION_CANCEL,
     END_FLAG
   };
 
+  // Scheduling class of an invocation - zero-initialized requests are normal.
+  enum class Priority : int8_t { LOW = -1, NORMAL = 0, HIGH = 1 };
+
+  inline std::string_view priority_name(Priority priority)
+  {
+    switch (priority) {
+    case Priority::LOW:
+      return "low";
+    case Priority::HIGH:
+      return "high";
+    default:
+      return "normal";
+    }
+  }
+
+  inline std::optional<Priority> parse_priority(std::string_view name)
+  {
+    if (name == "low") {
+      return Priority::LOW;
+    }
+    if (name == "normal") {
+      return Priority::NORMAL;
+    }
+    if (name == "high") {
+      return Priority::HIGH;
+    }
+    return std::nullopt;
+  }
+
   template <typename Data, template <class> typename CRTPMessageType>
   struct Message {
 
@@ -350,6 +390,11 @@ namespace praas::common::message {
     using Parent::data;
     using Parent::data_buffer;
 
+    static constexpr int DEADLINE_OFFSET =
+        4 + MessageConfig::NAME_LENGTH + MessageConfig::ID_LENGTH;
+    static constexpr int PRIORITY_OFFSET = DEADLINE_OFFSET + 4;
+    static constexpr int TIMEOUT_OFFSET = PRIORITY_OFFSET + 4;
+
     size_t fname_len;
     size_t invocation_id_len;
 
@@ -425,6 +470,52 @@ namespace praas::common::message {
       *reinterpret_cast<int32_t*>(data()) = size;
     }
 
+    int32_t deadline_ms() const
+    {
+      // NOLINTNEXTLINE
+      return *reinterpret_cast<const int32_t*>(data() + DEADLINE_OFFSET);
+    }
+
+    void deadline_ms(int32_t deadline)
+    {
+      if (deadline < 0) {
+        throw common::InvalidArgument{fmt::format("Negative deadline: {}", deadline)};
+      }
+
+      // NOLINTNEXTLINE
+      *reinterpret_cast<int32_t*>(data() + DEADLINE_OFFSET) = deadline;
+    }
+
+    Priority priority() const
+    {
+      auto val = static_cast<Priority>(data()[PRIORITY_OFFSET]);
+      if (val != Priority::LOW && val != Priority::HIGH) {
+        return Priority::NORMAL;
+      }
+      return val;
+    }
+
+    void priority(Priority val)
+    {
+      data()[PRIORITY_OFFSET] = static_cast<int8_t>(val);
+    }
+
+    int32_t timeout_ms() const
+    {
+      // NOLINTNEXTLINE
+      return *reinterpret_cast<const int32_t*>(data() + TIMEOUT_OFFSET);
+    }
+
+    void timeout_ms(int32_t timeout)
+    {
+      if (timeout < 0) {
+        throw common::InvalidArgument{fmt::format("Negative timeout: {}", timeout)};
+      }
+
+      // NOLINTNEXTLINE
+      *reinterpret_cast<int32_t*>(data() + TIMEOUT_OFFSET) = timeout;
+    }
+
     static MessageType type()
     {
       return MessageType::INVOCATION_REQUEST;
@@ -438,6 +529,10 @@ namespace praas::common::message {
     using Parent::data;
     using Parent::data_buffer;
 
+    // Admission control of the process rejected the invocation before queueing it -
+    // the payload holds the reason, and the invocation can be retried on another process.
+    static constexpr int32_t OVERLOADED = -2;
+
     size_t invocation_id_len;
 
     InvocationResult(Data&& data = Data())
@@ -742,6 +837,50 @@ namespace praas::common::message {
     }
   };
 
+  template <typename Data>
+  struct InvocationCancel : Message<Data, InvocationCancel> {
+
+    using Parent = Message<Data, InvocationCancel>;
+    using Parent::data;
+
+    size_t invocation_id_len;
+
+    InvocationCancel(Data&& data = Data())
+        // NOLINTNEXTLINE
+        : Parent(std::forward<Data>(data), MessageType::INVOCATION_CANCEL),
+          invocation_id_len(
+              // NOLINTNEXTLINE
+              strnlen(reinterpret_cast<const char*>(this->data()), MessageConfig::ID_LENGTH)
+          )
+    {
+    }
+
+    void invocation_id(std::string_view name)
+    {
+      if (name.length() > MessageConfig::ID_LENGTH) {
+        throw common::InvalidArgument{fmt::format(
+            "Invocation ID too long: {} > {}", name.length(), MessageConfig::ID_LENGTH
+        )};
+      }
+      std::strncpy(
+          // NOLINTNEXTLINE
+          reinterpret_cast<char*>(data()), name.data(), MessageConfig::ID_LENGTH
+      );
+      invocation_id_len = name.length();
+    }
+
+    std::string_view invocation_id() const
+    {
+      return std::string_view{// NOLINTNEXTLINE
+                              reinterpret_cast<const char*>(data()), invocation_id_len};
+    }
+
+    static MessageType type()
+    {
+      return MessageType::INVOCATION_CANCEL;
+    }
+  };
+
   using ProcessConnectionData = ProcessConnection<MessageData>;
   using SwapRequestData = SwapRequest<MessageData>;
   using SwapConfirmationData = SwapConfirmation<MessageData>;
@@ -751,6 +890,7 @@ namespace praas::common::message {
   using ProcessClosureData = ProcessClosure<MessageData>;
   using ApplicationUpdateData = ApplicationUpdate<MessageData>;
   using PutMessageData = PutMessage<MessageData>;
+  using InvocationCancelData = InvocationCancel<MessageData>;
   using ProcessConnectionPtr = ProcessConnection<MessagePtr>;
   using SwapRequestPtr = SwapRequest<MessagePtr>;
   using SwapConfirmationPtr = SwapConfirmation<MessagePtr>;
@@ -760,11 +900,12 @@ namespace praas::common::message {
   using ProcessClosurePtr = ProcessClosure<MessagePtr>;
   using ApplicationUpdatePtr = ApplicationUpdate<MessagePtr>;
   using PutMessagePtr = PutMessage<MessagePtr>;
+  using InvocationCancelPtr = InvocationCancel<MessagePtr>;
 
   using MessageVariants = std::variant<
       std::monostate, ProcessConnectionPtr, SwapRequestPtr, SwapConfirmationPtr,
       InvocationRequestPtr, InvocationResultPtr, DataPlaneMetricsPtr, ProcessClosurePtr,
-      ApplicationUpdatePtr, PutMessagePtr>;
+      ApplicationUpdatePtr, PutMessagePtr, InvocationCancelPtr>;
 
   struct MessageParser {
 
@@ -818,6 +959,10 @@ namespace praas::common::message {
         return MessageVariants{PutMessagePtr(std::move(data))};
       }
 
+      if (type == MessageType::INVOCATION_CANCEL) {
+        return MessageVariants{InvocationCancelPtr(std::move(data))};
+      }
+
       throw common::NotImplementedError{};
     }
   };
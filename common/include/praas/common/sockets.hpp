@@ -1,10 +1,29 @@
 #ifndef PRAAS_COMMON_SOCKETS_HPP
 #define PRAAS_COMMON_SOCKETS_HPP
 
+#include <cstddef>
+
+namespace trantor {
+  class TcpConnection;
+} // namespace trantor
+
 namespace praas::common::sockets {
 
   void disable_nagle(int fd);
 
+  // Sends the message header and its payload as a single write.
+  // With Nagle disabled, small messages then leave in one packet instead of two.
+  void send_message(
+      trantor::TcpConnection& conn, const void* header, size_t header_len, const void* payload,
+      size_t payload_len
+  );
+
+  // Blocking variant for raw sockets - one writev, repeated only after a partial write.
+  // Returns false when the socket failed.
+  bool write_message(
+      int fd, const void* header, size_t header_len, const void* payload, size_t payload_len
+  );
+
 } // namespace praas::common::sockets
 
 #endif
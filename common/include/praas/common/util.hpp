@@ -81,6 +81,30 @@ namespace praas::common::util {
     }
   }
 
+  // Scalar values have no set_defaults - the default is provided by the caller.
+  template <typename T>
+  void cereal_load_optional(
+      cereal::JSONInputArchive& archive, const std::string& name, T& value, const T& default_value
+  )
+  {
+    try {
+      archive(cereal::make_nvp(name, value));
+    } catch (cereal::Exception& exc) {
+
+      if (std::string_view{exc.what()}.find(fmt::format("({}) not found", name)) !=
+          std::string::npos) {
+
+        archive.setNextName(nullptr);
+        value = default_value;
+
+      } else {
+        throw common::InvalidConfigurationError(
+            "Could not parse configuration, reason: " + std::string{exc.what()}
+        );
+      }
+    }
+  }
+
 } // namespace praas::common::util
 
 #endif
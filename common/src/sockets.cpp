@@ -2,8 +2,14 @@
 #include <praas/common/sockets.hpp>
 #include <praas/common/util.hpp>
 
+#include <cerrno>
+
+#include <trantor/net/TcpConnection.h>
+#include <trantor/utils/MsgBuffer.h>
+
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <sys/uio.h>
 
 namespace praas::common::sockets {
 
@@ -15,4 +21,59 @@ namespace praas::common::sockets {
     util::assert_true(result >= 0);
   }
 
+  void send_message(
+      trantor::TcpConnection& conn, const void* header, size_t header_len, const void* payload,
+      size_t payload_len
+  )
+  {
+    if (payload_len == 0) {
+      conn.send(header, header_len);
+      return;
+    }
+
+    // trantor has no vectored send - it writes every send() separately.
+    // We build one buffer, which trantor moves into its output queue if the socket is busy.
+    trantor::MsgBuffer buffer{header_len + payload_len};
+    buffer.append(static_cast<const char*>(header), header_len);
+    buffer.append(static_cast<const char*>(payload), payload_len);
+
+    conn.send(std::move(buffer));
+  }
+
+  bool write_message(
+      int fd, const void* header, size_t header_len, const void* payload, size_t payload_len
+  )
+  {
+    // NOLINTNEXTLINE
+    iovec vecs[2] = {
+        {const_cast<void*>(header), header_len}, {const_cast<void*>(payload), payload_len}};
+    iovec* vec = vecs;
+    int count = payload_len > 0 ? 2 : 1;
+
+    while (count > 0) {
+
+      ssize_t written = writev(fd, vec, count);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+
+      // Skip the buffers that were sent in full, and move into the partially written one.
+      auto bytes = static_cast<size_t>(written);
+      while (count > 0 && bytes >= vec->iov_len) {
+        bytes -= vec->iov_len;
+        ++vec;
+        --count;
+      }
+      if (count > 0) {
+        vec->iov_base = static_cast<char*>(vec->iov_base) + bytes;
+        vec->iov_len -= bytes;
+      }
+    }
+
+    return true;
+  }
+
 }
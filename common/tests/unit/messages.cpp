@@ -157,6 +157,55 @@ TEST(Messages, InvocationRequestMsg)
   }
 }
 
+TEST(Messages, InvocationRequestMsgScheduling)
+{
+  {
+    InvocationRequestData req;
+    req.invocation_id("invoc-id-42");
+
+    EXPECT_EQ(req.priority(), Priority::NORMAL);
+    EXPECT_EQ(req.deadline_ms(), 0);
+    EXPECT_EQ(req.timeout_ms(), 0);
+  }
+
+  {
+    std::string invoc_id(MessageConfig::ID_LENGTH, 't');
+    std::string fname(MessageConfig::NAME_LENGTH, 'a');
+
+    InvocationRequestData req;
+    req.invocation_id(invoc_id);
+    req.function_name(fname);
+    req.payload_size(32);
+    req.priority(Priority::HIGH);
+    req.deadline_ms(250);
+    req.timeout_ms(1000);
+
+    EXPECT_EQ(req.invocation_id(), invoc_id);
+    EXPECT_EQ(req.function_name(), fname);
+    EXPECT_EQ(req.payload_size(), 32);
+    EXPECT_EQ(req.priority(), Priority::HIGH);
+    EXPECT_EQ(req.deadline_ms(), 250);
+    EXPECT_EQ(req.timeout_ms(), 1000);
+
+    auto parsed = MessageParser::parse(req.to_ptr());
+    ASSERT_TRUE(std::holds_alternative<InvocationRequestPtr>(parsed));
+    auto& parsed_req = std::get<InvocationRequestPtr>(parsed);
+    EXPECT_EQ(parsed_req.priority(), Priority::HIGH);
+    EXPECT_EQ(parsed_req.deadline_ms(), 250);
+    EXPECT_EQ(parsed_req.timeout_ms(), 1000);
+  }
+
+  {
+    InvocationRequestData req;
+    EXPECT_THROW(req.deadline_ms(-1), praas::common::InvalidArgument);
+    EXPECT_THROW(req.timeout_ms(-1), praas::common::InvalidArgument);
+  }
+
+  EXPECT_EQ(parse_priority("low"), Priority::LOW);
+  EXPECT_EQ(parse_priority(priority_name(Priority::HIGH)), Priority::HIGH);
+  EXPECT_FALSE(parse_priority("urgent").has_value());
+}
+
 TEST(Messages, InvocationRequestMsgIncorrect)
 {
   {
@@ -411,3 +460,24 @@ TEST(Messages, PutRequestMsgParse)
       parsed
   ));
 }
+
+TEST(Messages, InvocationCancelMsg)
+{
+  std::string invoc_id(MessageConfig::ID_LENGTH, 't');
+
+  InvocationCancelData req;
+  req.invocation_id(invoc_id);
+
+  EXPECT_EQ(req.invocation_id(), invoc_id);
+  EXPECT_EQ(req.type(), MessageType::INVOCATION_CANCEL);
+
+  InvocationCancelData incorrect;
+  EXPECT_THROW(
+      incorrect.invocation_id(std::string(MessageConfig::ID_LENGTH + 1, 't')),
+      praas::common::InvalidArgument
+  );
+
+  auto parsed = MessageParser::parse(req.to_ptr());
+  ASSERT_TRUE(std::holds_alternative<InvocationCancelPtr>(parsed));
+  EXPECT_EQ(std::get<InvocationCancelPtr>(parsed).invocation_id(), invoc_id);
+}
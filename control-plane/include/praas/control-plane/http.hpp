@@ -62,6 +62,8 @@ namespace praas::control_plane {
         const std::string& process_name
     );
 
+    // Optional parameters: "priority" (low, normal, high), "deadline" in milliseconds,
+    // and "timeout" in milliseconds - a running invocation is aborted after it.
     void invoke(
         const drogon::HttpRequestPtr&,
         std::function<void(const drogon::HttpResponsePtr&)>&& callback, const std::string& app_name,
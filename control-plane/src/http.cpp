@@ -3,11 +3,13 @@
 #include <praas/control-plane/config.hpp>
 #include <praas/control-plane/http.hpp>
 
+#include <praas/common/messages.hpp>
 #include <praas/common/util.hpp>
 #include <praas/control-plane/process.hpp>
 #include <praas/control-plane/resources.hpp>
 #include <praas/control-plane/worker.hpp>
 
+#include <charconv>
 #include <chrono>
 #include <drogon/HttpAppFramework.h>
 #include <drogon/HttpTypes.h>
@@ -132,6 +134,32 @@ namespace praas::control_plane {
       const std::string& function_name
   )
   {
+    std::string priority = request->getParameter("priority");
+    if (!priority.empty() && !common::message::parse_priority(priority).has_value()) {
+      callback(failed_response(
+          fmt::format("Unknown priority {}", priority), drogon::HttpStatusCode::k400BadRequest
+      ));
+      return;
+    }
+
+    // Both are milliseconds.
+    for (const char* param : {"deadline", "timeout"}) {
+
+      std::string value = request->getParameter(param);
+      if (value.empty()) {
+        continue;
+      }
+
+      int32_t value_ms = 0;
+      auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), value_ms);
+      if (ec != std::errc{} || ptr != value.data() + value.size() || value_ms < 0) {
+        callback(failed_response(
+            fmt::format("Incorrect {} {}", param, value), drogon::HttpStatusCode::k400BadRequest
+        ));
+        return;
+      }
+    }
+
     _logger->info("Push new invocation request of {}", function_name);
     auto start = std::chrono::high_resolution_clock::now();
     _workers.add_task(
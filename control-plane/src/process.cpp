@@ -3,6 +3,7 @@
 
 #include <praas/common/exceptions.hpp>
 #include <praas/common/messages.hpp>
+#include <praas/common/sockets.hpp>
 #include <praas/common/uuid.hpp>
 
 #include <chrono>
@@ -166,10 +167,25 @@ namespace praas::control_plane::process {
     req.payload_size(payload.length());
     req.total_length(payload.length());
 
+    // Scheduling parameters were validated by the HTTP server.
+    auto priority = common::message::parse_priority(invoc.request->getParameter("priority"));
+    if (priority.has_value()) {
+      req.priority(priority.value());
+    }
+    std::string deadline = invoc.request->getParameter("deadline");
+    if (!deadline.empty()) {
+      req.deadline_ms(std::stoi(deadline));
+    }
+    std::string timeout = invoc.request->getParameter("timeout");
+    if (!timeout.empty()) {
+      req.timeout_ms(std::stoi(timeout));
+    }
+
     spdlog::info("Submitting invocation {} to {}", req.invocation_id(), name());
 
-    _connection->send(req.bytes(), req.BUF_SIZE);
-    _connection->send(payload.data(), payload.length());
+    common::sockets::send_message(
+        *_connection, req.bytes(), req.BUF_SIZE, payload.data(), payload.length()
+    );
 
     invoc.submitted = true;
   }
@@ -211,7 +227,12 @@ namespace praas::control_plane::process {
       json["return_code"] = return_code;
       json["result"] = std::string{buf, len};
       auto resp = drogon::HttpResponse::newHttpJsonResponse(json);
-      resp->setStatusCode(drogon::k200OK);
+      // The process rejected the invocation - the client should retry later.
+      if (return_code == common::message::InvocationResultData::OVERLOADED) {
+        resp->setStatusCode(drogon::k503ServiceUnavailable);
+      } else {
+        resp->setStatusCode(drogon::k200OK);
+      }
 
       (*iter).callback(resp);
 
@@ -3,6 +3,7 @@
 
 #include <praas/process/runtime/internal/functions.hpp>
 #include <praas/process/runtime/internal/ipc/ipc.hpp>
+#include <praas/process/runtime/internal/placement.hpp>
 
 #include <istream>
 #include <optional>
@@ -32,15 +33,121 @@ namespace praas::process::config {
     void load_env();
   };
 
+  // Busy-polling before blocking - trades CPU time for the latency of a wakeup.
+  // Zero disables spinning; the controller and workers are configured separately,
+  // because a worker spinning for too long steals the core from other workers.
+  struct Polling {
+
+    static constexpr int DEFAULT_CONTROLLER_SPIN_US = 0;
+    static constexpr int DEFAULT_WORKER_SPIN_US = 0;
+
+    int controller_spin_us;
+    int worker_spin_us;
+
+    void load(cereal::JSONInputArchive& archive);
+    void set_defaults();
+  };
+
+  // Elastic pool of function workers. Disabled when max_workers is zero - the pool
+  // has then exactly function_workers workers.
+  // The pool grows when the backlog of ready invocations reaches scale_up_backlog,
+  // or when invocations keep waiting for a worker longer than scale_up_delay_ms.
+  // Workers idle for longer than idle_timeout_ms are stopped, down to min_workers.
+  struct Scaling {
+
+    static constexpr int DEFAULT_SCALE_UP_BACKLOG = 4;
+    static constexpr int DEFAULT_SCALE_UP_DELAY_MS = 10;
+    static constexpr int DEFAULT_IDLE_TIMEOUT_MS = 10000;
+
+    int min_workers;
+    int max_workers;
+    int scale_up_backlog;
+    int scale_up_delay_ms;
+    int idle_timeout_ms;
+
+    bool enabled() const
+    {
+      return max_workers > 0;
+    }
+
+    void load(cereal::JSONInputArchive& archive);
+    void set_defaults();
+  };
+
+  // Selection of an idle worker for the next invocation.
+  // ANY takes the most recently idle worker, preferring workers without busy slots.
+  // AFFINITY prefers an idle worker that last ran the same function; when all such workers
+  // are busy, the invocation waits for one of them for at most affinity_wait_us, and then
+  // takes any idle worker.
+  // Invocations of a lower priority class move one class up after waiting for aging_us.
+  struct Dispatch {
+
+    enum class Policy { ANY, AFFINITY };
+
+    static constexpr int DEFAULT_AFFINITY_WAIT_US = 0;
+    static constexpr int DEFAULT_AGING_US = 100000;
+
+    Policy policy;
+    int affinity_wait_us;
+    int aging_us;
+
+    void load(cereal::JSONInputArchive& archive);
+    void set_defaults();
+  };
+
+  // Limits of work accepted by the process - new invocations beyond them are rejected at once
+  // with the OVERLOADED return code, instead of queueing without bound. Zero disables a limit.
+  // Queued invocations have not been dispatched to a worker yet. Queued bytes are payloads
+  // held by the work queue and messages stored in the mailbox. The wait of a new invocation
+  // is estimated from the queued invocations, the workers, and the average execution time.
+  struct Admission {
+
+    int max_queued_invocations;
+    size_t max_queued_bytes;
+    int max_wait_ms;
+
+    void load(cereal::JSONInputArchive& archive);
+    void set_defaults();
+  };
+
+  // CPUs of the controller thread, the IO loops of the TCP server, and the function workers.
+  // Empty sets leave the threads to the kernel. The controller runs on any CPU of its set,
+  // while each IO loop and each worker is pinned to one CPU of its set, spreading them evenly.
+  // With local_memory, pinned threads and all workers allocate memory on their NUMA node.
+  struct Placement {
+
+    runtime::internal::CPUSet controller_cpus;
+    runtime::internal::CPUSet io_cpus;
+    runtime::internal::CPUSet worker_cpus;
+    bool local_memory;
+
+    void load(cereal::JSONInputArchive& archive);
+    void set_defaults();
+  };
+
   struct Controller {
 
     static constexpr int DEFAULT_PORT = 8080;
     static constexpr int DEFAULT_FUNCTION_WORKERS = 1;
     static constexpr int DEFAULT_MSG_SIZE = 8 * 1024;
+    static constexpr int DEFAULT_IO_THREADS = 1;
+    static constexpr int DEFAULT_THREAD_WORKERS = 1;
+    static constexpr int DEFAULT_INVOKER_THREADS = 1;
 
     int port;
     bool verbose;
     int function_workers;
+    // Event loops of the TCP server - connections of clients and peers are spread across them.
+    int io_threads;
+    // Workers are forked from one invoker that loaded all functions, instead of starting
+    // each of them from scratch. Not supported with the shared-memory IPC mode.
+    bool zygote;
+    // Threads of the controller executing functions with the thread execution mode.
+    // They are started only when such functions exist, and are not scaled.
+    int thread_workers;
+    // Invocations executed concurrently by each worker process, on threads sharing the loaded
+    // functions - only the C++ invoker supports more than one.
+    int invoker_threads;
     runtime::internal::ipc::IPCMode ipc_mode;
     int ipc_message_size;
     std::string ipc_name_prefix;
@@ -52,6 +159,16 @@ namespace praas::process::config {
 
     Code code;
 
+    Polling polling;
+
+    Scaling scaling;
+
+    Dispatch dispatch;
+
+    Admission admission;
+
+    Placement placement;
+
     void load(cereal::JSONInputArchive& archive);
     void load_env();
     void set_defaults();
@@ -5,15 +5,20 @@
 #include <praas/common/messages.hpp>
 #include <praas/process/controller/config.hpp>
 #include <praas/process/controller/messages.hpp>
+#include <praas/process/controller/mpsc_queue.hpp>
 #include <praas/process/controller/remote.hpp>
 #include <praas/process/controller/workers.hpp>
 #include <praas/process/runtime/internal/ipc/ipc.hpp>
 
+#include <chrono>
 #include <memory>
+#include <optional>
 #include <spdlog/spdlog.h>
 #include <string>
 #include <variant>
 
+struct epoll_event;
+
 namespace praas::process::remote {
 
   struct Server;
@@ -105,12 +110,59 @@ namespace praas::process {
         runtime::internal::BufferAccessor<const char> payload
     );
 
+    // Sends the result to all callers of the invocation.
+    void _process_invocation_result(
+        const Invocation& invocation, int return_code,
+        runtime::internal::BufferAccessor<const char> payload
+    );
+
+    // Output of a pipeline stage is queued as the input of the next one.
+    void _process_pipeline_stage(
+        Invocation& invocation, runtime::internal::BufferAccessor<const char> output
+    );
+
+    // Results of a batch are processed as separate invocations.
+    void _process_batch_result(
+        FunctionWorker& worker, int invocations, const runtime::internal::Buffer<char>& payload
+    );
+
+    // Pending invocations fail at once, running ones once their worker is replaced.
+    void _cancel_invocation(const std::string& invocation_id);
+
+    // Replaces workers stuck in cancelled or timed out invocations, and fails the invocations.
+    void _replace_stuck_workers();
+
+    // Returns the reason when the work queue cannot accept the payload of this invocation.
+    std::optional<std::string> _admit(const std::string& invocation_id, size_t bytes) const;
+
     // Retrieve the pending invocation object.
     // Forward the response to the owner.
     void _process_result(runtime::internal::Buffer<char>&&);
     void
     _process_result(const runtime::internal::ipc::Message& msg, runtime::internal::Buffer<char>&&);
 
+    void _register_worker(FunctionWorker& worker);
+    void _unregister_worker(FunctionWorker& worker);
+
+    // New workers do not know which processes of the application exist.
+    void _send_application_status(FunctionWorker& worker);
+
+    // Submit ready invocations to idle workers.
+    void _dispatch();
+
+    // Grows the pool when invocations wait for workers, and stops idle workers.
+    // Returns true if new workers were added.
+    bool _scale_workers();
+
+    // Poll for space in the message queue of a worker that did not accept all messages.
+    void _update_pending_send(FunctionWorker& worker);
+
+    // Wakes up the controller, unless a wakeup is already pending.
+    void _notify();
+
+    // Busy-polls for the configured time before blocking in epoll.
+    int _wait_events(epoll_event* events, int max_events);
+
     int _epoll_fd;
 
     int _event_fd;
@@ -120,7 +172,7 @@ namespace praas::process {
     static constexpr int DEFAULT_BUFFER_MESSAGES = 20;
     static constexpr int DEFAULT_BUFFER_SIZE = 5 * 1024 * 1024;
 
-    runtime::internal::BufferQueue<char> _buffers;
+    runtime::internal::BufferPool<char> _buffers;
 
     // Function triggers
     runtime::internal::Functions _functions;
@@ -128,17 +180,20 @@ namespace praas::process {
     // Function workers (IPC) - seperate processes.
     Workers _workers;
 
-    // Queue storing external data provided by the TCP server
-    std::deque<ExternalMessage> _external_queue;
-    std::mutex _deque_lock;
-    // No deque in tbb
-    // https://community.intel.com/t5/Intel-oneAPI-Threading-Building/Is-there-a-concurrent-dequeue/m-p/873829
-    // oneapi::tbb::concurrent_queue<ExternalMessage> _external_queue;
+    // Messages and application updates provided by the TCP server threads.
+    static constexpr size_t EXTERNAL_QUEUE_SIZE = 4096;
+    static constexpr size_t APP_UPDATES_QUEUE_SIZE = 256;
+    // Messages processed per wakeup, before we return to the workers.
+    static constexpr size_t MAX_EXTERNAL_BATCH = 256;
+
+    MPSCQueue<ExternalMessage> _external_queue{EXTERNAL_QUEUE_SIZE};
+    MPSCQueue<common::ApplicationUpdate> _app_updates{APP_UPDATES_QUEUE_SIZE};
+
+    // Set when the eventfd has been signaled, and the queues were not drained yet.
+    std::atomic<bool> _notified{};
 
     // Current world
-    std::mutex _app_lock;
     common::Application _application;
-    std::deque<common::ApplicationUpdate> _app_updates;
 
     // Queue storing pending invocations
     WorkQueue _work_queue;
@@ -158,6 +213,18 @@ namespace praas::process {
     static constexpr int MAX_EPOLL_EVENTS = 32;
     static constexpr int EPOLL_TIMEOUT = 1000;
 
+    std::chrono::microseconds _spin_time;
+
+    config::Scaling _scaling;
+
+    config::Placement _placement;
+
+    // Longest wait of an invocation for a worker that recently ran its function.
+    std::chrono::microseconds _affinity_wait;
+
+    // Since when invocations wait for a worker, or since the last scale-up.
+    std::optional<std::chrono::steady_clock::time_point> _backlog_since;
+
     static constexpr std::string_view SELF_PROCESS = "SELF";
   };
 
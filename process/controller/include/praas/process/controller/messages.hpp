@@ -26,7 +26,7 @@ namespace praas::process::message {
 
     std::optional<std::string> source{};
 
-    const FunctionWorker* worker{};
+    FunctionWorker* worker{};
   };
 
   /**
@@ -47,10 +47,13 @@ namespace praas::process::message {
 
     void insert_invocation(std::string_view key, FunctionWorker& worker);
 
-    const FunctionWorker* find_get(const std::string& key, std::string_view source);
+    FunctionWorker* find_get(const std::string& key, std::string_view source);
 
     // FIXME: inlined vector?
-    void find_invocation(std::string_view key, std::vector<const FunctionWorker*>& output);
+    void find_invocation(std::string_view key, std::vector<FunctionWorker*>& output);
+
+    // Drops all messages that a removed worker waits for.
+    void remove_worker(const FunctionWorker& worker);
 
   private:
     using key_t = std::tuple<std::string, std::string>;
@@ -95,9 +98,17 @@ namespace praas::process::message {
 
     const std::vector<std::tuple<std::string, double>>& state_keys() const;
 
+    // Payload of all stored messages and state.
+    size_t bytes() const
+    {
+      return _bytes;
+    }
+
   private:
     std::unordered_map<std::string, Message> _msgs;
 
+    size_t _bytes{};
+
     std::vector<std::tuple<std::string, double>> _state_keys;
 
     static constexpr std::string_view ANY_PROCESS = "ANY";
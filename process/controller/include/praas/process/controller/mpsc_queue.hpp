@@ -0,0 +1,173 @@
+#ifndef PRAAS_PROCESS_CONTROLLER_MPSC_QUEUE_HPP
+#define PRAAS_PROCESS_CONTROLLER_MPSC_QUEUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace praas::process {
+
+  /**
+   * Bounded, lock-free queue with many producers and a single consumer.
+   *
+   * Each cell has a sequence number telling whether it is free for the producer
+   * at a given position, or holds a value for the consumer (D. Vyukov's bounded queue).
+   * Producers only contend on the tail index; the consumer never writes it.
+   *
+   * The capacity is rounded up to a power of two.
+   *
+   * Producers that cannot wait for space use try_push. Blocking producers spin
+   * for a short time, and then sleep until the consumer calls wake_producers
+   * after draining.
+   */
+  template <typename T>
+  struct MPSCQueue {
+
+    explicit MPSCQueue(size_t capacity)
+        : _capacity(std::bit_ceil(std::max(capacity, size_t{2}))), _mask(_capacity - 1),
+          _cells(new Cell[_capacity])
+    {
+      for (size_t i = 0; i < _capacity; ++i) {
+        _cells[i].sequence.store(i, std::memory_order_relaxed);
+      }
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+    MPSCQueue(MPSCQueue&&) = delete;
+    MPSCQueue& operator=(MPSCQueue&&) = delete;
+    ~MPSCQueue() = default;
+
+    // Safe to call from any thread. Returns false when the queue is full.
+    template <typename... Args>
+    bool try_push(Args&&... args)
+    {
+      size_t pos = _tail.load(std::memory_order_relaxed);
+      Cell* cell = nullptr;
+
+      while (true) {
+
+        cell = &_cells[pos & _mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+        if (diff == 0) {
+          if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            break;
+          }
+        } else if (diff < 0) {
+          // The consumer did not free the cell from the previous round.
+          return false;
+        } else {
+          pos = _tail.load(std::memory_order_relaxed);
+        }
+      }
+
+      cell->value = T{std::forward<Args>(args)...};
+      cell->sequence.store(pos + 1, std::memory_order_release);
+
+      return true;
+    }
+
+    // Safe to call from any thread. Blocks while the queue is full.
+    // Returns false when the queue was closed before the value could be pushed.
+    template <typename... Args>
+    bool push(Args&&... args)
+    {
+      for (int i = 0; i < PUSH_SPINS; ++i) {
+        if (try_push(std::forward<Args>(args)...)) {
+          return true;
+        }
+        std::this_thread::yield();
+      }
+
+      // The arguments are consumed only by a successful push.
+      bool pushed = false;
+      std::unique_lock<std::mutex> guard{_space_lock};
+      _waiting_producers.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      _space.wait(guard, [&]() {
+        pushed = try_push(std::forward<Args>(args)...);
+        return pushed || _closed;
+      });
+      _waiting_producers.fetch_sub(1, std::memory_order_relaxed);
+
+      return pushed;
+    }
+
+    // Only the consumer thread can call it, after popping values.
+    void wake_producers()
+    {
+      // Producers register before checking for space - see the freed cells, or get notified.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (_waiting_producers.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> guard{_space_lock};
+        _space.notify_all();
+      }
+    }
+
+    // Releases blocked producers, and no longer blocks new ones.
+    void close()
+    {
+      std::lock_guard<std::mutex> guard{_space_lock};
+      _closed = true;
+      _space.notify_all();
+    }
+
+    // Only the consumer thread can call it. Returns false when the queue is empty.
+    bool try_pop(T& value)
+    {
+      Cell& cell = _cells[_head & _mask];
+      size_t seq = cell.sequence.load(std::memory_order_acquire);
+
+      if (seq != _head + 1) {
+        return false;
+      }
+
+      value = std::move(cell.value);
+      cell.sequence.store(_head + _capacity, std::memory_order_release);
+      ++_head;
+
+      return true;
+    }
+
+    size_t capacity() const
+    {
+      return _capacity;
+    }
+
+  private:
+    // Keep the indices and cells on separate cache lines.
+    static constexpr size_t CACHE_LINE = 64;
+
+    // Attempts before a full queue blocks the producer.
+    static constexpr int PUSH_SPINS = 64;
+
+    struct Cell {
+      std::atomic<size_t> sequence;
+      T value;
+    };
+
+    const size_t _capacity;
+    const size_t _mask;
+    std::unique_ptr<Cell[]> _cells;
+
+    alignas(CACHE_LINE) std::atomic<size_t> _tail{};
+    alignas(CACHE_LINE) size_t _head{};
+
+    alignas(CACHE_LINE) std::atomic<int> _waiting_producers{};
+    std::mutex _space_lock;
+    std::condition_variable _space;
+    bool _closed{};
+  };
+
+} // namespace praas::process
+
+#endif
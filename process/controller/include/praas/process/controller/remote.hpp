@@ -5,9 +5,12 @@
 #include <praas/process/controller/config.hpp>
 #include <praas/process/runtime/internal/buffer.hpp>
 
+#include <atomic>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <spdlog/logger.h>
 #include <trantor/net/EventLoopThread.h>
@@ -72,6 +75,10 @@ namespace praas::process::remote {
 
     common::message::MessageVariants parsed_msg;
 
+    // Payload of the current message - allocated when the header arrives,
+    // and filled as the data comes in.
+    runtime::internal::Buffer<char> payload;
+
     std::size_t bytes_to_read{};
 
     std::shared_ptr<trantor::TcpClient> client{};
@@ -95,6 +102,12 @@ namespace praas::process::remote {
       return _server.address().toPort();
     }
 
+    // Payloads are returned to the pool by the controller once processed.
+    runtime::internal::BufferPoolStats buffer_stats() const
+    {
+      return _buffers.stats();
+    }
+
     void invocation_result(
         RemoteType source, std::optional<std::string_view> remote_process,
         std::string_view invocation_id, int return_code,
@@ -116,6 +129,12 @@ namespace praas::process::remote {
     void poll(std::optional<std::string> control_plane_address = std::nullopt);
 
   private:
+    // Outgoing connections are spread across the same loops as accepted ones.
+    trantor::EventLoop* _next_io_loop();
+
+    // Loops run in threads started by the server - they are pinned once running.
+    void _pin_io_loops();
+
     void _connect(Connection* conn);
 
     bool _handle_connection(
@@ -139,6 +158,17 @@ namespace praas::process::remote {
         Connection& connection, common::message::PutMessagePtr msg, trantor::MsgBuffer* buffer
     );
 
+    bool _handle_invocation_cancel(
+        Connection& connection, common::message::InvocationCancelPtr msg,
+        trantor::MsgBuffer* buffer
+    );
+
+    // Passes the current message of the connection to the controller, tagged with its source.
+    void _forward(Connection& connection, runtime::internal::Buffer<char>&& payload);
+
+    // Returns true when the entire payload of the current message has been received.
+    bool _receive_payload(Connection& connection, size_t payload_size, trantor::MsgBuffer* buffer);
+
     void
     _handle_message(const trantor::TcpConnectionPtr& connectionPtr, trantor::MsgBuffer* buffer);
 
@@ -155,9 +185,16 @@ namespace praas::process::remote {
     // TCP server instance
     trantor::TcpServer _server;
 
-    runtime::internal::BufferQueue<char> _buffers;
+    // Loops handling connections - the main loop only accepts them.
+    std::vector<trantor::EventLoop*> _io_loops;
+    std::atomic<size_t> _io_loop_counter{};
+
+    runtime::internal::CPUSet _io_cpus;
+    bool _local_memory;
+
+    runtime::internal::BufferPool<char> _buffers;
 
-    // lock
+    // Connections are registered and used from all IO loops and the controller.
     std::mutex _conn_mutex;
     std::unordered_map<std::string, std::shared_ptr<Connection>> _connection_data;
     std::shared_ptr<Connection> _data_plane;
@@ -1,16 +1,31 @@
 #ifndef PRAAS_PROCESS_CONTROLLER_WORKERS_HPP
 #define PRAAS_PROCESS_CONTROLLER_WORKERS_HPP
 
+#include <praas/common/messages.hpp>
 #include <praas/process/controller/config.hpp>
 #include <praas/process/controller/remote.hpp>
 #include <praas/process/runtime/internal/buffer.hpp>
 #include <praas/process/runtime/internal/functions.hpp>
+#include <praas/process/runtime/internal/invoker.hpp>
 #include <praas/process/runtime/internal/ipc/ipc.hpp>
+#include <praas/process/runtime/internal/library.hpp>
+#include <praas/process/runtime/internal/placement.hpp>
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <deque>
+#include <limits>
+#include <list>
 #include <memory>
 #include <optional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <cereal/external/rapidjson/rapidjson.h>
 
@@ -23,9 +38,10 @@ namespace praas::process {
       return {remote::RemoteType::PROCESS, remote_process};
     }
 
-    static InvocationSource from_local()
+    // The function is the caller running in this process, if known.
+    static InvocationSource from_local(std::optional<std::string> function = std::nullopt)
     {
-      return {remote::RemoteType::LOCAL_FUNCTION, std::nullopt};
+      return {remote::RemoteType::LOCAL_FUNCTION, std::nullopt, std::move(function)};
     }
 
     static InvocationSource from_dataplane()
@@ -54,17 +70,219 @@ namespace praas::process {
       return !is_remote();
     }
 
+    // Name matched against the sources of a multi-source trigger:
+    // the calling process or the calling local function.
+    std::optional<std::string_view> name() const
+    {
+      if (source == remote::RemoteType::PROCESS) {
+        return remote_process;
+      }
+      if (source == remote::RemoteType::LOCAL_FUNCTION) {
+        return local_function;
+      }
+      return std::nullopt;
+    }
+
     remote::RemoteType source;
     std::optional<std::string> remote_process;
+    std::optional<std::string> local_function{};
+  };
+
+  // Scheduling class, deadline and timeout requested by the caller of an invocation.
+  struct InvocationScheduling {
+    common::message::Priority priority{common::message::Priority::NORMAL};
+    std::optional<std::chrono::steady_clock::time_point> deadline{};
+    // Zero uses the timeout of the function.
+    std::chrono::milliseconds timeout{};
+  };
+
+  // FIFO of objects linked through their own member - push and pop never allocate.
+  template <typename T, T* T::*Next>
+  struct IntrusiveQueue {
+
+    void push(T* ptr)
+    {
+      ptr->*Next = nullptr;
+      if (_tail) {
+        _tail->*Next = ptr;
+      } else {
+        _head = ptr;
+      }
+      _tail = ptr;
+      ++_size;
+    }
+
+    // Returns an object to the head, e.g., when it could not be used yet.
+    void push_front(T* ptr)
+    {
+      ptr->*Next = _head;
+      _head = ptr;
+      if (!_tail) {
+        _tail = ptr;
+      }
+      ++_size;
+    }
+
+    T* pop()
+    {
+      T* ptr = _head;
+      if (ptr) {
+        _head = ptr->*Next;
+        if (!_head) {
+          _tail = nullptr;
+        }
+        ptr->*Next = nullptr;
+        --_size;
+      }
+      return ptr;
+    }
+
+    // Unlinks an object from any position - linear in the queue length.
+    bool remove(T* ptr)
+    {
+      T* prev = nullptr;
+      for (T* cur = _head; cur; prev = cur, cur = cur->*Next) {
+
+        if (cur != ptr) {
+          continue;
+        }
+
+        if (prev) {
+          prev->*Next = cur->*Next;
+        } else {
+          _head = cur->*Next;
+        }
+        if (_tail == cur) {
+          _tail = prev;
+        }
+        cur->*Next = nullptr;
+        --_size;
+        return true;
+      }
+      return false;
+    }
+
+    T* front() const
+    {
+      return _head;
+    }
+
+    bool empty() const
+    {
+      return _head == nullptr;
+    }
+
+    size_t size() const
+    {
+      return _size;
+    }
+
+  private:
+    T* _head{};
+    T* _tail{};
+    size_t _size{};
+  };
+
+  // Doubly-linked list of objects linked through their own members - objects are unlinked
+  // from any position in constant time.
+  template <typename T, T* T::*Prev, T* T::*Next>
+  struct IntrusiveList {
+
+    void push_back(T* ptr)
+    {
+      ptr->*Prev = _tail;
+      ptr->*Next = nullptr;
+      if (_tail) {
+        _tail->*Next = ptr;
+      } else {
+        _head = ptr;
+      }
+      _tail = ptr;
+      ++_size;
+    }
+
+    void push_front(T* ptr)
+    {
+      ptr->*Prev = nullptr;
+      ptr->*Next = _head;
+      if (_head) {
+        _head->*Prev = ptr;
+      } else {
+        _tail = ptr;
+      }
+      _head = ptr;
+      ++_size;
+    }
+
+    void remove(T* ptr)
+    {
+      if (ptr->*Prev) {
+        (ptr->*Prev)->*Next = ptr->*Next;
+      } else {
+        _head = ptr->*Next;
+      }
+      if (ptr->*Next) {
+        (ptr->*Next)->*Prev = ptr->*Prev;
+      } else {
+        _tail = ptr->*Prev;
+      }
+      ptr->*Prev = nullptr;
+      ptr->*Next = nullptr;
+      --_size;
+    }
+
+    bool contains(const T* ptr) const
+    {
+      return ptr->*Prev != nullptr || _head == ptr;
+    }
+
+    T* front() const
+    {
+      return _head;
+    }
+
+    T* back() const
+    {
+      return _tail;
+    }
+
+    // Neighbours of a linked object - nullptr at the ends of the list.
+    static T* next(const T* ptr)
+    {
+      return ptr->*Next;
+    }
+
+    static T* prev(const T* ptr)
+    {
+      return ptr->*Prev;
+    }
+
+    bool empty() const
+    {
+      return _head == nullptr;
+    }
+
+    size_t size() const
+    {
+      return _size;
+    }
+
+  private:
+    T* _head{};
+    T* _tail{};
+    size_t _size{};
   };
 
+  struct ReadyQueue;
+
   struct Invocation {
 
     Invocation(
         const std::string& fname, const std::string& invocation_key,
-        const runtime::internal::Trigger* trigger, InvocationSource&& source
+        const runtime::internal::Trigger* trigger, InvocationSource&& source,
+        InvocationScheduling scheduling = {}
     )
-        : trigger(trigger), source(source)
+        : trigger(trigger), source(source), scheduling(scheduling)
     {
       req.function_name(fname);
       req.invocation_id(invocation_key);
@@ -106,34 +324,342 @@ namespace praas::process {
     bool active{};
 
     InvocationSource source;
+
+    InvocationScheduling scheduling;
+
+    // Running time after which the worker is replaced - 0 disables it.
+    std::chrono::milliseconds timeout{};
+
+    // Payload received from callers - counted by the admission control.
+    size_t received_bytes{};
+
+    // When the invocation was last taken for a worker.
+    std::chrono::steady_clock::time_point dispatched;
+
+    // Remote callers that sent further payload, e.g., to a multi-source trigger.
+    // They receive the result too; local callers are found through pending invocations.
+    std::vector<InvocationSource> remote_callers;
+
+    // Named sources of a multi-source trigger that already sent their payload.
+    std::vector<bool> received_sources;
+
+    // Waits in the dependency queue of its function.
+    bool waits_for_dependencies{};
+
+    // Ready queue of the function in the current priority class of the invocation
+    // - the invocation is linked there once its trigger fired.
+    ReadyQueue* queue{};
+    bool ready{};
+    Invocation* next_ready{};
+    std::chrono::steady_clock::time_point ready_since;
+    // Since when the invocation waits in its current priority class.
+    std::chrono::steady_clock::time_point class_since;
+
+    // Invocations dispatched together with this one to the same worker.
+    std::vector<Invocation*> batch;
   };
 
+  struct FunctionQueue;
+
+  // Invocations of one function in one priority class that can be dispatched now.
+  struct ReadyQueue {
+    IntrusiveQueue<Invocation, &Invocation::next_ready> invocations;
+
+    FunctionQueue* function{};
+
+    // Index of the priority class - 0 is the highest.
+    size_t priority{};
+
+    // Functions with a batch trigger are scheduled only when the batch can be dispatched.
+    const runtime::internal::BatchTrigger* batch{};
+
+    // Link in the round-robin list of functions with ready invocations.
+    ReadyQueue* next_function{};
+    bool scheduled{};
+  };
+
+  // Ready queues of one function, one for each priority class.
+  struct FunctionQueue {
+    static constexpr size_t PRIORITY_CLASSES = 3;
+
+    std::string_view function;
+
+    std::array<ReadyQueue, PRIORITY_CLASSES> classes;
+
+    // Limits of the function - see runtime::internal::Function.
+    int max_concurrency{};
+    int reserved_workers{};
+
+    // Invocations run on threads of the controller, not in worker processes.
+    bool thread{};
+
+    // Invocations dispatched to workers that did not finish yet.
+    int running{};
+
+    bool at_limit() const
+    {
+      return max_concurrency > 0 && running >= max_concurrency;
+    }
+
+    // Class index of a priority - 0 is the highest.
+    static size_t priority_class(common::message::Priority priority)
+    {
+      return static_cast<size_t>(
+          static_cast<int>(common::message::Priority::HIGH) - static_cast<int>(priority)
+      );
+    }
+
+    // Invocations of the function wait for a worker.
+    bool scheduled() const
+    {
+      return std::any_of(classes.begin(), classes.end(), [](const ReadyQueue& queue) {
+        return queue.scheduled;
+      });
+    }
+  };
+
+  // Outputs of upstream functions, and invocations waiting for them, of a function
+  // with a dependency trigger.
+  struct DependencyQueue {
+    const runtime::internal::DependencyTrigger* trigger{};
+
+    // Outputs of each upstream function, in the order of the trigger. Each holds at most
+    // one output per waiting invocation, and max_outputs of the trigger on top of that.
+    std::vector<std::deque<runtime::internal::Buffer<char>>> outputs;
+
+    // Invocations consume the outputs in the order of arrival.
+    std::deque<Invocation*> waiting;
+  };
+
+  /**
+   * Invocations wait until their trigger fires, and then move to the ready queue
+   * of their function. Functions with ready invocations are served round-robin.
+   *
+   * Each priority class has its own round-robin of functions, and higher classes are served
+   * first. Invocations age instead of starving: the oldest invocation of each function moves
+   * one class up after waiting for the aging period in its class, and to the highest class once
+   * its deadline is less than the aging period away - see age. Only the head of each function's
+   * queue ages, so aging costs one step per function and class, not per invocation. Invocations
+   * with a deadline are also ordered by the time they become urgent, and move to the highest
+   * class from any position in the queue.
+   *
+   * A function with the maximal number of invocations running is not scheduled until one
+   * of them finishes. Workers reserved by functions are not given to other functions -
+   * a function that used its reservation is dispatched only while there are more idle
+   * workers than reservations left unused by others. Running invocations are counted
+   * one by one, also in a batch. Functions executed on threads of the controller do not
+   * use worker processes, and are not limited by reservations.
+   *
+   * Triggers are checked only when an invocation receives new payload, and adding,
+   * dispatching and finishing an invocation never scan other invocations. Only cancelling
+   * a ready invocation scans the queue of its function.
+   *
+   * Callers check admit before adding an invocation - it rejects work beyond the limits
+   * of config::Admission. Continuing accepted work, e.g., with the next pipeline stage,
+   * is never rejected.
+   *
+   * Functions with a batch trigger return up to the batch size of invocations at once,
+   * linked to the first one. They are served when the batch is full, or when its oldest
+   * invocation waited for the maximal time - see schedule_batches.
+   *
+   * Invocations with a dependency trigger wait until the upstream functions and state keys
+   * are produced - see function_produced and state_produced. Outputs of upstream functions
+   * are kept until an invocation of the dependent function consumes them, but outputs not
+   * needed by waiting invocations are bounded by max_outputs of the trigger - the oldest
+   * ones are dropped.
+   */
   struct WorkQueue {
 
-    WorkQueue(runtime::internal::Functions& functions) : _functions(functions) {}
+    static constexpr std::chrono::microseconds DEFAULT_AGING{
+        config::Dispatch::DEFAULT_AGING_US};
+
+    WorkQueue(
+        runtime::internal::Functions& functions, std::chrono::microseconds aging = DEFAULT_AGING,
+        config::Admission admission = {}
+    )
+        : _functions(functions), _aging(aging), _admission(admission)
+    {
+    }
+
+    // Returns the reason when the payload should be rejected. Payload of a pending invocation
+    // is checked only against the byte limit. Stored bytes are held outside of the queue,
+    // e.g., in the mailbox, and the estimated wait depends on the number of workers.
+    std::optional<std::string>
+    admit(const std::string& key, size_t bytes, size_t stored_bytes, size_t workers) const;
 
+    // The scheduling is applied only when the payload creates a new invocation.
     std::optional<std::string> add_payload(
         const std::string& fname, const std::string& key, runtime::internal::Buffer<char>&& buffer,
-        InvocationSource&& source
+        InvocationSource&& source, InvocationScheduling scheduling = {}
+    );
+
+    // Queues the output of a finished pipeline stage as the input of the next stage.
+    // The new invocation keeps the key and the callers of the finished one.
+    std::optional<std::string>
+    add_stage(Invocation& previous, runtime::internal::Buffer<char>&& output);
+
+    // Idle worker processes decide if functions without a free reservation can be dispatched.
+    Invocation* next(size_t idle_workers = std::numeric_limits<size_t>::max());
+
+    // Passes the output of a successful invocation to functions depending on it.
+    void function_produced(
+        const std::string& fname, runtime::internal::BufferAccessor<const char> output
     );
 
-    Invocation* next();
+    // Releases invocations waiting for the state key.
+    void state_produced(const std::string& key);
+
+    // Moves invocations that waited for the aging period, or that approach their deadline,
+    // to a higher priority class.
+    void age(std::chrono::steady_clock::time_point now);
+
+    // Schedules batches whose oldest invocation waited for the maximal time.
+    void schedule_batches(std::chrono::steady_clock::time_point now);
+
+    // When the next incomplete batch should be dispatched.
+    std::optional<std::chrono::steady_clock::time_point> next_batch_deadline() const;
+
+    // When the next invocation in a lower class should move to the highest one.
+    std::optional<std::chrono::steady_clock::time_point> next_urgent_deadline() const;
+
+    // Returns an invocation that could not be dispatched yet to the head of its function's
+    // queue; other functions are served first.
+    void defer(Invocation& invocation);
 
     std::optional<Invocation> finish(const std::string& key);
 
+    // Removes an invocation that was not dispatched yet. Running invocations are not
+    // returned - their workers are stopped instead, see Workers::cancel.
+    std::optional<Invocation> cancel(const std::string& key);
+
     bool empty() const
     {
-      return _pending_invocations.empty();
+      return std::all_of(
+          _ready_functions.begin(), _ready_functions.end(),
+          [](const auto& functions) { return functions.empty(); }
+      );
+    }
+
+    // Functions with ready invocations, counted once for each priority class.
+    size_t ready_functions() const
+    {
+      size_t count = 0;
+      for (const auto& functions : _ready_functions) {
+        count += functions.size();
+      }
+      return count;
+    }
+
+    // Invocations that can be dispatched now.
+    size_t ready_invocations() const
+    {
+      return _ready_invocations;
+    }
+
+    // Invocations not dispatched to a worker yet - ready, or waiting for their trigger.
+    size_t queued_invocations() const
+    {
+      return _active_invocations.size() - static_cast<size_t>(_running);
     }
 
+    // Payload of the invocations that did not finish yet.
+    size_t queued_bytes() const
+    {
+      return _queued_bytes;
+    }
+
+    // Time until all queued invocations are dispatched, at the average execution time.
+    std::chrono::microseconds estimated_wait(size_t workers) const;
+
   private:
-    // FIFO but easy removal in the middle - we skip middle elements.
-    std::vector<Invocation*> _pending_invocations;
+    friend struct TriggerChecker;
+
+    void _check_trigger(Invocation& invocation);
+
+    void _make_ready(Invocation& invocation);
+
+    // Links a ready invocation in the queue of its current class.
+    void _enqueue(Invocation& invocation, std::chrono::steady_clock::time_point now);
+
+    bool _urgent(const Invocation& invocation, std::chrono::steady_clock::time_point now) const;
+
+    // Unlinks a ready invocation from the queue of its class.
+    void _unlink(Invocation& invocation);
+
+    DependencyQueue& _dependency_queue(const std::string& fname);
+
+    bool _dependencies_ready(const DependencyQueue& queue) const;
+
+    // Returns true when the invocation consumed its dependencies and can be dispatched.
+    bool _acquire_dependencies(Invocation& invocation, const std::string& fname);
+
+    void _release_dependents(DependencyQueue& queue);
+
+    // Stores the payload at the position of its source.
+    static std::optional<std::string> _add_source_payload(
+        Invocation& invocation, const runtime::internal::MultiSourceTrigger& trigger,
+        runtime::internal::Buffer<char>&& buffer, const InvocationSource& source
+    );
+
+    static bool
+    _can_dispatch(const ReadyQueue& queue, std::chrono::steady_clock::time_point now);
+
+    void _schedule(ReadyQueue& queue);
+
+    void _unschedule(ReadyQueue& queue);
+
+    // Schedules queues of the function that can be dispatched again.
+    void _reschedule(FunctionQueue& function, std::chrono::steady_clock::time_point now);
+
+    // Next function to dispatch, skipping functions that reached their limits.
+    ReadyQueue* _pop_ready(size_t idle_workers);
+
+    void _update_running(FunctionQueue& function, int change);
 
     // All invocations - active, and pending.
     std::unordered_map<std::string, Invocation> _active_invocations;
 
+    // Ready queues for each function - node-based, addresses stay stable.
+    std::unordered_map<std::string, FunctionQueue> _ready_queues;
+
+    // Round-robin of functions in each priority class, from the highest.
+    std::array<
+        IntrusiveQueue<ReadyQueue, &ReadyQueue::next_function>, FunctionQueue::PRIORITY_CLASSES>
+        _ready_functions;
+
+    std::vector<ReadyQueue*> _batch_queues;
+
+    // Ready invocations in the lower classes, by the time their deadline becomes urgent.
+    // Entries of invocations that were dispatched or removed since are skipped.
+    using UrgentEntry = std::pair<std::chrono::steady_clock::time_point, std::string>;
+    std::priority_queue<UrgentEntry, std::vector<UrgentEntry>, std::greater<>> _urgent_deadlines;
+
+    std::unordered_map<std::string, DependencyQueue> _dependency_queues;
+
+    // State keys that dependency triggers wait for.
+    std::unordered_set<std::string> _produced_state;
+
+    size_t _ready_invocations{};
+
+    // Reserved workers occupied by invocations of their functions.
+    int _used_reservations{};
+
+    // Invocations dispatched to workers that did not finish yet.
+    int _running{};
+
+    size_t _queued_bytes{};
+
+    // Moving average of the time from dispatching an invocation to its result.
+    std::chrono::microseconds _execution_time{};
+
+    // Weight of old samples in the moving average.
+    static constexpr int EXECUTION_TIME_WEIGHT = 8;
+
     runtime::internal::Functions& _functions;
+
+    std::chrono::microseconds _aging;
+
+    config::Admission _admission;
   };
 
   struct TriggerChecker : runtime::internal::TriggerVisitor {
@@ -145,74 +671,464 @@ namespace praas::process {
     bool ready{};
 
     void visit(const runtime::internal::DirectTrigger&) override;
+
+    void visit(const runtime::internal::BatchTrigger&) override;
+
+    void visit(const runtime::internal::MultiSourceTrigger&) override;
+
+    void visit(const runtime::internal::PipelineTrigger&) override;
+
+    void visit(const runtime::internal::DependencyTrigger&) override;
+  };
+
+  /**
+   * Invoker with all functions loaded that starts new workers by forking itself,
+   * which avoids loading libraries or starting the interpreter for every worker.
+   *
+   * Workers are forked as our children - the controller signals and collects them
+   * like workers started with exec.
+   */
+  struct ZygoteProcess {
+
+    // The memory policy of the zygote is inherited by its forks.
+    ZygoteProcess(
+        std::vector<std::string> args, const runtime::internal::CPUSet& cpus = {},
+        bool local_memory = false
+    );
+
+    ZygoteProcess(const ZygoteProcess&) = delete;
+    ZygoteProcess& operator=(const ZygoteProcess&) = delete;
+    ZygoteProcess(ZygoteProcess&&) = delete;
+    ZygoteProcess& operator=(ZygoteProcess&&) = delete;
+
+    ~ZygoteProcess();
+
+    // Blocks until the zygote forked a worker for the IPC channels, and returns its PID.
+    int spawn(const std::string& ipc_name, const runtime::internal::CPUSet& cpus = {});
+
+    // Closing the connection tells the zygote to exit.
+    void shutdown();
+
+    int pid() const
+    {
+      return _pid;
+    }
+
+  private:
+    int _pid{-1};
+
+    int _fd{-1};
   };
 
+  /**
+   * Invoker running in a worker process, or on a thread of the controller for functions
+   * with the thread execution mode.
+   *
+   * Each slot of the worker executes one invocation at a time. A C++ worker process can have
+   * several slots, each served by its own thread of the invoker; other workers have one.
+   * The worker is available while it has a free slot, and it is stopped or replaced together
+   * with all invocations it runs.
+   *
+   * A worker thread talks to the controller through the same messages as a worker process,
+   * but over channels in memory - the state of the controller is never accessed from
+   * the thread. User code cannot be interrupted: invocations of threads never time out,
+   * and a thread finishes only when the controller closes its channels.
+   */
   struct FunctionWorker {
 
+    // The worker is pinned to the CPUs before it starts the invoker.
     FunctionWorker(
         const char** args, runtime::internal::ipc::IPCMode, std::string ipc_name, int ipc_msg_size,
-        char** env = {}
+        runtime::internal::CPUSet cpus = {}, bool local_memory = false, char** env = {}
+    );
+
+    FunctionWorker(
+        ZygoteProcess& zygote, runtime::internal::ipc::IPCMode, std::string ipc_name,
+        int ipc_msg_size, runtime::internal::CPUSet cpus = {}
     );
 
+    // Starts a thread executing functions loaded into the controller.
+    FunctionWorker(
+        std::shared_ptr<const runtime::internal::FunctionsLibrary> library,
+        const std::string& process_id, runtime::internal::CPUSet cpus = {},
+        bool local_memory = false
+    );
+
+    FunctionWorker(const FunctionWorker&) = delete;
+    FunctionWorker& operator=(const FunctionWorker&) = delete;
+    FunctionWorker(FunctionWorker&&) = delete;
+    FunctionWorker& operator=(FunctionWorker&&) = delete;
+
+    ~FunctionWorker();
+
     runtime::internal::ipc::IPCChannel& ipc_write() const;
 
     runtime::internal::ipc::IPCChannel& ipc_read() const;
 
+    // Worker threads report the PID of the controller.
     int pid() const
     {
       return _pid;
     }
 
+    bool in_thread() const
+    {
+      return _in_thread;
+    }
+
+    // Empty when the worker is not pinned.
+    const runtime::internal::CPUSet& cpus() const
+    {
+      return _cpus;
+    }
+
+    // Worker sent the handshake after loading functions, and can receive invocations.
+    bool ready() const
+    {
+      return _ready;
+    }
+
+    void ready(bool val)
+    {
+      _ready = val;
+    }
+
+    // Invocations executed concurrently.
+    size_t slots() const
+    {
+      return _slots;
+    }
+
+    void slots(size_t val)
+    {
+      _slots = std::max(val, static_cast<size_t>(1));
+    }
+
+    // Slots executing an invocation.
+    size_t running() const
+    {
+      return _invocations.size();
+    }
+
+    // No slot is free.
     bool busy() const
     {
-      return _busy;
+      return _invocations.size() >= _slots;
+    }
+
+    // Controller waits until the worker makes space for queued messages.
+    bool send_pending() const
+    {
+      return _send_pending;
+    }
+
+    void send_pending(bool val)
+    {
+      _send_pending = val;
+    }
+
+    std::chrono::steady_clock::time_point idle_since() const
+    {
+      return _idle_since;
+    }
+
+    void idle_since(std::chrono::steady_clock::time_point val)
+    {
+      _idle_since = val;
+    }
+
+    // Queues of the function executed most recently - its state is warm in this worker.
+    const FunctionQueue* last_function() const
+    {
+      return _last_function;
+    }
+
+    void last_function(const FunctionQueue* val)
+    {
+      _last_function = val;
+    }
+
+    // Invocations executed now, each with the rest of its batch.
+    const std::vector<const Invocation*>& invocations() const
+    {
+      return _invocations;
     }
 
-    void busy(bool val)
+    // Running invocation with the key - possibly a member of a batch.
+    const Invocation* invocation(std::string_view key) const;
+
+    // When the worker is considered stuck in the invocation of a slot.
+    std::optional<std::chrono::steady_clock::time_point> timeout(std::string_view key) const;
+
+    // Caller cancelled one of the invocations - the worker is replaced.
+    bool cancelled() const
     {
-      _busy = val;
+      return _cancelled;
     }
 
+    void cancelled(bool val)
+    {
+      _cancelled = val;
+    }
+
+    // Worker sent an invalid message - it is replaced.
+    bool failed() const
+    {
+      return _failed;
+    }
+
+    void failed(bool val)
+    {
+      _failed = val;
+    }
+
+    // Returns when the worker is considered stuck in the invocation.
+    std::optional<std::chrono::steady_clock::time_point>
+    start(const Invocation& invocation, std::chrono::steady_clock::time_point now);
+
+    // Frees the slot executing the invocation - invocations of a batch are found by the first
+    // one. Returns false when no slot executes it.
+    bool stop(std::string_view key);
+
+    // Closes the channels of a worker thread, and waits until its invocation finishes.
+    void join();
+
+    // Links in the idle workers - see Workers.
+    FunctionWorker* idle_prev{};
+    FunctionWorker* idle_next{};
+
   private:
+    // IPC channels must be created before the worker starts - avoid race condition.
+    // Returns the descriptors that the worker must inherit.
+    std::vector<int> _create_channels(
+        runtime::internal::ipc::IPCMode mode, const std::string& ipc_name, int ipc_msg_size
+    );
+
     std::unique_ptr<runtime::internal::ipc::IPCChannel> _ipc_read;
 
     std::unique_ptr<runtime::internal::ipc::IPCChannel> _ipc_write;
 
     int _pid;
 
-    bool _busy;
+    runtime::internal::CPUSet _cpus;
+
+    bool _ready{};
+
+    size_t _slots{1};
+
+    bool _send_pending{};
+
+    std::chrono::steady_clock::time_point _idle_since;
+
+    const FunctionQueue* _last_function{};
+
+    // Invocation of each busy slot, and when it is considered stuck.
+    std::vector<const Invocation*> _invocations;
+    std::vector<std::optional<std::chrono::steady_clock::time_point>> _timeouts;
+
+    bool _cancelled{};
+
+    bool _failed{};
+
+    bool _in_thread{};
+
+    // Created before the thread starts, and only used by it.
+    std::unique_ptr<runtime::internal::Invoker> _invoker;
+
+    std::thread _thread;
+  };
+
+  using IdleWorkers =
+      IntrusiveList<FunctionWorker, &FunctionWorker::idle_prev, &FunctionWorker::idle_next>;
+
+  /**
+   * Selects an idle worker for an invocation. The policy can also decide
+   * that the invocation should wait for a better worker to become idle.
+   */
+  struct DispatchPolicy {
+
+    virtual ~DispatchPolicy() = default;
+
+    // Idle workers are ordered from the longest idle to the most recently idle, after
+    // workers with invocations running in their other slots.
+    // Returns nullptr when the invocation should wait.
+    virtual FunctionWorker* select(
+        const Invocation& invocation, const IdleWorkers& idle_workers,
+        const std::list<FunctionWorker>& workers, std::chrono::steady_clock::time_point now
+    ) = 0;
+
+    static std::unique_ptr<DispatchPolicy> create(const config::Dispatch& cfg);
+  };
+
+  // Most recently idle worker - its memory is still warm. Workers with busy slots are taken
+  // only when no worker is fully idle.
+  struct AnyWorkerPolicy : DispatchPolicy {
+
+    FunctionWorker* select(
+        const Invocation& invocation, const IdleWorkers& idle_workers,
+        const std::list<FunctionWorker>& workers, std::chrono::steady_clock::time_point now
+    ) override;
+  };
+
+  // Keeps functions on the workers that executed them - caches, interpreter state
+  // and thread-local data of the function are reused.
+  struct AffinityPolicy : DispatchPolicy {
+
+    AffinityPolicy(std::chrono::microseconds max_wait) : _max_wait(max_wait) {}
+
+    FunctionWorker* select(
+        const Invocation& invocation, const IdleWorkers& idle_workers,
+        const std::list<FunctionWorker>& workers, std::chrono::steady_clock::time_point now
+    ) override;
+
+  private:
+    std::chrono::microseconds _max_wait;
   };
 
   struct Workers {
 
     Workers(config::Controller& cfg);
 
-    std::vector<FunctionWorker>& workers()
+    // Starts worker threads when functions are executed on threads of the controller.
+    void start_threads(const runtime::internal::Functions& functions);
+
+    // Worker processes and threads.
+    // Addresses are stable - workers are registered in epoll by their pointer.
+    std::list<FunctionWorker>& workers()
     {
       return _workers;
     }
     bool has_idle_workers() const;
 
-    void submit(Invocation& invocation);
+    // Free slots of worker processes.
+    size_t idle() const
+    {
+      return _idle_slots;
+    }
+
+    // Worker processes - the number of threads is fixed.
+    size_t size() const
+    {
+      return _workers.size() - _threads;
+    }
+
+    // Invocations executed concurrently by each worker process.
+    size_t worker_slots() const
+    {
+      return static_cast<size_t>(_cfg.invoker_threads);
+    }
+
+    // Workers launched that did not send the handshake yet.
+    size_t starting() const
+    {
+      return _starting;
+    }
+
+    // Returns the worker executing the invocation. Returns nullptr when the dispatch policy
+    // decided that the invocation should wait, or when no worker of the execution mode
+    // of the function is idle.
+    FunctionWorker* submit(Invocation& invocation);
+
+    // Frees the slot of the worker executing the invocation.
+    void finish(FunctionWorker& worker, std::string_view key);
+
+    // Launches a new worker, which becomes idle once it reports to be ready.
+    FunctionWorker& add_worker();
+
+    void ready(FunctionWorker& worker);
+
+    // Removes from the idle workers the one that has been idle for the longest time,
+    // if it became idle before the deadline. Workers with busy slots are not removed.
+    FunctionWorker* expired_worker(std::chrono::steady_clock::time_point deadline);
+
+    // Stops an idle worker - the process is collected later, without blocking.
+    void remove(FunctionWorker& worker);
+
+    // Marks the worker running the invocation for replacement.
+    // Returns false when no worker runs it. Worker threads are never replaced.
+    bool cancel(std::string_view key);
+
+    // Marks a worker that sent an invalid message for replacement.
+    void fail(FunctionWorker& worker);
 
-    void finish(FunctionWorker& worker);
+    // Busy worker whose invocation was cancelled or timed out, or a worker that failed.
+    // The worker stays stuck until it is terminated.
+    FunctionWorker* stuck_worker(std::chrono::steady_clock::time_point now);
+
+    // When the next running invocation times out.
+    std::optional<std::chrono::steady_clock::time_point> next_timeout();
+
+    // Kills a busy worker - user code cannot be interrupted in any other way.
+    void terminate(FunctionWorker& worker);
+
+    // Messages to workers that have not been delivered yet.
+    size_t queued_bytes() const;
 
     void shutdown();
 
     void shutdown_channels();
 
   private:
-    void _launch_cpp(config::Controller& cfg, const std::string& ipc_name);
+    // Command starting the invoker of the function language, without the IPC name.
+    std::vector<std::string> _invoker_command() const;
+
+    // CPU of the worker set that runs the fewest workers.
+    runtime::internal::CPUSet _select_cpu() const;
+
+    void _send_batch(FunctionWorker& worker, Invocation& invocation);
+
+    void _collect_terminated();
+
+    // Idle lists keep the free slots of worker processes counted.
+    void _link_idle(FunctionWorker& worker, bool front);
+    void _unlink_idle(FunctionWorker& worker);
+
+    // Worker running the invocation that times out first, after dropping finished ones.
+    FunctionWorker* _next_timeout_worker();
+
+    config::Controller _cfg;
+
+    std::unique_ptr<ZygoteProcess> _zygote;
 
-    void _launch_python(config::Controller& cfg, const std::string& ipc_name);
+    std::unique_ptr<DispatchPolicy> _policy;
 
-    FunctionWorker* _get_idle_worker();
+    // Reused to encode batches of invocations.
+    std::vector<char> _batch_buffer;
 
-    std::vector<FunctionWorker> _workers;
+    std::list<FunctionWorker> _workers;
 
     int _worker_counter{};
 
-    int _idle_workers{};
+    size_t _starting{};
+
+    // Most recently finished workers are reused first - their memory is still warm,
+    // and the ones idle for the longest time are stopped first.
+    // Workers with a free slot are kept here, also when their other slots are busy.
+    IdleWorkers _idle_workers;
+
+    // Worker threads are kept apart - invocations never choose between them and processes.
+    IdleWorkers _idle_threads;
+
+    // Free slots of the idle worker processes.
+    size_t _idle_slots{};
+
+    // Worker executing each running invocation, also each member of a batch.
+    std::unordered_map<std::string, FunctionWorker*> _running;
+
+    // Running invocations by the time they time out. Entries of invocations that finished
+    // since are dropped when they reach the top.
+    using TimeoutEntry = std::pair<std::chrono::steady_clock::time_point, std::string>;
+    std::priority_queue<TimeoutEntry, std::vector<TimeoutEntry>, std::greater<>> _timeouts;
+
+    // Workers that failed, or whose invocation was cancelled.
+    std::vector<FunctionWorker*> _stuck;
+
+    std::shared_ptr<const runtime::internal::FunctionsLibrary> _library;
+
+    size_t _threads{};
+
+    // Stopped workers that have not exited yet.
+    std::vector<int> _terminated;
 
     std::shared_ptr<spdlog::logger> _logger;
   };
@@ -46,6 +46,129 @@ namespace praas::process::config {
     }
   }
 
+  void Polling::load(cereal::JSONInputArchive& archive)
+  {
+    common::util::cereal_load_optional(
+        archive, "controller-spin-us", controller_spin_us, DEFAULT_CONTROLLER_SPIN_US
+    );
+    common::util::cereal_load_optional(
+        archive, "worker-spin-us", worker_spin_us, DEFAULT_WORKER_SPIN_US
+    );
+  }
+
+  void Polling::set_defaults()
+  {
+    controller_spin_us = DEFAULT_CONTROLLER_SPIN_US;
+    worker_spin_us = DEFAULT_WORKER_SPIN_US;
+  }
+
+  void Scaling::load(cereal::JSONInputArchive& archive)
+  {
+    common::util::cereal_load_optional(archive, "min-workers", min_workers, 0);
+    common::util::cereal_load_optional(archive, "max-workers", max_workers, 0);
+    common::util::cereal_load_optional(
+        archive, "scale-up-backlog", scale_up_backlog, DEFAULT_SCALE_UP_BACKLOG
+    );
+    common::util::cereal_load_optional(
+        archive, "scale-up-delay-ms", scale_up_delay_ms, DEFAULT_SCALE_UP_DELAY_MS
+    );
+    common::util::cereal_load_optional(
+        archive, "idle-timeout-ms", idle_timeout_ms, DEFAULT_IDLE_TIMEOUT_MS
+    );
+
+    if (enabled() && (min_workers < 0 || min_workers > max_workers)) {
+      throw common::InvalidConfigurationError(
+          fmt::format("Incorrect worker bounds: min {}, max {}", min_workers, max_workers)
+      );
+    }
+  }
+
+  void Scaling::set_defaults()
+  {
+    min_workers = 0;
+    max_workers = 0;
+    scale_up_backlog = DEFAULT_SCALE_UP_BACKLOG;
+    scale_up_delay_ms = DEFAULT_SCALE_UP_DELAY_MS;
+    idle_timeout_ms = DEFAULT_IDLE_TIMEOUT_MS;
+  }
+
+  void Dispatch::load(cereal::JSONInputArchive& archive)
+  {
+    std::string policy_name;
+    common::util::cereal_load_optional(archive, "policy", policy_name, std::string{"affinity"});
+    common::util::cereal_load_optional(
+        archive, "affinity-wait-us", affinity_wait_us, DEFAULT_AFFINITY_WAIT_US
+    );
+    common::util::cereal_load_optional(archive, "aging-us", aging_us, DEFAULT_AGING_US);
+
+    if (policy_name == "any") {
+      policy = Policy::ANY;
+    } else if (policy_name == "affinity") {
+      policy = Policy::AFFINITY;
+    } else {
+      throw common::InvalidConfigurationError(
+          fmt::format("Unknown dispatch policy: {}", policy_name)
+      );
+    }
+  }
+
+  void Dispatch::set_defaults()
+  {
+    policy = Policy::AFFINITY;
+    affinity_wait_us = DEFAULT_AFFINITY_WAIT_US;
+    aging_us = DEFAULT_AGING_US;
+  }
+
+  void Admission::load(cereal::JSONInputArchive& archive)
+  {
+    common::util::cereal_load_optional(
+        archive, "max-queued-invocations", max_queued_invocations, 0
+    );
+    common::util::cereal_load_optional(
+        archive, "max-queued-bytes", max_queued_bytes, static_cast<size_t>(0)
+    );
+    common::util::cereal_load_optional(archive, "max-wait-ms", max_wait_ms, 0);
+
+    if (max_queued_invocations < 0 || max_wait_ms < 0) {
+      throw common::InvalidConfigurationError(fmt::format(
+          "Incorrect admission limits: invocations {}, wait {} ms", max_queued_invocations,
+          max_wait_ms
+      ));
+    }
+  }
+
+  void Admission::set_defaults()
+  {
+    max_queued_invocations = 0;
+    max_queued_bytes = 0;
+    max_wait_ms = 0;
+  }
+
+  void Placement::load(cereal::JSONInputArchive& archive)
+  {
+    std::string controller, io, workers;
+    common::util::cereal_load_optional(archive, "controller-cpus", controller, std::string{});
+    common::util::cereal_load_optional(archive, "io-cpus", io, std::string{});
+    common::util::cereal_load_optional(archive, "worker-cpus", workers, std::string{});
+    common::util::cereal_load_optional(archive, "local-memory", local_memory, false);
+
+    try {
+      controller_cpus = runtime::internal::CPUSet::parse(controller);
+      io_cpus = runtime::internal::CPUSet::parse(io);
+      worker_cpus = runtime::internal::CPUSet::parse(workers);
+    } catch (const common::InvalidArgument& e) {
+      throw common::InvalidConfigurationError(fmt::format("Incorrect placement: {}", e.what()));
+    }
+  }
+
+  void Placement::set_defaults()
+  {
+    controller_cpus = {};
+    io_cpus = {};
+    worker_cpus = {};
+    local_memory = false;
+  }
+
   void Controller::load(cereal::JSONInputArchive& archive)
   {
     archive(CEREAL_NVP(port));
@@ -61,6 +184,48 @@ namespace praas::process::config {
     archive(CEREAL_NVP(code));
 
     archive(CEREAL_NVP(process_id));
+
+    common::util::cereal_load_optional(archive, "polling", polling);
+    common::util::cereal_load_optional(archive, "scaling", scaling);
+    common::util::cereal_load_optional(archive, "dispatch", dispatch);
+    common::util::cereal_load_optional(archive, "admission", admission);
+    common::util::cereal_load_optional(archive, "placement", placement);
+    common::util::cereal_load_optional(archive, "io-threads", io_threads, DEFAULT_IO_THREADS);
+    common::util::cereal_load_optional(archive, "zygote", zygote, false);
+    common::util::cereal_load_optional(
+        archive, "thread-workers", thread_workers, DEFAULT_THREAD_WORKERS
+    );
+    common::util::cereal_load_optional(
+        archive, "invoker-threads", invoker_threads, DEFAULT_INVOKER_THREADS
+    );
+
+    if (io_threads < 1) {
+      throw common::InvalidConfigurationError(
+          fmt::format("Incorrect number of IO threads {}", io_threads)
+      );
+    }
+
+    // Channels of a worker are created after the zygote was started, and their descriptors
+    // cannot be inherited by its forks.
+    if (zygote && ipc_mode == runtime::internal::ipc::IPCMode::SHM) {
+      throw common::InvalidConfigurationError(
+          "Workers forked from the zygote cannot use the shared-memory IPC mode"
+      );
+    }
+
+    if (thread_workers < 0) {
+      throw common::InvalidConfigurationError(
+          fmt::format("Incorrect number of thread workers {}", thread_workers)
+      );
+    }
+
+    if (invoker_threads < 1 ||
+        (invoker_threads > 1 && code.language != runtime::internal::Language::CPP)) {
+      throw common::InvalidConfigurationError(fmt::format(
+          "Incorrect number of invoker threads {} - more than one requires C++ functions",
+          invoker_threads
+      ));
+    }
   }
 
   void Controller::load_env()
@@ -86,6 +251,10 @@ namespace praas::process::config {
   {
     port = DEFAULT_PORT;
     function_workers = DEFAULT_FUNCTION_WORKERS;
+    io_threads = DEFAULT_IO_THREADS;
+    zygote = false;
+    thread_workers = DEFAULT_THREAD_WORKERS;
+    invoker_threads = DEFAULT_INVOKER_THREADS;
     verbose = false;
     ipc_mode = runtime::internal::ipc::IPCMode::POSIX_MQ;
     ipc_message_size = DEFAULT_MSG_SIZE;
@@ -95,6 +264,11 @@ namespace praas::process::config {
     ipc_name_prefix = "";
 
     code.set_defaults();
+    polling.set_defaults();
+    scaling.set_defaults();
+    dispatch.set_defaults();
+    admission.set_defaults();
+    placement.set_defaults();
   }
 
   Controller Controller::deserialize(int argc, char** argv)
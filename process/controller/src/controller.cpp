@@ -9,9 +9,11 @@
 #include <praas/process/runtime/internal/ipc/messages.hpp>
 #include <praas/process/runtime/internal/state.hpp>
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <thread>
 
 #include <execinfo.h>
 #include <signal.h>
@@ -128,7 +130,12 @@ namespace praas::process {
 
   Controller::Controller(config::Controller cfg)
       : _buffers(DEFAULT_BUFFER_MESSAGES, DEFAULT_BUFFER_SIZE), _workers(cfg),
-        _work_queue(_functions), _process_id(cfg.process_id)
+        _work_queue(
+            _functions, std::chrono::microseconds{cfg.dispatch.aging_us}, cfg.admission
+        ),
+        _process_id(cfg.process_id), _spin_time(cfg.polling.controller_spin_us),
+        _scaling(cfg.scaling), _placement(cfg.placement),
+        _affinity_wait(cfg.dispatch.affinity_wait_us)
   {
 
     auto sink = std::make_shared<spdlog::sinks::stderr_color_sink_st>();
@@ -142,6 +149,15 @@ namespace praas::process {
       throw praas::common::PraaSException{fmt::format("Could not find file {}", path.c_str())};
     }
     _functions.initialize(in_stream, cfg.code.language);
+    _workers.start_threads(_functions);
+
+    int max_workers = _scaling.enabled() ? _scaling.max_workers : cfg.function_workers;
+    if (_functions.reserved_workers() > 0 && _functions.reserved_workers() >= max_workers) {
+      _logger->warn(
+          "Functions reserve {} of {} workers - functions without a reservation will not run",
+          _functions.reserved_workers(), max_workers
+      );
+    }
 
     // size is ignored by Linux
     _epoll_fd = epoll_create(255);
@@ -155,11 +171,8 @@ namespace praas::process {
     common::util::assert_other(_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK), -1);
     common::util::assert_true(epoll_add(_epoll_fd, _event_fd, this, EPOLLIN | EPOLLET | EPOLLPRI));
 
-    // FIXME: other IPC methods
     for (FunctionWorker& worker : _workers.workers()) {
-      common::util::assert_true(
-          epoll_add(_epoll_fd, worker.ipc_read().fd(), &worker, EPOLLIN | EPOLLPRI)
-      );
+      _register_worker(worker);
     }
 
     // FIXME: do we want to make it optional?
@@ -177,6 +190,26 @@ namespace praas::process {
     close(_epoll_fd);
   }
 
+  void Controller::_register_worker(FunctionWorker& worker)
+  {
+    // FIXME: other IPC methods
+    common::util::assert_true(
+        epoll_add(_epoll_fd, worker.ipc_read().fd(), &worker, EPOLLIN | EPOLLPRI)
+    );
+    // Enabled only when sending to the worker is deferred.
+    common::util::assert_true(epoll_add(_epoll_fd, worker.ipc_write().fd(), &worker, 0));
+  }
+
+  void Controller::_unregister_worker(FunctionWorker& worker)
+  {
+    common::util::assert_true(
+        epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, worker.ipc_read().fd(), nullptr) == 0
+    );
+    common::util::assert_true(
+        epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, worker.ipc_write().fd(), nullptr) == 0
+    );
+  }
+
   void Controller::set_remote(remote::Server* server)
   {
     this->_server = server;
@@ -187,52 +220,50 @@ namespace praas::process {
       std::string process_id
   )
   {
-    {
-      std::lock_guard<std::mutex> lock(_deque_lock);
-      _external_queue.emplace_back(
-          remote::RemoteType::PROCESS, process_id, msg, std::move(payload)
-      );
+    // Full queue blocks the server thread, and it stops reading from its connections.
+    if (_external_queue.push(
+            remote::RemoteType::PROCESS, std::move(process_id), std::move(msg), std::move(payload)
+        )) {
+      _notify();
     }
-    uint64_t tmp = 1;
-    common::util::assert_other(write(_event_fd, &tmp, sizeof(tmp)), -1);
   }
 
   void Controller::dataplane_message(
       praas::common::message::MessageData&& msg, runtime::internal::Buffer<char>&& payload
   )
   {
-    {
-      std::lock_guard<std::mutex> lock(_deque_lock);
-      _external_queue.emplace_back(
-          remote::RemoteType::DATA_PLANE, std::nullopt, msg, std::move(payload)
-      );
+    if (_external_queue.push(
+            remote::RemoteType::DATA_PLANE, std::nullopt, std::move(msg), std::move(payload)
+        )) {
+      _notify();
     }
-    uint64_t tmp = 1;
-    common::util::assert_other(write(_event_fd, &tmp, sizeof(tmp)), -1);
   }
 
   void Controller::controlplane_message(
       praas::common::message::MessageData&& msg, runtime::internal::Buffer<char>&& payload
   )
   {
-    {
-      std::lock_guard<std::mutex> lock(_deque_lock);
-      _external_queue.emplace_back(
-          remote::RemoteType::CONTROL_PLANE, std::nullopt, msg, std::move(payload)
-      );
+    if (_external_queue.push(
+            remote::RemoteType::CONTROL_PLANE, std::nullopt, std::move(msg), std::move(payload)
+        )) {
+      _notify();
     }
-    uint64_t tmp = 1;
-    common::util::assert_other(write(_event_fd, &tmp, sizeof(tmp)), -1);
   }
 
   void Controller::update_application(common::Application::Status status, std::string_view process)
   {
-    {
-      std::lock_guard<std::mutex> lock(_app_lock);
-      _app_updates.emplace_back(status, std::string{process});
+    if (_app_updates.push(status, std::string{process})) {
+      _notify();
+    }
+  }
+
+  void Controller::_notify()
+  {
+    // Only the first message after the controller started draining needs a wakeup.
+    if (!_notified.exchange(true, std::memory_order_acq_rel)) {
+      uint64_t tmp = 1;
+      common::util::assert_other(write(_event_fd, &tmp, sizeof(tmp)), -1);
     }
-    uint64_t tmp = 1;
-    common::util::assert_other(write(_event_fd, &tmp, sizeof(tmp)), -1);
   }
 
   void
@@ -247,6 +278,7 @@ namespace praas::process {
 
       for (FunctionWorker& worker : _workers.workers()) {
         worker.ipc_write().send(msg);
+        _update_pending_send(worker);
       }
     }
 
@@ -266,18 +298,30 @@ namespace praas::process {
                   _logger, "Received external invocation request of {}, key {}, inputs {}",
                   req.function_name(), req.invocation_id(), req.payload_size()
               );
-              auto res = _work_queue.add_payload(
-                  std::string{req.function_name()}, std::string{req.invocation_id()},
-                  std::move(msg.payload),
+              InvocationScheduling scheduling{req.priority()};
+              if (req.deadline_ms() > 0) {
+                scheduling.deadline = std::chrono::steady_clock::now() +
+                                      std::chrono::milliseconds{req.deadline_ms()};
+              }
+              scheduling.timeout = std::chrono::milliseconds{req.timeout_ms()};
+
+              auto source =
                   (msg.source.has_value() ? InvocationSource::from_process(msg.source.value())
-                                          : InvocationSource::from_source(msg.source_type))
-              );
+                                          : InvocationSource::from_source(msg.source_type));
+              int return_code = common::message::InvocationResultData::OVERLOADED;
+
+              auto res = _admit(std::string{req.invocation_id()}, msg.payload.len);
+              if (!res.has_value()) {
+                return_code = -1;
+                res = _work_queue.add_payload(
+                    std::string{req.function_name()}, std::string{req.invocation_id()},
+                    std::move(msg.payload), InvocationSource{source}, scheduling
+                );
+              }
 
               if (res.has_value()) {
                 _process_invocation_result(
-                    (msg.source.has_value() ? InvocationSource::from_process(msg.source.value())
-                                            : InvocationSource::from_source(msg.source_type)),
-                    req.invocation_id(), -1,
+                    source, req.invocation_id(), return_code,
                     runtime::internal::BufferAccessor<const char>{
                         res.value().data(), res.value().size()}
                 );
@@ -285,7 +329,7 @@ namespace praas::process {
             },
             [&, this](common::message::InvocationResultPtr& req) mutable {
               // Is there are pending message for this message?
-              std::vector<const FunctionWorker*> pending_workers;
+              std::vector<FunctionWorker*> pending_workers;
               _pending_msgs.find_invocation(std::string{req.invocation_id()}, pending_workers);
 
               // FIXME: remove this double message type, our message types are broken
@@ -294,7 +338,7 @@ namespace praas::process {
               result.return_code(req.return_code());
               result.buffer_length(msg.payload.len);
 
-              for (const FunctionWorker* worker : pending_workers) {
+              for (FunctionWorker* worker : pending_workers) {
 
                 SPDLOG_LOGGER_DEBUG(
                     _logger, "Sending external invocational result with key {}, message len {}",
@@ -302,11 +346,12 @@ namespace praas::process {
                 );
 
                 worker->ipc_write().send(result, msg.payload);
+                _update_pending_send(*worker);
               }
             },
             [&, this](common::message::PutMessagePtr& req) mutable {
               // Is there are pending message for this message?
-              const FunctionWorker* pending_worker =
+              FunctionWorker* pending_worker =
                   _pending_msgs.find_get(std::string{req.name()}, std::string{req.process_id()});
               if (pending_worker) {
 
@@ -320,6 +365,7 @@ namespace praas::process {
                 return_req.name(req.name());
 
                 pending_worker->ipc_write().send(return_req, std::move(msg.payload));
+                _update_pending_send(*pending_worker);
 
               } else {
 
@@ -337,6 +383,9 @@ namespace praas::process {
                 }
               }
             },
+            [this](common::message::InvocationCancelPtr& req) mutable {
+              _cancel_invocation(std::string{req.invocation_id()});
+            },
             [this](auto&) { _logger->error("Received unsupported message!"); }},
         parsed_msg
     );
@@ -356,6 +405,9 @@ namespace praas::process {
                   worker, req.invocation_id(), req.return_code(), std::move(payload)
               );
             },
+            [&, this](runtime::internal::ipc::InvocationBatchResultParsed& req) mutable {
+              _process_batch_result(worker, req.invocations(), payload);
+            },
             [&, this](runtime::internal::ipc::InvocationRequestParsed& req) mutable {
               _process_invocation(worker, req, std::move(payload));
             },
@@ -374,6 +426,7 @@ namespace praas::process {
                   return_req,
                   runtime::internal::BufferAccessor<const char>(str.data(), str.length())
               );
+              _update_pending_send(worker);
             },
             [&, this](runtime::internal::ipc::GetRequestParsed& req) mutable {
               if (req.state()) {
@@ -387,6 +440,7 @@ namespace praas::process {
 
                   // Send
                   worker.ipc_write().send(return_req, buf->accessor<const char>());
+                  _update_pending_send(worker);
 
                 } else {
 
@@ -396,6 +450,7 @@ namespace praas::process {
 
                   // Send
                   worker.ipc_write().send(return_req);
+                  _update_pending_send(worker);
                 }
 
               } else {
@@ -413,6 +468,7 @@ namespace praas::process {
                       req.process_id(), buf.value().len
                   );
                   worker.ipc_write().send(return_req, std::move(buf.value()));
+                  _update_pending_send(worker);
                 } else {
 
                   _pending_msgs.insert_get(
@@ -426,6 +482,9 @@ namespace praas::process {
                 }
               }
             },
+            [&, this](runtime::internal::ipc::WorkerReadyParsed&) mutable {
+              _workers.ready(worker);
+            },
             [this](auto&) { _logger->error("Received unsupported message!"); }},
         parsed_msg
     );
@@ -433,15 +492,12 @@ namespace praas::process {
 
   void Controller::poll()
   {
-    // FIXME: customize
-    runtime::internal::BufferQueue<char> buffers(10, 1024);
-    std::vector<ExternalMessage> msg;
     std::vector<common::ApplicationUpdate> updates;
 
     std::array<epoll_event, MAX_EPOLL_EVENTS> events;
     while (true) {
 
-      int events_count = epoll_wait(_epoll_fd, events.data(), MAX_EPOLL_EVENTS, EPOLL_TIMEOUT);
+      int events_count = _wait_events(events.data(), MAX_EPOLL_EVENTS);
 
       // Finish if we failed (but we were not interrupted), or when end was requested.
       if (_ending || (events_count == -1 && errno != EINVAL)) {
@@ -457,43 +513,31 @@ namespace praas::process {
           [[maybe_unused]] int read_size = read(_event_fd, &read_val, sizeof(read_val));
           assert(read_size != -1);
 
-          {
-            std::unique_lock<std::mutex> lock(_deque_lock);
+          // Producers signal again for messages pushed after this point.
+          _notified.exchange(false, std::memory_order_acq_rel);
 
-            size_t queue_size = _external_queue.size();
-            if (queue_size > 0) {
-              msg.resize(_external_queue.size());
-
-              for (size_t j = 0; j < queue_size; ++j) {
-                msg[j] = std::move(_external_queue.front());
-                _external_queue.pop_front();
-              }
-
-              lock.unlock();
-
-              for (size_t j = 0; j < msg.size(); ++j) {
-                _process_external_message(msg[j]);
-              }
-              msg.clear();
-            }
+          ExternalMessage external_msg;
+          size_t processed = 0;
+          while (processed < MAX_EXTERNAL_BATCH && _external_queue.try_pop(external_msg)) {
+            _process_external_message(external_msg);
+            ++processed;
           }
-          {
-            std::unique_lock<std::mutex> lock(_app_lock);
-            size_t queue_size = _app_updates.size();
 
-            if (queue_size > 0) {
-              updates.resize(queue_size);
+          _external_queue.wake_producers();
 
-              for (size_t j = 0; j < queue_size; ++j) {
-                updates[j] = std::move(_app_updates.front());
-                _app_updates.pop_front();
-              }
-
-              lock.unlock();
+          common::ApplicationUpdate update;
+          while (_app_updates.try_pop(update)) {
+            updates.push_back(std::move(update));
+          }
+          _app_updates.wake_producers();
+          if (!updates.empty()) {
+            _process_application_updates(updates);
+            updates.clear();
+          }
 
-              _process_application_updates(updates);
-              msg.clear();
-            }
+          // Come back to the remaining messages after handling the workers.
+          if (processed == MAX_EXTERNAL_BATCH) {
+            _notify();
           }
         }
         // Message
@@ -501,25 +545,36 @@ namespace praas::process {
 
           FunctionWorker& worker = *static_cast<FunctionWorker*>(events[i].data.ptr);
 
-          auto [complete, input] = worker.ipc_read().receive();
+          // Worker made space for the deferred messages.
+          if (worker.send_pending() && (events[i].events & worker.ipc_write().flush_events())) {
+            worker.ipc_write().flush();
+            _update_pending_send(worker);
+          }
+
+          if (events[i].events & EPOLLIN) {
+
+            // Workers run user code - a corrupted message fails the worker, not the controller.
+            try {
+              auto [complete, input] = worker.ipc_read().receive();
 
-          if (complete) {
-            _process_internal_message(worker, worker.ipc_read().message(), std::move(input));
+              if (complete) {
+                _process_internal_message(worker, worker.ipc_read().message(), std::move(input));
+              }
+            } catch (const common::InvalidMessage& e) {
+              _logger->error("Invalid message from worker {}: {}", worker.pid(), e.what());
+              _workers.fail(worker);
+            }
           }
         }
       }
 
-      // walk over all functions in a queue, schedule whatever possible
-      while (_workers.has_idle_workers()) {
-
-        Invocation* invoc = _work_queue.next();
+      // Workers are removed only after their events have been processed.
+      _replace_stuck_workers();
 
-        if (!invoc) {
-          break;
-        }
+      _dispatch();
 
-        // schedule on an idle worker
-        _workers.submit(*invoc);
+      if (_scale_workers()) {
+        _dispatch();
       }
     }
 
@@ -529,8 +584,195 @@ namespace praas::process {
     _logger->info("Controller finished polling");
   }
 
+  void Controller::_dispatch()
+  {
+    // walk over all functions in a queue, schedule whatever possible
+    // Each function can defer its invocation once - we stop when all of them wait.
+    auto now = std::chrono::steady_clock::now();
+    _work_queue.schedule_batches(now);
+    _work_queue.age(now);
+
+    size_t deferrals = _work_queue.ready_functions();
+    while (_workers.has_idle_workers() && deferrals > 0) {
+
+      Invocation* invoc = _work_queue.next(_workers.idle());
+
+      if (!invoc) {
+        break;
+      }
+
+      // schedule on an idle worker, unless the invocation waits for a warm one
+      FunctionWorker* worker = _workers.submit(*invoc);
+      if (!worker) {
+        _work_queue.defer(*invoc);
+        --deferrals;
+      } else {
+        _update_pending_send(*worker);
+      }
+    }
+  }
+
+  bool Controller::_scale_workers()
+  {
+    if (!_scaling.enabled()) {
+      return false;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    size_t backlog = _work_queue.ready_invocations();
+
+    if (backlog == 0) {
+      _backlog_since.reset();
+    } else if (!_backlog_since.has_value()) {
+      _backlog_since = now;
+    }
+
+    // Invocations wait for a worker, and workers that are still starting will take some of them.
+    // Invocations waiting for a warm worker are covered by idle workers.
+    // A large backlog gets a slot for each invocation, a small one only after a delay.
+    size_t new_workers = 0;
+    size_t max_workers = _scaling.max_workers;
+    size_t slots = _workers.worker_slots();
+    size_t uncovered =
+        backlog - std::min(backlog, _workers.starting() * slots + _workers.idle());
+    auto delay = std::chrono::milliseconds{_scaling.scale_up_delay_ms};
+    if (uncovered > 0 && _workers.size() < max_workers) {
+
+      if (uncovered >= static_cast<size_t>(_scaling.scale_up_backlog)) {
+        new_workers = std::min((uncovered + slots - 1) / slots, max_workers - _workers.size());
+      } else if (now - _backlog_since.value() >= delay) {
+        new_workers = 1;
+      }
+    }
+
+    for (size_t i = 0; i < new_workers; ++i) {
+
+      FunctionWorker& worker = _workers.add_worker();
+      _register_worker(worker);
+      _send_application_status(worker);
+    }
+    if (new_workers > 0) {
+      // Give new workers time to drain the backlog before growing again.
+      _backlog_since = now;
+      _logger->info("Scaled up to {} workers, backlog {}", _workers.size(), backlog);
+    }
+
+    // Workers idle for the longest time are stopped first.
+    auto deadline = now - std::chrono::milliseconds{_scaling.idle_timeout_ms};
+    while (FunctionWorker* worker = _workers.expired_worker(deadline)) {
+
+      _unregister_worker(*worker);
+      _workers.remove(*worker);
+      _logger->info("Scaled down to {} workers", _workers.size());
+    }
+
+    return new_workers > 0;
+  }
+
+  void Controller::_send_application_status(FunctionWorker& worker)
+  {
+    runtime::internal::ipc::ApplicationUpdate msg;
+
+    msg.status_change(static_cast<int32_t>(common::Application::Status::ACTIVE));
+    for (const std::string& process : _application.active_processes) {
+      msg.process_id(process);
+      worker.ipc_write().send(msg);
+      _update_pending_send(worker);
+    }
+
+    msg.status_change(static_cast<int32_t>(common::Application::Status::SWAPPED));
+    for (const std::string& process : _application.swapped_processes) {
+      msg.process_id(process);
+      worker.ipc_write().send(msg);
+      _update_pending_send(worker);
+    }
+  }
+
+  int Controller::_wait_events(epoll_event* events, int max_events)
+  {
+    // Messages arriving shortly after the last event do not pay for a wakeup.
+    if (_spin_time.count() > 0) {
+
+      auto end = std::chrono::steady_clock::now() + _spin_time;
+      do {
+        int events_count = epoll_wait(_epoll_fd, events, max_events, 0);
+        if (events_count != 0) {
+          return events_count;
+        }
+      } while (!_ending && std::chrono::steady_clock::now() < end);
+    }
+
+    // Wake up to grow the pool when invocations keep waiting, or to stop idle workers.
+    int timeout = EPOLL_TIMEOUT;
+    bool backlog = _work_queue.ready_invocations() > 0;
+    if (_scaling.enabled()) {
+      timeout = std::min(timeout, backlog ? _scaling.scale_up_delay_ms : _scaling.idle_timeout_ms);
+    }
+
+    // Invocations waiting for a warm worker take an idle one when the wait ends.
+    if (backlog && _workers.has_idle_workers()) {
+      auto wait = std::chrono::ceil<std::chrono::milliseconds>(_affinity_wait).count();
+      timeout = std::min(timeout, std::max(1, static_cast<int>(wait)));
+    }
+
+    auto wait_until = [&timeout](std::chrono::steady_clock::time_point time) {
+      auto remaining = time - std::chrono::steady_clock::now();
+      auto wait = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+      timeout = std::min(timeout, std::max(1, static_cast<int>(wait)));
+    };
+
+    // Incomplete batches are dispatched when their oldest invocation waited long enough.
+    auto batch_deadline = _work_queue.next_batch_deadline();
+    if (batch_deadline.has_value()) {
+      wait_until(batch_deadline.value());
+    }
+
+    // Invocations approaching their deadline move to the highest class.
+    auto urgent_deadline = _work_queue.next_urgent_deadline();
+    if (urgent_deadline.has_value()) {
+      wait_until(urgent_deadline.value());
+    }
+
+    // Workers stuck in an invocation are replaced once it times out.
+    auto worker_timeout = _workers.next_timeout();
+    if (worker_timeout.has_value()) {
+      wait_until(worker_timeout.value());
+    }
+
+    return epoll_wait(_epoll_fd, events, max_events, timeout);
+  }
+
+  void Controller::_update_pending_send(FunctionWorker& worker)
+  {
+    bool pending = worker.ipc_write().queued_bytes() > 0;
+    if (pending == worker.send_pending()) {
+      return;
+    }
+
+    SPDLOG_LOGGER_DEBUG(
+        _logger, "Worker {} {} messages, {} bytes queued", worker.pid(),
+        pending ? "cannot accept" : "accepted all", worker.ipc_write().queued_bytes()
+    );
+
+    common::util::assert_true(
+        epoll_mod(
+            _epoll_fd, worker.ipc_write().fd(), &worker,
+            pending ? worker.ipc_write().flush_events() : 0
+        )
+    );
+    worker.send_pending(pending);
+  }
+
   void Controller::start()
   {
+    // Threads started before, e.g., IO loops, keep their own placement.
+    if (!_placement.controller_cpus.empty()) {
+      _logger->info("Pinning the controller to CPUs {}", _placement.controller_cpus.str());
+      if (_placement.controller_cpus.pin() && _placement.local_memory) {
+        runtime::internal::use_local_memory();
+      }
+    }
+
     poll();
   }
 
@@ -543,6 +785,10 @@ namespace praas::process {
   {
     _ending = true;
 
+    // Server threads blocked on a full queue drop their messages.
+    _external_queue.close();
+    _app_updates.close();
+
     _logger->info("Closing controller polling.");
   }
 
@@ -561,13 +807,25 @@ namespace praas::process {
     _pending_msgs.insert_invocation(req.invocation_id(), worker);
     if (req.process_id() == SELF_PROCESS || req.process_id() == _process_id) {
 
-      auto res = _work_queue.add_payload(
-          std::string{req.function_name()}, std::string{req.invocation_id()}, std::move(payload),
-          InvocationSource::from_local()
-      );
+      // The caller is identified by the invocation running in the slot that sent the request.
+      std::optional<std::string> caller;
+      const Invocation* calling = worker.invocation(req.caller_id());
+      if (calling) {
+        caller = std::string{calling->req.function_name()};
+      }
+
+      int return_code = common::message::InvocationResultData::OVERLOADED;
+      auto res = _admit(std::string{req.invocation_id()}, payload.len);
+      if (!res.has_value()) {
+        return_code = -1;
+        res = _work_queue.add_payload(
+            std::string{req.function_name()}, std::string{req.invocation_id()},
+            std::move(payload), InvocationSource::from_local(std::move(caller))
+        );
+      }
       if (res.has_value()) {
         _process_invocation_result(
-            InvocationSource::from_local(), req.invocation_id(), -1,
+            InvocationSource::from_local(), req.invocation_id(), return_code,
             runtime::internal::BufferAccessor<const char>{res.value().data(), res.value().size()}
         );
       }
@@ -580,6 +838,23 @@ namespace praas::process {
     }
   }
 
+  std::optional<std::string>
+  Controller::_admit(const std::string& invocation_id, size_t bytes) const
+  {
+    // An elastic pool grows to drain the queue.
+    size_t workers = _workers.size();
+    if (_scaling.enabled()) {
+      workers = std::max(workers, static_cast<size_t>(_scaling.max_workers));
+    }
+    workers *= _workers.worker_slots();
+
+    auto res = _work_queue.admit(invocation_id, bytes, _mailbox.bytes(), workers);
+    if (res.has_value()) {
+      _logger->warn("Rejecting invocation {}: {}", invocation_id, res.value());
+    }
+    return res;
+  }
+
   // Store the message data, and check if there is a pending invocation waiting for this result
   // FIXME: this should be a single type
   void Controller::_process_put(
@@ -601,12 +876,13 @@ namespace praas::process {
             _logger, "Stored a state message to {}, with key {}, length {}", _process_id,
             req.name(), length
         );
+        _work_queue.state_produced(std::string{req.name()});
       }
 
     } else if (req.process_id() == SELF_PROCESS || req.process_id() == _process_id) {
 
       // Is there are pending message for this message?
-      const FunctionWorker* pending_worker =
+      FunctionWorker* pending_worker =
           _pending_msgs.find_get(std::string{req.name()}, _process_id);
       if (pending_worker) {
 
@@ -620,6 +896,7 @@ namespace praas::process {
         return_req.name(req.name());
 
         pending_worker->ipc_write().send(return_req, std::move(payload));
+        _update_pending_send(*pending_worker);
 
       } else {
 
@@ -656,7 +933,7 @@ namespace praas::process {
 
     } else {
 
-      std::vector<const FunctionWorker*> pending_workers;
+      std::vector<FunctionWorker*> pending_workers;
       _pending_msgs.find_invocation(invocation_id, pending_workers);
 
       // FIXME: remove this double message, our message types are broken
@@ -665,7 +942,7 @@ namespace praas::process {
       result.return_code(return_code);
       result.buffer_length(payload.len);
 
-      for (const FunctionWorker* worker : pending_workers) {
+      for (FunctionWorker* worker : pending_workers) {
 
         SPDLOG_LOGGER_DEBUG(
             _logger, "Replying invocation locally with key {}, message len {}",
@@ -673,6 +950,7 @@ namespace praas::process {
         );
 
         worker->ipc_write().send(result, payload);
+        _update_pending_send(*worker);
       }
     }
   }
@@ -687,14 +965,224 @@ namespace praas::process {
         return_code, payload.len
     );
 
+    // The slot refers to the invocation - free it before the invocation is removed.
+    _workers.finish(worker, invocation_id);
+
     std::optional<Invocation> invoc = _work_queue.finish(std::string{invocation_id});
     if (invoc.has_value()) {
+
       Invocation& invocation = invoc.value();
-      _process_invocation_result(invocation.source, invocation_id, return_code, payload);
+      if (return_code == 0) {
+        _work_queue.function_produced(std::string{invocation.req.function_name()}, payload);
+      }
+
+      if (return_code == 0 &&
+          invocation.trigger->type() == runtime::internal::Trigger::Type::PIPELINE) {
+        _process_pipeline_stage(invocation, payload);
+      } else {
+        _process_invocation_result(invocation, return_code, payload);
+      }
+
     } else {
       _logger->error("Could not find invocation for ID {}", invocation_id);
     }
-    _workers.finish(worker);
+  }
+
+  void Controller::_process_invocation_result(
+      const Invocation& invocation, int return_code,
+      runtime::internal::BufferAccessor<const char> payload
+  )
+  {
+    std::string_view invocation_id = invocation.req.invocation_id();
+
+    _process_invocation_result(invocation.source, invocation_id, return_code, payload);
+    for (const InvocationSource& caller : invocation.remote_callers) {
+      _process_invocation_result(caller, invocation_id, return_code, payload);
+    }
+  }
+
+  void Controller::_process_pipeline_stage(
+      Invocation& invocation, runtime::internal::BufferAccessor<const char> output
+  )
+  {
+    // The output is owned by the worker's message - the next stage needs its own copy.
+    auto buf = _buffers.retrieve_buffer(output.len);
+    std::copy(output.ptr, output.ptr + output.len, buf.data());
+    buf.len = output.len;
+
+    auto res = _work_queue.add_stage(invocation, std::move(buf));
+    if (res.has_value()) {
+      _process_invocation_result(
+          invocation, -1,
+          runtime::internal::BufferAccessor<const char>{res.value().data(), res.value().size()}
+      );
+    }
+  }
+
+  void Controller::_cancel_invocation(const std::string& invocation_id)
+  {
+    if (_workers.cancel(invocation_id)) {
+      SPDLOG_LOGGER_DEBUG(_logger, "Cancelling running invocation {}", invocation_id);
+      return;
+    }
+
+    std::optional<Invocation> invoc = _work_queue.cancel(invocation_id);
+    if (!invoc.has_value()) {
+      _logger->warn("Cannot cancel invocation {} - it does not exist", invocation_id);
+      return;
+    }
+
+    SPDLOG_LOGGER_DEBUG(_logger, "Cancelled pending invocation {}", invocation_id);
+    std::string_view error = "Invocation cancelled";
+    _process_invocation_result(
+        invoc.value(), -1, runtime::internal::BufferAccessor<const char>{error.data(), error.size()}
+    );
+  }
+
+  void Controller::_replace_stuck_workers()
+  {
+    auto now = std::chrono::steady_clock::now();
+    while (FunctionWorker* worker = _workers.stuck_worker(now)) {
+
+      // Invocations of the batch, and of other slots of the worker, fail together.
+      std::vector<std::string> keys;
+      for (const Invocation* invocation : worker->invocations()) {
+        keys.emplace_back(invocation->req.invocation_id());
+        for (const Invocation* batched : invocation->batch) {
+          keys.emplace_back(batched->req.invocation_id());
+        }
+      }
+
+      std::string error;
+      if (worker->failed()) {
+        error = "Worker failed";
+      } else {
+        error = fmt::format("Invocation {}", worker->cancelled() ? "cancelled" : "timed out");
+      }
+      _logger->warn(
+          "{}: {}, replacing worker {}", error, keys.empty() ? "" : keys.front(), worker->pid()
+      );
+
+      // User code cannot be interrupted - the worker and its pending messages are dropped.
+      _unregister_worker(*worker);
+      _pending_msgs.remove_worker(*worker);
+      _workers.terminate(*worker);
+
+      for (const std::string& key : keys) {
+        std::optional<Invocation> invoc = _work_queue.finish(key);
+        if (invoc.has_value()) {
+          _process_invocation_result(
+              invoc.value(), -1,
+              runtime::internal::BufferAccessor<const char>{error.data(), error.size()}
+          );
+        }
+      }
+
+      FunctionWorker& replacement = _workers.add_worker();
+      _register_worker(replacement);
+      _send_application_status(replacement);
+    }
+  }
+
+  void Controller::_process_batch_result(
+      FunctionWorker& worker, int invocations, const runtime::internal::Buffer<char>& payload
+  )
+  {
+    struct BatchResult {
+      std::string_view invocation_id;
+      int return_code;
+      runtime::internal::BufferAccessor<const char> payload;
+    };
+
+    const char* ptr = payload.data();
+    const char* end = ptr + payload.len;
+
+    std::vector<BatchResult> results;
+    for (int i = 0; i < invocations; ++i) {
+
+      if (ptr + runtime::internal::ipc::Message::BUF_SIZE > end) {
+        _logger->error("Batch result ended after {} of {} invocations", i, invocations);
+        break;
+      }
+
+      // NOLINTNEXTLINE
+      auto parsed_msg = runtime::internal::ipc::Message::parse_message(
+          reinterpret_cast<const int8_t*>(ptr)
+      );
+      if (!std::holds_alternative<runtime::internal::ipc::InvocationResultParsed>(parsed_msg)) {
+        _logger->error("Batch result contains an incorrect message");
+        break;
+      }
+      ptr += runtime::internal::ipc::Message::BUF_SIZE;
+
+      auto& res = std::get<runtime::internal::ipc::InvocationResultParsed>(parsed_msg);
+      size_t len =
+          std::min(static_cast<size_t>(res.buffer_length()), static_cast<size_t>(end - ptr));
+      results.push_back(
+          {res.invocation_id(), res.return_code(),
+           runtime::internal::BufferAccessor<const char>{ptr, len}}
+      );
+      ptr += len;
+    }
+
+    // The slot is held by the dispatched batch, not by the output of the worker. With several
+    // batches running, the first result tells them apart - without one, take the oldest batch.
+    // Keys are copied, because results remove the invocations.
+    std::vector<std::string> keys;
+    for (const Invocation* invocation : worker.invocations()) {
+
+      if (invocation->batch.empty()) {
+        continue;
+      }
+
+      std::vector<std::string> batch_keys{std::string{invocation->req.invocation_id()}};
+      for (const Invocation* batched : invocation->batch) {
+        batch_keys.emplace_back(batched->req.invocation_id());
+      }
+
+      bool matches =
+          !results.empty() &&
+          std::find(batch_keys.begin(), batch_keys.end(), results.front().invocation_id) !=
+              batch_keys.end();
+      if (keys.empty() || matches) {
+        keys = std::move(batch_keys);
+      }
+      if (matches) {
+        break;
+      }
+    }
+
+    for (const BatchResult& res : results) {
+      _process_invocation_result(worker, res.invocation_id, res.return_code, res.payload);
+    }
+
+    if (keys.empty()) {
+      _logger->error("Worker {} returned a batch result without a running batch", worker.pid());
+      return;
+    }
+
+    // Release the slot also when the batch was incomplete - before its invocation is removed.
+    _workers.finish(worker, keys.front());
+
+    // Invocations without a result fail - the caller should not wait for them forever.
+    std::string_view error = "Batch result is incomplete";
+    for (const std::string& key : keys) {
+
+      bool produced = std::any_of(results.begin(), results.end(), [&](const BatchResult& res) {
+        return res.invocation_id == key;
+      });
+      if (produced) {
+        continue;
+      }
+
+      std::optional<Invocation> invoc = _work_queue.finish(key);
+      if (invoc.has_value()) {
+        _process_invocation_result(
+            invoc.value(), -1,
+            runtime::internal::BufferAccessor<const char>{error.data(), error.size()}
+        );
+      }
+    }
   }
 
 } // namespace praas::process
@@ -36,7 +36,7 @@ namespace praas::process::message {
     );
   }
 
-  const FunctionWorker* PendingMessages::find_get(const std::string& key, std::string_view source)
+  FunctionWorker* PendingMessages::find_get(const std::string& key, std::string_view source)
   {
     auto [begin, end] = _msgs.equal_range(key);
 
@@ -61,7 +61,7 @@ namespace praas::process::message {
   }
 
   void
-  PendingMessages::find_invocation(std::string_view key, std::vector<const FunctionWorker*>& output)
+  PendingMessages::find_invocation(std::string_view key, std::vector<FunctionWorker*>& output)
   {
     // Invocations
     auto [begin, end] = _msgs.equal_range(std::string{key});
@@ -75,17 +75,32 @@ namespace praas::process::message {
     _msgs.erase(begin, end);
   }
 
+  void PendingMessages::remove_worker(const FunctionWorker& worker)
+  {
+    std::erase_if(_msgs, [&worker](const auto& msg) { return msg.second.worker == &worker; });
+  }
+
   bool MessageStore::put(
       const std::string& key, const std::string& source, runtime::internal::Buffer<char>& payload
   )
   {
+    size_t length = payload.len;
     auto [it, success] = _msgs.try_emplace(key, source, std::move(payload));
+    if (success) {
+      _bytes += length;
+    }
     return success;
   }
 
   bool MessageStore::state(const std::string& key, runtime::internal::Buffer<char>& payload)
   {
     // TODO: document breaking change - state now overwrites
+    auto existing = _msgs.find(key);
+    if (existing != _msgs.end()) {
+      _bytes -= existing->second.data.len;
+    }
+    _bytes += payload.len;
+
     auto [it, emplaced] = _msgs.insert_or_assign(key, Message{"", std::move(payload)});
     auto time = std::chrono::system_clock::now();
     auto timestamp =
@@ -122,6 +137,7 @@ namespace praas::process::message {
 
     auto buf = std::move((*it).second.data);
     _msgs.erase(it);
+    _bytes -= buf.len;
     return buf;
   }
 
@@ -2,10 +2,13 @@
 
 #include <praas/common/application.hpp>
 #include <praas/common/messages.hpp>
+#include <praas/common/sockets.hpp>
 #include <praas/common/util.hpp>
 #include <praas/process/controller/controller.hpp>
 #include <praas/process/runtime/internal/buffer.hpp>
 
+#include <algorithm>
+#include <tuple>
 #include <variant>
 
 #include <spdlog/spdlog.h>
@@ -15,10 +18,12 @@ namespace praas::process::remote {
 
   TCPServer::TCPServer(Controller& controller, const config::Controller& cfg)
       : _is_running(true), _controller(controller),
-        _server(_loop_thread.getLoop(), trantor::InetAddress(cfg.port), "tcpserver")
+        _server(_loop_thread.getLoop(), trantor::InetAddress(cfg.port), "tcpserver"),
+        _io_cpus(cfg.placement.io_cpus), _local_memory(cfg.placement.local_memory)
   {
-    // FIXME: do I need to configure this?
-    _server.setIoLoopNum(1);
+    // Connections are assigned to IO loops in a round-robin fashion.
+    _server.setIoLoopNum(cfg.io_threads);
+    _io_loops = _server.getIoLoops();
 
     _server.setConnectionCallback([this](const trantor::TcpConnectionPtr& connectionPtr) {
       if (connectionPtr->connected()) {
@@ -80,6 +85,7 @@ namespace praas::process::remote {
     _logger->info("TCP server is starting!");
     _loop_thread.run();
     _server.start();
+    _pin_io_loops();
 
     if (!control_plane_address.has_value()) {
       spdlog::warn("Missing control plane address!");
@@ -95,13 +101,18 @@ namespace praas::process::remote {
         Connection::Status::CONNECTING, RemoteType::CONTROL_PLANE, std::nullopt, nullptr
     );
 
-    _control_plane = conn;
-    auto [iter, inserted] = _connection_data.emplace("CONTROLPLANE", std::move(conn));
-    common::util::assert_true(inserted);
+    decltype(_connection_data)::iterator iter;
+    {
+      std::unique_lock<std::mutex> lock{_conn_mutex};
+
+      _control_plane = conn;
+      bool inserted = false;
+      std::tie(iter, inserted) = _connection_data.emplace("CONTROLPLANE", std::move(conn));
+      common::util::assert_true(inserted);
+    }
 
     (*iter).second->client = std::make_shared<trantor::TcpClient>(
-        this->_server.getLoop(), trantor::InetAddress{address, static_cast<uint16_t>(port)},
-        "client"
+        _next_io_loop(), trantor::InetAddress{address, static_cast<uint16_t>(port)}, "client"
     );
 
     std::promise<void> connected;
@@ -126,6 +137,7 @@ namespace praas::process::remote {
 
           } else {
             _logger->error("Terminated connection to control plane!");
+            std::unique_lock<std::mutex> lock{_conn_mutex};
             _control_plane.reset();
           }
         }
@@ -190,16 +202,13 @@ namespace praas::process::remote {
 
     bool consumed = false;
 
-    // Checking if we have enough bytes
-    if (conn->bytes_to_read > 0) {
-
-      if (buffer->readableBytes() < conn->bytes_to_read)
-        return;
+    // Payload of the current message is still arriving.
+    if (!conn->payload.null()) {
 
       // Three types of messages require long payloads:
       // invoke
       // put
-      std::visit(
+      consumed = std::visit(
           common::message::overloaded{
               [this, buffer, conn = conn.get()](common::message::InvocationRequestPtr& invoc
               ) mutable -> bool { return _handle_invocation(*conn, invoc, buffer); },
@@ -228,6 +237,8 @@ namespace praas::process::remote {
               ) mutable -> bool { return _handle_invocation_result(*conn, invoc, buffer); },
               [this, buffer, conn = conn.get()](common::message::PutMessagePtr& req
               ) mutable -> bool { return _handle_put_message(*conn, req, buffer); },
+              [this, buffer, conn = conn.get()](common::message::InvocationCancelPtr& req
+              ) mutable -> bool { return _handle_invocation_cancel(*conn, req, buffer); },
               [connectionPtr, this,
                buffer](common::message::ProcessConnectionPtr& msg) mutable -> bool {
                 // Connection always consumed a message
@@ -264,38 +275,17 @@ namespace praas::process::remote {
       Connection& connection, common::message::InvocationRequestPtr msg, trantor::MsgBuffer* buffer
   )
   {
-    // We just started
-    if (connection.bytes_to_read == 0) {
-
-      connection.bytes_to_read = msg.payload_size();
-
-      buffer->retrieve(praas::common::message::MessageConfig::BUF_SIZE);
-    }
-
     // Check that we have the payload
-    if (buffer->readableBytes() >= msg.payload_size()) {
+    if (_receive_payload(connection, msg.payload_size(), buffer)) {
 
-      auto buf = _buffers.retrieve_buffer(msg.payload_size());
-      std::copy_n(buffer->peek(), msg.payload_size(), buf.data());
-      buf.len = msg.payload_size();
-      buffer->retrieve(msg.payload_size());
+      auto buf = std::move(connection.payload);
 
       SPDLOG_LOGGER_DEBUG(
           _logger, "Received complete invocation request of {}, with {} bytes of input",
           msg.function_name(), msg.payload_size()
       );
 
-      if (connection.type == RemoteType::DATA_PLANE) {
-        _controller.dataplane_message(std::move(connection.cur_msg), std::move(buf));
-      } else if (connection.type == RemoteType::CONTROL_PLANE) {
-        _controller.controlplane_message(std::move(connection.cur_msg), std::move(buf));
-      } else {
-        _controller.remote_message(
-            std::move(connection.cur_msg), std::move(buf), connection.id.value()
-        );
-      }
-
-      connection.bytes_to_read = 0;
+      _forward(connection, std::move(buf));
 
       return true;
     }
@@ -309,21 +299,10 @@ namespace praas::process::remote {
       Connection& connection, common::message::InvocationResultPtr msg, trantor::MsgBuffer* buffer
   )
   {
-    // We just started
-    if (connection.bytes_to_read == 0) {
-
-      connection.bytes_to_read = msg.total_length();
-
-      buffer->retrieve(praas::common::message::MessageConfig::BUF_SIZE);
-    }
-
     // Check that we have the payload
-    if (buffer->readableBytes() >= connection.bytes_to_read) {
+    if (_receive_payload(connection, msg.total_length(), buffer)) {
 
-      auto buf = _buffers.retrieve_buffer(connection.bytes_to_read);
-      std::copy_n(buffer->peek(), connection.bytes_to_read, buf.data());
-      buf.len = connection.bytes_to_read;
-      buffer->retrieve(connection.bytes_to_read);
+      auto buf = std::move(connection.payload);
 
       SPDLOG_LOGGER_DEBUG(
           _logger, "Received invocation result for id {}, with {} bytes of input",
@@ -334,8 +313,6 @@ namespace praas::process::remote {
           std::move(connection.cur_msg), std::move(buf), connection.id.value()
       );
 
-      connection.bytes_to_read = 0;
-
       return true;
     }
     // Not enough payload, not consumed
@@ -348,28 +325,15 @@ namespace praas::process::remote {
       Connection& connection, common::message::PutMessagePtr msg, trantor::MsgBuffer* buffer
   )
   {
-    // We just started
-    if (connection.bytes_to_read == 0) {
-
-      connection.bytes_to_read = msg.total_length();
-
-      buffer->retrieve(praas::common::message::MessageConfig::BUF_SIZE);
-    }
-
     // Check that we have the payload
-    if (buffer->readableBytes() >= connection.bytes_to_read) {
+    if (_receive_payload(connection, msg.total_length(), buffer)) {
 
-      auto buf = _buffers.retrieve_buffer(connection.bytes_to_read);
-      std::copy_n(buffer->peek(), connection.bytes_to_read, buf.data());
-      buf.len = connection.bytes_to_read;
-      buffer->retrieve(connection.bytes_to_read);
+      auto buf = std::move(connection.payload);
 
       _controller.remote_message(
           std::move(connection.cur_msg), std::move(buf), connection.id.value()
       );
 
-      connection.bytes_to_read = 0;
-
       SPDLOG_LOGGER_DEBUG(
           _logger, "Finished processing PUT, {} remaining bytes", buffer->readableBytes()
       );
@@ -379,6 +343,55 @@ namespace praas::process::remote {
     return false;
   }
 
+  bool TCPServer::_handle_invocation_cancel(
+      Connection& connection, common::message::InvocationCancelPtr msg, trantor::MsgBuffer* buffer
+  )
+  {
+    SPDLOG_LOGGER_DEBUG(_logger, "Received cancellation of invocation {}", msg.invocation_id());
+
+    // Header-only message
+    buffer->retrieve(praas::common::message::MessageConfig::BUF_SIZE);
+    _forward(connection, runtime::internal::Buffer<char>{});
+
+    return true;
+  }
+
+  void TCPServer::_forward(Connection& connection, runtime::internal::Buffer<char>&& payload)
+  {
+    if (connection.type == RemoteType::DATA_PLANE) {
+      _controller.dataplane_message(std::move(connection.cur_msg), std::move(payload));
+    } else if (connection.type == RemoteType::CONTROL_PLANE) {
+      _controller.controlplane_message(std::move(connection.cur_msg), std::move(payload));
+    } else {
+      _controller.remote_message(
+          std::move(connection.cur_msg), std::move(payload), connection.id.value()
+      );
+    }
+  }
+
+  bool TCPServer::_receive_payload(
+      Connection& connection, size_t payload_size, trantor::MsgBuffer* buffer
+  )
+  {
+    // We just started - the header announced the length, allocate the destination once.
+    if (connection.payload.null()) {
+
+      buffer->retrieve(praas::common::message::MessageConfig::BUF_SIZE);
+
+      connection.payload = _buffers.retrieve_buffer(payload_size);
+      connection.bytes_to_read = payload_size;
+    }
+
+    // Move whatever arrived - trantor's buffer never grows to hold the entire payload.
+    size_t size = std::min(buffer->readableBytes(), connection.bytes_to_read);
+    std::copy_n(buffer->peek(), size, connection.payload.data() + connection.payload.len);
+    connection.payload.len += size;
+    connection.bytes_to_read -= size;
+    buffer->retrieve(size);
+
+    return connection.bytes_to_read == 0;
+  }
+
   bool TCPServer::_handle_connection(
       const trantor::TcpConnectionPtr& connectionPtr, common::message::ProcessConnectionPtr msg
   )
@@ -472,10 +485,9 @@ namespace praas::process::remote {
     req.return_code(return_code);
     req.total_length(payload.len);
 
-    conn->conn->send(req.bytes(), req.BUF_SIZE);
-    if (payload.len > 0) {
-      conn->conn->send(payload.data(), payload.len);
-    }
+    common::sockets::send_message(
+        *conn->conn, req.bytes(), req.BUF_SIZE, payload.data(), payload.len
+    );
   }
 
   bool TCPServer::_handle_app_update(
@@ -542,8 +554,10 @@ namespace praas::process::remote {
       put_req.total_length(payload.len);
       SPDLOG_LOGGER_DEBUG(_logger, "Send PUT message {} with payload len {}", name, payload.len);
 
-      conn->conn->send(put_req.bytes(), praas::common::message::MessageConfig::BUF_SIZE);
-      conn->conn->send(payload.data(), payload.len);
+      common::sockets::send_message(
+          *conn->conn, put_req.bytes(), praas::common::message::MessageConfig::BUF_SIZE,
+          payload.data(), payload.len
+      );
     }
   }
 
@@ -592,22 +606,51 @@ namespace praas::process::remote {
           _logger, "Send invocation request message with payload len {}", payload.len
       );
 
-      conn->conn->send(req.bytes(), praas::common::message::MessageConfig::BUF_SIZE);
-      conn->conn->send(payload.data(), payload.len);
+      common::sockets::send_message(
+          *conn->conn, req.bytes(), praas::common::message::MessageConfig::BUF_SIZE,
+          payload.data(), payload.len
+      );
     }
   }
 
+  void TCPServer::_pin_io_loops()
+  {
+    if (_io_cpus.empty()) {
+      return;
+    }
+    _logger->info("Pinning IO loops to CPUs {}", _io_cpus.str());
+
+    // Each loop pins its own thread. The accepting loop shares all CPUs of IO loops.
+    auto pin = [local_memory = _local_memory](const runtime::internal::CPUSet& cpus) {
+      if (cpus.pin() && local_memory) {
+        runtime::internal::use_local_memory();
+      }
+    };
+    _loop_thread.getLoop()->runInLoop([pin, cpus = _io_cpus]() { pin(cpus); });
+    for (size_t i = 0; i < _io_loops.size(); ++i) {
+      _io_loops[i]->runInLoop([pin, cpus = _io_cpus.select(i)]() { pin(cpus); });
+    }
+  }
+
+  trantor::EventLoop* TCPServer::_next_io_loop()
+  {
+    return _io_loops[_io_loop_counter++ % _io_loops.size()];
+  }
+
   void TCPServer::_connect(Connection* conn)
   {
 
     conn->status = Connection::Status::CONNECTING;
     conn->client = std::make_shared<trantor::TcpClient>(
-        this->_server.getLoop(),
-        trantor::InetAddress{conn->ip_address, static_cast<uint16_t>(conn->port)}, "client"
+        _next_io_loop(), trantor::InetAddress{conn->ip_address, static_cast<uint16_t>(conn->port)},
+        "client"
     );
 
     conn->client->setConnectionCallback(
         [this, connection = conn](const trantor::TcpConnectionPtr& conn) -> void {
+          // Senders store pending messages while holding the lock.
+          std::unique_lock<std::mutex> lock{_conn_mutex};
+
           if (conn->connected()) {
 
             connection->status = Connection::Status::CONNECTED;
@@ -624,10 +667,10 @@ namespace praas::process::remote {
 
               auto& msg = std::get<0>(pending_msg);
               auto& buf = std::get<1>(pending_msg);
-              conn->send(msg.data(), praas::common::message::MessageConfig::BUF_SIZE);
-              if (buf.len > 0) {
-                conn->send(buf.data(), buf.len);
-              }
+              common::sockets::send_message(
+                  *conn, msg.data(), praas::common::message::MessageConfig::BUF_SIZE, buf.data(),
+                  buf.len
+              );
             }
             connection->pendings_msgs.clear();
 
@@ -5,6 +5,8 @@
 #include <praas/process/runtime/internal/buffer.hpp>
 #include <praas/process/runtime/internal/functions.hpp>
 
+#include <algorithm>
+#include <array>
 #include <filesystem>
 #include <fstream>
 #include <optional>
@@ -12,7 +14,9 @@
 #include <cereal/archives/json.hpp>
 #include <spdlog/spdlog.h>
 
+#include <fcntl.h>
 #include <sys/signal.h>
+#include <sys/socket.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -20,29 +24,54 @@ namespace praas::process {
 
   std::optional<std::string> WorkQueue::add_payload(
       const std::string& fname, const std::string& key, runtime::internal::Buffer<char>&& buffer,
-      InvocationSource&& source
+      InvocationSource&& source, InvocationScheduling scheduling
   )
   {
     auto it = _active_invocations.find(key);
+    size_t bytes = buffer.len;
 
     // Extend an existing pending invocation
     // FIXME: bug when we schedule two functions with the same key?
     if (it != _active_invocations.end() && !(*it).second.active) {
-      it->second.payload.push_back(std::move(buffer));
+
+      Invocation& invocation = it->second;
+      if (invocation.trigger->type() == runtime::internal::Trigger::Type::MULTI_SOURCE) {
+        auto res = _add_source_payload(
+            invocation,
+            *static_cast<const runtime::internal::MultiSourceTrigger*>(invocation.trigger),
+            std::move(buffer), source
+        );
+        if (res.has_value()) {
+          return res;
+        }
+      } else {
+        invocation.payload.push_back(std::move(buffer));
+      }
+      invocation.received_bytes += bytes;
+      _queued_bytes += bytes;
+
+      if (source.is_remote()) {
+        invocation.remote_callers.push_back(std::move(source));
+      }
+
+      if (!invocation.ready) {
+        _check_trigger(invocation);
+      }
     }
     // Create a new invocation
     else {
 
-      const runtime::internal::Trigger* trigger = _functions.get_trigger(fname);
-      if (!trigger) {
+      const runtime::internal::Function* func = _functions.get_function(fname);
+      if (!func) {
         std::string msg = fmt::format("Ignoring invocation of an unknown function {}", fname);
         spdlog::error(msg);
         return msg;
       }
+      const runtime::internal::Trigger* trigger = func->trigger.get();
 
       auto [it, inserted] = _active_invocations.emplace(
           std::piecewise_construct, std::forward_as_tuple(key),
-          std::forward_as_tuple(fname, key, trigger, std::move(source))
+          std::forward_as_tuple(fname, key, trigger, std::move(source), scheduling)
       );
 
       if (!inserted) {
@@ -51,113 +80,1053 @@ namespace praas::process {
         spdlog::error(msg);
         return msg;
       }
-      SPDLOG_DEBUG("Inserted a new invocation {} for function {}", key, fname);
+      SPDLOG_DEBUG("Inserted a new invocation {} for function {}", key, fname);
+
+      it->second.timeout = scheduling.timeout.count() > 0
+                               ? scheduling.timeout
+                               : std::chrono::milliseconds{func->timeout_ms};
+
+      if (trigger->type() == runtime::internal::Trigger::Type::MULTI_SOURCE) {
+        auto res = _add_source_payload(
+            it->second, *static_cast<const runtime::internal::MultiSourceTrigger*>(trigger),
+            std::move(buffer), it->second.source
+        );
+        if (res.has_value()) {
+          _active_invocations.erase(it);
+          return res;
+        }
+      } else {
+        it->second.payload.push_back(std::move(buffer));
+      }
+      it->second.received_bytes = bytes;
+      _queued_bytes += bytes;
+
+      it->second.start();
+
+      auto [queue, created] = _ready_queues.try_emplace(fname);
+      FunctionQueue& function = queue->second;
+      if (created) {
+        function.function = queue->first;
+        function.max_concurrency = func->max_concurrency;
+        function.reserved_workers = func->reserved_workers;
+        function.thread = func->execution == runtime::internal::Execution::THREAD;
+        for (size_t i = 0; i < FunctionQueue::PRIORITY_CLASSES; ++i) {
+          function.classes[i].function = &function;
+          function.classes[i].priority = i;
+        }
+      }
+      if (created && trigger->type() == runtime::internal::Trigger::Type::BATCH) {
+        for (ReadyQueue& ready_queue : function.classes) {
+          ready_queue.batch = static_cast<const runtime::internal::BatchTrigger*>(trigger);
+          _batch_queues.push_back(&ready_queue);
+        }
+      }
+      it->second.queue = &function.classes[FunctionQueue::priority_class(scheduling.priority)];
+
+      _check_trigger(it->second);
+    }
+
+    return std::nullopt;
+  }
+
+  std::optional<std::string> WorkQueue::admit(
+      const std::string& key, size_t bytes, size_t stored_bytes, size_t workers
+  ) const
+  {
+    if (_admission.max_queued_bytes > 0 &&
+        _queued_bytes + stored_bytes + bytes > _admission.max_queued_bytes) {
+      return fmt::format("Queued payload would exceed {} bytes", _admission.max_queued_bytes);
+    }
+
+    // Payload of a pending invocation does not add new work.
+    auto it = _active_invocations.find(key);
+    if (it != _active_invocations.end() && !it->second.active) {
+      return std::nullopt;
+    }
+
+    if (_admission.max_queued_invocations > 0 &&
+        queued_invocations() >= static_cast<size_t>(_admission.max_queued_invocations)) {
+      return fmt::format("Too many queued invocations: {}", queued_invocations());
+    }
+
+    if (_admission.max_wait_ms > 0) {
+      auto wait = estimated_wait(workers);
+      if (wait > std::chrono::milliseconds{_admission.max_wait_ms}) {
+        return fmt::format(
+            "Estimated wait of {} ms exceeds {} ms",
+            std::chrono::duration_cast<std::chrono::milliseconds>(wait).count(),
+            _admission.max_wait_ms
+        );
+      }
+    }
+
+    return std::nullopt;
+  }
+
+  std::chrono::microseconds WorkQueue::estimated_wait(size_t workers) const
+  {
+    return _execution_time * static_cast<int64_t>(queued_invocations()) /
+           static_cast<int64_t>(std::max(workers, static_cast<size_t>(1)));
+  }
+
+  std::optional<std::string>
+  WorkQueue::add_stage(Invocation& previous, runtime::internal::Buffer<char>&& output)
+  {
+    const auto* trigger = static_cast<const runtime::internal::PipelineTrigger*>(previous.trigger);
+    const std::string& next = trigger->next();
+    std::string key{previous.req.invocation_id()};
+
+    auto res = add_payload(
+        next, key, std::move(output), InvocationSource{previous.source}, previous.scheduling
+    );
+    if (res.has_value()) {
+      return res;
+    }
+
+    auto it = _active_invocations.find(key);
+    if (it != _active_invocations.end()) {
+      it->second.remote_callers = std::move(previous.remote_callers);
+    }
+
+    return std::nullopt;
+  }
+
+  std::optional<std::string> WorkQueue::_add_source_payload(
+      Invocation& invocation, const runtime::internal::MultiSourceTrigger& trigger,
+      runtime::internal::Buffer<char>&& buffer, const InvocationSource& source
+  )
+  {
+    // Any source - arguments are kept in the order of arrival.
+    if (!trigger.named()) {
+      invocation.payload.push_back(std::move(buffer));
+      return std::nullopt;
+    }
+
+    auto name = source.name();
+    int idx = name.has_value() ? trigger.source_index(name.value()) : -1;
+    if (idx < 0) {
+      std::string msg = fmt::format(
+          "Invocation {} of {} does not expect payload from {}", invocation.req.invocation_id(),
+          invocation.req.function_name(), name.value_or("an unnamed source")
+      );
+      spdlog::error(msg);
+      return msg;
+    }
+
+    if (invocation.received_sources.empty()) {
+      invocation.received_sources.resize(trigger.nargs());
+      invocation.payload.resize(trigger.nargs());
+    }
+
+    if (invocation.received_sources[idx]) {
+      std::string msg = fmt::format(
+          "Invocation {} of {} already received payload from {}", invocation.req.invocation_id(),
+          invocation.req.function_name(), name.value()
+      );
+      spdlog::error(msg);
+      return msg;
+    }
+
+    invocation.payload[idx] = std::move(buffer);
+    invocation.received_sources[idx] = true;
+
+    return std::nullopt;
+  }
+
+  void WorkQueue::_check_trigger(Invocation& invocation)
+  {
+    TriggerChecker visitor{invocation, *this};
+
+    // Check if the function is ready to be invoked
+    invocation.trigger->accept(visitor);
+
+    if (!visitor.ready) {
+      return;
+    }
+
+    _make_ready(invocation);
+  }
+
+  void WorkQueue::_make_ready(Invocation& invocation)
+  {
+    invocation.ready = true;
+    invocation.ready_since = std::chrono::steady_clock::now();
+
+    const auto& deadline = invocation.scheduling.deadline;
+    if (_urgent(invocation, invocation.ready_since)) {
+      invocation.queue = &invocation.queue->function->classes[0];
+    } else if (deadline.has_value() && invocation.queue->priority > 0) {
+      _urgent_deadlines.emplace(
+          deadline.value() - _aging, std::string{invocation.req.invocation_id()}
+      );
+    }
+
+    _enqueue(invocation, invocation.ready_since);
+  }
+
+  void WorkQueue::_enqueue(Invocation& invocation, std::chrono::steady_clock::time_point now)
+  {
+    invocation.class_since = now;
+
+    ReadyQueue& queue = *invocation.queue;
+    queue.invocations.push(&invocation);
+
+    if (queue.scheduled) {
+      ++_ready_invocations;
+    } else if (_can_dispatch(queue, now)) {
+      _schedule(queue);
+    }
+  }
+
+  bool WorkQueue::_urgent(const Invocation& invocation, std::chrono::steady_clock::time_point now)
+      const
+  {
+    const auto& deadline = invocation.scheduling.deadline;
+    return deadline.has_value() && deadline.value() - now <= _aging;
+  }
+
+  void WorkQueue::_unlink(Invocation& invocation)
+  {
+    ReadyQueue& queue = *invocation.queue;
+    queue.invocations.remove(&invocation);
+
+    if (queue.scheduled) {
+      --_ready_invocations;
+      if (queue.invocations.empty()) {
+        _ready_functions[queue.priority].remove(&queue);
+        queue.scheduled = false;
+      }
+    }
+  }
+
+  void WorkQueue::age(std::chrono::steady_clock::time_point now)
+  {
+    // Approaching deadlines are found at any position in the queues.
+    while (!_urgent_deadlines.empty() && _urgent_deadlines.top().first <= now) {
+
+      auto it = _active_invocations.find(_urgent_deadlines.top().second);
+      _urgent_deadlines.pop();
+      if (it == _active_invocations.end()) {
+        continue;
+      }
+
+      // The key might belong to an invocation added after the indexed one finished.
+      Invocation& invocation = it->second;
+      if (invocation.active || !invocation.ready || invocation.queue->priority == 0 ||
+          !_urgent(invocation, now)) {
+        continue;
+      }
+
+      _unlink(invocation);
+      invocation.queue = &invocation.queue->function->classes[0];
+      _enqueue(invocation, now);
+    }
+
+    for (size_t priority = 1; priority < FunctionQueue::PRIORITY_CLASSES; ++priority) {
+
+      // Visit each function of the class once, keeping the round-robin order.
+      auto& functions = _ready_functions[priority];
+      for (size_t i = functions.size(); i > 0; --i) {
+
+        ReadyQueue* queue = functions.pop();
+
+        while (!queue->invocations.empty()) {
+
+          Invocation& head = *queue->invocations.front();
+          size_t target = priority;
+          if (_urgent(head, now)) {
+            target = 0;
+          } else if (now - head.class_since >= _aging) {
+            target = priority - 1;
+          }
+
+          if (target == priority) {
+            break;
+          }
+
+          queue->invocations.pop();
+          --_ready_invocations;
+
+          head.queue = &queue->function->classes[target];
+          _enqueue(head, now);
+        }
+
+        if (queue->invocations.empty()) {
+          queue->scheduled = false;
+        } else {
+          functions.push(queue);
+        }
+      }
+    }
+  }
+
+  DependencyQueue& WorkQueue::_dependency_queue(const std::string& fname)
+  {
+    auto [it, created] = _dependency_queues.try_emplace(fname);
+    if (created) {
+      it->second.trigger =
+          static_cast<const runtime::internal::DependencyTrigger*>(_functions.get_trigger(fname));
+      it->second.outputs.resize(it->second.trigger->functions().size());
+    }
+    return it->second;
+  }
+
+  bool WorkQueue::_dependencies_ready(const DependencyQueue& queue) const
+  {
+    for (const auto& outputs : queue.outputs) {
+      if (outputs.empty()) {
+        return false;
+      }
+    }
+
+    for (const auto& key : queue.trigger->state()) {
+      if (_produced_state.find(key) == _produced_state.end()) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool WorkQueue::_acquire_dependencies(Invocation& invocation, const std::string& fname)
+  {
+    // Additional payload of an invocation that already waits.
+    if (invocation.waits_for_dependencies) {
+      return false;
+    }
+
+    DependencyQueue& queue = _dependency_queue(fname);
+
+    // Earlier invocations consume the outputs first.
+    if (!queue.waiting.empty() || !_dependencies_ready(queue)) {
+      invocation.waits_for_dependencies = true;
+      queue.waiting.push_back(&invocation);
+      return false;
+    }
+
+    for (auto& outputs : queue.outputs) {
+      invocation.payload.push_back(std::move(outputs.front()));
+      outputs.pop_front();
+    }
+    return true;
+  }
+
+  void WorkQueue::_release_dependents(DependencyQueue& queue)
+  {
+    while (!queue.waiting.empty() && _dependencies_ready(queue)) {
+
+      Invocation& invocation = *queue.waiting.front();
+      queue.waiting.pop_front();
+
+      for (auto& outputs : queue.outputs) {
+        invocation.payload.push_back(std::move(outputs.front()));
+        outputs.pop_front();
+      }
+
+      invocation.waits_for_dependencies = false;
+      _make_ready(invocation);
+    }
+  }
+
+  void WorkQueue::function_produced(
+      const std::string& fname, runtime::internal::BufferAccessor<const char> output
+  )
+  {
+    for (const auto& dependent : _functions.function_dependents(fname)) {
+
+      DependencyQueue& queue = _dependency_queue(dependent);
+
+      const auto& upstream = queue.trigger->functions();
+      auto it = std::find(upstream.begin(), upstream.end(), fname);
+      auto& outputs = queue.outputs[std::distance(upstream.begin(), it)];
+      outputs.push_back(output.copy());
+
+      _release_dependents(queue);
+
+      // Waiting invocations consume the oldest outputs - keep them, and a bounded backlog.
+      size_t limit = queue.waiting.size() + queue.trigger->max_outputs();
+      if (outputs.size() > limit) {
+        spdlog::debug(
+            "Dropping {} outputs of {} for dependent function {}", outputs.size() - limit, fname,
+            dependent
+        );
+        outputs.erase(outputs.begin(), outputs.end() - static_cast<std::ptrdiff_t>(limit));
+      }
+    }
+  }
+
+  void WorkQueue::state_produced(const std::string& key)
+  {
+    const auto& dependents = _functions.state_dependents(key);
+    if (dependents.empty() || !_produced_state.insert(key).second) {
+      return;
+    }
+
+    for (const auto& dependent : dependents) {
+      _release_dependents(_dependency_queue(dependent));
+    }
+  }
+
+  bool WorkQueue::_can_dispatch(const ReadyQueue& queue, std::chrono::steady_clock::time_point now)
+  {
+    if (queue.function->at_limit()) {
+      return false;
+    }
+
+    if (!queue.batch) {
+      return true;
+    }
+
+    return queue.invocations.size() >= static_cast<size_t>(queue.batch->size()) ||
+           now - queue.invocations.front()->ready_since >= queue.batch->max_wait();
+  }
+
+  void WorkQueue::_schedule(ReadyQueue& queue)
+  {
+    queue.scheduled = true;
+    _ready_functions[queue.priority].push(&queue);
+    _ready_invocations += queue.invocations.size();
+  }
+
+  void WorkQueue::_unschedule(ReadyQueue& queue)
+  {
+    queue.scheduled = false;
+    _ready_invocations -= queue.invocations.size();
+  }
+
+  void WorkQueue::_reschedule(FunctionQueue& function, std::chrono::steady_clock::time_point now)
+  {
+    for (ReadyQueue& queue : function.classes) {
+      if (!queue.scheduled && !queue.invocations.empty() && _can_dispatch(queue, now)) {
+        _schedule(queue);
+      }
+    }
+  }
+
+  void WorkQueue::_update_running(FunctionQueue& function, int change)
+  {
+    int reserved = std::min(function.running, function.reserved_workers);
+    function.running += change;
+    _running += change;
+    _used_reservations += std::min(function.running, function.reserved_workers) - reserved;
+  }
+
+  ReadyQueue* WorkQueue::_pop_ready(size_t idle_workers)
+  {
+    auto unused_reservations =
+        static_cast<size_t>(_functions.reserved_workers() - _used_reservations);
+
+    for (auto& functions : _ready_functions) {
+      for (size_t i = functions.size(); i > 0; --i) {
+
+        ReadyQueue* queue = functions.pop();
+        const FunctionQueue& function = *queue->function;
+
+        // The function is scheduled again when one of its invocations finishes.
+        if (function.at_limit()) {
+          _unschedule(*queue);
+          continue;
+        }
+
+        // Remaining idle workers are kept for functions with unused reservations.
+        if (!function.thread && function.running >= function.reserved_workers &&
+            idle_workers <= unused_reservations) {
+          functions.push(queue);
+          continue;
+        }
+
+        return queue;
+      }
+    }
+
+    return nullptr;
+  }
+
+  Invocation* WorkQueue::next(size_t idle_workers)
+  {
+    ReadyQueue* queue = _pop_ready(idle_workers);
+
+    // No function can be invoked now.
+    if (!queue) {
+      return nullptr;
+    }
+
+    Invocation* invocation = queue->invocations.pop();
+    --_ready_invocations;
+
+    FunctionQueue& function = *queue->function;
+
+    // Take the rest of the batch, without exceeding the concurrency of the function.
+    if (queue->batch) {
+      auto size = static_cast<size_t>(queue->batch->size());
+      if (function.max_concurrency > 0) {
+        size = std::min(size, static_cast<size_t>(function.max_concurrency - function.running));
+      }
+
+      invocation->batch.clear();
+      while (invocation->batch.size() + 1 < size && !queue->invocations.empty()) {
+        invocation->batch.push_back(queue->invocations.pop());
+        --_ready_invocations;
+      }
+    }
+
+    _update_running(function, static_cast<int>(1 + invocation->batch.size()));
+
+    // Other functions go first before the next invocation of this one.
+    // A batch that is not full yet waits for more invocations.
+    if (queue->invocations.empty()) {
+      queue->scheduled = false;
+    } else if (!_can_dispatch(*queue, std::chrono::steady_clock::now())) {
+      _unschedule(*queue);
+    } else {
+      _ready_functions[queue->priority].push(queue);
+    }
+
+    return invocation;
+  }
+
+  void WorkQueue::defer(Invocation& invocation)
+  {
+    ReadyQueue& queue = *invocation.queue;
+
+    for (auto it = invocation.batch.rbegin(); it != invocation.batch.rend(); ++it) {
+      queue.invocations.push_front(*it);
+    }
+    queue.invocations.push_front(&invocation);
+
+    size_t count = 1 + invocation.batch.size();
+    invocation.batch.clear();
+
+    _update_running(*queue.function, -static_cast<int>(count));
+
+    if (queue.scheduled) {
+      _ready_invocations += count;
+    } else {
+      _schedule(queue);
+    }
+    _reschedule(*queue.function, std::chrono::steady_clock::now());
+  }
+
+  void WorkQueue::schedule_batches(std::chrono::steady_clock::time_point now)
+  {
+    for (ReadyQueue* queue : _batch_queues) {
+      if (!queue->scheduled && !queue->invocations.empty() && _can_dispatch(*queue, now)) {
+        _schedule(*queue);
+      }
+    }
+  }
+
+  std::optional<std::chrono::steady_clock::time_point> WorkQueue::next_batch_deadline() const
+  {
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    for (const ReadyQueue* queue : _batch_queues) {
+      if (queue->scheduled || queue->invocations.empty()) {
+        continue;
+      }
+
+      auto time = queue->invocations.front()->ready_since + queue->batch->max_wait();
+      if (!deadline.has_value() || time < deadline.value()) {
+        deadline = time;
+      }
+    }
+    return deadline;
+  }
+
+  std::optional<std::chrono::steady_clock::time_point> WorkQueue::next_urgent_deadline() const
+  {
+    if (_urgent_deadlines.empty()) {
+      return std::nullopt;
+    }
+    return _urgent_deadlines.top().first;
+  }
+
+  std::optional<Invocation> WorkQueue::finish(const std::string& key)
+  {
+    // Check if the function invocation exists and is not pending.
+    auto it = _active_invocations.find(key);
+
+    if (it == _active_invocations.end() || !(*it).second.active) {
+      return std::nullopt;
+    }
+    it->second.end();
+
+    auto now = std::chrono::steady_clock::now();
+    FunctionQueue& function = *it->second.queue->function;
+    _update_running(function, -1);
+    _reschedule(function, now);
+
+    auto execution_time =
+        std::chrono::duration_cast<std::chrono::microseconds>(now - it->second.dispatched);
+    if (_execution_time.count() == 0) {
+      _execution_time = execution_time;
+    } else {
+      _execution_time += (execution_time - _execution_time) / EXECUTION_TIME_WEIGHT;
+    }
+    _queued_bytes -= it->second.received_bytes;
+
+    Invocation invoc = std::move((*it).second);
+    _active_invocations.erase(it);
+    std::cerr << fmt::format("Invocation took {} us", invoc.duration()) << std::endl;
+
+    return invoc;
+  }
+
+  std::optional<Invocation> WorkQueue::cancel(const std::string& key)
+  {
+    auto it = _active_invocations.find(key);
+    if (it == _active_invocations.end() || it->second.active) {
+      return std::nullopt;
+    }
+    Invocation& invocation = it->second;
+
+    if (invocation.waits_for_dependencies) {
+
+      std::erase(
+          _dependency_queue(std::string{invocation.req.function_name()}).waiting, &invocation
+      );
+
+    } else if (invocation.ready) {
+      _unlink(invocation);
+    }
+    invocation.end();
+    _queued_bytes -= invocation.received_bytes;
+
+    Invocation invoc = std::move(invocation);
+    _active_invocations.erase(it);
+
+    return invoc;
+  }
+
+  void TriggerChecker::visit(const runtime::internal::DirectTrigger&)
+  {
+    // Single argument, no dependencies - always ready
+    ready = true;
+  }
+
+  void TriggerChecker::visit(const runtime::internal::BatchTrigger&)
+  {
+    // Each invocation is ready - the work queue decides when the batch is dispatched.
+    ready = true;
+  }
+
+  void TriggerChecker::visit(const runtime::internal::PipelineTrigger&)
+  {
+    // Each stage takes the output of the previous one - always ready
+    ready = true;
+  }
+
+  void TriggerChecker::visit(const runtime::internal::DependencyTrigger&)
+  {
+    // Single argument - ready when the dependencies are satisfied.
+    ready = work_queue._acquire_dependencies(
+        invocation, std::string{invocation.req.function_name()}
+    );
+  }
+
+  void TriggerChecker::visit(const runtime::internal::MultiSourceTrigger& trigger)
+  {
+    if (trigger.named()) {
+      const auto& received = invocation.received_sources;
+      ready = !received.empty() && std::all_of(received.begin(), received.end(), [](bool val) {
+        return val;
+      });
+    } else {
+      ready = invocation.payload.size() >= static_cast<size_t>(trigger.nargs());
+    }
+  }
+
+  std::unique_ptr<DispatchPolicy> DispatchPolicy::create(const config::Dispatch& cfg)
+  {
+    if (cfg.policy == config::Dispatch::Policy::AFFINITY) {
+      return std::make_unique<AffinityPolicy>(std::chrono::microseconds{cfg.affinity_wait_us});
+    }
+    return std::make_unique<AnyWorkerPolicy>();
+  }
+
+  FunctionWorker* AnyWorkerPolicy::select(
+      const Invocation&, const IdleWorkers& idle_workers,
+      const std::list<FunctionWorker>&, std::chrono::steady_clock::time_point
+  )
+  {
+    return idle_workers.back();
+  }
+
+  FunctionWorker* AffinityPolicy::select(
+      const Invocation& invocation, const IdleWorkers& idle_workers,
+      const std::list<FunctionWorker>& workers, std::chrono::steady_clock::time_point now
+  )
+  {
+    for (FunctionWorker* worker = idle_workers.back(); worker; worker = IdleWorkers::prev(worker)) {
+      if (worker->last_function() == invocation.queue->function) {
+        return worker;
+      }
+    }
+
+    // A busy worker has the function warm - wait for it, but not for too long.
+    if (now - invocation.ready_since < _max_wait) {
+      for (const FunctionWorker& worker : workers) {
+        if (worker.busy() && worker.last_function() == invocation.queue->function) {
+          return nullptr;
+        }
+      }
+    }
+
+    // Do not take the warm worker of a function that has invocations waiting.
+    for (FunctionWorker* worker = idle_workers.back(); worker; worker = IdleWorkers::prev(worker)) {
+      const FunctionQueue* function = worker->last_function();
+      if (!function || !function->scheduled()) {
+        return worker;
+      }
+    }
+
+    return idle_workers.back();
+  }
+
+  namespace {
+
+    // Starts the invoker - the descriptors are inherited by the new process, while all others
+    // are closed on exec. CPU affinity and the memory policy are kept across exec.
+    int launch_process(
+        const char** args, char** envp, const std::vector<int>& inherited_fds = {},
+        const runtime::internal::CPUSet& cpus = {}, bool local_memory = false
+    )
+    {
+      int mypid = fork();
+      if (mypid < 0) {
+        throw praas::common::PraaSException{
+            fmt::format("Fork failed! {}, reason {} {}", mypid, errno, strerror(errno))};
+      }
+
+      if (mypid == 0) {
+
+        mypid = getpid();
+        auto out_file = ("invoker_" + std::to_string(mypid));
+
+        spdlog::info("Invoker begins work on PID {}", mypid);
+        int fd = open(out_file.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+        dup2(fd, 1);
+        dup2(fd, 2);
+
+        for (int inherited_fd : inherited_fds) {
+          fcntl(inherited_fd, F_SETFD, 0);
+        }
+
+        if (!cpus.empty()) {
+          cpus.pin();
+        }
+        if (local_memory) {
+          runtime::internal::use_local_memory();
+        }
+
+        int ret = 0;
+        if (envp) {
+          ret = execvpe(args[0], const_cast<char**>(&args[0]), envp);
+        } else {
+          ret = execvp(args[0], const_cast<char**>(&args[0]));
+        }
+        if (ret == -1) {
+          spdlog::error("Invoker process {} failed {}, reason {}", args[0], errno, strerror(errno));
+          close(fd);
+          exit(1);
+        }
+
+      } else {
+        spdlog::info("Started invoker process with PID {}", mypid);
+      }
+
+      return mypid;
+    }
+
+    // Loop of the C++ invoker. Exceptions of user code fail the invocation - on a thread,
+    // they would terminate the controller.
+    void run_thread_worker(
+        const runtime::internal::FunctionsLibrary& library, runtime::internal::Invoker& invoker
+    )
+    {
+      invoker.ready();
+
+      runtime::Context context = invoker.create_context();
+      while (auto invoc = invoker.poll()) {
+
+        auto func = library.get_function(invoc->function_name);
+        if (!func) {
+          spdlog::error("Could not load function {}", invoc->function_name);
+          invoker.finish(
+              invoc->key, fmt::format("Could not load function {}", invoc->function_name)
+          );
+          continue;
+        }
+
+        context.start_invocation(invoc->key);
+        try {
+          int ret = (*func)(invoc.value(), context);
+          invoker.finish(context.invocation_id(), context.as_buffer(), ret);
+        } catch (const std::exception& exc) {
+          spdlog::error("Invocation {} failed: {}", invoc->key, exc.what());
+          invoker.finish(context.invocation_id(), exc.what());
+        }
+        context.end_invocation();
+      }
+    }
 
-      it->second.payload.push_back(std::move(buffer));
+  } // namespace
 
-      it->second.start();
+  ZygoteProcess::ZygoteProcess(
+      std::vector<std::string> args, const runtime::internal::CPUSet& cpus, bool local_memory
+  )
+  {
+    // Sequenced packets keep the boundaries of requests and replies.
+    std::array<int, 2> fds{};
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds.data()) != 0) {
+      throw praas::common::PraaSException{
+          fmt::format("Could not create the zygote socket, reason {}", strerror(errno))};
+    }
+
+    args.emplace_back("--zygote-fd");
+    args.emplace_back(std::to_string(fds[1]));
 
-      // Now add the function to the queue
-      _pending_invocations.push_back(&it->second);
+    std::vector<const char*> argv;
+    for (const std::string& arg : args) {
+      argv.push_back(arg.c_str());
     }
+    argv.push_back(nullptr);
 
-    return std::nullopt;
+    _pid = launch_process(argv.data(), nullptr, {fds[1]}, cpus, local_memory);
+    _fd = fds[0];
+    close(fds[1]);
+  }
+
+  ZygoteProcess::~ZygoteProcess()
+  {
+    shutdown();
   }
 
-  Invocation* WorkQueue::next()
+  int ZygoteProcess::spawn(const std::string& ipc_name, const runtime::internal::CPUSet& cpus)
   {
-    for (auto it = _pending_invocations.begin(); it != _pending_invocations.end(); ++it) {
+    // CPUs follow the IPC name after a null character.
+    std::string request = ipc_name;
+    if (!cpus.empty()) {
+      request += '\0';
+      request += cpus.str();
+    }
 
-      TriggerChecker visitor{*(*it), *this};
+    if (send(_fd, request.data(), request.length(), MSG_NOSIGNAL) !=
+        static_cast<ssize_t>(request.length())) {
+      throw praas::common::PraaSException{
+          fmt::format("Could not send request to the zygote, reason {}", strerror(errno))};
+    }
 
-      // Check if the function is ready to be invoked
-      (*it)->trigger->accept(visitor);
+    int32_t pid = -1;
+    ssize_t len = 0;
+    do {
+      len = recv(_fd, &pid, sizeof(pid), 0);
+    } while (len < 0 && errno == EINTR);
 
-      if (visitor.ready) {
-        Invocation* ptr = *it;
-        _pending_invocations.erase(it);
-        return ptr;
-      }
+    if (len != sizeof(pid) || pid < 0) {
+      throw praas::common::PraaSException{"Zygote failed to start a worker!"};
     }
-    // No function can be invoked now.
-    return nullptr;
+
+    return pid;
   }
 
-  std::optional<Invocation> WorkQueue::finish(const std::string& key)
+  void ZygoteProcess::shutdown()
   {
-    // Check if the function invocation exists and is not pending.
-    auto it = _active_invocations.find(key);
-
-    if (it == _active_invocations.end() || !(*it).second.active) {
-      return std::nullopt;
+    if (_fd < 0) {
+      return;
     }
-    it->second.end();
 
-    Invocation invoc = std::move((*it).second);
-    _active_invocations.erase(it);
-    std::cerr << fmt::format("Invocation took {} us", invoc.duration()) << std::endl;
+    close(_fd);
+    _fd = -1;
 
-    return invoc;
+    int status{};
+    waitpid(_pid, &status, 0);
   }
 
-  void TriggerChecker::visit(const runtime::internal::DirectTrigger&)
+  FunctionWorker::FunctionWorker(
+      const char** args, runtime::internal::ipc::IPCMode mode, std::string ipc_name,
+      int ipc_msg_size, runtime::internal::CPUSet cpus, bool local_memory, char** envp
+  )
+      : _cpus(std::move(cpus))
   {
-    // Single argument, no dependencies - always ready
-    ready = true;
+    auto inherited_fds = _create_channels(mode, ipc_name, ipc_msg_size);
+
+    _pid = launch_process(args, envp, inherited_fds, _cpus, local_memory);
   }
 
   FunctionWorker::FunctionWorker(
-      const char** args, runtime::internal::ipc::IPCMode mode, std::string ipc_name,
-      int ipc_msg_size, char** envp
+      ZygoteProcess& zygote, runtime::internal::ipc::IPCMode mode, std::string ipc_name,
+      int ipc_msg_size, runtime::internal::CPUSet cpus
+  )
+      : _cpus(std::move(cpus))
+  {
+    _create_channels(mode, ipc_name, ipc_msg_size);
+
+    _pid = zygote.spawn(ipc_name, _cpus);
+    spdlog::info("Forked invoker process with PID {} from zygote", _pid);
+  }
+
+  FunctionWorker::FunctionWorker(
+      std::shared_ptr<const runtime::internal::FunctionsLibrary> library,
+      const std::string& process_id, runtime::internal::CPUSet cpus, bool local_memory
+  )
+      : _pid(getpid()), _cpus(std::move(cpus))
+  {
+    // Messages to the worker, and its replies.
+    auto input = runtime::internal::ipc::ThreadChannel::create_queue();
+    auto output = runtime::internal::ipc::ThreadChannel::create_queue();
+
+    _ipc_write = std::make_unique<runtime::internal::ipc::ThreadChannel>(
+        input, runtime::internal::ipc::IPCDirection::WRITE, false
+    );
+    _ipc_read = std::make_unique<runtime::internal::ipc::ThreadChannel>(
+        output, runtime::internal::ipc::IPCDirection::READ, false
+    );
+    _invoker = std::make_unique<runtime::internal::Invoker>(
+        process_id,
+        std::make_unique<runtime::internal::ipc::ThreadChannel>(
+            input, runtime::internal::ipc::IPCDirection::READ, true
+        ),
+        std::make_unique<runtime::internal::ipc::ThreadChannel>(
+            output, runtime::internal::ipc::IPCDirection::WRITE, false
+        )
+    );
+
+    _in_thread = true;
+
+    _thread = std::thread{[this, library = std::move(library), local_memory]() {
+      if (!_cpus.empty() && _cpus.pin() && local_memory) {
+        runtime::internal::use_local_memory();
+      }
+      run_thread_worker(*library, *_invoker);
+    }};
+    spdlog::info("Started invoker thread");
+  }
+
+  FunctionWorker::~FunctionWorker()
+  {
+    join();
+  }
+
+  void FunctionWorker::join()
+  {
+    if (!_thread.joinable()) {
+      return;
+    }
+
+    _invoker->stop();
+    _ipc_write->shutdown();
+    _thread.join();
+  }
+
+  std::vector<int> FunctionWorker::_create_channels(
+      runtime::internal::ipc::IPCMode mode, const std::string& ipc_name, int ipc_msg_size
   )
   {
+    std::vector<int> inherited_fds;
 
-    // IPC channels must be created before we fork - avoid race condition.
+    // Controller never blocks on a worker - sends to a full queue are deferred.
     if (mode == runtime::internal::ipc::IPCMode::POSIX_MQ) {
       _ipc_read = std::make_unique<runtime::internal::ipc::POSIXMQChannel>(
-          ipc_name + "_read", runtime::internal::ipc::IPCDirection::READ, true, true, ipc_msg_size
+          ipc_name + "_read", runtime::internal::ipc::IPCDirection::READ, false, true, ipc_msg_size
       );
       _ipc_write = std::make_unique<runtime::internal::ipc::POSIXMQChannel>(
-          ipc_name + "_write", runtime::internal::ipc::IPCDirection::WRITE, true, true, ipc_msg_size
+          ipc_name + "_write", runtime::internal::ipc::IPCDirection::WRITE, false, true,
+          ipc_msg_size
+      );
+    } else if (mode == runtime::internal::ipc::IPCMode::SHM) {
+      // Buffers allocated by the worker are passed to us without copying.
+      auto arena = runtime::internal::ipc::SHMArena::create();
+      auto read = std::make_unique<runtime::internal::ipc::SHMChannel>(
+          ipc_name + "_read", runtime::internal::ipc::IPCDirection::READ, true,
+          runtime::internal::ipc::SHMChannel::RING_SIZE, arena
+      );
+      auto write = std::make_unique<runtime::internal::ipc::SHMChannel>(
+          ipc_name + "_write", runtime::internal::ipc::IPCDirection::WRITE, true,
+          runtime::internal::ipc::SHMChannel::RING_SIZE, arena
       );
-    }
 
-    int mypid = fork();
-    if (mypid < 0) {
-      throw praas::common::PraaSException{
-          fmt::format("Fork failed! {}, reason {} {}", mypid, errno, strerror(errno))};
+      inherited_fds = read->descriptors();
+      for (int fd : write->descriptors()) {
+        inherited_fds.push_back(fd);
+      }
+
+      _ipc_read = std::move(read);
+      _ipc_write = std::move(write);
     }
 
-    if (mypid == 0) {
+    return inherited_fds;
+  }
 
-      mypid = getpid();
-      auto out_file = ("invoker_" + std::to_string(mypid));
+  std::optional<std::chrono::steady_clock::time_point>
+  FunctionWorker::start(const Invocation& invocation, std::chrono::steady_clock::time_point now)
+  {
+    _invocations.push_back(&invocation);
 
-      spdlog::info("Invoker begins work on PID {}", mypid);
-      int fd = open(out_file.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
-      dup2(fd, 1);
-      dup2(fd, 2);
-      // int ret = execvp(args[0], const_cast<char**>(&args[0]));
+    // Functions on threads have no timeout.
+    if (_in_thread) {
+      _timeouts.emplace_back();
+      return std::nullopt;
+    }
 
-      int ret = 0;
-      if (envp) {
-        ret = execvpe(args[0], const_cast<char**>(&args[0]), envp);
-      } else {
-        ret = execvp(args[0], const_cast<char**>(&args[0]));
-      }
-      if (ret == -1) {
-        spdlog::error("Invoker process {} failed {}, reason {}", args[0], errno, strerror(errno));
-        close(fd);
-        exit(1);
+    // Invocations of a batch run one after another - the batch gets the sum of their timeouts,
+    // and none if one of them has no timeout.
+    std::chrono::milliseconds timeout = invocation.timeout;
+    for (const Invocation* batched : invocation.batch) {
+      if (timeout.count() == 0 || batched->timeout.count() == 0) {
+        timeout = std::chrono::milliseconds{0};
+        break;
       }
+      timeout += batched->timeout;
+    }
 
+    if (timeout.count() > 0) {
+      _timeouts.emplace_back(now + timeout);
     } else {
-      spdlog::info("Started invoker process with PID {}", mypid);
+      _timeouts.emplace_back();
+    }
+    return _timeouts.back();
+  }
+
+  bool FunctionWorker::stop(std::string_view key)
+  {
+    for (size_t i = 0; i < _invocations.size(); ++i) {
+
+      if (_invocations[i]->req.invocation_id() != key) {
+        continue;
+      }
+
+      _invocations.erase(_invocations.begin() + static_cast<std::ptrdiff_t>(i));
+      _timeouts.erase(_timeouts.begin() + static_cast<std::ptrdiff_t>(i));
+      return true;
     }
+    return false;
+  }
+
+  const Invocation* FunctionWorker::invocation(std::string_view key) const
+  {
+    for (const Invocation* invocation : _invocations) {
 
-    _pid = mypid;
+      if (invocation->req.invocation_id() == key) {
+        return invocation;
+      }
+      for (const Invocation* batched : invocation->batch) {
+        if (batched->req.invocation_id() == key) {
+          return batched;
+        }
+      }
+    }
+    return nullptr;
+  }
 
-    _busy = false;
+  std::optional<std::chrono::steady_clock::time_point>
+  FunctionWorker::timeout(std::string_view key) const
+  {
+    for (size_t i = 0; i < _invocations.size(); ++i) {
+      if (_invocations[i]->req.invocation_id() == key) {
+        return _timeouts[i];
+      }
+    }
+    return std::nullopt;
   }
 
   runtime::internal::ipc::IPCChannel& FunctionWorker::ipc_read() const
@@ -170,139 +1139,458 @@ namespace praas::process {
     return *_ipc_write;
   }
 
-  void Workers::_launch_cpp(config::Controller& cfg, const std::string& ipc_name)
+  std::vector<std::string> Workers::_invoker_command() const
   {
+    std::vector<std::string> args;
+
     // Linux specific
-    std::string exec_path = cfg.deployment_location.empty()
-                                ? std::filesystem::canonical("/proc/self/exe").parent_path() /
-                                      "invoker" / "cpp_invoker_exe"
-                                : std::filesystem::path{cfg.deployment_location} / "bin" /
-                                      "invoker" / "cpp_invoker_exe";
-    const char* argv[] = {
-        exec_path.c_str(),
-        "--process-id",
-        cfg.process_id.c_str(),
-        "--ipc-mode",
-        "posix_mq",
-        "--ipc-name",
-        ipc_name.c_str(),
-        "--code-location",
-        cfg.code.location.c_str(),
-        "--code-config-location",
-        cfg.code.config_location.c_str(),
-        nullptr};
-
-    _workers.emplace_back(argv, cfg.ipc_mode, ipc_name, cfg.ipc_message_size);
-  }
-
-  void Workers::_launch_python(config::Controller& cfg, const std::string& ipc_name)
-  {
-    std::string python_runtime =
-        !cfg.code.language_runtime_path.empty() ? cfg.code.language_runtime_path : "python";
-
-    std::filesystem::path deployment_path =
-        cfg.deployment_location.empty()
-            ? std::filesystem::canonical("/proc/self/exe").parent_path() / "invoker" / "python.py"
-            : std::filesystem::path{cfg.deployment_location} / "bin" / "invoker" / "python.py";
-
-    const char* argv[] = {
-        python_runtime.c_str(),
-        deployment_path.c_str(),
-        "--process-id",
-        cfg.process_id.c_str(),
-        "--ipc-mode",
-        "posix_mq",
-        "--ipc-name",
-        ipc_name.c_str(),
-        "--code-location",
-        cfg.code.location.c_str(),
-        "--code-config-location",
-        cfg.code.config_location.c_str(),
-        nullptr};
-
-    _workers.emplace_back(argv, cfg.ipc_mode, ipc_name, cfg.ipc_message_size);
-  }
-
-  Workers::Workers(config::Controller& cfg)
+    std::filesystem::path invoker_path =
+        _cfg.deployment_location.empty()
+            ? std::filesystem::canonical("/proc/self/exe").parent_path() / "invoker"
+            : std::filesystem::path{_cfg.deployment_location} / "bin" / "invoker";
+
+    if (_cfg.code.language == runtime::internal::Language::CPP) {
+      args.emplace_back(invoker_path / "cpp_invoker_exe");
+    } else if (_cfg.code.language == runtime::internal::Language::PYTHON) {
+      args.emplace_back(
+          !_cfg.code.language_runtime_path.empty() ? _cfg.code.language_runtime_path : "python"
+      );
+      args.emplace_back(invoker_path / "python.py");
+    }
+
+    args.insert(
+        args.end(), {"--process-id", _cfg.process_id, "--ipc-mode",
+                     runtime::internal::ipc::serialize(_cfg.ipc_mode), "--code-location",
+                     _cfg.code.location, "--code-config-location", _cfg.code.config_location,
+                     "--spin-time", std::to_string(_cfg.polling.worker_spin_us)}
+    );
+    if (_cfg.invoker_threads > 1) {
+      args.insert(args.end(), {"--threads", std::to_string(_cfg.invoker_threads)});
+    }
+
+    return args;
+  }
+
+  Workers::Workers(config::Controller& cfg) : _cfg(cfg)
   {
 
     _logger = common::util::create_logger("Workers");
 
+    _policy = DispatchPolicy::create(cfg.dispatch);
+
     common::util::assert_other(
         static_cast<int>(cfg.code.language), static_cast<int>(runtime::internal::Language::NONE)
     );
 
-    for (int i = 0; i < cfg.function_workers; ++i) {
+    if (cfg.zygote) {
+      // The zygote shares the CPUs of workers.
+      _zygote = std::make_unique<ZygoteProcess>(
+          _invoker_command(), cfg.placement.worker_cpus, cfg.placement.local_memory
+      );
+      _logger->info("Started zygote process with PID {}", _zygote->pid());
+    }
+
+    int workers = cfg.function_workers;
+    if (cfg.scaling.enabled()) {
+      workers = std::clamp(workers, cfg.scaling.min_workers, cfg.scaling.max_workers);
+    }
 
-      std::string ipc_name;
-      if (cfg.ipc_name_prefix.empty()) {
-        ipc_name = fmt::format("/praas_queue_{}_{}", getpid(), _worker_counter++);
-      } else {
-        ipc_name =
-            fmt::format("/{}_praas_queue_{}_{}", cfg.ipc_name_prefix, getpid(), _worker_counter++);
+    for (int i = 0; i < workers; ++i) {
+      add_worker();
+    }
+  }
+
+  void Workers::start_threads(const runtime::internal::Functions& functions)
+  {
+    if (functions.thread_functions() == 0) {
+      return;
+    }
+
+    // Libraries of these functions are opened in the controller.
+    _library = std::make_shared<const runtime::internal::FunctionsLibrary>(
+        functions, runtime::internal::Execution::THREAD
+    );
+
+    for (int i = 0; i < _cfg.thread_workers; ++i) {
+      _workers.emplace_back(_library, _cfg.process_id, _select_cpu(), _cfg.placement.local_memory);
+      ++_threads;
+      ++_starting;
+    }
+    _logger->info("Started {} worker threads", _threads);
+  }
+
+  FunctionWorker& Workers::add_worker()
+  {
+    std::string ipc_name;
+    if (_cfg.ipc_name_prefix.empty()) {
+      ipc_name = fmt::format("/praas_queue_{}_{}", getpid(), _worker_counter++);
+    } else {
+      ipc_name =
+          fmt::format("/{}_praas_queue_{}_{}", _cfg.ipc_name_prefix, getpid(), _worker_counter++);
+    }
+
+    runtime::internal::CPUSet cpus = _select_cpu();
+    if (_zygote) {
+      _workers.emplace_back(
+          *_zygote, _cfg.ipc_mode, ipc_name, _cfg.ipc_message_size, std::move(cpus)
+      );
+    } else {
+
+      std::vector<std::string> args = _invoker_command();
+      args.insert(args.end(), {"--ipc-name", ipc_name});
+
+      std::vector<const char*> argv;
+      for (const std::string& arg : args) {
+        argv.push_back(arg.c_str());
       }
+      argv.push_back(nullptr);
+
+      _workers.emplace_back(
+          argv.data(), _cfg.ipc_mode, ipc_name, _cfg.ipc_message_size, std::move(cpus),
+          _cfg.placement.local_memory
+      );
+    }
+    _workers.back().slots(static_cast<size_t>(_cfg.invoker_threads));
+    ++_starting;
+
+    return _workers.back();
+  }
+
+  runtime::internal::CPUSet Workers::_select_cpu() const
+  {
+    const std::vector<int>& cpus = _cfg.placement.worker_cpus.cpus;
+    if (cpus.empty()) {
+      return {};
+    }
 
-      if (cfg.code.language == runtime::internal::Language::CPP) {
-        _launch_cpp(cfg, ipc_name);
-      } else if (cfg.code.language == runtime::internal::Language::PYTHON) {
-        _launch_python(cfg, ipc_name);
+    std::vector<int> workers(cpus.size());
+    for (const FunctionWorker& worker : _workers) {
+      if (worker.cpus().empty()) {
+        continue;
       }
+      auto it = std::lower_bound(cpus.begin(), cpus.end(), worker.cpus().cpus.front());
+      if (it != cpus.end() && *it == worker.cpus().cpus.front()) {
+        ++workers[std::distance(cpus.begin(), it)];
+      }
+    }
+
+    auto idx = std::distance(workers.begin(), std::min_element(workers.begin(), workers.end()));
+    return _cfg.placement.worker_cpus.select(static_cast<size_t>(idx));
+  }
+
+  void Workers::ready(FunctionWorker& worker)
+  {
+    if (worker.ready()) {
+      return;
     }
+    SPDLOG_LOGGER_DEBUG(_logger, "Worker {} is ready", worker.pid());
 
-    _idle_workers = cfg.function_workers;
+    worker.ready(true);
+    --_starting;
+
+    worker.idle_since(std::chrono::steady_clock::now());
+    _link_idle(worker, false);
   }
 
-  FunctionWorker* Workers::_get_idle_worker()
+  FunctionWorker* Workers::expired_worker(std::chrono::steady_clock::time_point deadline)
   {
-    if (_idle_workers == 0) {
+    if (size() <= static_cast<size_t>(_cfg.scaling.min_workers)) {
       return nullptr;
     }
 
-    for (FunctionWorker& worker : _workers) {
-      if (!worker.busy()) {
-        return &worker;
+    // Workers with busy slots are kept ahead of the fully idle ones.
+    FunctionWorker* worker = _idle_workers.front();
+    while (worker && worker->running() > 0) {
+      worker = IdleWorkers::next(worker);
+    }
+    if (!worker || worker->idle_since() >= deadline) {
+      return nullptr;
+    }
+
+    _unlink_idle(*worker);
+    return worker;
+  }
+
+  void Workers::remove(FunctionWorker& worker)
+  {
+    SPDLOG_LOGGER_DEBUG(_logger, "Stopping idle worker {}", worker.pid());
+
+    kill(worker.pid(), SIGINT);
+    _terminated.push_back(worker.pid());
+
+    _unlink_idle(worker);
+    _workers.remove_if([&worker](const FunctionWorker& w) { return &w == &worker; });
+
+    _collect_terminated();
+  }
+
+  bool Workers::cancel(std::string_view key)
+  {
+    auto it = _running.find(std::string{key});
+    if (it == _running.end()) {
+      return false;
+    }
+
+    // The whole batch is stopped with the worker, and so are invocations of other slots.
+    FunctionWorker& worker = *it->second;
+    if (worker.in_thread()) {
+      _logger->warn("Invocation {} runs on a thread, and cannot be cancelled", key);
+      return true;
+    }
+
+    if (!worker.failed() && !worker.cancelled()) {
+      _stuck.push_back(&worker);
+    }
+    worker.cancelled(true);
+    return true;
+  }
+
+  void Workers::fail(FunctionWorker& worker)
+  {
+    if (!worker.failed() && !worker.cancelled()) {
+      _stuck.push_back(&worker);
+    }
+    worker.failed(true);
+  }
+
+  FunctionWorker* Workers::_next_timeout_worker()
+  {
+    while (!_timeouts.empty()) {
+
+      const auto& [time, key] = _timeouts.top();
+
+      // The key might belong to an invocation submitted after the indexed one finished.
+      auto it = _running.find(key);
+      if (it != _running.end() && it->second->timeout(key) == time) {
+        return it->second;
       }
+      _timeouts.pop();
+    }
+    return nullptr;
+  }
+
+  FunctionWorker* Workers::stuck_worker(std::chrono::steady_clock::time_point now)
+  {
+    if (!_stuck.empty()) {
+      return _stuck.back();
+    }
+
+    FunctionWorker* worker = _next_timeout_worker();
+    if (worker && _timeouts.top().first <= now) {
+      return worker;
     }
-    // Should never happen
     return nullptr;
   }
 
+  std::optional<std::chrono::steady_clock::time_point> Workers::next_timeout()
+  {
+    if (!_next_timeout_worker()) {
+      return std::nullopt;
+    }
+    return _timeouts.top().first;
+  }
+
+  void Workers::terminate(FunctionWorker& worker)
+  {
+    SPDLOG_LOGGER_DEBUG(_logger, "Killing busy worker {}", worker.pid());
+
+    kill(worker.pid(), SIGKILL);
+    _terminated.push_back(worker.pid());
+
+    // Workers with free slots stay idle while running other invocations.
+    _unlink_idle(worker);
+    std::erase(_stuck, &worker);
+    for (const Invocation* invocation : worker.invocations()) {
+      _running.erase(std::string{invocation->req.invocation_id()});
+      for (const Invocation* batched : invocation->batch) {
+        _running.erase(std::string{batched->req.invocation_id()});
+      }
+    }
+
+    _workers.remove_if([&worker](const FunctionWorker& w) { return &w == &worker; });
+
+    _collect_terminated();
+  }
+
+  void Workers::_collect_terminated()
+  {
+    std::erase_if(_terminated, [](int pid) {
+      int status{};
+      return waitpid(pid, &status, WNOHANG) != 0;
+    });
+  }
+
+  void Workers::_link_idle(FunctionWorker& worker, bool front)
+  {
+    auto& idle = worker.in_thread() ? _idle_threads : _idle_workers;
+    if (front) {
+      idle.push_front(&worker);
+    } else {
+      idle.push_back(&worker);
+    }
+
+    if (!worker.in_thread()) {
+      _idle_slots += worker.slots() - worker.running();
+    }
+  }
+
+  void Workers::_unlink_idle(FunctionWorker& worker)
+  {
+    auto& idle = worker.in_thread() ? _idle_threads : _idle_workers;
+    if (!idle.contains(&worker)) {
+      return;
+    }
+    idle.remove(&worker);
+
+    if (!worker.in_thread()) {
+      _idle_slots -= worker.slots() - worker.running();
+    }
+  }
+
   bool Workers::has_idle_workers() const
   {
-    return _idle_workers > 0;
+    return !_idle_workers.empty() || !_idle_threads.empty();
   }
 
-  void Workers::submit(Invocation& invocation)
+  FunctionWorker* Workers::submit(Invocation& invocation)
   {
     if (!has_idle_workers()) {
       throw praas::common::PraaSException{"No idle workers!"};
     }
 
-    FunctionWorker* worker = _get_idle_worker();
+    auto now = std::chrono::steady_clock::now();
+    FunctionWorker* worker = nullptr;
+
+    // Threads share the memory of the controller - any of them is warm.
+    if (invocation.queue->function->thread) {
+
+      if (_idle_threads.empty()) {
+        return nullptr;
+      }
+      worker = _idle_threads.back();
+
+    } else {
+
+      if (_idle_workers.empty()) {
+        return nullptr;
+      }
+      worker = _policy->select(invocation, _idle_workers, _workers, now);
+      if (!worker) {
+        return nullptr;
+      }
+    }
+    _unlink_idle(*worker);
+
+    if (invocation.batch.empty()) {
+
+      invocation.confirm_payload();
+
+      SPDLOG_LOGGER_DEBUG(
+          _logger, "Sending invocation of {}, with key {}", invocation.req.function_name(),
+          invocation.req.invocation_id()
+      );
+
+      worker->ipc_write().send(invocation.req, invocation.payload);
+
+    } else {
+      _send_batch(*worker, invocation);
+    }
+
+    worker->last_function(invocation.queue->function);
+    auto timeout = worker->start(invocation, now);
+    if (timeout.has_value()) {
+      _timeouts.emplace(timeout.value(), std::string{invocation.req.invocation_id()});
+    }
+
+    // Further invocations go to the same process while it has free slots - but after
+    // the fully idle workers, which have more of them.
+    if (!worker->busy()) {
+      _link_idle(*worker, true);
+    }
+
+    invocation.active = true;
+    invocation.dispatched = now;
+    _running.insert_or_assign(std::string{invocation.req.invocation_id()}, worker);
+    for (Invocation* batched : invocation.batch) {
+      batched->active = true;
+      batched->dispatched = now;
+      _running.insert_or_assign(std::string{batched->req.invocation_id()}, worker);
+    }
 
-    invocation.confirm_payload();
+    return worker;
+  }
 
+  void Workers::_send_batch(FunctionWorker& worker, Invocation& invocation)
+  {
     SPDLOG_LOGGER_DEBUG(
-        _logger, "Sending invocation of {}, with key {}", invocation.req.function_name(),
-        invocation.req.invocation_id()
+        _logger, "Sending batch of {} invocations of {}", invocation.batch.size() + 1,
+        invocation.req.function_name()
     );
 
-    worker->ipc_write().send(invocation.req, invocation.payload);
+    // Each invocation is encoded as its own request followed by its payload.
+    _batch_buffer.clear();
+    auto append = [this](Invocation& invoc) {
+      invoc.confirm_payload();
 
-    worker->busy(true);
+      // NOLINTNEXTLINE
+      const char* header = reinterpret_cast<const char*>(invoc.req.bytes());
+      _batch_buffer.insert(
+          _batch_buffer.end(), header, header + runtime::internal::ipc::Message::BUF_SIZE
+      );
+      for (const auto& buf : invoc.payload) {
+        _batch_buffer.insert(_batch_buffer.end(), buf.data(), buf.data() + buf.len);
+      }
+    };
 
-    invocation.active = true;
+    append(invocation);
+    for (Invocation* batched : invocation.batch) {
+      append(*batched);
+    }
 
-    this->_idle_workers--;
+    runtime::internal::ipc::InvocationBatch msg;
+    msg.invocations(static_cast<int32_t>(invocation.batch.size() + 1));
+    worker.ipc_write().send(
+        msg,
+        runtime::internal::BufferAccessor<const char>{_batch_buffer.data(), _batch_buffer.size()}
+    );
   }
 
-  void Workers::finish(FunctionWorker& worker)
+  void Workers::finish(FunctionWorker& worker, std::string_view key)
   {
-    // Mark the worker as inactive
-    // Increase number of active worker
+    // A worker with a free slot is already idle.
+    bool available = !worker.busy();
+    const Invocation* invocation = worker.invocation(key);
+    if (!worker.stop(key)) {
+      return;
+    }
 
-    worker.busy(false);
-    _idle_workers++;
+    _running.erase(std::string{key});
+    for (const Invocation* batched : invocation->batch) {
+      _running.erase(std::string{batched->req.invocation_id()});
+    }
+    if (available && !worker.in_thread()) {
+      ++_idle_slots;
+    }
+
+    // Fully idle workers are the most recently idle - the others stay ahead of them.
+    if (worker.running() == 0) {
+      worker.idle_since(std::chrono::steady_clock::now());
+      if (available) {
+        _unlink_idle(worker);
+      }
+      _link_idle(worker, false);
+    } else if (!available) {
+      _link_idle(worker, true);
+    }
+  }
+
+  size_t Workers::queued_bytes() const
+  {
+    size_t bytes = 0;
+    for (const FunctionWorker& worker : _workers) {
+      bytes += worker.ipc_write().queued_bytes();
+    }
+    return bytes;
   }
 
   void Workers::shutdown_channels()
@@ -315,13 +1603,30 @@ namespace praas::process {
 
   void Workers::shutdown()
   {
+    // No more forks after the workers are stopped.
+    if (_zygote) {
+      _zygote->shutdown();
+    }
+
     for (FunctionWorker& worker : _workers) {
-      kill(worker.pid(), SIGINT);
+      if (!worker.in_thread()) {
+        kill(worker.pid(), SIGINT);
+      }
     }
 
     int status{};
+    for (int pid : _terminated) {
+      waitpid(pid, &status, 0);
+    }
+    _terminated.clear();
+
     for (FunctionWorker& worker : _workers) {
 
+      if (worker.in_thread()) {
+        worker.join();
+        continue;
+      }
+
       waitpid(worker.pid(), &status, 0);
 
       if (WIFEXITED(status)) {
@@ -1,14 +1,20 @@
 
 #include <praas/process/runtime/context.hpp>
 #include <praas/process/runtime/internal/invoker.hpp>
+#include <praas/process/runtime/internal/library.hpp>
+#include <praas/process/runtime/internal/zygote.hpp>
+
+#include <functional>
+#include <thread>
+#include <vector>
 
 #include <execinfo.h>
+#include <pthread.h>
 #include <signal.h>
 #include <sys/time.h>
 
 #include <spdlog/spdlog.h>
 
-#include "functions.hpp"
 #include "opts.hpp"
 
 praas::process::runtime::internal::Invoker* instance = nullptr;
@@ -42,6 +48,47 @@ void failure_handler(int signum)
   exit(1);
 }
 
+// Each execution thread has its own context. Exceptions of user code fail the invocation
+// - with many threads, they would stop invocations of all of them.
+void execute(
+    const praas::process::runtime::internal::FunctionsLibrary& library,
+    praas::process::runtime::internal::Invoker& invoker
+)
+{
+  praas::process::runtime::Context context = invoker.create_context();
+
+  while (true) {
+
+    auto invoc = invoker.poll();
+
+    if (ending || !invoc.has_value()) {
+      break;
+    }
+
+    auto& invoc_value = invoc.value();
+
+    // The slot is released, and the rest of a batch is sent, only by finishing the invocation.
+    auto func = library.get_function(invoc_value.function_name);
+    if (!func) {
+      spdlog::error("Could not load function {}", invoc_value.function_name);
+      invoker.finish(
+          invoc_value.key, fmt::format("Could not load function {}", invoc_value.function_name)
+      );
+      continue;
+    }
+
+    context.start_invocation(invoc_value.key);
+    try {
+      int ret = (*func)(invoc_value, context);
+      invoker.finish(context.invocation_id(), context.as_buffer(), ret);
+    } catch (const std::exception& exc) {
+      spdlog::error("Invocation {} failed: {}", invoc_value.key, exc.what());
+      invoker.finish(context.invocation_id(), exc.what());
+    }
+    context.end_invocation();
+  }
+}
+
 int main(int argc, char** argv)
 {
   auto config = praas::process::opts(argc, argv);
@@ -75,34 +122,60 @@ int main(int argc, char** argv)
     sigaction(SIGHUP, &sa, NULL);
   }
 
+  // Functions executed on threads of the controller never come to the invoker.
+  praas::process::runtime::internal::FunctionsLibrary library{
+      config.code_location, config.code_config_location,
+      praas::process::runtime::internal::Execution::PROCESS};
+
+  // Zygote forks workers with functions already loaded, and only the workers continue.
+  if (config.zygote_fd >= 0) {
+
+    praas::process::runtime::internal::Zygote zygote{config.zygote_fd};
+    while (true) {
+
+      auto ipc_name = zygote.wait();
+      if (ending || !ipc_name.has_value()) {
+        spdlog::info("Zygote is closing down");
+        return 0;
+      }
+
+      if (zygote.fork() == 0) {
+        config.ipc_name = std::move(ipc_name.value());
+        break;
+      }
+    }
+  }
+
   praas::process::runtime::internal::Invoker invoker{
-      config.process_id, config.ipc_mode, config.ipc_name};
-  praas::process::FunctionsLibrary library{config.code_location, config.code_config_location};
+      config.process_id, config.ipc_mode, config.ipc_name, config.spin_time, config.threads};
   instance = &invoker;
 
-  praas::process::runtime::Context context = invoker.create_context();
+  if (config.threads == 1) {
 
-  while (true) {
+    invoker.ready();
+    execute(library, invoker);
 
-    auto invoc = invoker.poll();
+  } else {
 
-    if (ending || !invoc.has_value()) {
-      break;
+    // Stop signals are handled by the dispatching thread - they interrupt its receive.
+    sigset_t signals, previous;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < config.threads; ++i) {
+      threads.emplace_back(execute, std::cref(library), std::ref(invoker));
     }
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
 
-    auto& invoc_value = invoc.value();
+    invoker.ready();
+    invoker.dispatch();
 
-    // spdlog::info("invoking {}, invocation key {}", invoc_value.function_name, invoc_value.key);
-    auto func = library.get_function(invoc_value.function_name);
-    if (!func) {
-      spdlog::error("Could not load function {}", invoc_value.function_name);
-    } else {
-      context.start_invocation(invoc_value.key);
-      int ret = (*func)(invoc_value, context);
-      invoker.finish(context.invocation_id(), context.as_buffer(), ret);
-      context.end_invocation();
-      // spdlog::info("Finished invocation of {} with {}", invoc_value.function_name,
-      // invoc_value.key);
+    for (auto& thread : threads) {
+      thread.join();
     }
   }
 
@@ -10,7 +10,7 @@ namespace praas::process {
   {
     cxxopts::Options options("praas-invoker-cpp", "Handle function invocations.");
     options
-        .add_options()("process-id", "Process identificator.", cxxopts::value<std::string>())("ipc-mode", "IPC mode.", cxxopts::value<std::string>())("ipc-name", "Name used to identify the IPC channel.", cxxopts::value<std::string>())("code-location", "Location of functions.", cxxopts::value<std::string>())("code-config-location", "Name of the function configuration.", cxxopts::value<std::string>())(
+        .add_options()("process-id", "Process identificator.", cxxopts::value<std::string>())("ipc-mode", "IPC mode.", cxxopts::value<std::string>())("ipc-name", "Name used to identify the IPC channel.", cxxopts::value<std::string>())("code-location", "Location of functions.", cxxopts::value<std::string>())("code-config-location", "Name of the function configuration.", cxxopts::value<std::string>())("spin-time", "Busy-polling time in microseconds before blocking.", cxxopts::value<int>()->default_value("0"))("zygote-fd", "Socket of the controller requesting new workers.", cxxopts::value<int>()->default_value("-1"))("threads", "Number of execution threads.", cxxopts::value<int>()->default_value("1"))(
             "v,verbose", "Verbose output", cxxopts::value<bool>()->default_value("false")
         );
     auto parsed_options = options.parse(argc, argv);
@@ -25,11 +25,21 @@ namespace praas::process {
       );
       exit(1);
     }
-    result.ipc_name = parsed_options["ipc-name"].as<std::string>();
+    result.zygote_fd = parsed_options["zygote-fd"].as<int>();
+    // Zygote receives IPC names of workers from the controller.
+    if (result.zygote_fd < 0) {
+      result.ipc_name = parsed_options["ipc-name"].as<std::string>();
+    }
     result.verbose = parsed_options["verbose"].as<bool>();
 
     result.code_location = parsed_options["code-location"].as<std::string>();
     result.code_config_location = parsed_options["code-config-location"].as<std::string>();
+    result.spin_time = std::chrono::microseconds{parsed_options["spin-time"].as<int>()};
+    result.threads = parsed_options["threads"].as<int>();
+    if (result.threads < 1) {
+      spdlog::error("Incorrect number of threads {}!", result.threads);
+      exit(1);
+    }
 
     return result;
   }
@@ -3,6 +3,7 @@
 
 #include <praas/process/runtime/internal/ipc/ipc.hpp>
 
+#include <chrono>
 #include <string>
 
 namespace praas::process {
@@ -17,6 +18,14 @@ namespace praas::process {
     std::string code_location;
     std::string code_config_location;
 
+    std::chrono::microseconds spin_time;
+
+    // Invocations executed concurrently by the process, each on its own thread.
+    int threads;
+
+    // Connection to the controller - the invoker runs as a zygote and forks workers.
+    int zygote_fd;
+
     bool verbose;
   };
 
@@ -1,5 +1,6 @@
 #include <praas/process/runtime/internal/invoker.hpp>
 #include <praas/process/runtime/internal/ipc/ipc.hpp>
+#include <praas/process/runtime/internal/zygote.hpp>
 #include "praas/process/runtime/internal/buffer.hpp"
 
 #if defined(PRAAS_WITH_INVOKER_PYTHON)
@@ -14,12 +15,23 @@ void define_pypraas_invoker(py::module& m)
   m.attr("__name__") = "_pypraas.invoker";
 
   py::enum_<praas::process::runtime::internal::ipc::IPCMode>(m, "IPCMode", py::arithmetic())
-      .value("POSIX_MQ", praas::process::runtime::internal::ipc::IPCMode::POSIX_MQ);
+      .value("POSIX_MQ", praas::process::runtime::internal::ipc::IPCMode::POSIX_MQ)
+      .value("SHM", praas::process::runtime::internal::ipc::IPCMode::SHM);
+
+  m.def("deserialize_ipc_mode", &praas::process::runtime::internal::ipc::deserialize);
 
   py::class_<praas::process::runtime::internal::Invoker>(m, "Invoker")
       .def(py::init<
            const std::string&, praas::process::runtime::internal::ipc::IPCMode, const std::string&>(
       ))
+      .def(py::init([](const std::string& process_id,
+                       praas::process::runtime::internal::ipc::IPCMode ipc_mode,
+                       const std::string& ipc_name, int spin_time_us) {
+        return new praas::process::runtime::internal::Invoker(
+            process_id, ipc_mode, ipc_name, std::chrono::microseconds{spin_time_us}
+        );
+      }))
+      .def("ready", &praas::process::runtime::internal::Invoker::ready)
       .def("poll", &praas::process::runtime::internal::Invoker::poll)
       .def("create_context", &praas::process::runtime::internal::Invoker::create_context)
       .def(
@@ -34,6 +46,21 @@ void define_pypraas_invoker(py::module& m)
               &praas::process::runtime::internal::Invoker::finish
           )
       );
+
+  py::class_<praas::process::runtime::internal::Zygote>(m, "Zygote")
+      .def(py::init<int>())
+      .def("wait", &praas::process::runtime::internal::Zygote::wait)
+      .def("fork", [](praas::process::runtime::internal::Zygote& zygote) {
+        // Interpreter state must be consistent in the new process, like with os.fork.
+        PyOS_BeforeFork();
+        int pid = zygote.fork();
+        if (pid == 0) {
+          PyOS_AfterFork_Child();
+        } else {
+          PyOS_AfterFork_Parent();
+        }
+        return pid;
+      });
 }
 
 #endif
@@ -57,12 +57,32 @@ class Functions:
 @click.option('--ipc-name', type=str, help='IPC name.')
 @click.option('--code-location', type=str, help='Code location.')
 @click.option('--code-config-location', type=str, help='Code config location.')
-def invoke(process_id, ipc_mode, ipc_name, code_location, code_config_location):
+@click.option('--spin-time', type=int, default=0, help='Busy-polling time in microseconds.')
+@click.option('--zygote-fd', type=int, default=None, help='Socket of the controller requesting new workers.')
+def invoke(process_id, ipc_mode, ipc_name, code_location, code_config_location, spin_time, zygote_fd):
 
     functions = Functions(code_location, code_config_location)
 
-    # FIXME: ipc mode as string
-    invoker = pypraas.invoker.Invoker(process_id, pypraas.invoker.IPCMode.POSIX_MQ, ipc_name)
+    # Zygote forks workers with modules already imported, and only the workers continue.
+    if zygote_fd is not None:
+
+        zygote = pypraas.invoker.Zygote(zygote_fd)
+        while True:
+
+            ipc_name = zygote.wait()
+            if ipc_name is None:
+                print("Zygote is closing down", file=sys.stderr)
+                sys.exit(0)
+
+            if zygote.fork() == 0:
+                break
+
+        del zygote
+
+    invoker = pypraas.invoker.Invoker(
+        process_id, pypraas.invoker.deserialize_ipc_mode(ipc_mode), ipc_name, spin_time
+    )
+    invoker.ready()
 
     context = invoker.create_context()
 
@@ -26,6 +26,8 @@ namespace praas::process::runtime {
 
     // Prefered way - if we use shm, we want to write directly to a buffer and just transport
     // the location of the message.
+    // With shared memory IPC, buffers from get_buffer are not copied - the receiver
+    // shares them, and they should not be modified after sending.
     void put(std::string_view destination, std::string_view msg_key, Buffer buf);
 
     std::vector<std::tuple<std::string, double>> state_keys();
@@ -62,6 +64,7 @@ namespace praas::process::runtime {
 
     void set_output_buffer(Buffer buf);
 
+    // Allocated in memory shared with the controller when possible.
     Buffer get_buffer(size_t size);
 
     void write_output(const std::byte* ptr, size_t len, size_t pos);
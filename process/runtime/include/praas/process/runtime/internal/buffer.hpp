@@ -1,16 +1,49 @@
 #ifndef PRAAS_PROCESS_RUNTIME_INTERNAL_BUFFER_HPP
 #define PRAAS_PROCESS_RUNTIME_INTERNAL_BUFFER_HPP
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cstdint>
 #include <memory>
-#include <queue>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace praas::process::runtime::internal {
 
   template <typename T>
   struct Buffer;
 
+  // Memory that is not released to the heap, e.g., a shared memory segment or a buffer pool.
+  struct BufferOwner {
+    virtual ~BufferOwner() = default;
+    virtual void release(void* ptr, size_t tag) = 0;
+
+    // Memory is visible to another process.
+    virtual bool shared() const
+    {
+      return false;
+    }
+  };
+
+  struct BufferDeleter {
+    // Empty for heap allocations.
+    std::shared_ptr<BufferOwner> owner{};
+    // Owner-specific description of the allocation, e.g., its size class.
+    size_t tag{};
+
+    template <typename T>
+    void operator()(T* ptr) const
+    {
+      if (owner) {
+        owner->release(ptr, tag);
+      } else {
+        delete[] ptr;
+      }
+    }
+  };
+
   template <typename T>
   struct BufferAccessor {
     T* ptr{};
@@ -49,12 +82,16 @@ namespace praas::process::runtime::internal {
 
   template <typename T>
   struct Buffer {
-    std::unique_ptr<T[]> ptr{};
+    std::unique_ptr<T[], BufferDeleter> ptr{};
     size_t size{};
     size_t len{};
 
     Buffer() = default;
     Buffer(T* ptr, size_t size, size_t len = 0) : ptr(ptr), size(size), len(len) {}
+    Buffer(T* ptr, size_t size, size_t len, BufferDeleter deleter)
+        : ptr(ptr, std::move(deleter)), size(size), len(len)
+    {
+    }
 
     Buffer(const Buffer&) = delete;
     Buffer& operator=(const Buffer&) = delete;
@@ -80,7 +117,8 @@ namespace praas::process::runtime::internal {
     template <typename U>
     Buffer(Buffer<U>&& obj) noexcept
     {
-      this->ptr.reset(reinterpret_cast<T*>(obj.ptr.release()));
+      this->ptr = std::unique_ptr<T[], BufferDeleter>{
+          reinterpret_cast<T*>(obj.ptr.release()), std::move(obj.ptr.get_deleter())};
       this->size = obj.size;
       this->len = obj.len;
 
@@ -104,9 +142,15 @@ namespace praas::process::runtime::internal {
       return ptr == 0;
     }
 
+    bool shared() const
+    {
+      return ptr.get_deleter().owner && ptr.get_deleter().owner->shared();
+    }
+
     void resize(size_t size)
     {
-      ptr.reset(new T[size]);
+      // Drops the owner - the new memory always comes from the heap.
+      ptr = std::unique_ptr<T[], BufferDeleter>{new T[size]};
       this->size = size;
       this->len = 0;
     }
@@ -129,49 +173,154 @@ namespace praas::process::runtime::internal {
     }
   };
 
+  struct BufferPoolStats {
+    // Requests served with a cached buffer.
+    size_t hits{};
+    // Requests that needed a new allocation, including the ones above the largest size class.
+    size_t misses{};
+    // Memory owned by the pool - both cached buffers and the ones currently in use.
+    size_t allocated_bytes{};
+    // Memory of buffers waiting in the pool for reuse.
+    size_t cached_bytes{};
+  };
+
+  /**
+   * Thread-safe pool of buffers in size classes of powers of two.
+   *
+   * Buffers keep a reference to the pool and return to it on destruction, also when
+   * they are released by another thread. The storage outlives the pool object until
+   * the last buffer is returned.
+   *
+   * Requests above the largest size class are served from the heap and never cached.
+   * Returned buffers are freed when the cache already holds max_cached_bytes.
+   */
   template <typename T>
-  struct BufferQueue {
+  struct BufferPool {
 
-    typedef Buffer<T> val_t;
+    // Sizes are counted in elements, like the size of a Buffer.
+    static constexpr size_t MIN_CLASS_SIZE = 64;
+    static constexpr size_t NUM_CLASSES = 20;
+    static constexpr size_t MAX_CLASS_SIZE = MIN_CLASS_SIZE << (NUM_CLASSES - 1);
 
-    std::queue<val_t> _buffers;
+    static constexpr size_t DEFAULT_MAX_CACHED_BYTES = 64 * 1024 * 1024;
 
-    BufferQueue() = default;
+    BufferPool() : BufferPool(0, 0) {}
 
-    BufferQueue(size_t elements, size_t elem_size)
+    // Preallocates the given number of buffers - the cache always has space for them.
+    BufferPool(size_t elements, size_t elem_size) : _storage(std::make_shared<Storage>())
     {
+      if (elements == 0 || elem_size == 0 || elem_size > MAX_CLASS_SIZE) {
+        return;
+      }
+
+      size_t size_class = _size_class(elem_size);
+      size_t class_bytes = _class_size(size_class) * sizeof(T);
+
+      _storage->max_cached_bytes = std::max(DEFAULT_MAX_CACHED_BYTES, elements * class_bytes);
       for (size_t i = 0; i < elements; ++i) {
-        _buffers.push(val_t{new T[elem_size], elem_size});
+        _storage->free_buffers[size_class].push_back(new T[_class_size(size_class)]);
       }
+      _storage->stats.allocated_bytes = _storage->stats.cached_bytes = elements * class_bytes;
     }
 
-    ~BufferQueue() = default;
-
     Buffer<T> retrieve_buffer(size_t size)
     {
-      if (_buffers.empty()) {
-        return _allocate_buffer(size);
+      if (size > MAX_CLASS_SIZE) {
+        std::lock_guard<std::mutex> guard{_storage->lock};
+        _storage->stats.misses++;
+        return Buffer<T>{new T[size], size, 0};
       }
 
-      Buffer<T> buf = std::move(_buffers.front());
-      _buffers.pop();
-      if (_buffers.size() < size) {
-        buf.resize(size);
+      size_t size_class = _size_class(size);
+      size_t class_size = _class_size(size_class);
+      BufferDeleter deleter{_storage, size_class};
+
+      {
+        std::lock_guard<std::mutex> guard{_storage->lock};
+
+        auto& buffers = _storage->free_buffers[size_class];
+        if (!buffers.empty()) {
+
+          T* ptr = buffers.back();
+          buffers.pop_back();
+          _storage->stats.hits++;
+          _storage->stats.cached_bytes -= class_size * sizeof(T);
+
+          return Buffer<T>{ptr, class_size, 0, std::move(deleter)};
+        }
+
+        _storage->stats.misses++;
+        _storage->stats.allocated_bytes += class_size * sizeof(T);
       }
 
-      return buf;
+      return Buffer<T>{new T[class_size], class_size, 0, std::move(deleter)};
+    }
+
+    BufferPoolStats stats() const
+    {
+      std::lock_guard<std::mutex> guard{_storage->lock};
+      return _storage->stats;
+    }
+
+    void max_cached_bytes(size_t bytes)
+    {
+      std::lock_guard<std::mutex> guard{_storage->lock};
+      _storage->max_cached_bytes = bytes;
     }
 
-    void return_buffer(Buffer<T>&& buf)
+  private:
+    struct Storage : BufferOwner {
+
+      std::mutex lock;
+
+      std::array<std::vector<T*>, NUM_CLASSES> free_buffers;
+
+      BufferPoolStats stats;
+
+      size_t max_cached_bytes = DEFAULT_MAX_CACHED_BYTES;
+
+      ~Storage() override
+      {
+        for (auto& buffers : free_buffers) {
+          for (T* ptr : buffers) {
+            delete[] ptr;
+          }
+        }
+      }
+
+      void release(void* ptr, size_t size_class) override
+      {
+        size_t bytes = _class_size(size_class) * sizeof(T);
+        {
+          std::lock_guard<std::mutex> guard{lock};
+
+          if (stats.cached_bytes + bytes <= max_cached_bytes) {
+            free_buffers[size_class].push_back(static_cast<T*>(ptr));
+            stats.cached_bytes += bytes;
+            return;
+          }
+
+          stats.allocated_bytes -= bytes;
+        }
+
+        delete[] static_cast<T*>(ptr);
+      }
+    };
+
+    static size_t _size_class(size_t size)
     {
-      buf.len = 0;
-      _buffers.push(std::move(buf));
+      if (size <= MIN_CLASS_SIZE) {
+        return 0;
+      }
+      return std::bit_width((size - 1) / MIN_CLASS_SIZE);
     }
 
-    Buffer<T> _allocate_buffer(size_t size)
+    static size_t _class_size(size_t size_class)
     {
-      return Buffer<T>{new T[size], size, 0};
+      return MIN_CLASS_SIZE << size_class;
     }
+
+    std::shared_ptr<Storage> _storage;
   };
 
 } // namespace praas::process::runtime::internal
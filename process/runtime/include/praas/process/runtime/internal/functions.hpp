@@ -1,9 +1,11 @@
 #ifndef PRAAS_PROCESS_RUNTIME_FUNCTIONS_HPP
 #define PRAAS_PROCESS_RUNTIME_FUNCTIONS_HPP
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <cereal/external/rapidjson/fwd.h>
 
@@ -15,6 +17,10 @@ namespace praas::process::runtime::internal {
 
   Language string_to_language(std::string language);
 
+  // Functions run in worker processes, or - when the code is trusted - on threads
+  // of the controller, which avoids passing messages to another process.
+  enum class Execution { PROCESS = 0, THREAD };
+
   struct TriggerVisitor;
 
   struct Trigger {
@@ -46,9 +52,151 @@ namespace praas::process::runtime::internal {
     void accept(TriggerVisitor&) const;
   };
 
+  // Invocations are dispatched together to one worker, once there are enough of them,
+  // or when the oldest one waited for max_wait.
+  struct BatchTrigger : Trigger {
+
+    static constexpr int DEFAULT_MAX_WAIT_US = 1000;
+
+    BatchTrigger(std::string name, int size, std::chrono::microseconds max_wait)
+        : Trigger(std::move(name)), _size(size), _max_wait(max_wait)
+    {
+    }
+
+    Type type() const override;
+
+    void accept(TriggerVisitor&) const override;
+
+    int size() const
+    {
+      return _size;
+    }
+
+    std::chrono::microseconds max_wait() const
+    {
+      return _max_wait;
+    }
+
+  private:
+    int _size;
+    std::chrono::microseconds _max_wait;
+  };
+
+  // Fan-in: the invocation waits until payloads from all named sources, or from the given
+  // number of arbitrary sources, have arrived. Arguments follow the order of named sources.
+  struct MultiSourceTrigger : Trigger {
+
+    MultiSourceTrigger(std::string name, int nargs) : Trigger(std::move(name)), _nargs(nargs) {}
+
+    MultiSourceTrigger(std::string name, std::vector<std::string> sources)
+        : Trigger(std::move(name)), _nargs(static_cast<int>(sources.size())),
+          _sources(std::move(sources))
+    {
+    }
+
+    Type type() const override;
+
+    void accept(TriggerVisitor&) const override;
+
+    int nargs() const
+    {
+      return _nargs;
+    }
+
+    bool named() const
+    {
+      return !_sources.empty();
+    }
+
+    const std::vector<std::string>& sources() const
+    {
+      return _sources;
+    }
+
+    // Position of the source among arguments, or -1 when it is not expected.
+    int source_index(std::string_view source) const;
+
+  private:
+    int _nargs;
+    std::vector<std::string> _sources;
+  };
+
+  // The output of the function becomes the input of the next stage. Only the result of
+  // the last stage returns to the caller.
+  struct PipelineTrigger : Trigger {
+
+    PipelineTrigger(std::string name, std::string next)
+        : Trigger(std::move(name)), _next(std::move(next))
+    {
+    }
+
+    Type type() const override;
+
+    void accept(TriggerVisitor&) const override;
+
+    const std::string& next() const
+    {
+      return _next;
+    }
+
+  private:
+    std::string _next;
+  };
+
+  // The invocation waits until each upstream function produced an output, and all state
+  // keys exist. Each invocation consumes one output of every upstream function, passed
+  // as arguments after its own payload.
+  // Outputs needed by waiting invocations are always kept. Beyond them, at most max_outputs
+  // outputs of each upstream function are kept for future invocations - older ones are dropped.
+  struct DependencyTrigger : Trigger {
+
+    static constexpr int DEFAULT_MAX_OUTPUTS = 64;
+
+    DependencyTrigger(
+        std::string name, std::vector<std::string> functions, std::vector<std::string> state,
+        int max_outputs = DEFAULT_MAX_OUTPUTS
+    )
+        : Trigger(std::move(name)), _functions(std::move(functions)), _state(std::move(state)),
+          _max_outputs(max_outputs)
+    {
+    }
+
+    Type type() const override;
+
+    void accept(TriggerVisitor&) const override;
+
+    const std::vector<std::string>& functions() const
+    {
+      return _functions;
+    }
+
+    const std::vector<std::string>& state() const
+    {
+      return _state;
+    }
+
+    int max_outputs() const
+    {
+      return _max_outputs;
+    }
+
+  private:
+    std::vector<std::string> _functions;
+    std::vector<std::string> _state;
+    int _max_outputs;
+  };
+
   struct TriggerVisitor {
 
     virtual void visit(const DirectTrigger&) = 0;
+
+    virtual void visit(const BatchTrigger&) = 0;
+
+    virtual void visit(const MultiSourceTrigger&) = 0;
+
+    virtual void visit(const PipelineTrigger&) = 0;
+
+    virtual void visit(const DependencyTrigger&) = 0;
   };
 
   struct Function {
@@ -66,6 +214,19 @@ namespace praas::process::runtime::internal {
     std::string module_name;
     std::string function_name;
 
+    // Invocations running at the same time - 0 is unlimited.
+    int max_concurrency{};
+
+    // Workers that only this function can use, e.g., so that a storm of slow invocations
+    // of other functions cannot take all of them.
+    int reserved_workers{};
+
+    // Time after which a running invocation is aborted and its worker replaced - 0 disables it.
+    int timeout_ms{};
+
+    // Threads cannot be stopped or reserved - such functions have no timeout or reservation.
+    Execution execution{Execution::PROCESS};
+
     void load_config(std::istream&);
   };
 
@@ -80,6 +241,24 @@ namespace praas::process::runtime::internal {
 
     const Function* get_function(std::string name) const;
 
+    // Functions with a dependency trigger waiting for the output of this function.
+    const std::vector<std::string>& function_dependents(const std::string& name) const;
+
+    // Functions with a dependency trigger waiting for this state key.
+    const std::vector<std::string>& state_dependents(const std::string& key) const;
+
+    // Workers reserved by all functions.
+    int reserved_workers() const
+    {
+      return _reserved_workers;
+    }
+
+    // Functions executed on threads of the controller.
+    int thread_functions() const
+    {
+      return _thread_functions;
+    }
+
     citer_t begin() const
     {
       return _functions.begin();
@@ -91,7 +270,20 @@ namespace praas::process::runtime::internal {
     }
 
   private:
+    // Each pipeline stage must exist, and the pipeline must end.
+    void _validate_pipelines() const;
+
+    // Upstream functions must exist and cannot depend on their dependents.
+    void _index_dependencies();
+
     std::unordered_map<std::string, Function> _functions;
+
+    std::unordered_map<std::string, std::vector<std::string>> _function_dependents;
+    std::unordered_map<std::string, std::vector<std::string>> _state_dependents;
+
+    int _reserved_workers{};
+
+    int _thread_functions{};
   };
 
 } // namespace praas::process::runtime::internal
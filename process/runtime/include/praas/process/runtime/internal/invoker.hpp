@@ -8,26 +8,64 @@
 #include <praas/process/runtime/invocation.hpp>
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <spdlog/spdlog.h>
 
 namespace praas::process::runtime::internal {
 
+  /**
+   * Receives invocations from the controller, and returns their results.
+   *
+   * With several threads, invocations run concurrently in one process: the thread calling
+   * dispatch receives all messages, and each execution thread polls for its own invocations.
+   * An execution thread is bound to its slot when it creates its context. Replies are routed
+   * to the thread that sent the request - by the invocation id, or by the message name;
+   * threads waiting for the same message name receive the replies in any order.
+   */
   struct Invoker {
 
-    Invoker(std::string process_id, ipc::IPCMode ipc_mode, const std::string& ipc_name);
+    // With non-zero spin time, the invoker busy-polls for the next message before blocking.
+    Invoker(
+        std::string process_id, ipc::IPCMode ipc_mode, const std::string& ipc_name,
+        std::chrono::microseconds spin_time = std::chrono::microseconds{0}, int threads = 1
+    );
+
+    // Invoker running on a thread of the controller, connected through the given channels.
+    Invoker(
+        std::string process_id, std::unique_ptr<ipc::IPCChannel> read_channel,
+        std::unique_ptr<ipc::IPCChannel> write_channel
+    );
+
+    // Tells the controller that functions are loaded - no invocations are sent before.
+    void ready();
 
     std::optional<Invocation> poll();
 
+    // Receives messages for execution threads until the channel is closed,
+    // and wakes up all threads before returning.
+    void dispatch();
+
     void finish(std::string_view invocation_id, BufferAccessor<const char> output, int return_code);
 
     void finish(std::string_view invocation_id, std::string_view error_message);
 
     void shutdown();
 
+    // Invoker on a thread is stopped by closing its channels - the pending poll
+    // returns nothing instead of reporting a failure.
+    void stop()
+    {
+      _ending = true;
+    }
+
     void put(ipc::Message& msg, BufferAccessor<std::byte> payload);
     void put(ipc::Message& msg, BufferAccessor<const char> payload);
 
@@ -36,13 +74,13 @@ namespace praas::process::runtime::internal {
     template <typename MsgType>
     std::tuple<MsgType, Buffer<char>> get()
     {
-      auto [read, data] = _ipc_channel_read->receive();
+      auto [read, data] = _receive_reply();
       if (!read) {
         throw common::FunctionGetFailure{"Failed get - forgot to send reason"};
       }
 
       // Receive GET request result with payload.
-      auto parsed_msg = _ipc_channel_read->message().parse();
+      auto parsed_msg = _reply_message().parse();
       if (!std::holds_alternative<MsgType>(parsed_msg)) {
         throw common::FunctionGetFailure{"Received incorrect message!"};
       }
@@ -51,6 +89,7 @@ namespace praas::process::runtime::internal {
       return std::make_tuple(req, std::move(data));
     }
 
+    // Binds the calling thread to a free slot when the invoker has several threads.
     Context create_context();
 
     common::Application& application()
@@ -58,13 +97,72 @@ namespace praas::process::runtime::internal {
       return _app_status;
     }
 
+    // Shared with the controller - empty if the IPC method does not support it.
+    const std::shared_ptr<ipc::SHMArena>& arena() const
+    {
+      return _arena;
+    }
+
   private:
     // Standard input size = 5 MB
     static constexpr int BUFFER_SIZE = 1024 * 1024 * 5;
 
-    std::string _process_id;
+    // Invocation executed by one thread, and the reply it waits for.
+    struct Slot {
+
+      Buffer<std::byte> input;
+
+      // Invocation executed now - the caller of local invocations sent by the thread.
+      std::string invocation_id;
+
+      // Invocations of a batch are returned one by one from the input buffer,
+      // and their results are sent together after the last one.
+      std::byte* batch_pos{};
+      int batch_remaining{};
+      int batch_size{};
+      std::vector<char> batch_results;
+
+      // Type of the expected reply, and its key - the message name or the invocation id.
+      ipc::Message::Type reply_type{ipc::Message::Type::GENERIC_HEADER};
+      std::string reply_key;
+
+      bool replied{};
+      ipc::Message reply;
+      Buffer<char> reply_data;
+      std::condition_variable reply_cv;
+    };
+
+    // Slot of the calling thread - the only one, unless the invoker has several threads.
+    Slot& _slot() const;
+
+    // Returns true when the message holds an invocation.
+    bool _read_message(Slot& slot, ipc::Message::MessageVariants& parsed_msg, Invocation& invoc);
 
-    Buffer<std::byte> _input;
+    // Returns the number of payload bytes used by the invocation.
+    size_t _read_invocation(
+        const ipc::InvocationRequestParsed& req, std::byte* data, size_t len, Invocation& invoc
+    );
+
+    void _next_batch_invocation(Slot& slot, Invocation& invoc);
+
+    void _send_result(ipc::InvocationResult& msg, BufferAccessor<const char> output);
+
+    template <typename Payload>
+    void _send(ipc::Message& msg, Payload payload);
+
+    // The reply is registered before the request is sent - it cannot arrive earlier.
+    void _expect_reply(Slot& slot, const ipc::Message& msg);
+
+    void _deliver_reply(
+        ipc::Message::Type type, std::string_view key, const ipc::Message& msg,
+        Buffer<char>&& data
+    );
+
+    std::tuple<bool, Buffer<char>> _receive_reply();
+
+    const ipc::Message& _reply_message() const;
+
+    std::string _process_id;
 
     common::Application _app_status;
 
@@ -73,6 +171,26 @@ namespace praas::process::runtime::internal {
     std::unique_ptr<ipc::IPCChannel> _ipc_channel_read;
     std::unique_ptr<ipc::IPCChannel> _ipc_channel_write;
 
+    std::shared_ptr<ipc::SHMArena> _arena;
+
+    int _threads{1};
+
+    std::vector<std::unique_ptr<Slot>> _slots;
+
+    size_t _bound_slots{};
+
+    static thread_local Slot* _thread_slot;
+
+    // Protects slots and received invocations shared with the dispatching thread.
+    std::mutex _lock;
+
+    // Invocations received by the dispatching thread, waiting for an execution thread.
+    std::deque<std::tuple<ipc::Message, Buffer<char>>> _invocations;
+    std::condition_variable _invocations_cv;
+
+    // Messages of execution threads are sent one at a time.
+    std::mutex _write_lock;
+
     std::shared_ptr<spdlog::logger> _logger;
   };
 
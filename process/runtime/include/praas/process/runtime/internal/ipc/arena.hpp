@@ -0,0 +1,137 @@
+#ifndef PRAAS_PROCESS_RUNTIME_IPC_ARENA_HPP
+#define PRAAS_PROCESS_RUNTIME_IPC_ARENA_HPP
+
+#include <praas/process/runtime/internal/buffer.hpp>
+
+#include <memory>
+
+namespace praas::process::runtime::internal::ipc {
+
+  /**
+   * Buffer allocator placed in a memory segment shared by the controller and a single worker.
+   *
+   * Buffers are allocated in pages, and each block carries a reference count stored in the
+   * segment. This allows both sides to hold the same block: the sender of a message takes an
+   * additional reference, and the receiver releases it once the buffer is no longer needed.
+   * All bookkeeping is protected by a robust, process-shared mutex.
+   *
+   * The segment is an anonymous memfd created by the controller before forking the worker.
+   * The descriptor is passed to the child and announced through the SHM channel.
+   * Pages are reserved on allocation - when the system cannot back them, the allocation fails
+   * and the caller should fall back to the heap. Freed pages stay reserved for the next
+   * allocations, until their size exceeds the retained limit - then holes are punched into
+   * all free pages, and the memory is returned to the system.
+   */
+  struct SHMArena : BufferOwner, std::enable_shared_from_this<SHMArena> {
+
+    static constexpr size_t PAGE_SIZE = 64 * 1024;
+
+    // Only the pages that are allocated are backed by memory.
+    static constexpr size_t DEFAULT_SIZE = 1024UL * 1024 * 1024;
+
+    static constexpr size_t DEFAULT_RETAINED_SIZE = 16UL * 1024 * 1024;
+
+    static std::shared_ptr<SHMArena> create(
+        size_t size = DEFAULT_SIZE, size_t retained_size = DEFAULT_RETAINED_SIZE
+    );
+
+    static std::shared_ptr<SHMArena> open(int fd);
+
+    SHMArena(const SHMArena&) = delete;
+    SHMArena& operator=(const SHMArena&) = delete;
+    SHMArena(SHMArena&&) = delete;
+    SHMArena& operator=(SHMArena&&) = delete;
+
+    ~SHMArena() override;
+
+    int fd() const
+    {
+      return _fd;
+    }
+
+    size_t size() const
+    {
+      return _data_size;
+    }
+
+    bool contains(const void* ptr) const;
+
+    size_t offset(const void* ptr) const;
+
+    // Returns a null buffer if the arena cannot fit the allocation.
+    template <typename T>
+    Buffer<T> allocate(size_t size)
+    {
+      void* ptr = _allocate(size);
+      if (!ptr) {
+        return Buffer<T>{};
+      }
+      return Buffer<T>{static_cast<T*>(ptr), size, 0, BufferDeleter{shared_from_this()}};
+    }
+
+    // Takes a buffer reference that has been acquired by the other side.
+    // Throws InvalidMessage unless the location is the start of an allocated block fitting len.
+    template <typename T>
+    Buffer<T> adopt(size_t offset, size_t len)
+    {
+      _validate(offset, len);
+
+      // NOLINTNEXTLINE
+      T* ptr = reinterpret_cast<T*>(_data + offset);
+      return Buffer<T>{ptr, len, len, BufferDeleter{shared_from_this()}};
+    }
+
+    // Adds a reference to the block containing the pointer.
+    void acquire(const void* ptr);
+
+    // Blocks are found by their address - the tag is not used.
+    void release(void* ptr, size_t tag) override;
+
+    bool shared() const override
+    {
+      return true;
+    }
+
+    // Number of allocated pages.
+    size_t used_pages() const;
+
+    // Number of pages backed by memory - allocated, and free ones that are retained.
+    size_t reserved_pages() const;
+
+  private:
+    struct Header;
+    struct PageEntry;
+
+    SHMArena() = default;
+
+    void _map(int fd, size_t mapped_size);
+
+    void* _allocate(size_t size);
+
+    // Locations are sent by the other process - it might be faulty or malicious.
+    void _validate(size_t offset, size_t len) const;
+
+    // Returns the memory of all free pages to the system. Requires the lock.
+    void _punch_free_pages();
+
+    size_t _page(const void* ptr) const;
+
+    void _lock() const;
+    void _unlock() const;
+
+    int _fd{-1};
+
+    Header* _header{};
+
+    PageEntry* _pages{};
+
+    char* _data{};
+
+    size_t _data_size{};
+
+    size_t _mapped_size{};
+  };
+
+} // namespace praas::process::runtime::internal::ipc
+
+#endif
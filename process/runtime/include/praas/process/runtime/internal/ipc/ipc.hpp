@@ -2,22 +2,31 @@
 #define PRAAS_PROCESS_RUNTIME_IPC_IPC_HPP
 
 #include <praas/process/runtime/internal/buffer.hpp>
+#include <praas/process/runtime/internal/ipc/arena.hpp>
 #include <praas/process/runtime/internal/ipc/messages.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <memory>
 #include <optional>
 #include <string>
 #include <tuple>
 
 #include <mqueue.h>
+#include <sys/epoll.h>
 
 namespace praas::process::runtime::internal::ipc {
 
-  enum IPCMode { POSIX_MQ, NONE };
+  enum IPCMode { POSIX_MQ, SHM, NONE };
 
   enum IPCDirection { WRITE, READ };
 
   IPCMode deserialize(std::string);
 
+  std::string serialize(IPCMode);
+
   struct IPCChannel {
 
     virtual ~IPCChannel() = 0;
@@ -38,7 +47,38 @@ namespace praas::process::runtime::internal::ipc {
 
     virtual const Message& message() const = 0;
 
+    // Sends the data that could not be delivered without blocking.
+    // Returns true when nothing is left in the send queue.
+    virtual bool flush() = 0;
+
+    // Events of fd() reported by epoll when flush can deliver more data.
+    virtual uint32_t flush_events() const
+    {
+      return EPOLLOUT;
+    }
+
+    // Bytes accepted by send but not delivered to the receiver yet.
+    virtual size_t queued_bytes() const = 0;
+
+    // The highest number of queued bytes observed since the channel was opened.
+    virtual size_t max_queued_bytes() const = 0;
+
+    // Usage of the pool providing buffers for received messages.
+    virtual BufferPoolStats buffer_stats() const = 0;
+
     virtual void shutdown() = 0;
+
+    // Stops a blocking receive, which then reports a failure. Safe to call from a signal handler.
+    virtual void interrupt() {}
+
+    // Blocking receive busy-polls for the next message before going to sleep.
+    void spin_time(std::chrono::microseconds time)
+    {
+      _spin_time = time;
+    }
+
+  protected:
+    std::chrono::microseconds _spin_time{};
   };
 
   struct POSIXMQChannel : public IPCChannel {
@@ -50,8 +90,10 @@ namespace praas::process::runtime::internal::ipc {
     static constexpr int BUFFER_ELEMS = 5;
     static constexpr int BUFFER_SIZE = 1 * 1024 * 1024;
 
+    // Non-blocking channels never wait for the receiver - when the queue is full,
+    // the remaining data is kept in the send queue until flush delivers it.
     POSIXMQChannel(
-        std::string queue_name, IPCDirection direction, bool send, bool create = false,
+        std::string queue_name, IPCDirection direction, bool blocking, bool create = false,
         int msg_size = MAX_MSG_SIZE
     );
     virtual ~POSIXMQChannel();
@@ -71,6 +113,23 @@ namespace praas::process::runtime::internal::ipc {
     void send(Message& msg, BufferAccessor<const char> buf) override;
     void send(Message& msg, BufferAccessor<std::byte> buf) override;
 
+    bool flush() override;
+
+    size_t queued_bytes() const override
+    {
+      return _queued_bytes;
+    }
+
+    size_t max_queued_bytes() const override
+    {
+      return _max_queued_bytes;
+    }
+
+    BufferPoolStats buffer_stats() const override
+    {
+      return _buffers.stats();
+    }
+
     void shutdown() override;
 
     const Message& message() const override
@@ -87,8 +146,10 @@ namespace praas::process::runtime::internal::ipc {
 
     int _msg_size;
 
-    BufferQueue<char> _buffers;
+    BufferPool<char> _buffers;
 
+    // Single queue message - the channel is used in one direction only,
+    // and the buffer holds either the received message or the coalesced one to send.
     std::unique_ptr<int8_t[]> _msg_buffer;
 
     bool _header_read{};
@@ -98,11 +159,263 @@ namespace praas::process::runtime::internal::ipc {
 
     Buffer<char> _msg_payload;
 
-    void _send(const char* data, int len) const;
-    void _send(const int8_t* data, int len) const;
+    // Each element is the undelivered part of a single send, and it is split into
+    // queue messages from its beginning - the receiver never sees the boundaries moved.
+    std::deque<Buffer<char>> _send_queue;
+    // Bytes of the front element that have already been delivered.
+    size_t _send_pos{};
+
+    size_t _queued_bytes{};
+    size_t _max_queued_bytes{};
+
+    void _send(const char* data, int len);
+    void _send(const int8_t* data, int len);
+    // Returns the number of bytes delivered before the queue became full.
+    int _send_chunks(const char* data, int len) const;
+
+    // Header and a payload that fit in a single queue message are sent together.
+    // The receiver recognizes them by the length of the message.
+    bool _fits_inline(size_t len) const;
+    // Copies the header into the message buffer, returns the location of payload.
+    int8_t* _inline_header(const Message& msg);
     size_t _recv(int8_t* data, size_t len) const;
     size_t _recv(std::byte* data, size_t len) const;
     size_t _recv(char* data, size_t len) const;
+
+    // Polls for a single queue message until the spin time expires.
+    // Returns zero when nothing arrived.
+    size_t _spin_recv(int8_t* data) const;
+  };
+
+  /**
+   * Single-producer, single-consumer ring buffer placed in POSIX shared memory.
+   *
+   * Messages are copied once into the ring and once out of it, regardless of their size.
+   * The two eventfd doorbells are only rung when the other side announced that it sleeps:
+   * the reader waiting for data, or the writer waiting for free space.
+   *
+   * The segment and doorbells are created by the controller before forking the worker.
+   * Doorbells are closed on exec - the controller passes them only to the worker of the channel,
+   * which inherits them under the numbers stored in the segment header.
+   * The descriptor of a channel is the doorbell of its reader - or of its writer, when
+   * the channel is used to send.
+   *
+   * When the channel is attached to a buffer arena, payloads allocated in the arena are not
+   * copied: the message carries only their location, and the receiver shares the block.
+   */
+  struct SHMChannel : public IPCChannel {
+
+    static constexpr size_t RING_SIZE = 4 * 1024 * 1024;
+
+    static constexpr int BUFFER_ELEMS = 5;
+    static constexpr int BUFFER_SIZE = 1 * 1024 * 1024;
+
+    // The creator announces the arena to the other side.
+    // When opening, the arena is mapped from the header unless it is provided.
+    SHMChannel(
+        std::string name, IPCDirection direction, bool create = false, size_t ring_size = RING_SIZE,
+        std::shared_ptr<SHMArena> arena = nullptr
+    );
+    virtual ~SHMChannel();
+
+    std::string name() const
+    {
+      return _name;
+    }
+
+    const std::shared_ptr<SHMArena>& arena() const
+    {
+      return _arena;
+    }
+
+    // Descriptors the worker must inherit to open the channel: doorbells, and the arena.
+    std::vector<int> descriptors() const;
+
+    int fd() const override;
+
+    std::tuple<bool, Buffer<char>> receive() override;
+    bool blocking_receive(Buffer<std::byte>& buf) override;
+
+    void send(Message& msg) override;
+    void send(Message& msg, const std::vector<Buffer<char>>& data) override;
+    void send(Message& msg, BufferAccessor<const char> buf) override;
+    void send(Message& msg, BufferAccessor<std::byte> buf) override;
+
+    // Only the controller defers sends - the worker waits for free space in the ring.
+    bool flush() override;
+
+    size_t queued_bytes() const override
+    {
+      return _queued_bytes;
+    }
+
+    size_t max_queued_bytes() const override
+    {
+      return _max_queued_bytes;
+    }
+
+    // The reader rings the doorbell of fd() when it frees space in the ring.
+    uint32_t flush_events() const override
+    {
+      return EPOLLIN;
+    }
+
+    BufferPoolStats buffer_stats() const override
+    {
+      return _buffers.stats();
+    }
+
+    void shutdown() override;
+
+    // Rings the doorbell that the blocked side sleeps on.
+    void interrupt() override;
+
+    const Message& message() const override
+    {
+      return _msg;
+    }
+
+  private:
+    struct RingHeader;
+
+    // Each message header is followed by the location of its payload in the arena.
+    static constexpr uint64_t INLINE_PAYLOAD = std::numeric_limits<uint64_t>::max();
+    static constexpr size_t HEADER_SIZE = Message::BUF_SIZE + sizeof(uint64_t);
+
+    RingHeader* _header{};
+
+    char* _ring{};
+
+    size_t _mapped_size{};
+
+    bool _created;
+
+    // The controller polls the doorbells with epoll, and never waits for the worker:
+    // a partially received message is kept until the rest arrives, and data that does not fit
+    // into the ring is kept in the send queue until flush delivers it.
+    // The worker blocks until the next message arrives, or until there is space in the ring.
+    bool _blocking;
+
+    // Waiting for the doorbell is retried when a signal arrives - only interrupt() stops it.
+    std::atomic<bool> _interrupted{};
+
+    IPCDirection _direction;
+
+    std::string _name;
+
+    BufferPool<char> _buffers;
+
+    std::shared_ptr<SHMArena> _arena;
+
+    Message _msg;
+
+    // Bytes of the header and payload location received so far.
+    size_t _header_read{};
+
+    uint64_t _location{INLINE_PAYLOAD};
+
+    Buffer<char> _msg_payload;
+
+    // Same as in POSIXMQChannel - undelivered parts of sends, in their order.
+    std::deque<Buffer<char>> _send_queue;
+    size_t _send_pos{};
+
+    size_t _queued_bytes{};
+    size_t _max_queued_bytes{};
+
+    size_t _readable() const;
+    size_t _writable() const;
+
+    // Return false when no data (space) is available and the side has been armed for a wakeup.
+    bool _wait_readable(bool blocking) const;
+    bool _wait_writable(bool blocking) const;
+
+    void _send(Message& msg, const char* data, size_t len);
+    void _send(const char* data, size_t len);
+    // Copy as much as possible without waiting, and return the number of bytes.
+    size_t _write(const char* data, size_t len) const;
+    size_t _read(char* data, size_t len) const;
+    // Waits until all data has been received.
+    size_t _recv(char* data, size_t len) const;
+
+    // Returns the arena offset of the payload, or INLINE_PAYLOAD.
+    uint64_t _recv_header();
+
+    // Continues the message received in the previous calls.
+    // Returns true when the header and payload are complete.
+    bool _recv_partial();
+  };
+
+  /**
+   * Channel between the controller and a worker running on one of its threads.
+   *
+   * Messages are passed through a queue in memory, and each payload is copied once when
+   * sent - the receiver takes over the copy. The eventfd of the queue is readable while the queue
+   * holds messages, which lets the controller poll it with epoll like other channels.
+   * Blocking receivers sleep on the queue instead.
+   *
+   * Both sides of a connection share the queue. Shutting down either of them closes it,
+   * and wakes up a receiver waiting for the next message.
+   */
+  struct ThreadChannel : public IPCChannel {
+
+    static constexpr int BUFFER_ELEMS = 5;
+    static constexpr int BUFFER_SIZE = 1 * 1024 * 1024;
+
+    struct Queue;
+
+    static std::shared_ptr<Queue> create_queue();
+
+    ThreadChannel(std::shared_ptr<Queue> queue, IPCDirection direction, bool blocking);
+    virtual ~ThreadChannel() = default;
+
+    int fd() const override;
+
+    std::tuple<bool, Buffer<char>> receive() override;
+    bool blocking_receive(Buffer<std::byte>& buf) override;
+
+    void send(Message& msg) override;
+    void send(Message& msg, const std::vector<Buffer<char>>& data) override;
+    void send(Message& msg, BufferAccessor<const char> buf) override;
+    void send(Message& msg, BufferAccessor<std::byte> buf) override;
+
+    // The queue is unbounded - nothing is ever deferred.
+    bool flush() override
+    {
+      return true;
+    }
+
+    size_t queued_bytes() const override
+    {
+      return 0;
+    }
+
+    size_t max_queued_bytes() const override
+    {
+      return 0;
+    }
+
+    // Payloads come from the pool of the queue, and return there when the receiver drops them.
+    BufferPoolStats buffer_stats() const override;
+
+    void shutdown() override;
+
+    const Message& message() const override
+    {
+      return _msg;
+    }
+
+  private:
+    std::shared_ptr<Queue> _queue;
+
+    bool _blocking;
+
+    Message _msg;
+
+    void _send(const Message& msg, Buffer<char>&& payload);
+
+    // Returns false when the queue is empty, or when it was closed while waiting.
+    bool _recv(Buffer<char>& payload);
   };
 
 } // namespace praas::process::runtime::internal::ipc
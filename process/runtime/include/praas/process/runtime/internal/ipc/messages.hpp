@@ -27,6 +27,9 @@ namespace praas::process::runtime::internal::ipc {
   struct StateKeysRequestParsed;
   struct StateKeysResultParsed;
   struct ApplicationUpdateParsed;
+  struct WorkerReadyParsed;
+  struct InvocationBatchParsed;
+  struct InvocationBatchResultParsed;
 
   struct Message {
 
@@ -39,6 +42,9 @@ namespace praas::process::runtime::internal::ipc {
       APPLICATION_UPDATE,
       STATE_KEYS_REQUEST,
       STATE_KEYS_RESULT,
+      WORKER_READY,
+      INVOCATION_BATCH,
+      INVOCATION_BATCH_RESULT,
       END_FLAG
     };
 
@@ -68,7 +74,8 @@ namespace praas::process::runtime::internal::ipc {
 
     using MessageVariants = std::variant<
         GetRequestParsed, PutRequestParsed, InvocationRequestParsed, InvocationResultParsed,
-        ApplicationUpdateParsed, StateKeysResultParsed, StateKeysRequestParsed>;
+        ApplicationUpdateParsed, StateKeysResultParsed, StateKeysRequestParsed, WorkerReadyParsed,
+        InvocationBatchParsed, InvocationBatchResultParsed>;
 
     MessageVariants parse() const;
 
@@ -152,11 +159,13 @@ namespace praas::process::runtime::internal::ipc {
     static constexpr Type TYPE = Type::PUT_REQUEST;
   };
 
+  // Invocation ID, function name, process ID, caller ID, and the lengths of buffers.
   struct InvocationRequestParsed {
     const int8_t* buf;
     size_t process_id_len;
     size_t id_len;
     size_t name_len;
+    size_t caller_id_len;
 
     InvocationRequestParsed(const int8_t* buf)
         : buf(buf),
@@ -169,6 +178,11 @@ namespace praas::process::runtime::internal::ipc {
           name_len(strnlen(
               // NOLINTNEXTLINE
               reinterpret_cast<const char*>(buf + Message::ID_LENGTH), Message::NAME_LENGTH
+          )),
+          caller_id_len(strnlen(
+              // NOLINTNEXTLINE
+              reinterpret_cast<const char*>(buf + 2 * Message::ID_LENGTH + Message::NAME_LENGTH),
+              Message::ID_LENGTH
           ))
     {
     }
@@ -176,13 +190,16 @@ namespace praas::process::runtime::internal::ipc {
     std::string_view process_id() const;
     std::string_view invocation_id() const;
     std::string_view function_name() const;
+    // Invocation of the function that sent a local request - empty for other requests.
+    std::string_view caller_id() const;
     int32_t buffers() const;
     const int32_t* buffers_lengths() const;
   };
 
   struct InvocationRequest : Message, InvocationRequestParsed {
 
-    static constexpr int MAX_BUFFERS = 16;
+    // Lengths of buffers fill the rest of the header.
+    static constexpr int MAX_BUFFERS = 8;
 
     InvocationRequest()
         : Message(Type::INVOCATION_REQUEST),
@@ -190,7 +207,24 @@ namespace praas::process::runtime::internal::ipc {
     {
     }
 
+    // The parsed view must point into our own buffer, not into the copied one.
+    InvocationRequest(const InvocationRequest& obj) : Message(obj), InvocationRequestParsed(obj)
+    {
+      buf = this->data.data() + HEADER_OFFSET;
+    }
+
+    InvocationRequest& operator=(const InvocationRequest& obj)
+    {
+      Message::operator=(obj);
+      InvocationRequestParsed::operator=(obj);
+      buf = this->data.data() + HEADER_OFFSET;
+      return *this;
+    }
+
+    ~InvocationRequest() = default;
+
     using InvocationRequestParsed::buffers;
+    using InvocationRequestParsed::caller_id;
     using InvocationRequestParsed::function_name;
     using InvocationRequestParsed::invocation_id;
     using InvocationRequestParsed::process_id;
@@ -198,6 +232,7 @@ namespace praas::process::runtime::internal::ipc {
     void process_id(std::string_view id);
     void invocation_id(std::string_view id);
     void function_name(std::string_view name);
+    void caller_id(std::string_view id);
     void buffers(int32_t* begin, int32_t* end);
     void buffers(int32_t buf);
 
@@ -213,7 +248,7 @@ namespace praas::process::runtime::internal::ipc {
 
       // NOLINTNEXTLINE
       auto ptr = reinterpret_cast<int32_t*>(
-          data.data() + HEADER_OFFSET + Message::NAME_LENGTH + 2 * Message::ID_LENGTH
+          data.data() + HEADER_OFFSET + Message::NAME_LENGTH + 3 * Message::ID_LENGTH
       );
       *ptr++ = elems;
 
@@ -321,6 +356,72 @@ namespace praas::process::runtime::internal::ipc {
     void status_change(int32_t code);
   };
 
+  // Sent by the invoker once its functions are loaded - only then it receives invocations.
+  struct WorkerReadyParsed {
+    const int8_t* buf;
+
+    WorkerReadyParsed(const int8_t* buf) : buf(buf) {}
+
+    int32_t pid() const;
+  };
+
+  struct WorkerReady : Message, WorkerReadyParsed {
+
+    WorkerReady()
+        : Message(Type::WORKER_READY), WorkerReadyParsed(this->data.data() + HEADER_OFFSET)
+    {
+    }
+
+    using WorkerReadyParsed::pid;
+
+    void pid(int32_t pid);
+  };
+
+  // Invocations of one function sent to a worker together. The payload holds for each of them
+  // the header of an InvocationRequest, followed by its buffers.
+  struct InvocationBatchParsed {
+    const int8_t* buf;
+
+    InvocationBatchParsed(const int8_t* buf) : buf(buf) {}
+
+    int32_t invocations() const;
+  };
+
+  struct InvocationBatch : Message, InvocationBatchParsed {
+
+    InvocationBatch()
+        : Message(Type::INVOCATION_BATCH), InvocationBatchParsed(this->data.data() + HEADER_OFFSET)
+    {
+    }
+
+    using InvocationBatchParsed::invocations;
+
+    void invocations(int32_t count);
+  };
+
+  // Results of a batch. The payload holds for each invocation the header of an InvocationResult,
+  // followed by its output.
+  struct InvocationBatchResultParsed {
+    const int8_t* buf;
+
+    InvocationBatchResultParsed(const int8_t* buf) : buf(buf) {}
+
+    int32_t invocations() const;
+  };
+
+  struct InvocationBatchResult : Message, InvocationBatchResultParsed {
+
+    InvocationBatchResult()
+        : Message(Type::INVOCATION_BATCH_RESULT),
+          InvocationBatchResultParsed(this->data.data() + HEADER_OFFSET)
+    {
+    }
+
+    using InvocationBatchResultParsed::invocations;
+
+    void invocations(int32_t count);
+  };
+
 } // namespace praas::process::runtime::internal::ipc
 
 #endif
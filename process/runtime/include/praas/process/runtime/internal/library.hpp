@@ -0,0 +1,52 @@
+#ifndef PRAAS_PROCESS_RUNTIME_INTERNAL_LIBRARY_HPP
+#define PRAAS_PROCESS_RUNTIME_INTERNAL_LIBRARY_HPP
+
+#include <praas/process/runtime/context.hpp>
+#include <praas/process/runtime/internal/functions.hpp>
+#include <praas/process/runtime/invocation.hpp>
+
+#include <string>
+#include <unordered_map>
+
+namespace praas::process::runtime::internal {
+
+  // Shared libraries with the code of C++ functions. Libraries are opened once,
+  // even when many functions come from them, and closed with the object.
+  struct FunctionsLibrary {
+
+    static constexpr Language LANGUAGE = Language::CPP;
+
+    using FuncType = int (*)(Invocation, Context&);
+
+    // Only functions with the given execution mode are loaded - the controller
+    // never opens libraries of functions that run in worker processes.
+    FunctionsLibrary(const Functions& functions, Execution execution);
+
+    FunctionsLibrary(
+        const std::string& code_location, const std::string& config_location, Execution execution
+    );
+
+    FunctionsLibrary(const FunctionsLibrary&) = delete;
+    FunctionsLibrary(FunctionsLibrary&&) = delete;
+    FunctionsLibrary& operator=(const FunctionsLibrary&) = delete;
+    FunctionsLibrary& operator=(FunctionsLibrary&&) = delete;
+    ~FunctionsLibrary();
+
+    // Safe to call from many threads.
+    FuncType get_function(const std::string& name) const;
+
+  private:
+    void _load(const Functions& functions, Execution execution);
+
+    bool _load_function(
+        const std::string& function_name, const std::string& library_name,
+        const std::string& library_function
+    );
+
+    std::unordered_map<std::string, void*> _libraries;
+    std::unordered_map<std::string, void*> _functions;
+  };
+
+} // namespace praas::process::runtime::internal
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef PRAAS_PROCESS_RUNTIME_INTERNAL_PLACEMENT_HPP
+#define PRAAS_PROCESS_RUNTIME_INTERNAL_PLACEMENT_HPP
+
+#include <string>
+#include <vector>
+
+namespace praas::process::runtime::internal {
+
+  // CPUs of a thread, written in the list format of Linux, e.g., "0-3,8".
+  // An empty set leaves the placement to the kernel.
+  struct CPUSet {
+
+    std::vector<int> cpus;
+
+    static CPUSet parse(const std::string& list);
+
+    std::string str() const;
+
+    bool empty() const
+    {
+      return cpus.empty();
+    }
+
+    // One CPU of the set - consecutive indices take the CPUs in turn.
+    CPUSet select(size_t idx) const;
+
+    // Pins the calling thread, and threads it creates later. Returns false on failure.
+    bool pin() const;
+  };
+
+  // Memory first touched by the calling thread is placed on the NUMA node it runs on,
+  // even when the process inherited another policy, e.g., interleaving from numactl.
+  // The policy is inherited by forks and kept across exec. Returns false on failure.
+  bool use_local_memory();
+
+} // namespace praas::process::runtime::internal
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef PRAAS_PROCESS_RUNTIME_INTERNAL_ZYGOTE_HPP
+#define PRAAS_PROCESS_RUNTIME_INTERNAL_ZYGOTE_HPP
+
+#include <praas/process/runtime/internal/placement.hpp>
+
+#include <optional>
+#include <string>
+
+namespace praas::process::runtime::internal {
+
+  /**
+   * Invoker that loaded all functions once, and creates new workers by forking itself.
+   *
+   * The controller sends the IPC name of each new worker over a socket, and the zygote
+   * replies with the PID of the fork. Workers are forked with CLONE_PARENT - they become
+   * children of the controller, like workers started with exec, and the controller
+   * signals and collects them in the same way.
+   *
+   * The IPC name can be followed by a null character and the CPUs of the worker - it is
+   * pinned before it returns from fork, and before it allocates any memory of its own.
+   */
+  struct Zygote {
+
+    // Maximal length of the IPC name in a request.
+    static constexpr int MAX_REQUEST_LENGTH = 256;
+
+    explicit Zygote(int fd);
+
+    Zygote(const Zygote&) = delete;
+    Zygote& operator=(const Zygote&) = delete;
+    Zygote(Zygote&&) = delete;
+    Zygote& operator=(Zygote&&) = delete;
+
+    ~Zygote();
+
+    // Blocks until the controller requests a new worker, and returns its IPC name.
+    // CPUs of the requested worker are kept for the next fork.
+    // Returns nothing when the controller closed the connection, or we were interrupted.
+    std::optional<std::string> wait();
+
+    // Returns the PID of the new worker in the zygote, negative on failure, and zero in the worker.
+    // The worker no longer holds the connection to the controller.
+    int fork();
+
+  private:
+    int _fd;
+
+    CPUSet _cpus;
+  };
+
+} // namespace praas::process::runtime::internal
+
+#endif
@@ -25,7 +25,16 @@ namespace praas::process::runtime {
 
   Buffer Context::get_buffer(size_t size)
   {
-    _user_buffers.emplace_back(new std::byte[size], size, 0);
+    internal::Buffer<std::byte> buf;
+    // Shared memory - put, state and invoke will not copy the data.
+    if (_invoker.arena()) {
+      buf = _invoker.arena()->allocate<std::byte>(size);
+    }
+    if (buf.null()) {
+      buf = internal::Buffer<std::byte>{new std::byte[size], size, 0};
+    }
+
+    _user_buffers.push_back(std::move(buf));
     return Buffer{
         _user_buffers.back().ptr.get(), _user_buffers.back().len, _user_buffers.back().size};
   }
@@ -0,0 +1,327 @@
+#include <praas/process/runtime/internal/ipc/arena.hpp>
+
+#include <praas/common/exceptions.hpp>
+#include <praas/common/util.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace praas::process::runtime::internal::ipc {
+
+  struct SHMArena::Header {
+    pthread_mutex_t lock;
+
+    uint64_t pages;
+
+    // Offset of the first data page.
+    uint64_t data_offset;
+
+    // Free pages that are still backed by memory, and their limit.
+    uint64_t retained_pages;
+    uint64_t max_retained_pages;
+  };
+
+  // Entries are only modified under the lock.
+  // Every page of an allocated block stores the first page and the length of the block.
+  // Pages with zero length are free.
+  struct SHMArena::PageEntry {
+    uint32_t start;
+    uint32_t pages;
+    // Only valid for the first page of the block.
+    uint32_t refs;
+    // Backed by memory - kept when the page is freed.
+    uint32_t reserved;
+  };
+
+  namespace {
+
+    size_t round_up(size_t size, size_t alignment)
+    {
+      return (size + alignment - 1) / alignment * alignment;
+    }
+
+  } // namespace
+
+  std::shared_ptr<SHMArena> SHMArena::create(size_t size, size_t retained_size)
+  {
+    std::shared_ptr<SHMArena> arena{new SHMArena{}};
+
+    size_t pages = size / PAGE_SIZE;
+    size_t data_offset = round_up(sizeof(Header) + pages * sizeof(PageEntry), PAGE_SIZE);
+    size_t mapped_size = data_offset + pages * PAGE_SIZE;
+
+    // Only the worker of the arena inherits the descriptor - the controller passes it explicitly.
+    int fd = memfd_create("praas_buffers", MFD_CLOEXEC);
+    common::util::assert_other(fd, -1);
+    // Sparse file - pages are reserved when allocated.
+    common::util::assert_other(ftruncate(fd, mapped_size), -1);
+
+    arena->_map(fd, mapped_size);
+
+    // The segment is zero-initialized: all pages are free.
+    arena->_header->pages = pages;
+    arena->_header->data_offset = data_offset;
+    arena->_header->max_retained_pages = retained_size / PAGE_SIZE;
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    // The worker can die while holding the lock.
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&arena->_header->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    // NOLINTNEXTLINE
+    arena->_pages = reinterpret_cast<PageEntry*>(arena->_header + 1);
+    // NOLINTNEXTLINE
+    arena->_data = reinterpret_cast<char*>(arena->_header) + data_offset;
+    arena->_data_size = pages * PAGE_SIZE;
+
+    SPDLOG_DEBUG("Created shared memory arena with {} pages, fd {}", pages, fd);
+
+    return arena;
+  }
+
+  std::shared_ptr<SHMArena> SHMArena::open(int fd)
+  {
+    std::shared_ptr<SHMArena> arena{new SHMArena{}};
+
+    struct stat attributes {};
+    if (fstat(fd, &attributes) == -1) {
+      throw praas::common::PraaSException{
+          fmt::format("Shared memory arena {} was not inherited from the controller", fd)};
+    }
+
+    // Our own descriptor, to reserve pages and to close independently of the channel.
+    int arena_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    common::util::assert_other(arena_fd, -1);
+
+    arena->_map(arena_fd, attributes.st_size);
+
+    // NOLINTNEXTLINE
+    arena->_pages = reinterpret_cast<PageEntry*>(arena->_header + 1);
+    // NOLINTNEXTLINE
+    arena->_data = reinterpret_cast<char*>(arena->_header) + arena->_header->data_offset;
+    arena->_data_size = arena->_header->pages * PAGE_SIZE;
+
+    return arena;
+  }
+
+  void SHMArena::_map(int fd, size_t mapped_size)
+  {
+    void* ptr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+      close(fd);
+      throw praas::common::PraaSException{
+          fmt::format("Failed mapping shared memory arena, error {}", strerror(errno))};
+    }
+
+    _fd = fd;
+    _header = static_cast<Header*>(ptr);
+    _mapped_size = mapped_size;
+  }
+
+  SHMArena::~SHMArena()
+  {
+    if (_header) {
+      munmap(_header, _mapped_size);
+    }
+    if (_fd != -1) {
+      close(_fd);
+    }
+  }
+
+  void SHMArena::_lock() const
+  {
+    int ret = pthread_mutex_lock(&_header->lock);
+    if (ret == EOWNERDEAD) {
+      // Bookkeeping is updated before unlocking a block, and the state is consistent.
+      // At worst, the dead process leaked its blocks.
+      pthread_mutex_consistent(&_header->lock);
+    } else if (ret != 0) {
+      throw praas::common::PraaSException{
+          fmt::format("Failed locking shared memory arena, error {}", strerror(ret))};
+    }
+  }
+
+  void SHMArena::_unlock() const
+  {
+    pthread_mutex_unlock(&_header->lock);
+  }
+
+  bool SHMArena::contains(const void* ptr) const
+  {
+    return ptr >= _data && ptr < _data + _data_size;
+  }
+
+  size_t SHMArena::offset(const void* ptr) const
+  {
+    return static_cast<const char*>(ptr) - _data;
+  }
+
+  size_t SHMArena::_page(const void* ptr) const
+  {
+    return offset(ptr) / PAGE_SIZE;
+  }
+
+  void* SHMArena::_allocate(size_t size)
+  {
+    size_t pages = std::max(round_up(size, PAGE_SIZE) / PAGE_SIZE, 1UL);
+    size_t total_pages = _header->pages;
+
+    _lock();
+
+    // First fit - jump over allocated blocks.
+    size_t start = 0;
+    size_t free_pages = 0;
+    for (size_t idx = 0; idx < total_pages && free_pages < pages;) {
+
+      if (_pages[idx].pages != 0) {
+        idx = _pages[idx].start + _pages[idx].pages;
+        start = idx;
+        free_pages = 0;
+      } else {
+        ++idx;
+        ++free_pages;
+      }
+    }
+
+    if (free_pages < pages) {
+      _unlock();
+      SPDLOG_DEBUG("Shared memory arena cannot fit {} bytes", size);
+      return nullptr;
+    }
+
+    // Reserve the memory now, and not on first access - the latter terminates with SIGBUS.
+    int ret = fallocate(_fd, 0, _header->data_offset + start * PAGE_SIZE, pages * PAGE_SIZE);
+    if (ret != 0) {
+      _unlock();
+      SPDLOG_DEBUG("Shared memory arena cannot reserve {} bytes, error {}", size, strerror(errno));
+      return nullptr;
+    }
+
+    for (size_t idx = start; idx < start + pages; ++idx) {
+      _header->retained_pages -= _pages[idx].reserved;
+      _pages[idx] = PageEntry{static_cast<uint32_t>(start), static_cast<uint32_t>(pages), 0, 1};
+    }
+    _pages[start].refs = 1;
+
+    _unlock();
+
+    return _data + start * PAGE_SIZE;
+  }
+
+  void SHMArena::_validate(size_t offset, size_t len) const
+  {
+    bool valid = offset < _data_size && len <= _data_size - offset && offset % PAGE_SIZE == 0;
+
+    if (valid) {
+      size_t page = offset / PAGE_SIZE;
+
+      _lock();
+      const PageEntry& entry = _pages[page];
+      valid = entry.pages != 0 && entry.start == page && entry.refs > 0 &&
+              len <= entry.pages * PAGE_SIZE;
+      _unlock();
+    }
+
+    if (!valid) {
+      throw praas::common::InvalidMessage{
+          fmt::format("Invalid shared buffer at offset {}, length {}", offset, len)};
+    }
+  }
+
+  void SHMArena::acquire(const void* ptr)
+  {
+    size_t page = _page(ptr);
+
+    _lock();
+    _pages[_pages[page].start].refs += 1;
+    _unlock();
+  }
+
+  void SHMArena::release(void* ptr, size_t)
+  {
+    size_t page = _page(ptr);
+
+    _lock();
+
+    size_t start = _pages[page].start;
+    size_t pages = _pages[page].pages;
+
+    if (--_pages[start].refs == 0) {
+      for (size_t idx = start; idx < start + pages; ++idx) {
+        _pages[idx] = PageEntry{0, 0, 0, 1};
+      }
+      _header->retained_pages += pages;
+
+      if (_header->retained_pages > _header->max_retained_pages) {
+        _punch_free_pages();
+      }
+    }
+
+    _unlock();
+  }
+
+  void SHMArena::_punch_free_pages()
+  {
+    size_t total_pages = _header->pages;
+
+    for (size_t idx = 0; idx < total_pages;) {
+
+      if (_pages[idx].pages != 0 || !_pages[idx].reserved) {
+        ++idx;
+        continue;
+      }
+
+      // Consecutive free pages are returned with a single call.
+      size_t start = idx;
+      while (idx < total_pages && _pages[idx].pages == 0 && _pages[idx].reserved) {
+        _pages[idx].reserved = 0;
+        ++idx;
+      }
+
+      int ret = fallocate(
+          _fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, _header->data_offset + start * PAGE_SIZE,
+          (idx - start) * PAGE_SIZE
+      );
+      if (ret != 0) {
+        spdlog::error("Could not release memory of shared memory arena, error {}", strerror(errno));
+      }
+    }
+
+    _header->retained_pages = 0;
+  }
+
+  size_t SHMArena::reserved_pages() const
+  {
+    size_t reserved = 0;
+
+    _lock();
+    for (size_t idx = 0; idx < _header->pages; ++idx) {
+      reserved += _pages[idx].reserved;
+    }
+    _unlock();
+
+    return reserved;
+  }
+
+  size_t SHMArena::used_pages() const
+  {
+    size_t used = 0;
+
+    _lock();
+    for (size_t idx = 0; idx < _header->pages; ++idx) {
+      used += _pages[idx].pages != 0;
+    }
+    _unlock();
+
+    return used;
+  }
+
+} // namespace praas::process::runtime::internal::ipc
@@ -2,7 +2,9 @@
 
 #include <praas/common/exceptions.hpp>
 
+#include <algorithm>
 #include <fstream>
+#include <functional>
 
 #include <cereal/external/rapidjson/document.h>
 #include <cereal/external/rapidjson/istreamwrapper.h>
@@ -50,9 +52,150 @@ namespace praas::process::runtime::internal {
       return std::make_unique<DirectTrigger>(fname);
     }
 
+    if (trigger_type == "batch") {
+
+      auto size = it->value.FindMember("size");
+      if (size == it->value.MemberEnd() || !size->value.IsInt() || size->value.GetInt() < 1) {
+        throw common::InvalidJSON{fmt::format("Incorrect batch size for {}", fname)};
+      }
+
+      int max_wait = BatchTrigger::DEFAULT_MAX_WAIT_US;
+      auto wait = it->value.FindMember("max-wait-us");
+      if (wait != it->value.MemberEnd()) {
+        if (!wait->value.IsInt() || wait->value.GetInt() < 0) {
+          throw common::InvalidJSON{fmt::format("Incorrect batch wait time for {}", fname)};
+        }
+        max_wait = wait->value.GetInt();
+      }
+
+      return std::make_unique<BatchTrigger>(
+          fname, size->value.GetInt(), std::chrono::microseconds{max_wait}
+      );
+    }
+
+    if (trigger_type == "multi-source") {
+
+      auto sources = it->value.FindMember("sources");
+      if (sources != it->value.MemberEnd()) {
+
+        if (!sources->value.IsArray() || sources->value.Size() == 0) {
+          throw common::InvalidJSON{fmt::format("Incorrect list of sources for {}", fname)};
+        }
+
+        std::vector<std::string> names;
+        for (const auto& source : sources->value.GetArray()) {
+          if (!source.IsString() || source.GetStringLength() == 0 ||
+              std::find(names.begin(), names.end(), source.GetString()) != names.end()) {
+            throw common::InvalidJSON{fmt::format("Incorrect source name for {}", fname)};
+          }
+          names.emplace_back(source.GetString());
+        }
+
+        return std::make_unique<MultiSourceTrigger>(fname, std::move(names));
+      }
+
+      auto nargs = it->value.FindMember("nargs");
+      if (nargs == it->value.MemberEnd() || !nargs->value.IsInt() || nargs->value.GetInt() < 1) {
+        throw common::InvalidJSON{fmt::format("Incorrect number of sources for {}", fname)};
+      }
+
+      return std::make_unique<MultiSourceTrigger>(fname, nargs->value.GetInt());
+    }
+
+    if (trigger_type == "pipeline") {
+
+      auto next = it->value.FindMember("next");
+      if (next == it->value.MemberEnd() || !next->value.IsString() ||
+          next->value.GetStringLength() == 0) {
+        throw common::InvalidJSON{fmt::format("Incorrect next stage of pipeline {}", fname)};
+      }
+
+      return std::make_unique<PipelineTrigger>(fname, next->value.GetString());
+    }
+
+    if (trigger_type == "dependency") {
+
+      auto parse_names = [&](const char* key) {
+        std::vector<std::string> names;
+
+        auto member = it->value.FindMember(key);
+        if (member == it->value.MemberEnd()) {
+          return names;
+        }
+        if (!member->value.IsArray()) {
+          throw common::InvalidJSON{fmt::format("Incorrect list of {} for {}", key, fname)};
+        }
+
+        for (const auto& name : member->value.GetArray()) {
+          if (!name.IsString() || name.GetStringLength() == 0 ||
+              std::find(names.begin(), names.end(), name.GetString()) != names.end()) {
+            throw common::InvalidJSON{fmt::format("Incorrect dependency in {} of {}", key, fname)};
+          }
+          names.emplace_back(name.GetString());
+        }
+        return names;
+      };
+
+      auto functions = parse_names("functions");
+      auto state = parse_names("state");
+      if (functions.empty() && state.empty()) {
+        throw common::InvalidJSON{fmt::format("No dependencies of {}", fname)};
+      }
+
+      int max_outputs = DependencyTrigger::DEFAULT_MAX_OUTPUTS;
+      auto outputs = it->value.FindMember("max-outputs");
+      if (outputs != it->value.MemberEnd()) {
+        if (!outputs->value.IsInt() || outputs->value.GetInt() < 0) {
+          throw common::InvalidJSON{fmt::format("Incorrect limit of outputs for {}", fname)};
+        }
+        max_outputs = outputs->value.GetInt();
+      }
+
+      return std::make_unique<DependencyTrigger>(
+          fname, std::move(functions), std::move(state), max_outputs
+      );
+    }
+
     throw common::InvalidJSON{fmt::format("Could not parse trigger type {}", trigger_type)};
   }
 
+  namespace {
+
+    // Optional, non-negative limit of a function - 0 when not set.
+    int parse_limit(const rapidjson::Value& obj, const char* key, const std::string& fname)
+    {
+      auto it = obj.FindMember(key);
+      if (it == obj.MemberEnd()) {
+        return 0;
+      }
+
+      if (!it->value.IsInt() || it->value.GetInt() < 0) {
+        throw common::InvalidJSON{fmt::format("Incorrect {} for {}", key, fname)};
+      }
+      return it->value.GetInt();
+    }
+
+    // Optional, the default is a worker process.
+    Execution parse_execution(const rapidjson::Value& obj, const std::string& fname)
+    {
+      auto it = obj.FindMember("execution");
+      if (it == obj.MemberEnd()) {
+        return Execution::PROCESS;
+      }
+
+      std::string_view execution =
+          it->value.IsString() ? std::string_view{it->value.GetString()} : "";
+      if (execution == "process") {
+        return Execution::PROCESS;
+      }
+      if (execution == "thread") {
+        return Execution::THREAD;
+      }
+      throw common::InvalidJSON{fmt::format("Incorrect execution for {}", fname)};
+    }
+
+  } // namespace
+
   void Functions::initialize(std::istream& in_stream, Language language)
   {
     rapidjson::Document doc;
@@ -81,13 +224,134 @@ namespace praas::process::runtime::internal {
       std::string module_name = it->value["module"].GetString();
       std::string function_name = it->value["function"].GetString();
 
-      _functions.emplace(
+      auto res = _functions.emplace(
           std::piecewise_construct, std::forward_as_tuple(fname),
           std::make_tuple(module_name, function_name, std::move(trigger))
       );
+      Function& func = res.first->second;
+
+      func.max_concurrency = parse_limit(function_cfg.value, "max-concurrency", fname);
+      func.reserved_workers = parse_limit(function_cfg.value, "reserved-workers", fname);
+      if (func.max_concurrency > 0 && func.reserved_workers > func.max_concurrency) {
+        throw common::InvalidJSON{fmt::format(
+            "Function {} reserves more workers than its maximal concurrency", fname
+        )};
+      }
+      _reserved_workers += func.reserved_workers;
+
+      func.timeout_ms = parse_limit(function_cfg.value, "timeout-ms", fname);
+
+      // Only native code can be loaded into the controller.
+      func.execution = parse_execution(function_cfg.value, fname);
+      if (func.execution == Execution::THREAD) {
+
+        if (language != Language::CPP) {
+          throw common::InvalidJSON{fmt::format(
+              "Function {} cannot run on a thread - only C++ functions can", fname
+          )};
+        }
+        if (func.reserved_workers > 0 || func.timeout_ms > 0) {
+          throw common::InvalidJSON{fmt::format(
+              "Function {} runs on a thread, and cannot reserve workers or time out", fname
+          )};
+        }
+        ++_thread_functions;
+      }
+    }
+
+    _validate_pipelines();
+    _index_dependencies();
+  }
+
+  void Functions::_validate_pipelines() const
+  {
+    for (const auto& [fname, func] : _functions) {
+
+      // A chain longer than the number of functions must contain a cycle.
+      const Trigger* trigger = func.trigger.get();
+      size_t stages = 0;
+      while (trigger->type() == Trigger::Type::PIPELINE) {
+
+        const auto& next = static_cast<const PipelineTrigger*>(trigger)->next();
+        trigger = get_trigger(next);
+        if (!trigger) {
+          throw common::InvalidJSON{
+              fmt::format("Pipeline {} continues with an unknown function {}", fname, next)};
+        }
+
+        if (++stages > _functions.size()) {
+          throw common::InvalidJSON{fmt::format("Pipeline {} never ends", fname)};
+        }
+      }
+    }
+  }
+
+  void Functions::_index_dependencies()
+  {
+    for (const auto& [fname, func] : _functions) {
+
+      if (func.trigger->type() != Trigger::Type::DEPENDENCY) {
+        continue;
+      }
+
+      const auto* trigger = static_cast<const DependencyTrigger*>(func.trigger.get());
+      for (const auto& upstream : trigger->functions()) {
+        if (!get_trigger(upstream)) {
+          throw common::InvalidJSON{
+              fmt::format("Function {} depends on an unknown function {}", fname, upstream)};
+        }
+        _function_dependents[upstream].push_back(fname);
+      }
+      for (const auto& key : trigger->state()) {
+        _state_dependents[key].push_back(fname);
+      }
+    }
+
+    // Depth-first search from every function - a function met again on the current path
+    // would wait for its own output.
+    enum class Visit { NONE, ACTIVE, DONE };
+    std::unordered_map<std::string, Visit> visited;
+
+    std::function<void(const std::string&)> visit = [&](const std::string& fname) {
+      auto& status = visited[fname];
+      if (status == Visit::ACTIVE) {
+        throw common::InvalidJSON{fmt::format("Dependencies of {} form a cycle", fname)};
+      }
+      if (status == Visit::DONE) {
+        return;
+      }
+
+      status = Visit::ACTIVE;
+      auto it = _function_dependents.find(fname);
+      if (it != _function_dependents.end()) {
+        for (const auto& dependent : it->second) {
+          visit(dependent);
+        }
+      }
+      visited[fname] = Visit::DONE;
+    };
+
+    for (const auto& [fname, dependents] : _function_dependents) {
+      visit(fname);
     }
   }
 
+  const std::vector<std::string>& Functions::function_dependents(const std::string& name) const
+  {
+    static const std::vector<std::string> EMPTY;
+
+    auto it = _function_dependents.find(name);
+    return it != _function_dependents.end() ? it->second : EMPTY;
+  }
+
+  const std::vector<std::string>& Functions::state_dependents(const std::string& key) const
+  {
+    static const std::vector<std::string> EMPTY;
+
+    auto it = _state_dependents.find(key);
+    return it != _state_dependents.end() ? it->second : EMPTY;
+  }
+
   const Trigger* Functions::get_trigger(std::string name) const
   {
     auto it = _functions.find(name);
@@ -116,6 +380,52 @@ namespace praas::process::runtime::internal {
     return Type::DIRECT;
   }
 
+  void BatchTrigger::accept(TriggerVisitor& visitor) const
+  {
+    visitor.visit(*this);
+  }
+
+  Trigger::Type BatchTrigger::type() const
+  {
+    return Type::BATCH;
+  }
+
+  void MultiSourceTrigger::accept(TriggerVisitor& visitor) const
+  {
+    visitor.visit(*this);
+  }
+
+  Trigger::Type MultiSourceTrigger::type() const
+  {
+    return Type::MULTI_SOURCE;
+  }
+
+  int MultiSourceTrigger::source_index(std::string_view source) const
+  {
+    auto it = std::find(_sources.begin(), _sources.end(), source);
+    return it != _sources.end() ? static_cast<int>(std::distance(_sources.begin(), it)) : -1;
+  }
+
+  void PipelineTrigger::accept(TriggerVisitor& visitor) const
+  {
+    visitor.visit(*this);
+  }
+
+  Trigger::Type PipelineTrigger::type() const
+  {
+    return Type::PIPELINE;
+  }
+
+  void DependencyTrigger::accept(TriggerVisitor& visitor) const
+  {
+    visitor.visit(*this);
+  }
+
+  Trigger::Type DependencyTrigger::type() const
+  {
+    return Type::DEPENDENCY;
+  }
+
   std::string_view Trigger::name() const
   {
     return _name;
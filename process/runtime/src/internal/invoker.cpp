@@ -6,18 +6,25 @@
 #include <praas/process/runtime/internal/buffer.hpp>
 #include <praas/process/runtime/internal/ipc/messages.hpp>
 
+#include <algorithm>
 #include <optional>
 #include <variant>
 
 #include <sys/prctl.h>
 #include <sys/signal.h>
+#include <unistd.h>
 
 #include <spdlog/spdlog.h>
 
 namespace praas::process::runtime::internal {
 
-  Invoker::Invoker(std::string process_id, ipc::IPCMode ipc_mode, const std::string& ipc_name)
-      : _process_id(std::move(process_id))
+  thread_local Invoker::Slot* Invoker::_thread_slot = nullptr;
+
+  Invoker::Invoker(
+      std::string process_id, ipc::IPCMode ipc_mode, const std::string& ipc_name,
+      std::chrono::microseconds spin_time, int threads
+  )
+      : _process_id(std::move(process_id)), _threads(std::max(threads, 1))
   {
     if (ipc_mode == ipc::IPCMode::POSIX_MQ) {
       _ipc_channel_read = std::make_unique<ipc::POSIXMQChannel>(
@@ -26,6 +33,21 @@ namespace praas::process::runtime::internal {
       _ipc_channel_write = std::make_unique<ipc::POSIXMQChannel>(
           ipc_name + "_read", ipc::IPCDirection::WRITE, false, false
       );
+    } else if (ipc_mode == ipc::IPCMode::SHM) {
+      auto read_channel =
+          std::make_unique<ipc::SHMChannel>(ipc_name + "_write", ipc::IPCDirection::READ, false);
+      // Both channels share the arena announced by the controller.
+      _arena = read_channel->arena();
+      _ipc_channel_read = std::move(read_channel);
+      _ipc_channel_write = std::make_unique<ipc::SHMChannel>(
+          ipc_name + "_read", ipc::IPCDirection::WRITE, false, ipc::SHMChannel::RING_SIZE, _arena
+      );
+    }
+
+    _ipc_channel_read->spin_time(spin_time);
+
+    for (int i = 0; i < _threads; ++i) {
+      _slots.emplace_back(std::make_unique<Slot>());
     }
 
     // Make sure we are killed if the parent controller forgets about us.
@@ -37,15 +59,171 @@ namespace praas::process::runtime::internal {
     _app_status.active_processes.emplace_back(_process_id);
   }
 
+  Invoker::Invoker(
+      std::string process_id, std::unique_ptr<ipc::IPCChannel> read_channel,
+      std::unique_ptr<ipc::IPCChannel> write_channel
+  )
+      : _process_id(std::move(process_id)), _ipc_channel_read(std::move(read_channel)),
+        _ipc_channel_write(std::move(write_channel))
+  {
+    _slots.emplace_back(std::make_unique<Slot>());
+
+    _logger = common::util::create_logger("Invoker");
+
+    _app_status.active_processes.emplace_back(_process_id);
+  }
+
+  void Invoker::ready()
+  {
+    ipc::WorkerReady msg;
+    msg.pid(getpid());
+
+    _send(msg, BufferAccessor<std::byte>{});
+  }
+
+  Invoker::Slot& Invoker::_slot() const
+  {
+    if (_threads > 1 && _thread_slot) {
+      return *_thread_slot;
+    }
+    return *_slots.front();
+  }
+
+  size_t Invoker::_read_invocation(
+      const ipc::InvocationRequestParsed& req, std::byte* data, size_t len, Invocation& invoc
+  )
+  {
+    // Validate
+    size_t total_len = 0;
+    for (int i = 0; i < req.buffers(); ++i) {
+      total_len += req.buffers_lengths()[i];
+    }
+    if (total_len > len) {
+      throw praas::common::PraaSException(
+          fmt::format("Header declared {} bytes, but we only received {}!", total_len, len)
+      );
+    }
+
+    invoc.key = req.invocation_id();
+    invoc.function_name = req.function_name();
+
+    std::byte* ptr = data;
+    for (int i = 0; i < req.buffers(); ++i) {
+
+      size_t buf_len = req.buffers_lengths()[i];
+      invoc.args.emplace_back(ptr, buf_len, buf_len);
+      ptr += buf_len;
+    };
+
+    return total_len;
+  }
+
+  void Invoker::_next_batch_invocation(Slot& slot, Invocation& invoc)
+  {
+    std::byte* end = slot.input.ptr.get() + slot.input.len;
+    if (slot.batch_pos + ipc::Message::BUF_SIZE > end) {
+      throw praas::common::PraaSException("Batch ended before all invocations were received!");
+    }
+
+    // NOLINTNEXTLINE
+    auto parsed_msg =
+        ipc::Message::parse_message(reinterpret_cast<const int8_t*>(slot.batch_pos));
+    if (!std::holds_alternative<ipc::InvocationRequestParsed>(parsed_msg)) {
+      throw praas::common::PraaSException("Batch contains an incorrect message!");
+    }
+    slot.batch_pos += ipc::Message::BUF_SIZE;
+
+    auto& req = std::get<ipc::InvocationRequestParsed>(parsed_msg);
+    slot.batch_pos += _read_invocation(req, slot.batch_pos, end - slot.batch_pos, invoc);
+    slot.invocation_id = invoc.key;
+    --slot.batch_remaining;
+  }
+
+  bool Invoker::_read_message(
+      Slot& slot, ipc::Message::MessageVariants& parsed_msg, Invocation& invoc
+  )
+  {
+    bool received_invocation = false;
+
+    std::visit(
+        ipc::overloaded{
+            [&](ipc::InvocationRequestParsed& req) mutable {
+              SPDLOG_LOGGER_DEBUG(
+                  _logger, "Received invocation request of {}, key {}, inputs {}",
+                  req.function_name(), req.invocation_id(), req.buffers()
+              );
+
+              _read_invocation(req, slot.input.ptr.get(), slot.input.len, invoc);
+              slot.invocation_id = invoc.key;
+              received_invocation = true;
+            },
+            [&](ipc::InvocationBatchParsed& req) mutable {
+              SPDLOG_LOGGER_DEBUG(_logger, "Received batch of {} invocations", req.invocations());
+
+              if (req.invocations() > 0) {
+                slot.batch_remaining = req.invocations();
+                slot.batch_pos = slot.input.ptr.get();
+                slot.batch_results.clear();
+                slot.batch_size = 0;
+
+                _next_batch_invocation(slot, invoc);
+                received_invocation = true;
+              }
+            },
+            [&](ipc::ApplicationUpdateParsed& req) mutable {
+              SPDLOG_LOGGER_DEBUG(
+                  _logger, "Received application update - process change for {}",
+                  req.process_id()
+              );
+              _app_status.update(
+                  static_cast<common::Application::Status>(req.status_change()), req.process_id()
+              );
+            },
+            [](auto&) { spdlog::error("Received unsupported message!"); }},
+        parsed_msg
+    );
+
+    return received_invocation;
+  }
+
   std::optional<Invocation> Invoker::poll()
   {
     Invocation invoc;
     bool received_invocation = false;
+    Slot& slot = _slot();
+
+    // Input buffer holds the rest of the batch.
+    if (slot.batch_remaining > 0) {
+      _next_batch_invocation(slot, invoc);
+      return invoc;
+    }
+
+    // Messages are received by the dispatching thread.
+    if (_threads > 1) {
+
+      std::unique_lock<std::mutex> lock{_lock};
+      _invocations_cv.wait(lock, [this]() { return _ending || !_invocations.empty(); });
+      if (_invocations.empty()) {
+        return std::nullopt;
+      }
+
+      auto [msg, data] = std::move(_invocations.front());
+      _invocations.pop_front();
+      lock.unlock();
+
+      // The payload stays in the slot until the next invocation of the thread.
+      slot.input = Buffer<std::byte>{std::move(data)};
+      auto parsed_msg = msg.parse();
+      if (!_read_message(slot, parsed_msg, invoc)) {
+        return std::nullopt;
+      }
+      return invoc;
+    }
 
     while (!received_invocation && !_ending) {
 
       try {
-        auto read = _ipc_channel_read->blocking_receive(_input);
+        auto read = _ipc_channel_read->blocking_receive(slot.input);
 
         if (!read) {
           throw praas::common::PraaSException(
@@ -54,44 +232,63 @@ namespace praas::process::runtime::internal {
         }
 
         auto parsed_msg = _ipc_channel_read->message().parse();
+        received_invocation = _read_message(slot, parsed_msg, invoc);
+
+      } catch (praas::common::PraaSException& exc) {
+        if (_ending) {
+          spdlog::info("Shutting down the invoker");
+        } else {
+          spdlog::error("Unexpected end of the invoker {}", exc.what());
+          return std::nullopt;
+        }
+      }
+    }
+
+    if (!received_invocation) {
+      return std::nullopt;
+    }
+    return invoc;
+  }
+
+  void Invoker::dispatch()
+  {
+    while (!_ending) {
+
+      try {
+        auto [read, data] = _ipc_channel_read->receive();
+
+        if (!read) {
+          throw praas::common::PraaSException(
+              fmt::format("Did not receive a full message - failed receive!")
+          );
+        }
+
+        const ipc::Message& msg = _ipc_channel_read->message();
+        auto parsed_msg = msg.parse();
 
         std::visit(
             ipc::overloaded{
-                [&](ipc::InvocationRequestParsed& req) mutable {
-                  SPDLOG_LOGGER_DEBUG(
-                      _logger, "Received invocation request of {}, key {}, inputs {}",
-                      req.function_name(), req.invocation_id(), req.buffers()
-                  );
-
-                  // Validate
-                  size_t total_len = 0;
-                  for (int i = 0; i < req.buffers(); ++i) {
-                    total_len += req.buffers_lengths()[i];
-                  }
-                  if (total_len > _input.len) {
-                    throw praas::common::PraaSException(fmt::format(
-                        "Header declared {} bytes, but we only received {}!", total_len, _input.len
-                    ));
-                  }
-
-                  invoc.key = req.invocation_id();
-                  invoc.function_name = req.function_name();
-
-                  std::byte* ptr = _input.ptr.get();
-                  for (int i = 0; i < req.buffers(); ++i) {
-
-                    size_t len = req.buffers_lengths()[i];
-                    invoc.args.emplace_back(ptr, len, len);
-                    ptr += len;
-                  };
-
-                  received_invocation = true;
+                [&](ipc::InvocationRequestParsed&) mutable {
+                  std::lock_guard<std::mutex> guard{_lock};
+                  _invocations.emplace_back(msg, std::move(data));
+                  _invocations_cv.notify_one();
+                },
+                [&](ipc::InvocationBatchParsed&) mutable {
+                  std::lock_guard<std::mutex> guard{_lock};
+                  _invocations.emplace_back(msg, std::move(data));
+                  _invocations_cv.notify_one();
+                },
+                [&](ipc::GetRequestParsed& req) mutable {
+                  _deliver_reply(msg.type(), req.name(), msg, std::move(data));
+                },
+                [&](ipc::StateKeysResultParsed&) mutable {
+                  _deliver_reply(msg.type(), "", msg, std::move(data));
+                },
+                [&](ipc::InvocationResultParsed& req) mutable {
+                  _deliver_reply(msg.type(), req.invocation_id(), msg, std::move(data));
                 },
                 [&](ipc::ApplicationUpdateParsed& req) mutable {
-                  SPDLOG_LOGGER_DEBUG(
-                      _logger, "Received application update - process change for {}",
-                      req.process_id()
-                  );
+                  std::lock_guard<std::mutex> guard{_lock};
                   _app_status.update(
                       static_cast<common::Application::Status>(req.status_change()),
                       req.process_id()
@@ -106,12 +303,88 @@ namespace praas::process::runtime::internal {
           spdlog::info("Shutting down the invoker");
         } else {
           spdlog::error("Unexpected end of the invoker {}", exc.what());
-          return std::nullopt;
         }
+        break;
       }
     }
 
-    return invoc;
+    std::lock_guard<std::mutex> guard{_lock};
+    _ending = true;
+    _invocations_cv.notify_all();
+    for (auto& slot : _slots) {
+      slot->reply_cv.notify_all();
+    }
+  }
+
+  void Invoker::_expect_reply(Slot& slot, const ipc::Message& msg)
+  {
+    auto parsed_msg = msg.parse();
+
+    std::lock_guard<std::mutex> guard{_lock};
+    std::visit(
+        ipc::overloaded{
+            [&](ipc::GetRequestParsed& req) mutable {
+              slot.reply_type = ipc::Message::Type::GET_REQUEST;
+              slot.reply_key = req.name();
+            },
+            [&](ipc::StateKeysRequestParsed&) mutable {
+              slot.reply_type = ipc::Message::Type::STATE_KEYS_RESULT;
+              slot.reply_key.clear();
+            },
+            [&](ipc::InvocationRequestParsed& req) mutable {
+              slot.reply_type = ipc::Message::Type::INVOCATION_RESULT;
+              slot.reply_key = req.invocation_id();
+            },
+            [](auto&) {}},
+        parsed_msg
+    );
+  }
+
+  void Invoker::_deliver_reply(
+      ipc::Message::Type type, std::string_view key, const ipc::Message& msg, Buffer<char>&& data
+  )
+  {
+    std::lock_guard<std::mutex> guard{_lock};
+    for (auto& slot : _slots) {
+
+      if (slot->replied || slot->reply_type != type || slot->reply_key != key) {
+        continue;
+      }
+
+      slot->reply = msg;
+      slot->reply_data = std::move(data);
+      slot->replied = true;
+      slot->reply_cv.notify_one();
+      return;
+    }
+
+    _logger->error("Received a reply with key {} that no thread waits for", key);
+  }
+
+  std::tuple<bool, Buffer<char>> Invoker::_receive_reply()
+  {
+    if (_threads == 1) {
+      return _ipc_channel_read->receive();
+    }
+
+    Slot& slot = _slot();
+    std::unique_lock<std::mutex> lock{_lock};
+    slot.reply_cv.wait(lock, [&]() { return _ending || slot.replied; });
+    if (!slot.replied) {
+      return std::make_tuple(false, Buffer<char>{});
+    }
+
+    slot.replied = false;
+    slot.reply_type = ipc::Message::Type::GENERIC_HEADER;
+    return std::make_tuple(true, std::move(slot.reply_data));
+  }
+
+  const ipc::Message& Invoker::_reply_message() const
+  {
+    if (_threads == 1) {
+      return _ipc_channel_read->message();
+    }
+    return _slot().reply;
   }
 
   void Invoker::finish(
@@ -123,7 +396,7 @@ namespace praas::process::runtime::internal {
     msg.buffer_length(output.len);
     msg.invocation_id(invocation_id);
 
-    _ipc_channel_write->send(msg, output);
+    _send_result(msg, output);
   }
 
   void Invoker::finish(std::string_view invocation_id, std::string_view error_message)
@@ -135,23 +408,77 @@ namespace praas::process::runtime::internal {
     msg.buffer_length(output.len);
     msg.invocation_id(invocation_id);
 
-    _ipc_channel_write->send(msg, output);
+    _send_result(msg, output);
   }
 
-  void Invoker::put(ipc::Message& msg, BufferAccessor<std::byte> payload)
+  void Invoker::_send_result(ipc::InvocationResult& msg, BufferAccessor<const char> output)
+  {
+    Slot& slot = _slot();
+
+    // Invocation outside of a batch
+    if (slot.batch_pos == nullptr) {
+      _send(msg, output);
+      return;
+    }
+
+    // NOLINTNEXTLINE
+    const char* header = reinterpret_cast<const char*>(msg.bytes());
+    slot.batch_results.insert(slot.batch_results.end(), header, header + ipc::Message::BUF_SIZE);
+    if (output.len > 0) {
+      slot.batch_results.insert(slot.batch_results.end(), output.ptr, output.ptr + output.len);
+    }
+    ++slot.batch_size;
+
+    // Results of all invocations return together.
+    if (slot.batch_remaining == 0) {
+
+      ipc::InvocationBatchResult batch_msg;
+      batch_msg.invocations(slot.batch_size);
+      _send(
+          batch_msg,
+          BufferAccessor<const char>{slot.batch_results.data(), slot.batch_results.size()}
+      );
+
+      slot.batch_pos = nullptr;
+      slot.batch_results.clear();
+    }
+  }
+
+  template <typename Payload>
+  void Invoker::_send(ipc::Message& msg, Payload payload)
   {
+    // The controller names the source of a local invocation by the function of the caller.
+    if (msg.type() == ipc::Message::Type::INVOCATION_REQUEST) {
+      static_cast<ipc::InvocationRequest&>(msg).caller_id(_slot().invocation_id);
+    }
+
+    if (_threads == 1) {
+      _ipc_channel_write->send(msg, payload);
+      return;
+    }
+
+    if (_thread_slot) {
+      _expect_reply(*_thread_slot, msg);
+    }
+
+    std::lock_guard<std::mutex> guard{_write_lock};
     _ipc_channel_write->send(msg, payload);
   }
 
+  void Invoker::put(ipc::Message& msg, BufferAccessor<std::byte> payload)
+  {
+    _send(msg, payload);
+  }
+
   void Invoker::put(ipc::Message& msg, BufferAccessor<const char> payload)
   {
-    _ipc_channel_write->send(msg, payload);
+    _send(msg, payload);
   }
 
   std::tuple<ipc::GetRequestParsed, Buffer<char>> Invoker::get(ipc::Message& msg)
   {
     // Send GET request, zero payload.
-    _ipc_channel_write->send(msg, BufferAccessor<std::byte>{});
+    _send(msg, BufferAccessor<std::byte>{});
 
     return this->get<ipc::GetRequestParsed>();
   }
@@ -159,12 +486,25 @@ namespace praas::process::runtime::internal {
   void Invoker::shutdown()
   {
     _ending = true;
-    _ipc_channel_read.reset();
-    _ipc_channel_write.reset();
+
+    // The interrupted receive stops the dispatching thread. Execution threads might still send,
+    // and the channels are closed with the invoker.
+    _ipc_channel_read->interrupt();
   }
 
   Context Invoker::create_context()
   {
+    if (_threads > 1) {
+
+      std::lock_guard<std::mutex> guard{_lock};
+      if (_bound_slots == _slots.size()) {
+        throw praas::common::PraaSException(
+            fmt::format("All {} execution threads of the invoker are in use!", _threads)
+        );
+      }
+      _thread_slot = _slots[_bound_slots++].get();
+    }
+
     return Context{_process_id, *this};
   }
 
@@ -3,10 +3,23 @@
 #include <praas/common/exceptions.hpp>
 #include <praas/common/util.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
 #include <thread>
 
 #include <spdlog/spdlog.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <sys/signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace praas::process::runtime::internal::ipc {
 
@@ -14,15 +27,30 @@ namespace praas::process::runtime::internal::ipc {
   {
     if (mode == "posix_mq") {
       return IPCMode::POSIX_MQ;
+    } else if (mode == "shm") {
+      return IPCMode::SHM;
     } else {
       return IPCMode::NONE;
     }
   }
 
+  std::string serialize(IPCMode mode)
+  {
+    switch (mode) {
+    case IPCMode::POSIX_MQ:
+      return "posix_mq";
+    case IPCMode::SHM:
+      return "shm";
+    case IPCMode::NONE:
+      return "";
+    }
+    return "";
+  }
+
   IPCChannel::~IPCChannel() {}
 
   POSIXMQChannel::POSIXMQChannel(
-      std::string queue_name, IPCDirection direction, bool send, bool create, int message_size
+      std::string queue_name, IPCDirection direction, bool blocking, bool create, int message_size
   )
       : _created(create), _name(queue_name), _msg_size(message_size),
         _buffers(BUFFER_ELEMS, BUFFER_SIZE)
@@ -36,7 +64,7 @@ namespace praas::process::runtime::internal::ipc {
       attributes.mq_maxmsg = MAX_MSGS;
       attributes.mq_msgsize = message_size;
 
-      if (send)
+      if (blocking)
         _queue = mq_open(
             queue_name.c_str(), O_CREAT | O_EXCL | mq_direction, S_IRUSR | S_IWUSR, &attributes
         );
@@ -50,7 +78,7 @@ namespace praas::process::runtime::internal::ipc {
         // Attempt remove - unless it is used by another process
         mq_unlink(queue_name.c_str());
 
-        if (send)
+        if (blocking)
           common::util::assert_other(
               _queue = mq_open(
                   queue_name.c_str(), O_CREAT | O_EXCL | mq_direction, S_IRUSR | S_IWUSR,
@@ -105,6 +133,10 @@ namespace praas::process::runtime::internal::ipc {
       common::util::assert_other(mq_close(_queue), -1);
     }
     _queue = -1;
+
+    _send_queue.clear();
+    _send_pos = 0;
+    _queued_bytes = 0;
   }
 
   int POSIXMQChannel::fd() const
@@ -126,6 +158,12 @@ namespace praas::process::runtime::internal::ipc {
     SPDLOG_DEBUG("Sending message, buffer length {}", buf.len);
     msg.total_length(buf.len);
 
+    if (_fits_inline(buf.len)) {
+      std::memcpy(_inline_header(msg), buf.data(), buf.len);
+      _send(_msg_buffer.get(), static_cast<int>(Message::BUF_SIZE + buf.len));
+      return;
+    }
+
     _send(msg.bytes(), msg.BUF_SIZE);
     if (buf.len > 0)
       _send(buf.data(), buf.len);
@@ -136,6 +174,12 @@ namespace praas::process::runtime::internal::ipc {
     SPDLOG_DEBUG("Sending message, buffer length {}", buf.len);
     msg.total_length(buf.len);
 
+    if (_fits_inline(buf.len)) {
+      std::memcpy(_inline_header(msg), buf.data(), buf.len);
+      _send(_msg_buffer.get(), static_cast<int>(Message::BUF_SIZE + buf.len));
+      return;
+    }
+
     _send(msg.bytes(), msg.BUF_SIZE);
     if (buf.len > 0) {
       _send(reinterpret_cast<char*>(buf.data()), buf.len);
@@ -151,6 +195,16 @@ namespace praas::process::runtime::internal::ipc {
 
     msg.total_length(len);
 
+    if (_fits_inline(len)) {
+      int8_t* payload = _inline_header(msg);
+      for (const auto& buf : data) {
+        std::memcpy(payload, buf.data(), buf.len);
+        payload += buf.len;
+      }
+      _send(_msg_buffer.get(), static_cast<int>(Message::BUF_SIZE + len));
+      return;
+    }
+
     _send(msg.bytes(), msg.BUF_SIZE);
     for (const auto& buf : data) {
       if (buf.len > 0) {
@@ -159,15 +213,49 @@ namespace praas::process::runtime::internal::ipc {
     }
   }
 
-  void POSIXMQChannel::_send(const int8_t* data, int len) const
+  bool POSIXMQChannel::_fits_inline(size_t len) const
+  {
+    return len > 0 && Message::BUF_SIZE + len <= static_cast<size_t>(_msg_size);
+  }
+
+  int8_t* POSIXMQChannel::_inline_header(const Message& msg)
+  {
+    std::copy_n(msg.bytes(), Message::BUF_SIZE, _msg_buffer.get());
+    return _msg_buffer.get() + Message::BUF_SIZE;
+  }
+
+  void POSIXMQChannel::_send(const int8_t* data, int len)
   {
     // NOLINTNEXTLINE
     _send(reinterpret_cast<const char*>(data), len);
   }
 
-  void POSIXMQChannel::_send(const char* data, int len) const
+  void POSIXMQChannel::_send(const char* data, int len)
+  {
+    // Messages cannot be reordered - nothing is sent directly while the queue is not empty.
+    int pos = _send_queue.empty() ? _send_chunks(data, len) : 0;
+
+    if (pos < len) {
+
+      Buffer<char> buf = _buffers.retrieve_buffer(len - pos);
+      buf.len = len - pos;
+      std::copy_n(data + pos, buf.len, buf.data());
+      _send_queue.push_back(std::move(buf));
+
+      _queued_bytes += len - pos;
+      _max_queued_bytes = std::max(_max_queued_bytes, _queued_bytes);
+
+      SPDLOG_DEBUG(
+          "Queue {} is full, deferred {} bytes, {} bytes waiting in total", _name, len - pos,
+          _queued_bytes
+      );
+    }
+  }
+
+  int POSIXMQChannel::_send_chunks(const char* data, int len) const
   {
-    for (int pos = 0; pos < len;) {
+    int pos = 0;
+    while (pos < len) {
 
       auto size = (len - pos < _msg_size) ? len - pos : _msg_size;
       int ret = mq_send(_queue, data + pos, size, 1);
@@ -178,22 +266,48 @@ namespace praas::process::runtime::internal::ipc {
 
       if (ret == -1) {
 
-        // if (errno == EAGAIN) {
-        //   // FIXME: add to epoll as oneshot to be woken up as ready
-        //   std::this_thread::sleep_for(std::chrono::microseconds(5));
-        // } else {
+        // Non-blocking queue is full - the caller keeps the rest until the receiver makes space.
+        if (errno == EAGAIN) {
+          break;
+        }
+
         throw praas::common::PraaSException{
             fmt::format("Failed sending with error {}, strerror {}", errno, strerror(errno))};
-        //}
-      } else {
-        pos += size;
       }
+
+      pos += size;
+    }
+
+    return pos;
+  }
+
+  bool POSIXMQChannel::flush()
+  {
+    while (!_send_queue.empty()) {
+
+      Buffer<char>& buf = _send_queue.front();
+
+      int sent = _send_chunks(buf.data() + _send_pos, buf.len - _send_pos);
+      _send_pos += sent;
+      _queued_bytes -= sent;
+
+      if (_send_pos < buf.len) {
+        return false;
+      }
+
+      _send_queue.pop_front();
+      _send_pos = 0;
     }
+
+    return true;
   }
 
   bool POSIXMQChannel::blocking_receive(Buffer<std::byte>& buf)
   {
-    size_t read_data = _recv(_msg_buffer.get(), Message::BUF_SIZE);
+    size_t read_data = _spin_recv(_msg_buffer.get());
+    if (read_data == 0) {
+      read_data = _recv(_msg_buffer.get(), Message::BUF_SIZE);
+    }
     // We do not support sending partial message headers.
     if (read_data < Message::BUF_SIZE) {
       throw praas::common::NotImplementedError();
@@ -207,6 +321,13 @@ namespace praas::process::runtime::internal::ipc {
       buf.resize(data_to_read);
     }
 
+    // Small payload arrived together with the header.
+    if (read_data > Message::BUF_SIZE) {
+      buf.len = read_data - Message::BUF_SIZE;
+      std::memcpy(buf.data(), _msg_buffer.get() + Message::BUF_SIZE, buf.len);
+      return buf.len >= data_to_read;
+    }
+
     read_data = _recv(buf.data(), data_to_read);
     buf.len = read_data;
     SPDLOG_DEBUG("Read {} bytes out of queue {}", read_data, _name);
@@ -218,7 +339,10 @@ namespace praas::process::runtime::internal::ipc {
     // Did we read message header in the previous call?
     if (!_msg_read) {
 
-      size_t read_data = _recv(_msg_buffer.get(), Message::BUF_SIZE);
+      size_t read_data = _spin_recv(_msg_buffer.get());
+      if (read_data == 0) {
+        read_data = _recv(_msg_buffer.get(), Message::BUF_SIZE);
+      }
 
       // We did not manage to read any data
       if (read_data == 0) {
@@ -233,6 +357,14 @@ namespace praas::process::runtime::internal::ipc {
       // FIXME: avoid a copy here?
       std::copy_n(_msg_buffer.get(), Message::BUF_SIZE, _msg.data.data());
 
+      // Small payload arrived together with the header - the message is complete.
+      if (read_data > Message::BUF_SIZE) {
+        Buffer<char> buf = _buffers.retrieve_buffer(read_data - Message::BUF_SIZE);
+        buf.len = read_data - Message::BUF_SIZE;
+        std::copy_n(_msg_buffer.get() + Message::BUF_SIZE, buf.len, buf.data());
+        return std::make_tuple(true, std::move(buf));
+      }
+
       _msg_read = true;
     }
 
@@ -306,4 +438,744 @@ namespace praas::process::runtime::internal::ipc {
     return pos;
   }
 
+  size_t POSIXMQChannel::_spin_recv(int8_t* data) const
+  {
+    if (_spin_time.count() == 0) {
+      return 0;
+    }
+
+    // Timeout in the past - returns immediately on an empty queue, also on a blocking one.
+    timespec timeout{};
+    auto end = std::chrono::steady_clock::now() + _spin_time;
+
+    do {
+
+      long rcv_len = mq_timedreceive(
+          // NOLINTNEXTLINE
+          _queue, reinterpret_cast<char*>(data), _msg_size, nullptr, &timeout
+      );
+
+      if (rcv_len != -1) {
+        return rcv_len;
+      } else if (errno != ETIMEDOUT && errno != EAGAIN) {
+        throw praas::common::PraaSException{
+            fmt::format("Failed receiving with error {}, strerror {}", errno, strerror(errno))};
+      }
+
+    } while (std::chrono::steady_clock::now() < end);
+
+    return 0;
+  }
+
+  struct SHMChannel::RingHeader {
+
+    // Total number of bytes written - modified only by the writer.
+    alignas(64) std::atomic<uint64_t> head;
+
+    // Total number of bytes read - modified only by the reader.
+    alignas(64) std::atomic<uint64_t> tail;
+
+    alignas(64) std::atomic<uint32_t> reader_waiting;
+    std::atomic<uint32_t> writer_waiting;
+
+    uint64_t capacity;
+
+    int data_fd;
+    int space_fd;
+
+    // Buffer arena of the channel, -1 if payloads are always copied.
+    int arena_fd;
+  };
+
+  static_assert(std::atomic<uint64_t>::is_always_lock_free);
+  static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+  namespace {
+
+    void ring_doorbell(int fd)
+    {
+      uint64_t val = 1;
+      common::util::assert_other(write(fd, &val, sizeof(val)), -1);
+    }
+
+    void clear_doorbell(int fd)
+    {
+      uint64_t val;
+      // Non-blocking eventfd, EAGAIN when nobody rang.
+      [[maybe_unused]] auto ret = read(fd, &val, sizeof(val));
+    }
+
+    void wait_doorbell(int fd)
+    {
+      pollfd pfd{fd, POLLIN, 0};
+      while (::poll(&pfd, 1, -1) == -1) {
+        // A signal delivered to the process does not mean the doorbell rang.
+        if (errno == EINTR) {
+          continue;
+        }
+        throw praas::common::PraaSException{
+            fmt::format("Failed waiting on doorbell, error {}", strerror(errno))};
+      }
+      clear_doorbell(fd);
+    }
+
+  } // namespace
+
+  SHMChannel::SHMChannel(
+      std::string name, IPCDirection direction, bool create, size_t ring_size,
+      std::shared_ptr<SHMArena> arena
+  )
+      : _created(create), _blocking(!create), _direction(direction), _name(std::move(name)),
+        _buffers(BUFFER_ELEMS, BUFFER_SIZE), _arena(std::move(arena))
+  {
+    int fd = -1;
+
+    if (create) {
+
+      _mapped_size = sizeof(RingHeader) + ring_size;
+
+      fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+      if (fd == -1 && errno == EEXIST) {
+
+        // Attempt remove - unless it is used by another process
+        shm_unlink(_name.c_str());
+        fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+      }
+      common::util::assert_other(fd, -1);
+      common::util::assert_other(ftruncate(fd, _mapped_size), -1);
+
+    } else {
+
+      common::util::assert_other(fd = shm_open(_name.c_str(), O_RDWR, 0), -1);
+
+      struct stat attributes {};
+      common::util::assert_other(fstat(fd, &attributes), -1);
+      _mapped_size = attributes.st_size;
+    }
+
+    void* ptr = mmap(nullptr, _mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+      throw praas::common::PraaSException{
+          fmt::format("Failed mapping {}, error {}", _name, strerror(errno))};
+    }
+
+    if (create) {
+
+      _header = new (ptr) RingHeader{};
+      _header->capacity = ring_size;
+      // The reader has not polled yet - the first message must ring the doorbell.
+      _header->reader_waiting = 1;
+
+      // Workers started later must not inherit doorbells of other workers.
+      common::util::assert_other(_header->data_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK), -1);
+      common::util::assert_other(_header->space_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK), -1);
+
+      _header->arena_fd = _arena ? _arena->fd() : -1;
+
+    } else {
+
+      _header = static_cast<RingHeader*>(ptr);
+
+      if (fcntl(_header->data_fd, F_GETFD) == -1 || fcntl(_header->space_fd, F_GETFD) == -1) {
+        throw praas::common::PraaSException{
+            fmt::format("Doorbells of {} were not inherited from the controller", _name)};
+      }
+
+      if (!_arena && _header->arena_fd != -1) {
+        _arena = SHMArena::open(_header->arena_fd);
+      }
+    }
+
+    // NOLINTNEXTLINE
+    _ring = reinterpret_cast<char*>(ptr) + sizeof(RingHeader);
+
+    SPDLOG_DEBUG("Opened shared memory channel {}, capacity {}", _name, _header->capacity);
+  }
+
+  SHMChannel::~SHMChannel()
+  {
+    shutdown();
+  }
+
+  void SHMChannel::shutdown()
+  {
+    if (!_header) {
+      return;
+    }
+
+    int data_fd = _header->data_fd;
+    int space_fd = _header->space_fd;
+
+    common::util::assert_other(munmap(_header, _mapped_size), -1);
+    _header = nullptr;
+    _ring = nullptr;
+
+    close(data_fd);
+    close(space_fd);
+
+    _send_queue.clear();
+    _send_pos = 0;
+    _queued_bytes = 0;
+    _msg_payload = Buffer<char>{};
+    _header_read = 0;
+
+    if (_created) {
+      common::util::assert_other(shm_unlink(_name.c_str()), -1);
+
+      SPDLOG_DEBUG("Closed shared memory channel {}", _name);
+    }
+  }
+
+  std::vector<int> SHMChannel::descriptors() const
+  {
+    std::vector<int> fds{_header->data_fd, _header->space_fd};
+    if (_header->arena_fd != -1) {
+      fds.push_back(_header->arena_fd);
+    }
+    return fds;
+  }
+
+  int SHMChannel::fd() const
+  {
+    return _direction == IPCDirection::READ ? _header->data_fd : _header->space_fd;
+  }
+
+  void SHMChannel::interrupt()
+  {
+    if (!_header) {
+      return;
+    }
+
+    _interrupted.store(true);
+    ring_doorbell(fd());
+  }
+
+  size_t SHMChannel::_readable() const
+  {
+    return _header->head.load() - _header->tail.load(std::memory_order_relaxed);
+  }
+
+  size_t SHMChannel::_writable() const
+  {
+    return _header->capacity -
+           (_header->head.load(std::memory_order_relaxed) - _header->tail.load());
+  }
+
+  bool SHMChannel::_wait_readable(bool blocking) const
+  {
+    // Busy-poll the ring before announcing that we sleep - no system calls on either side.
+    if (blocking && _spin_time.count() > 0 && _readable() == 0) {
+      auto end = std::chrono::steady_clock::now() + _spin_time;
+      while (_readable() == 0 && std::chrono::steady_clock::now() < end) {
+      }
+    }
+
+    while (_readable() == 0) {
+
+      // Announce that we sleep - the writer will ring the doorbell on the next write.
+      _header->reader_waiting.store(1);
+      clear_doorbell(_header->data_fd);
+
+      if (_readable() > 0) {
+        // The data might have been published before we raised the flag.
+        // Make sure that epoll reports the remaining messages.
+        ring_doorbell(_header->data_fd);
+        return true;
+      }
+
+      if (!blocking) {
+        return false;
+      }
+
+      // Checked after clearing the doorbell - the ring of interrupt() cannot be lost.
+      if (_interrupted.load()) {
+        throw praas::common::PraaSException{"Interrupted waiting for a message"};
+      }
+
+      wait_doorbell(_header->data_fd);
+    }
+
+    return true;
+  }
+
+  bool SHMChannel::_wait_writable(bool blocking) const
+  {
+    while (_writable() == 0) {
+
+      _header->writer_waiting.store(1);
+      clear_doorbell(_header->space_fd);
+
+      if (_writable() > 0) {
+        return true;
+      }
+
+      if (!blocking) {
+        return false;
+      }
+
+      if (_interrupted.load()) {
+        throw praas::common::PraaSException{"Interrupted waiting for space in the ring"};
+      }
+
+      wait_doorbell(_header->space_fd);
+    }
+
+    return true;
+  }
+
+  void SHMChannel::send(Message& msg)
+  {
+    _send(msg, nullptr, 0);
+  }
+
+  void SHMChannel::send(Message& msg, BufferAccessor<const char> buf)
+  {
+    SPDLOG_DEBUG("Sending message, buffer length {}", buf.len);
+    _send(msg, buf.data(), buf.len);
+  }
+
+  void SHMChannel::send(Message& msg, BufferAccessor<std::byte> buf)
+  {
+    SPDLOG_DEBUG("Sending message, buffer length {}", buf.len);
+    // NOLINTNEXTLINE
+    _send(msg, reinterpret_cast<const char*>(buf.data()), buf.len);
+  }
+
+  void SHMChannel::send(Message& msg, const std::vector<Buffer<char>>& data)
+  {
+    // Single buffer can be passed without a copy.
+    if (data.size() == 1) {
+      _send(msg, data[0].data(), data[0].len);
+      return;
+    }
+
+    size_t len = 0;
+    for (const auto& buf : data) {
+      len += buf.len;
+    }
+
+    msg.total_length(len);
+
+    uint64_t location = INLINE_PAYLOAD;
+    // NOLINTNEXTLINE
+    _send(reinterpret_cast<const char*>(msg.bytes()), msg.BUF_SIZE);
+    // NOLINTNEXTLINE
+    _send(reinterpret_cast<const char*>(&location), sizeof(location));
+    for (const auto& buf : data) {
+      if (buf.len > 0) {
+        _send(buf.data(), buf.len);
+      }
+    }
+  }
+
+  void SHMChannel::_send(Message& msg, const char* data, size_t len)
+  {
+    msg.total_length(len);
+
+    uint64_t location = INLINE_PAYLOAD;
+    if (_arena && len > 0 && _arena->contains(data)) {
+      // The reference is released by the receiver.
+      _arena->acquire(data);
+      location = _arena->offset(data);
+    }
+
+    // NOLINTNEXTLINE
+    _send(reinterpret_cast<const char*>(msg.bytes()), msg.BUF_SIZE);
+    // NOLINTNEXTLINE
+    _send(reinterpret_cast<const char*>(&location), sizeof(location));
+    if (location == INLINE_PAYLOAD && len > 0) {
+      _send(data, len);
+    }
+  }
+
+  void SHMChannel::_send(const char* data, size_t len)
+  {
+    if (_blocking) {
+      for (size_t pos = _write(data, len); pos < len; pos += _write(data + pos, len - pos)) {
+        _wait_writable(true);
+      }
+      return;
+    }
+
+    // Messages cannot be reordered - nothing is sent directly while the queue is not empty.
+    size_t pos = _send_queue.empty() ? _write(data, len) : 0;
+
+    if (pos < len) {
+
+      Buffer<char> buf = _buffers.retrieve_buffer(len - pos);
+      buf.len = len - pos;
+      std::copy_n(data + pos, buf.len, buf.data());
+      _send_queue.push_back(std::move(buf));
+
+      _queued_bytes += len - pos;
+      _max_queued_bytes = std::max(_max_queued_bytes, _queued_bytes);
+
+      SPDLOG_DEBUG(
+          "Ring {} is full, deferred {} bytes, {} bytes waiting in total", _name, len - pos,
+          _queued_bytes
+      );
+
+      // Arms the writer - the reader might have made space in the meantime.
+      flush();
+    }
+  }
+
+  bool SHMChannel::flush()
+  {
+    while (!_send_queue.empty()) {
+
+      Buffer<char>& buf = _send_queue.front();
+
+      size_t sent = _write(buf.data() + _send_pos, buf.len - _send_pos);
+      _send_pos += sent;
+      _queued_bytes -= sent;
+
+      if (_send_pos < buf.len) {
+        if (!_wait_writable(false)) {
+          return false;
+        }
+        continue;
+      }
+
+      _send_queue.pop_front();
+      _send_pos = 0;
+    }
+
+    return true;
+  }
+
+  size_t SHMChannel::_write(const char* data, size_t len) const
+  {
+    const size_t capacity = _header->capacity;
+    uint64_t head = _header->head.load(std::memory_order_relaxed);
+
+    size_t size = std::min(_writable(), len);
+    if (size == 0) {
+      return 0;
+    }
+
+    size_t offset = head % capacity;
+    size_t first_part = std::min(size, capacity - offset);
+
+    std::memcpy(_ring + offset, data, first_part);
+    std::memcpy(_ring, data + first_part, size - first_part);
+
+    _header->head.store(head + size);
+
+    if (_header->reader_waiting.load() && _header->reader_waiting.exchange(0)) {
+      ring_doorbell(_header->data_fd);
+    }
+
+    return size;
+  }
+
+  size_t SHMChannel::_read(char* data, size_t len) const
+  {
+    const size_t capacity = _header->capacity;
+    uint64_t tail = _header->tail.load(std::memory_order_relaxed);
+
+    size_t size = std::min(_readable(), len);
+    if (size == 0) {
+      return 0;
+    }
+
+    size_t offset = tail % capacity;
+    size_t first_part = std::min(size, capacity - offset);
+
+    std::memcpy(data, _ring + offset, first_part);
+    std::memcpy(data + first_part, _ring, size - first_part);
+
+    _header->tail.store(tail + size);
+
+    if (_header->writer_waiting.load() && _header->writer_waiting.exchange(0)) {
+      ring_doorbell(_header->space_fd);
+    }
+
+    return size;
+  }
+
+  size_t SHMChannel::_recv(char* data, size_t len) const
+  {
+    for (size_t pos = _read(data, len); pos < len; pos += _read(data + pos, len - pos)) {
+      // Message has been started - wait for the rest.
+      _wait_readable(true);
+    }
+
+    return len;
+  }
+
+  uint64_t SHMChannel::_recv_header()
+  {
+    // NOLINTNEXTLINE
+    _recv(reinterpret_cast<char*>(_msg.data.data()), Message::BUF_SIZE);
+
+    uint64_t location = INLINE_PAYLOAD;
+    // NOLINTNEXTLINE
+    _recv(reinterpret_cast<char*>(&location), sizeof(location));
+
+    if (location != INLINE_PAYLOAD && !_arena) {
+      throw praas::common::PraaSException{
+          fmt::format("Received a shared buffer on channel {} without an arena", _name)};
+    }
+
+    return location;
+  }
+
+  bool SHMChannel::blocking_receive(Buffer<std::byte>& buf)
+  {
+    _wait_readable(true);
+
+    uint64_t location = _recv_header();
+    size_t data_to_read = _msg.total_length();
+
+    if (location != INLINE_PAYLOAD) {
+      buf = _arena->adopt<std::byte>(location, data_to_read);
+      return true;
+    }
+
+    // Never write into a block that might be shared with the other side.
+    if (buf.shared() || buf.size < data_to_read) {
+      buf.resize(data_to_read);
+    }
+
+    // NOLINTNEXTLINE
+    buf.len = _recv(reinterpret_cast<char*>(buf.data()), data_to_read);
+    SPDLOG_DEBUG("Read {} bytes out of shared memory channel {}", buf.len, _name);
+    return true;
+  }
+
+  bool SHMChannel::_recv_partial()
+  {
+    if (_header_read < Message::BUF_SIZE) {
+      _header_read += _read(
+          // NOLINTNEXTLINE
+          reinterpret_cast<char*>(_msg.data.data()) + _header_read,
+          Message::BUF_SIZE - _header_read
+      );
+    }
+
+    if (_header_read >= Message::BUF_SIZE && _header_read < HEADER_SIZE) {
+
+      size_t pos = _header_read - Message::BUF_SIZE;
+      // NOLINTNEXTLINE
+      _header_read += _read(reinterpret_cast<char*>(&_location) + pos, sizeof(_location) - pos);
+
+      if (_header_read == HEADER_SIZE) {
+
+        if (_location != INLINE_PAYLOAD) {
+          if (!_arena) {
+            throw praas::common::PraaSException{fmt::format(
+                "Received a shared buffer on channel {} without an arena", _name
+            )};
+          }
+          _msg_payload = _arena->adopt<char>(_location, _msg.total_length());
+        } else if (_msg.total_length() > 0) {
+          _msg_payload = _buffers.retrieve_buffer(_msg.total_length());
+        }
+      }
+    }
+
+    if (_header_read < HEADER_SIZE) {
+      return false;
+    }
+
+    if (_location == INLINE_PAYLOAD && _msg_payload.len < _msg.total_length()) {
+      _msg_payload.len += _read(
+          _msg_payload.data() + _msg_payload.len, _msg.total_length() - _msg_payload.len
+      );
+    }
+
+    return _location != INLINE_PAYLOAD || _msg_payload.len == _msg.total_length();
+  }
+
+  std::tuple<bool, Buffer<char>> SHMChannel::receive()
+  {
+    // Epoll might wake us up spuriously, and the writer might die in the middle of a message
+    // - never block the controller. The rest of the message is received in the next calls.
+    while (!_recv_partial()) {
+      if (!_wait_readable(_blocking)) {
+        return std::make_tuple(false, Buffer<char>{});
+      }
+    }
+
+    Buffer<char> buf = std::move(_msg_payload);
+    _msg_payload = Buffer<char>{};
+    _header_read = 0;
+    _location = INLINE_PAYLOAD;
+
+    // Re-arm the reader before returning to epoll, or the writer will never ring again.
+    if (!_blocking) {
+      _header->reader_waiting.store(1);
+      if (_readable() > 0) {
+        ring_doorbell(_header->data_fd);
+      }
+    }
+
+    return std::make_tuple(true, std::move(buf));
+  }
+
+  struct ThreadChannel::Queue {
+
+    std::mutex lock;
+    std::condition_variable cv;
+
+    std::deque<std::tuple<Message, Buffer<char>>> messages;
+
+    bool closed{};
+
+    // Holds a non-zero value while messages are queued.
+    int event_fd;
+
+    BufferPool<char> buffers{BUFFER_ELEMS, BUFFER_SIZE};
+
+    Queue()
+    {
+      common::util::assert_other(event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK), -1);
+    }
+
+    Queue(const Queue&) = delete;
+    Queue& operator=(const Queue&) = delete;
+    Queue(Queue&&) = delete;
+    Queue& operator=(Queue&&) = delete;
+
+    ~Queue()
+    {
+      close(event_fd);
+    }
+  };
+
+  std::shared_ptr<ThreadChannel::Queue> ThreadChannel::create_queue()
+  {
+    return std::make_shared<Queue>();
+  }
+
+  ThreadChannel::ThreadChannel(std::shared_ptr<Queue> queue, IPCDirection, bool blocking)
+      : _queue(std::move(queue)), _blocking(blocking)
+  {
+  }
+
+  void ThreadChannel::shutdown()
+  {
+    if (!_queue) {
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard{_queue->lock};
+      _queue->closed = true;
+    }
+    _queue->cv.notify_all();
+  }
+
+  int ThreadChannel::fd() const
+  {
+    return _queue->event_fd;
+  }
+
+  BufferPoolStats ThreadChannel::buffer_stats() const
+  {
+    return _queue->buffers.stats();
+  }
+
+  void ThreadChannel::send(Message& msg)
+  {
+    msg.total_length(0);
+    _send(msg, Buffer<char>{});
+  }
+
+  void ThreadChannel::send(Message& msg, BufferAccessor<const char> buf)
+  {
+    msg.total_length(buf.len);
+
+    Buffer<char> payload{};
+    if (buf.len > 0) {
+      payload = _queue->buffers.retrieve_buffer(buf.len);
+      std::memcpy(payload.data(), buf.data(), buf.len);
+      payload.len = buf.len;
+    }
+    _send(msg, std::move(payload));
+  }
+
+  void ThreadChannel::send(Message& msg, BufferAccessor<std::byte> buf)
+  {
+    // NOLINTNEXTLINE
+    send(msg, BufferAccessor<const char>{reinterpret_cast<const char*>(buf.data()), buf.len});
+  }
+
+  void ThreadChannel::send(Message& msg, const std::vector<Buffer<char>>& data)
+  {
+    size_t len = 0;
+    for (const auto& buf : data) {
+      len += buf.len;
+    }
+    msg.total_length(len);
+
+    Buffer<char> payload{};
+    if (len > 0) {
+      payload = _queue->buffers.retrieve_buffer(len);
+      for (const auto& buf : data) {
+        std::memcpy(payload.data() + payload.len, buf.data(), buf.len);
+        payload.len += buf.len;
+      }
+    }
+    _send(msg, std::move(payload));
+  }
+
+  void ThreadChannel::_send(const Message& msg, Buffer<char>&& payload)
+  {
+    {
+      std::lock_guard<std::mutex> guard{_queue->lock};
+      if (_queue->messages.empty()) {
+        ring_doorbell(_queue->event_fd);
+      }
+      _queue->messages.emplace_back(msg, std::move(payload));
+    }
+    _queue->cv.notify_one();
+  }
+
+  bool ThreadChannel::_recv(Buffer<char>& payload)
+  {
+    std::unique_lock<std::mutex> guard{_queue->lock};
+
+    if (_blocking) {
+      _queue->cv.wait(guard, [this]() { return !_queue->messages.empty() || _queue->closed; });
+    }
+
+    if (_queue->messages.empty()) {
+      return false;
+    }
+
+    auto& [msg, data] = _queue->messages.front();
+    _msg = msg;
+    payload = std::move(data);
+    _queue->messages.pop_front();
+
+    // Epoll stops reporting the queue once the last message is taken.
+    if (_queue->messages.empty()) {
+      clear_doorbell(_queue->event_fd);
+    }
+
+    return true;
+  }
+
+  bool ThreadChannel::blocking_receive(Buffer<std::byte>& buf)
+  {
+    Buffer<char> payload;
+    if (!_recv(payload)) {
+      return false;
+    }
+
+    // The receiver takes over the copy made by the sender.
+    buf = Buffer<std::byte>{std::move(payload)};
+    return true;
+  }
+
+  std::tuple<bool, Buffer<char>> ThreadChannel::receive()
+  {
+    Buffer<char> payload;
+    bool read = _recv(payload);
+    return std::make_tuple(read, std::move(payload));
+  }
+
 } // namespace praas::process::runtime::internal::ipc
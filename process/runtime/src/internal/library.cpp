@@ -1,28 +1,45 @@
-#include "functions.hpp"
+#include <praas/process/runtime/internal/library.hpp>
 
 #include <praas/common/exceptions.hpp>
 
+#include <cassert>
 #include <filesystem>
 #include <fstream>
 
 #include <dlfcn.h>
 
-#include <cereal/external/rapidjson/document.h>
-#include <cereal/external/rapidjson/istreamwrapper.h>
 #include <spdlog/spdlog.h>
 
-namespace praas::process {
+namespace praas::process::runtime::internal {
 
-  FunctionsLibrary::FunctionsLibrary(std::string code_location, std::string config_location)
+  FunctionsLibrary::FunctionsLibrary(const Functions& functions, Execution execution)
+  {
+    _load(functions, execution);
+  }
+
+  FunctionsLibrary::FunctionsLibrary(
+      const std::string& code_location, const std::string& config_location, Execution execution
+  )
   {
     auto path = std::filesystem::path{code_location} / config_location;
     std::ifstream in_stream{path};
     if (!in_stream.is_open()) {
       throw praas::common::PraaSException{fmt::format("Could not find file {}", path.c_str())};
     }
-    _func_db.initialize(in_stream, LANGUAGE);
 
-    for (const auto& func : _func_db) {
+    Functions functions;
+    functions.initialize(in_stream, LANGUAGE);
+    _load(functions, execution);
+  }
+
+  void FunctionsLibrary::_load(const Functions& functions, Execution execution)
+  {
+    for (const auto& func : functions) {
+
+      if (func.second.execution != execution) {
+        continue;
+      }
+
       if (!_load_function(func.first, func.second.module_name, func.second.function_name)) {
         spdlog::error(
             "Could not load {} from {}!", func.second.function_name, func.second.module_name
@@ -69,12 +86,14 @@ namespace praas::process {
     }
   }
 
-  FunctionsLibrary::FuncType FunctionsLibrary::get_function(std::string name)
+  FunctionsLibrary::FuncType FunctionsLibrary::get_function(const std::string& name) const
   {
     auto it = _functions.find(name);
     if (it == _functions.end()) {
       return nullptr;
     }
+    // NOLINTNEXTLINE
     return reinterpret_cast<FuncType>((*it).second);
   }
-} // namespace praas::process
+
+} // namespace praas::process::runtime::internal
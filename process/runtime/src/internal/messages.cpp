@@ -49,6 +49,18 @@ namespace praas::process::runtime::internal::ipc {
       return MessageVariants{StateKeysRequestParsed(data + HEADER_OFFSET)};
     }
 
+    if (type == Type::WORKER_READY) {
+      return MessageVariants{WorkerReadyParsed(data + HEADER_OFFSET)};
+    }
+
+    if (type == Type::INVOCATION_BATCH) {
+      return MessageVariants{InvocationBatchParsed(data + HEADER_OFFSET)};
+    }
+
+    if (type == Type::INVOCATION_BATCH_RESULT) {
+      return MessageVariants{InvocationBatchResultParsed(data + HEADER_OFFSET)};
+    }
+
     throw common::PraaSException{fmt::format("Unknown message with type number {}", type_val)};
   }
 
@@ -144,14 +156,14 @@ namespace praas::process::runtime::internal::ipc {
   int32_t InvocationRequestParsed::buffers() const
   {
     // NOLINTNEXTLINE
-    return *reinterpret_cast<const int32_t*>(buf + 2 * Message::ID_LENGTH + Message::NAME_LENGTH);
+    return *reinterpret_cast<const int32_t*>(buf + 3 * Message::ID_LENGTH + Message::NAME_LENGTH);
   }
 
   const int32_t* InvocationRequestParsed::buffers_lengths() const
   {
     // NOLINTNEXTLINE
     return reinterpret_cast<const int32_t*>(
-        buf + 2 * Message::ID_LENGTH + Message::NAME_LENGTH + sizeof(int32_t)
+        buf + 3 * Message::ID_LENGTH + Message::NAME_LENGTH + sizeof(int32_t)
     );
   }
 
@@ -175,6 +187,14 @@ namespace praas::process::runtime::internal::ipc {
                             reinterpret_cast<const char*>(buf + Message::ID_LENGTH), name_len};
   }
 
+  std::string_view InvocationRequestParsed::caller_id() const
+  {
+    return std::string_view{
+        // NOLINTNEXTLINE
+        reinterpret_cast<const char*>(buf + 2 * Message::ID_LENGTH + Message::NAME_LENGTH),
+        caller_id_len};
+  }
+
   void InvocationRequest::process_id(std::string_view id)
   {
     if (id.length() > Message::ID_LENGTH) {
@@ -221,11 +241,28 @@ namespace praas::process::runtime::internal::ipc {
     name_len = name.length();
   }
 
+  void InvocationRequest::caller_id(std::string_view id)
+  {
+    if (id.length() > Message::ID_LENGTH) {
+      throw common::InvalidArgument{
+          fmt::format("Caller ID too long: {} > {}", id.length(), Message::ID_LENGTH)};
+    }
+
+    std::strncpy(
+        // NOLINTNEXTLINE
+        reinterpret_cast<char*>(
+            data.data() + HEADER_OFFSET + 2 * Message::ID_LENGTH + Message::NAME_LENGTH
+        ),
+        id.data(), Message::ID_LENGTH
+    );
+    caller_id_len = id.length();
+  }
+
   void InvocationRequest::buffers(int32_t buffer_len)
   {
     // NOLINTNEXTLINE
     auto ptr = reinterpret_cast<int32_t*>(
-        data.data() + HEADER_OFFSET + Message::NAME_LENGTH + 2 * Message::ID_LENGTH
+        data.data() + HEADER_OFFSET + Message::NAME_LENGTH + 3 * Message::ID_LENGTH
     );
     *ptr++ = 1;
     *ptr = buffer_len;
@@ -242,7 +279,7 @@ namespace praas::process::runtime::internal::ipc {
 
     // NOLINTNEXTLINE
     auto ptr = reinterpret_cast<int32_t*>(
-        data.data() + HEADER_OFFSET + Message::NAME_LENGTH + 2 * Message::ID_LENGTH
+        data.data() + HEADER_OFFSET + Message::NAME_LENGTH + 3 * Message::ID_LENGTH
     );
     *ptr++ = elems;
 
@@ -341,4 +378,40 @@ namespace praas::process::runtime::internal::ipc {
     *reinterpret_cast<int32_t*>(data.data() + HEADER_OFFSET + Message::NAME_LENGTH) = code;
   }
 
+  int32_t WorkerReadyParsed::pid() const
+  {
+    // NOLINTNEXTLINE
+    return *reinterpret_cast<const int32_t*>(buf);
+  }
+
+  void WorkerReady::pid(int32_t pid)
+  {
+    // NOLINTNEXTLINE
+    *reinterpret_cast<int32_t*>(data.data() + HEADER_OFFSET) = pid;
+  }
+
+  int32_t InvocationBatchParsed::invocations() const
+  {
+    // NOLINTNEXTLINE
+    return *reinterpret_cast<const int32_t*>(buf);
+  }
+
+  void InvocationBatch::invocations(int32_t count)
+  {
+    // NOLINTNEXTLINE
+    *reinterpret_cast<int32_t*>(data.data() + HEADER_OFFSET) = count;
+  }
+
+  int32_t InvocationBatchResultParsed::invocations() const
+  {
+    // NOLINTNEXTLINE
+    return *reinterpret_cast<const int32_t*>(buf);
+  }
+
+  void InvocationBatchResult::invocations(int32_t count)
+  {
+    // NOLINTNEXTLINE
+    *reinterpret_cast<int32_t*>(data.data() + HEADER_OFFSET) = count;
+  }
+
 } // namespace praas::process::runtime::internal::ipc
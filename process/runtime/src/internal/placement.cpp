@@ -0,0 +1,129 @@
+#include <praas/process/runtime/internal/placement.hpp>
+
+#include <praas/common/exceptions.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace praas::process::runtime::internal {
+
+  namespace {
+
+    int parse_cpu(const std::string& list, const std::string& value)
+    {
+      size_t pos = 0;
+      int cpu = -1;
+      try {
+        cpu = std::stoi(value, &pos);
+      } catch (const std::logic_error&) {
+        pos = 0;
+      }
+
+      if (value.empty() || pos != value.length() || cpu < 0 || cpu >= CPU_SETSIZE) {
+        throw common::InvalidArgument{fmt::format("Incorrect CPU {} in the list {}", value, list)};
+      }
+      return cpu;
+    }
+
+  } // namespace
+
+  CPUSet CPUSet::parse(const std::string& list)
+  {
+    CPUSet set;
+
+    size_t begin = 0;
+    while (begin < list.length()) {
+
+      size_t end = list.find(',', begin);
+      if (end == std::string::npos) {
+        end = list.length();
+      }
+      std::string range = list.substr(begin, end - begin);
+      begin = end + 1;
+
+      size_t dash = range.find('-');
+      int first = parse_cpu(list, range.substr(0, dash));
+      int last = dash == std::string::npos ? first : parse_cpu(list, range.substr(dash + 1));
+      if (last < first) {
+        throw common::InvalidArgument{
+            fmt::format("Incorrect range {} in the list {}", range, list)};
+      }
+
+      for (int cpu = first; cpu <= last; ++cpu) {
+        set.cpus.push_back(cpu);
+      }
+    }
+
+    std::sort(set.cpus.begin(), set.cpus.end());
+    set.cpus.erase(std::unique(set.cpus.begin(), set.cpus.end()), set.cpus.end());
+
+    return set;
+  }
+
+  std::string CPUSet::str() const
+  {
+    std::string list;
+    for (size_t i = 0; i < cpus.size();) {
+
+      // Consecutive CPUs are written as a range.
+      size_t last = i;
+      while (last + 1 < cpus.size() && cpus[last + 1] == cpus[last] + 1) {
+        ++last;
+      }
+
+      if (!list.empty()) {
+        list += ',';
+      }
+      list += std::to_string(cpus[i]);
+      if (last > i) {
+        list += fmt::format("-{}", cpus[last]);
+      }
+
+      i = last + 1;
+    }
+    return list;
+  }
+
+  CPUSet CPUSet::select(size_t idx) const
+  {
+    if (cpus.empty()) {
+      return {};
+    }
+    return CPUSet{{cpus[idx % cpus.size()]}};
+  }
+
+  bool CPUSet::pin() const
+  {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+      CPU_SET(cpu, &set);
+    }
+
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+      spdlog::error("Could not pin the thread to CPUs {}, reason {}", str(), strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  bool use_local_memory()
+  {
+    // NOLINTNEXTLINE
+    if (syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0) != 0) {
+      spdlog::error("Could not set the local memory policy, reason {}", strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+} // namespace praas::process::runtime::internal
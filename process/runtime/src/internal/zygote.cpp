@@ -0,0 +1,102 @@
+#include <praas/process/runtime/internal/zygote.hpp>
+
+#include <praas/common/exceptions.hpp>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace praas::process::runtime::internal {
+
+  Zygote::Zygote(int fd) : _fd(fd)
+  {
+    // Forked workers never inherit the connection to the controller.
+    fcntl(_fd, F_SETFD, FD_CLOEXEC);
+  }
+
+  Zygote::~Zygote()
+  {
+    if (_fd >= 0) {
+      close(_fd);
+    }
+  }
+
+  std::optional<std::string> Zygote::wait()
+  {
+    std::array<char, MAX_REQUEST_LENGTH> request{};
+
+    ssize_t len = recv(_fd, request.data(), request.size(), 0);
+    if (len <= 0) {
+      if (len < 0) {
+        spdlog::info("Zygote stops receiving requests, reason {}", strerror(errno));
+      }
+      return std::nullopt;
+    }
+
+    std::string ipc_name{request.data(), strnlen(request.data(), static_cast<size_t>(len))};
+    if (ipc_name.length() + 1 < static_cast<size_t>(len)) {
+      try {
+        _cpus = CPUSet::parse(std::string{
+            request.data() + ipc_name.length() + 1,
+            static_cast<size_t>(len) - ipc_name.length() - 1});
+      } catch (const common::InvalidArgument& e) {
+        spdlog::error("Zygote ignores the placement of a worker: {}", e.what());
+        _cpus = CPUSet{};
+      }
+    } else {
+      _cpus = CPUSet{};
+    }
+
+    return ipc_name;
+  }
+
+  int Zygote::fork()
+  {
+    // Same as fork, but the new process is a sibling of the zygote.
+    // NOLINTNEXTLINE
+    auto pid = static_cast<int>(syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, 0, 0, 0));
+
+    if (pid == 0) {
+
+      close(_fd);
+      _fd = -1;
+
+      if (!_cpus.empty()) {
+        _cpus.pin();
+      }
+
+      // Same output as of workers started by the controller.
+      auto out_file = ("invoker_" + std::to_string(getpid()));
+      int fd = open(out_file.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+      if (fd >= 0) {
+        dup2(fd, 1);
+        dup2(fd, 2);
+        close(fd);
+      }
+
+      return 0;
+    }
+
+    if (pid < 0) {
+      spdlog::error("Zygote failed to fork a worker, reason {}", strerror(errno));
+    }
+
+    // The controller receives -1 on failure.
+    int32_t reply = pid;
+    if (send(_fd, &reply, sizeof(reply), MSG_NOSIGNAL) != sizeof(reply)) {
+      spdlog::error("Zygote failed to reply to the controller, reason {}", strerror(errno));
+    }
+
+    return pid;
+  }
+
+} // namespace praas::process::runtime::internal
@@ -5,6 +5,7 @@
 
 #include <chrono>
 #include <iostream>
+#include <thread>
 
 extern "C" int
 add(praas::process::runtime::Invocation invocation, praas::process::runtime::Context& context)
@@ -35,6 +36,14 @@ extern "C" int error_function(
   return 1;
 }
 
+extern "C" int hanging_function(
+    praas::process::runtime::Invocation /*unused*/, praas::process::runtime::Context& /*unused*/
+)
+{
+  std::this_thread::sleep_for(std::chrono::seconds(10));
+  return 0;
+}
+
 extern "C" int large_payload(
     praas::process::runtime::Invocation invocation, praas::process::runtime::Context& context
 )
@@ -447,3 +456,45 @@ extern "C" int local_invocation_unknown(
 
   return 0;
 }
+
+// Source of a multi-source invocation - returns the result of the reduction.
+extern "C" int
+map_source(praas::process::runtime::Invocation invocation, praas::process::runtime::Context& context)
+{
+  Input in{};
+  invocation.args[0].deserialize(in);
+
+  Output value{in.arg1};
+  auto buf = context.get_buffer(1024);
+  buf.serialize(value);
+
+  praas::process::runtime::InvocationResult invoc_result =
+      context.invoke(context.process_id(), "reduce_sources", "reduce_id", buf);
+  if (invoc_result.return_code != 0) {
+    return 1;
+  }
+
+  Output out{};
+  invoc_result.payload.deserialize(out);
+  auto& output_buf = context.get_output_buffer();
+  output_buf.serialize(out);
+
+  return 0;
+}
+
+// Subtracts the value of the second source from the first one.
+extern "C" int reduce_sources(
+    praas::process::runtime::Invocation invocation, praas::process::runtime::Context& context
+)
+{
+  Output first{};
+  Output second{};
+  invocation.args[0].deserialize(first);
+  invocation.args[1].deserialize(second);
+
+  Output out{first.result - second.result};
+  auto& buf = context.get_output_buffer();
+  buf.serialize(out);
+
+  return 0;
+}
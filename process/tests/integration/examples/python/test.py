@@ -5,6 +5,7 @@ from datetime import datetime
 import json
 import numpy as np
 import pickle
+import time
 
 import pypraas
 
@@ -60,6 +61,11 @@ def error_function(invocation, context):
 
     return 1
 
+def hanging_function(invocation, context):
+
+    time.sleep(10)
+    return 0
+
 def large_payload(invocation, context):
 
     input_data = np.frombuffer(invocation.args[0].view_readable(), dtype=np.int32).astype(dtype=np.int_)
@@ -67,7 +67,8 @@ size_t generate_input_json(std::string key, const runtime::internal::Buffer<char
   return pos;
 }
 
-class ProcessMessagingTest : public testing::TestWithParam<std::tuple<std::string, std::string>> {
+class ProcessMessagingTest
+    : public testing::TestWithParam<std::tuple<std::string, std::string, std::string>> {
 public:
   void SetUp(int workers)
   {
@@ -79,6 +80,7 @@ public:
     cfg.code.location = path;
     cfg.code.config_location = "configuration.json";
     cfg.code.language = runtime::internal::string_to_language(std::get<1>(GetParam()));
+    cfg.ipc_mode = runtime::internal::ipc::deserialize(std::get<2>(GetParam()));
 
     cfg.function_workers = workers;
     // process/tests/<exe> -> process
@@ -177,7 +179,7 @@ TEST_P(ProcessMessagingTest, GetPutOneWorker)
   std::string process_id = "remote-process-1";
   std::array<std::string, 2> invocation_id = {"first_id", "second_id"};
 
-  runtime::internal::BufferQueue<char> buffers(10, 1024);
+  runtime::internal::BufferPool<char> buffers(10, 1024);
 
   reset();
 
@@ -238,7 +240,7 @@ INSTANTIATE_TEST_SUITE_P(
     ProcessGetPutTestSelf, ProcessMessagingTest,
     testing::Combine(
         testing::Values("get_message_self", "get_message_any", "get_message_explicit"),
-        testing::Values("cpp", "python")
+        testing::Values("cpp", "python"), testing::Values("posix_mq", "shm")
     )
 );
 #else
@@ -246,7 +248,7 @@ INSTANTIATE_TEST_SUITE_P(
     ProcessGetPutTestSelf, ProcessMessagingTest,
     testing::Combine(
         testing::Values("get_message_self", "get_message_any", "get_message_explicit"),
-        testing::Values("cpp")
+        testing::Values("cpp"), testing::Values("posix_mq", "shm")
     )
 );
 #endif
@@ -269,7 +271,7 @@ TEST_P(ProcessMessagingTest, GetPutTwoWorkers)
   std::string process_id = "remote-process-1";
   std::array<std::string, 2> invocation_id = {"first_id", "second_id"};
 
-  runtime::internal::BufferQueue<char> buffers(10, 1024);
+  runtime::internal::BufferPool<char> buffers(10, 1024);
 
   reset();
 
@@ -91,7 +91,8 @@ int get_output_json(const runtime::internal::Buffer<char>& buf)
   return out.result;
 }
 
-class ProcessInvocationTest : public testing::TestWithParam<std::string> {
+class ProcessInvocationTest
+    : public testing::TestWithParam<std::tuple<std::string, std::string>> {
 public:
   void SetUp() override
   {
@@ -102,7 +103,8 @@ public:
     auto path = std::filesystem::canonical("/proc/self/exe").parent_path() / "integration";
     cfg.code.location = path;
     cfg.code.config_location = "configuration.json";
-    cfg.code.language = runtime::internal::string_to_language(GetParam());
+    cfg.code.language = runtime::internal::string_to_language(std::get<0>(GetParam()));
+    cfg.ipc_mode = runtime::internal::ipc::deserialize(std::get<1>(GetParam()));
 
     // process/tests/<exe> -> process
     cfg.deployment_location =
@@ -195,7 +197,7 @@ TEST_P(ProcessInvocationTest, SimpleInvocation)
   std::array<std::tuple<int, int>, 2> args = {std::make_tuple(42, 4), std::make_tuple(-1, 35)};
   std::array<int, 2> results = {46, 34};
 
-  runtime::internal::BufferQueue<char> buffers(10, 1024);
+  runtime::internal::BufferPool<char> buffers(10, 1024);
 
   reset();
 
@@ -303,6 +305,60 @@ TEST_P(ProcessInvocationTest, ReturnError)
   EXPECT_EQ(return_code, 1);
 }
 
+TEST_P(ProcessInvocationTest, Timeout)
+{
+  auto invoke = [this](const std::string& function_name, const std::string& invocation_id) {
+    reset();
+
+    praas::common::message::InvocationRequestData msg;
+    msg.function_name(function_name);
+    msg.invocation_id(invocation_id);
+    controller->dataplane_message(
+        std::move(msg.data_buffer()), runtime::internal::Buffer<char>{}
+    );
+
+    return finished.get_future().wait_for(std::chrono::seconds(2));
+  };
+
+  ASSERT_EQ(std::future_status::ready, invoke("hanging_function", "first_id"));
+  EXPECT_EQ(id, "first_id");
+  EXPECT_EQ(return_code, -1);
+  EXPECT_EQ(std::string_view(payload.data(), payload.len), "Invocation timed out");
+
+  // The stuck worker was replaced - the next invocation succeeds.
+  ASSERT_EQ(std::future_status::ready, invoke("zero_return", "second_id"));
+  EXPECT_EQ(id, "second_id");
+  EXPECT_EQ(return_code, 0);
+}
+
+TEST_P(ProcessInvocationTest, Cancel)
+{
+  std::string invocation_id = "first_id";
+
+  reset();
+
+  // The requested timeout overrides the one of the function.
+  praas::common::message::InvocationRequestData msg;
+  msg.function_name("hanging_function");
+  msg.invocation_id(invocation_id);
+  msg.timeout_ms(10000);
+  controller->dataplane_message(std::move(msg.data_buffer()), runtime::internal::Buffer<char>{});
+
+  // Let the invocation start - the worker running it is replaced.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  praas::common::message::InvocationCancelData cancel;
+  cancel.invocation_id(invocation_id);
+  controller->dataplane_message(
+      std::move(cancel.data_buffer()), runtime::internal::Buffer<char>{}
+  );
+
+  ASSERT_EQ(std::future_status::ready, finished.get_future().wait_for(std::chrono::seconds(2)));
+  EXPECT_EQ(id, invocation_id);
+  EXPECT_EQ(return_code, -1);
+  EXPECT_EQ(std::string_view(payload.data(), payload.len), "Invocation cancelled");
+}
+
 TEST_P(ProcessInvocationTest, NonExistingFunction)
 {
   std::string function_name = "non_existing_function";
@@ -336,7 +392,7 @@ TEST_P(ProcessInvocationTest, LargePayload)
   std::string process_id = "remote-process-1";
   std::string invocation_id = "first_id";
 
-  runtime::internal::BufferQueue<char> buffers(1, BUF_LEN);
+  runtime::internal::BufferPool<char> buffers(1, BUF_LEN);
 
   praas::common::message::InvocationRequestData msg;
   msg.function_name(function_name);
@@ -369,10 +425,105 @@ TEST_P(ProcessInvocationTest, LargePayload)
   }
 }
 
+TEST_P(ProcessInvocationTest, Pipeline)
+{
+  // Two stages - each one adds 2, and only the final result returns.
+  const int BUF_LEN = 1024 * sizeof(int);
+  std::string function_name = "large_payload_pipeline";
+  std::string process_id = "remote-process-1";
+  std::string invocation_id = "first_id";
+
+  runtime::internal::BufferPool<char> buffers(1, BUF_LEN);
+
+  praas::common::message::InvocationRequestData msg;
+  msg.function_name(function_name);
+  msg.invocation_id(invocation_id);
+
+  auto buf = buffers.retrieve_buffer(BUF_LEN);
+  int data_len = BUF_LEN / sizeof(int);
+  int* data_input = reinterpret_cast<int*>(buf.data());
+  for (int i = 0; i < data_len; ++i) {
+    data_input[i] = i;
+  }
+  buf.len = BUF_LEN;
+
+  msg.payload_size(buf.len);
+
+  controller->remote_message(std::move(msg.data_buffer()), std::move(buf), process_id);
+
+  // Wait for the invocation to finish
+  ASSERT_EQ(std::future_status::ready, finished.get_future().wait_for(std::chrono::seconds(1)));
+
+  EXPECT_TRUE(process.has_value());
+  EXPECT_EQ(process.value(), process_id);
+  EXPECT_EQ(id, invocation_id);
+  EXPECT_EQ(return_code, 0);
+
+  ASSERT_EQ(payload.len, BUF_LEN);
+  int* data_output = reinterpret_cast<int*>(payload.data());
+  for (int i = 0; i < data_len; ++i) {
+    EXPECT_EQ(i + 4, data_output[i]);
+  }
+}
+
+TEST_P(ProcessInvocationTest, ThreadExecution)
+{
+  // Only C++ functions run on threads of the controller.
+  if (cfg.code.language != runtime::internal::Language::CPP) {
+    GTEST_SKIP();
+  }
+
+  const int BUF_LEN = 1024 * sizeof(int);
+  std::string process_id = "remote-process-1";
+
+  runtime::internal::BufferPool<char> buffers(1, BUF_LEN);
+  int data_len = BUF_LEN / sizeof(int);
+
+  // The pipeline starts on a thread, and continues in the worker process.
+  std::array<std::tuple<std::string, std::string, int>, 2> invocations = {
+      std::make_tuple("large_payload_thread", "first_id", 2),
+      std::make_tuple("large_payload_thread_pipeline", "second_id", 4)};
+
+  for (const auto& [function_name, invocation_id, added] : invocations) {
+
+    reset();
+
+    praas::common::message::InvocationRequestData msg;
+    msg.function_name(function_name);
+    msg.invocation_id(invocation_id);
+
+    auto buf = buffers.retrieve_buffer(BUF_LEN);
+    int* data_input = reinterpret_cast<int*>(buf.data());
+    for (int i = 0; i < data_len; ++i) {
+      data_input[i] = i;
+    }
+    buf.len = BUF_LEN;
+
+    msg.payload_size(buf.len);
+
+    controller->remote_message(std::move(msg.data_buffer()), std::move(buf), process_id);
+
+    ASSERT_EQ(std::future_status::ready, finished.get_future().wait_for(std::chrono::seconds(1)));
+
+    EXPECT_EQ(id, invocation_id);
+    EXPECT_EQ(return_code, 0);
+
+    ASSERT_EQ(payload.len, BUF_LEN);
+    int* data_output = reinterpret_cast<int*>(payload.data());
+    for (int i = 0; i < data_len; ++i) {
+      EXPECT_EQ(i + added, data_output[i]);
+    }
+  }
+}
+
 #if defined(PRAAS_WITH_INVOKER_PYTHON)
 INSTANTIATE_TEST_SUITE_P(
-    ProcessInvocationTest, ProcessInvocationTest, testing::Values("cpp", "python")
+    ProcessInvocationTest, ProcessInvocationTest,
+    testing::Combine(testing::Values("cpp", "python"), testing::Values("posix_mq", "shm"))
 );
 #else
-INSTANTIATE_TEST_SUITE_P(ProcessInvocationTest, ProcessInvocationTest, testing::Values("cpp"));
+INSTANTIATE_TEST_SUITE_P(
+    ProcessInvocationTest, ProcessInvocationTest,
+    testing::Combine(testing::Values("cpp"), testing::Values("posix_mq", "shm"))
+);
 #endif
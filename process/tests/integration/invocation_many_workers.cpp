@@ -93,10 +93,18 @@ int get_output_json(const runtime::internal::Buffer<char>& buf)
 
 class ProcessManyWorkersInvocationTest : public testing::TestWithParam<std::string> {
 public:
-  void SetUp(int workers)
+  void SetUp(
+      int workers, std::optional<config::Scaling> scaling = std::nullopt, bool zygote = false,
+      int invoker_threads = 1
+  )
   {
     cfg.set_defaults();
     cfg.verbose = true;
+    cfg.zygote = zygote;
+    cfg.invoker_threads = invoker_threads;
+    if (scaling.has_value()) {
+      cfg.scaling = scaling.value();
+    }
 
     // Linux specific
     auto path = std::filesystem::canonical("/proc/self/exe").parent_path() / "integration";
@@ -204,7 +212,7 @@ TEST_P(ProcessManyWorkersInvocationTest, SubsequentInvocations)
       std::make_tuple(-33, 39)};
   std::array<int, COUNT> results = {46, 34, 1000, 6};
 
-  runtime::internal::BufferQueue<char> buffers(10, 1024);
+  runtime::internal::BufferPool<char> buffers(10, 1024);
 
   // Submit
   for (int idx = 0; idx < COUNT; ++idx) {
@@ -263,7 +271,7 @@ TEST_P(ProcessManyWorkersInvocationTest, ConcurrentInvocations)
       std::make_tuple(-33, 39)};
   std::array<int, COUNT> results = {46, 34, 1000, 6};
 
-  runtime::internal::BufferQueue<char> buffers(10, 1024);
+  runtime::internal::BufferPool<char> buffers(10, 1024);
 
   // Submit
   for (int idx = 0; idx < COUNT; ++idx) {
@@ -306,6 +314,379 @@ TEST_P(ProcessManyWorkersInvocationTest, ConcurrentInvocations)
   }
 }
 
+TEST_P(ProcessManyWorkersInvocationTest, BatchInvocations)
+{
+  SetUp(1);
+
+  // Fewer invocations than the batch size - they are dispatched together after the wait.
+  const int COUNT = 3;
+  const int BUF_LEN = 1024;
+  std::string function_name = "add_batch";
+  std::array<std::string, COUNT> invocation_id = {"1_id", "2_id", "3_id"};
+
+  std::array<std::tuple<int, int>, COUNT> args = {
+      std::make_tuple(42, 4), std::make_tuple(-1, 35), std::make_tuple(1000, 0)};
+  std::array<int, COUNT> results = {46, 34, 1000};
+
+  runtime::internal::BufferPool<char> buffers(10, 1024);
+
+  auto begin = std::chrono::system_clock::now();
+
+  // Submit
+  for (int idx = 0; idx < COUNT; ++idx) {
+
+    praas::common::message::InvocationRequestData msg;
+    msg.function_name(function_name);
+    msg.invocation_id(invocation_id[idx]);
+
+    auto buf = buffers.retrieve_buffer(BUF_LEN);
+    buf.len = generate_input(std::get<0>(args[idx]), std::get<1>(args[idx]), buf);
+    msg.payload_size(buf.len);
+
+    controller->dataplane_message(std::move(msg.data_buffer()), std::move(buf));
+  }
+
+  // wait
+  for (int idx = 0; idx < COUNT; ++idx) {
+    ASSERT_EQ(
+        std::future_status::ready,
+        saved_results[idx].finished.get_future().wait_for(std::chrono::seconds(2))
+    );
+  }
+  EXPECT_GE(std::chrono::system_clock::now() - begin, std::chrono::milliseconds(100));
+
+  // Validate result - the batch keeps the order of invocations.
+  for (int idx = 0; idx < COUNT; ++idx) {
+    EXPECT_FALSE(saved_results[idx].process.has_value());
+    EXPECT_EQ(saved_results[idx].id, invocation_id[idx]);
+    EXPECT_EQ(saved_results[idx].return_code, 0);
+
+    ASSERT_TRUE(saved_results[idx].payload.len > 0);
+    int res = get_output(saved_results[idx].payload);
+    EXPECT_EQ(res, results[idx]);
+  }
+}
+
+TEST_P(ProcessManyWorkersInvocationTest, DependencyInvocations)
+{
+  SetUp(1);
+
+  // The dependent function waits for the output of the upstream one.
+  const int COUNT = 2;
+  const int BUF_LEN = 1024;
+  std::array<std::string, COUNT> function_name = {"add_dependent", "add"};
+  std::array<std::string, COUNT> invocation_id = {"1_id", "2_id"};
+
+  std::array<std::tuple<int, int>, COUNT> args = {
+      std::make_tuple(42, 4), std::make_tuple(-1, 35)};
+
+  runtime::internal::BufferPool<char> buffers(10, 1024);
+
+  // Submit
+  for (int idx = 0; idx < COUNT; ++idx) {
+
+    praas::common::message::InvocationRequestData msg;
+    msg.function_name(function_name[idx]);
+    msg.invocation_id(invocation_id[idx]);
+
+    auto buf = buffers.retrieve_buffer(BUF_LEN);
+    buf.len = generate_input(std::get<0>(args[idx]), std::get<1>(args[idx]), buf);
+    msg.payload_size(buf.len);
+
+    controller->dataplane_message(std::move(msg.data_buffer()), std::move(buf));
+  }
+
+  // wait
+  for (int idx = 0; idx < COUNT; ++idx) {
+    ASSERT_EQ(
+        std::future_status::ready,
+        saved_results[idx].finished.get_future().wait_for(std::chrono::seconds(1))
+    );
+  }
+
+  // Upstream finishes first.
+  std::array<std::string, COUNT> order = {"2_id", "1_id"};
+  std::array<int, COUNT> results = {34, 46};
+  for (int idx = 0; idx < COUNT; ++idx) {
+    EXPECT_EQ(saved_results[idx].id, order[idx]);
+    EXPECT_EQ(saved_results[idx].return_code, 0);
+
+    ASSERT_TRUE(saved_results[idx].payload.len > 0);
+    int res = get_output(saved_results[idx].payload);
+    EXPECT_EQ(res, results[idx]);
+  }
+}
+
+TEST_P(ProcessManyWorkersInvocationTest, ElasticPool)
+{
+  // Start without workers - they are added for the backlog, and stopped when idle.
+  config::Scaling scaling;
+  scaling.set_defaults();
+  scaling.min_workers = 0;
+  scaling.max_workers = 2;
+  scaling.scale_up_backlog = 1;
+  scaling.idle_timeout_ms = 100;
+  SetUp(0, scaling);
+
+  const int COUNT = 4;
+  const int BUF_LEN = 1024;
+  std::string function_name = "add";
+
+  std::array<std::tuple<int, int>, COUNT> args = {
+      std::make_tuple(42, 4), std::make_tuple(-1, 35), std::make_tuple(1000, 0),
+      std::make_tuple(-33, 39)};
+  std::array<int, COUNT> results = {46, 34, 1000, 6};
+
+  runtime::internal::BufferPool<char> buffers(10, 1024);
+
+  // Second round runs after the idle workers have been stopped.
+  for (int round = 0; round < 2; ++round) {
+
+    reset();
+    idx = 0;
+
+    std::array<std::string, COUNT> invocation_id;
+    for (int idx = 0; idx < COUNT; ++idx) {
+
+      invocation_id[idx] = fmt::format("{}_{}_id", round, idx);
+
+      praas::common::message::InvocationRequestData msg;
+      msg.function_name(function_name);
+      msg.invocation_id(invocation_id[idx]);
+
+      auto buf = buffers.retrieve_buffer(BUF_LEN);
+      buf.len = generate_input(std::get<0>(args[idx]), std::get<1>(args[idx]), buf);
+      msg.payload_size(buf.len);
+
+      controller->dataplane_message(std::move(msg.data_buffer()), std::move(buf));
+    }
+
+    for (int idx = 0; idx < COUNT; ++idx) {
+      ASSERT_EQ(
+          std::future_status::ready,
+          saved_results[idx].finished.get_future().wait_for(std::chrono::seconds(5))
+      );
+    }
+
+    std::sort(saved_results.begin(), saved_results.end(), [](Result& first, Result& second) {
+      return first.id < second.id;
+    });
+
+    for (int idx = 0; idx < COUNT; ++idx) {
+      EXPECT_EQ(saved_results[idx].id, invocation_id[idx]);
+      EXPECT_EQ(saved_results[idx].return_code, 0);
+
+      ASSERT_TRUE(saved_results[idx].payload.len > 0);
+      EXPECT_EQ(get_output(saved_results[idx].payload), results[idx]);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(scaling.idle_timeout_ms * 3));
+  }
+}
+
+TEST_P(ProcessManyWorkersInvocationTest, ZygoteWorkers)
+{
+  // Start without workers - all of them are forked from the zygote for the backlog.
+  config::Scaling scaling;
+  scaling.set_defaults();
+  scaling.min_workers = 0;
+  scaling.max_workers = 4;
+  scaling.scale_up_backlog = 1;
+  SetUp(0, scaling, true);
+
+  const int COUNT = 4;
+  const int BUF_LEN = 1024;
+  std::string function_name = "add";
+  std::array<std::string, COUNT> invocation_id = {"1_id", "2_id", "3_id", "4_id"};
+
+  std::array<std::tuple<int, int>, COUNT> args = {
+      std::make_tuple(42, 4), std::make_tuple(-1, 35), std::make_tuple(1000, 0),
+      std::make_tuple(-33, 39)};
+  std::array<int, COUNT> results = {46, 34, 1000, 6};
+
+  runtime::internal::BufferPool<char> buffers(10, 1024);
+
+  for (int idx = 0; idx < COUNT; ++idx) {
+
+    praas::common::message::InvocationRequestData msg;
+    msg.function_name(function_name);
+    msg.invocation_id(invocation_id[idx]);
+
+    auto buf = buffers.retrieve_buffer(BUF_LEN);
+    buf.len = generate_input(std::get<0>(args[idx]), std::get<1>(args[idx]), buf);
+    msg.payload_size(buf.len);
+
+    controller->dataplane_message(std::move(msg.data_buffer()), std::move(buf));
+  }
+
+  for (int idx = 0; idx < COUNT; ++idx) {
+    ASSERT_EQ(
+        std::future_status::ready,
+        saved_results[idx].finished.get_future().wait_for(std::chrono::seconds(5))
+    );
+  }
+
+  std::sort(saved_results.begin(), saved_results.end(), [](Result& first, Result& second) {
+    return first.id < second.id;
+  });
+
+  for (int idx = 0; idx < COUNT; ++idx) {
+    EXPECT_EQ(saved_results[idx].id, invocation_id[idx]);
+    EXPECT_EQ(saved_results[idx].return_code, 0);
+
+    ASSERT_TRUE(saved_results[idx].payload.len > 0);
+    EXPECT_EQ(get_output(saved_results[idx].payload), results[idx]);
+  }
+}
+
+TEST_P(ProcessManyWorkersInvocationTest, InvokerThreads)
+{
+  // Only the C++ invoker runs several threads.
+  if (GetParam() != "cpp") {
+    GTEST_SKIP();
+  }
+
+  // Each invocation of power waits for the next one - all three run at once in one process.
+  SetUp(1, std::nullopt, false, 3);
+
+  const int BUF_LEN = 1024;
+  std::string function_name = "power";
+  std::string invocation_id = "first_id";
+
+  runtime::internal::BufferPool<char> buffers(10, 1024);
+
+  praas::common::message::InvocationRequestData msg;
+  msg.function_name(function_name);
+  msg.invocation_id(invocation_id);
+
+  auto buf = buffers.retrieve_buffer(BUF_LEN);
+  buf.len = generate_input(2, 4, buf);
+  msg.payload_size(buf.len);
+
+  controller->dataplane_message(std::move(msg.data_buffer()), std::move(buf));
+
+  ASSERT_EQ(
+      std::future_status::ready,
+      saved_results[0].finished.get_future().wait_for(std::chrono::seconds(2))
+  );
+
+  EXPECT_FALSE(saved_results[0].process.has_value());
+  EXPECT_EQ(saved_results[0].id, invocation_id);
+  EXPECT_EQ(saved_results[0].return_code, 0);
+
+  ASSERT_TRUE(saved_results[0].payload.len > 0);
+  EXPECT_EQ(get_output(saved_results[0].payload), 16);
+}
+
+TEST_P(ProcessManyWorkersInvocationTest, CancelInvokerThread)
+{
+  if (GetParam() != "cpp") {
+    GTEST_SKIP();
+  }
+
+  // Two invocations hang in a worker that still has a free slot - it stays idle.
+  SetUp(1, std::nullopt, false, 3);
+
+  std::array<std::string, 2> hanging_ids = {"first_id", "second_id"};
+  for (const std::string& invocation_id : hanging_ids) {
+    praas::common::message::InvocationRequestData msg;
+    msg.function_name("hanging_function");
+    msg.invocation_id(invocation_id);
+    msg.timeout_ms(10000);
+    controller->dataplane_message(std::move(msg.data_buffer()), runtime::internal::Buffer<char>{});
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  // The worker is replaced - invocations of its other slots fail together.
+  praas::common::message::InvocationCancelData cancel;
+  cancel.invocation_id(hanging_ids[0]);
+  controller->dataplane_message(
+      std::move(cancel.data_buffer()), runtime::internal::Buffer<char>{}
+  );
+
+  // The killed worker is no longer idle - the next invocation waits for its replacement.
+  runtime::internal::BufferPool<char> buffers(10, 1024);
+
+  praas::common::message::InvocationRequestData msg;
+  msg.function_name("add");
+  msg.invocation_id("third_id");
+
+  auto buf = buffers.retrieve_buffer(1024);
+  buf.len = generate_input(42, 4, buf);
+  msg.payload_size(buf.len);
+
+  controller->dataplane_message(std::move(msg.data_buffer()), std::move(buf));
+
+  std::vector<std::string> ids;
+  for (int idx = 0; idx < 2; ++idx) {
+    ASSERT_EQ(
+        std::future_status::ready,
+        saved_results[idx].finished.get_future().wait_for(std::chrono::seconds(2))
+    );
+    EXPECT_EQ(saved_results[idx].return_code, -1);
+    EXPECT_EQ(
+        std::string_view(saved_results[idx].payload.data(), saved_results[idx].payload.len),
+        "Invocation cancelled"
+    );
+    ids.emplace_back(saved_results[idx].id);
+  }
+  EXPECT_THAT(ids, testing::UnorderedElementsAre(hanging_ids[0], hanging_ids[1]));
+
+  ASSERT_EQ(
+      std::future_status::ready,
+      saved_results[2].finished.get_future().wait_for(std::chrono::seconds(2))
+  );
+  EXPECT_EQ(saved_results[2].id, "third_id");
+  EXPECT_EQ(saved_results[2].return_code, 0);
+
+  ASSERT_TRUE(saved_results[2].payload.len > 0);
+  EXPECT_EQ(get_output(saved_results[2].payload), 46);
+}
+
+TEST_P(ProcessManyWorkersInvocationTest, MultiSourceInvokerThreads)
+{
+  if (GetParam() != "cpp") {
+    GTEST_SKIP();
+  }
+
+  // Both sources and the reduction run at once in one process - sources are named by
+  // the function that sent the payload, not by the one dispatched last.
+  SetUp(1, std::nullopt, false, 3);
+
+  const int BUF_LEN = 1024;
+  runtime::internal::BufferPool<char> buffers(10, BUF_LEN);
+
+  std::array<std::string, 2> functions = {"map_first", "map_second"};
+  std::array<int, 2> values = {10, 3};
+  for (int idx = 0; idx < 2; ++idx) {
+
+    praas::common::message::InvocationRequestData msg;
+    msg.function_name(functions[idx]);
+    msg.invocation_id(functions[idx]);
+
+    auto buf = buffers.retrieve_buffer(BUF_LEN);
+    buf.len = generate_input(values[idx], 0, buf);
+    msg.payload_size(buf.len);
+
+    controller->dataplane_message(std::move(msg.data_buffer()), std::move(buf));
+  }
+
+  std::vector<std::string> ids;
+  for (int idx = 0; idx < 2; ++idx) {
+    ASSERT_EQ(
+        std::future_status::ready,
+        saved_results[idx].finished.get_future().wait_for(std::chrono::seconds(2))
+    );
+    EXPECT_EQ(saved_results[idx].return_code, 0);
+
+    ASSERT_TRUE(saved_results[idx].payload.len > 0);
+    EXPECT_EQ(get_output(saved_results[idx].payload), 7);
+    ids.emplace_back(saved_results[idx].id);
+  }
+  EXPECT_THAT(ids, testing::UnorderedElementsAre(functions[0], functions[1]));
+}
+
 #if defined(PRAAS_WITH_INVOKER_PYTHON)
 INSTANTIATE_TEST_SUITE_P(
     ProcessManyWorkersInvocationTest, ProcessManyWorkersInvocationTest,
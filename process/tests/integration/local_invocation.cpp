@@ -189,7 +189,7 @@ TEST_P(ProcessLocalInvocationTest, SimpleInvocation)
       std::make_tuple(2, 3), std::make_tuple(2, 4), std::make_tuple(3, 5)};
   std::array<int, 3> results = {8, 16, 243};
 
-  runtime::internal::BufferQueue<char> buffers(10, 1024);
+  runtime::internal::BufferPool<char> buffers(10, 1024);
 
   for (int i = 0; i < invocation_id.size(); ++i) {
 
@@ -9,6 +9,7 @@
 
 #include "examples/cpp/test.hpp"
 
+#include <algorithm>
 #include <exception>
 #include <filesystem>
 #include <future>
@@ -193,7 +194,7 @@ TEST_P(ProcessRemoteServer, DataPlaneInvocations)
       std::make_tuple(42, 4), std::make_tuple(-1, 35), std::make_tuple(1000, 0),
       std::make_tuple(-33, 39)};
   std::array<int, COUNT> results = {46, 34, 1000, 6};
-  runtime::internal::BufferQueue<char> buffers(10, BUF_LEN);
+  runtime::internal::BufferPool<char> buffers(10, BUF_LEN);
 
   for (int idx = 0; idx < args.size(); ++idx) {
 
@@ -212,6 +213,85 @@ TEST_P(ProcessRemoteServer, DataPlaneInvocations)
   server.shutdown();
 }
 
+TEST_P(ProcessRemoteServer, SplitPayload)
+{
+  SetUp(1);
+
+  remote::TCPServer server{*controller.get(), cfg};
+  controller->set_remote(&server);
+  server.poll();
+
+  praas::sdk::Process process{"localhost", DEFAULT_CONTROLLER_PORT};
+
+  ASSERT_TRUE(process.connect());
+
+  const int COUNT = 2;
+  int BUF_LEN = 1024;
+  std::array<std::string, COUNT> invocation_id = {"first_id", "second_id"};
+  std::array<std::tuple<int, int>, COUNT> args = {
+      std::make_tuple(42, 4), std::make_tuple(-1, 35)};
+  std::array<int, COUNT> results = {46, 34};
+  runtime::internal::BufferPool<char> buffers(10, BUF_LEN);
+
+  std::vector<char> data;
+  size_t first_end = 0;
+  for (int idx = 0; idx < COUNT; ++idx) {
+
+    auto buf = buffers.retrieve_buffer(BUF_LEN);
+    buf.len = generate_input(std::get<0>(args[idx]), std::get<1>(args[idx]), buf);
+
+    praas::common::message::InvocationRequestData msg;
+    msg.function_name("add");
+    msg.invocation_id(invocation_id[idx]);
+    msg.payload_size(buf.len);
+
+    data.insert(data.end(), msg.bytes(), msg.bytes() + msg.BUF_SIZE);
+    data.insert(data.end(), buf.data(), buf.data() + buf.len);
+    if (idx == 0) {
+      first_end = data.size();
+    }
+  }
+
+  // The payload of the first invocation arrives in several reads,
+  // and the last one also contains the entire second invocation.
+  size_t header_end = praas::common::message::MessageConfig::BUF_SIZE;
+  std::array<size_t, 4> splits = {
+      header_end + 1, (header_end + first_end) / 2, first_end - 1, data.size()};
+  auto& connection = process.connection();
+  size_t pos = 0;
+  for (size_t split : splits) {
+    auto len = static_cast<ssize_t>(split - pos);
+    ASSERT_EQ(connection.write_n(data.data() + pos, split - pos), len);
+    pos = split;
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+
+  for (int idx = 0; idx < COUNT; ++idx) {
+
+    praas::common::message::MessageData response;
+    connection.read_n(response.data(), praas::common::message::MessageConfig::BUF_SIZE);
+
+    auto parsed_msg = praas::common::message::MessageParser::parse(response);
+    ASSERT_TRUE(std::holds_alternative<praas::common::message::InvocationResultPtr>(parsed_msg));
+    auto& result = std::get<praas::common::message::InvocationResultPtr>(parsed_msg);
+    EXPECT_EQ(result.return_code(), 0);
+
+    std::vector<char> payload(result.total_length());
+    connection.read_n(payload.data(), payload.size());
+
+    auto result_idx = std::distance(
+        invocation_id.begin(),
+        std::find(invocation_id.begin(), invocation_id.end(), result.invocation_id())
+    );
+    ASSERT_LT(result_idx, COUNT);
+    EXPECT_EQ(get_output(payload.data(), payload.size()), results[result_idx]);
+  }
+
+  process.disconnect();
+
+  server.shutdown();
+}
+
 #if defined(PRAAS_WITH_INVOKER_PYTHON)
 INSTANTIATE_TEST_SUITE_P(
     ProcessRemoteServer, ProcessRemoteServer, testing::Values("cpp", "python")
@@ -216,7 +216,7 @@ TEST_P(ProcessRemoteServers, GetPutCommunication)
   SetUp(1);
 
   const int BUF_LEN = 1024;
-  runtime::internal::BufferQueue<char> buffers(10, 1024);
+  runtime::internal::BufferPool<char> buffers(10, 1024);
 
   std::vector<std::unique_ptr<remote::TCPServer>> servers;
   for (int i = 0; i < PROC_COUNT; ++i) {
@@ -293,7 +293,7 @@ TEST_P(ProcessRemoteServers, SimultaenousMessaging)
   SetUp(2);
 
   const int BUF_LEN = 1024;
-  runtime::internal::BufferQueue<char> buffers(10, 1024);
+  runtime::internal::BufferPool<char> buffers(10, 1024);
 
   std::vector<std::unique_ptr<remote::TCPServer>> servers;
   for (int i = 0; i < PROC_COUNT; ++i) {
@@ -363,7 +363,7 @@ TEST_P(ProcessRemoteServers, RemoteInvocations)
   SetUp(2);
 
   const int BUF_LEN = 1024;
-  runtime::internal::BufferQueue<char> buffers(10, 1024);
+  runtime::internal::BufferPool<char> buffers(10, 1024);
 
   std::vector<std::unique_ptr<remote::TCPServer>> servers;
   for (int i = 0; i < PROC_COUNT; ++i) {
@@ -434,7 +434,7 @@ TEST_P(ProcessRemoteServers, RemoteInvocationsUnknown)
   SetUp(2);
 
   const int BUF_LEN = 1024;
-  runtime::internal::BufferQueue<char> buffers(10, 1024);
+  runtime::internal::BufferPool<char> buffers(10, 1024);
 
   std::vector<std::unique_ptr<remote::TCPServer>> servers;
   for (int i = 0; i < PROC_COUNT; ++i) {
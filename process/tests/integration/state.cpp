@@ -176,7 +176,7 @@ TEST_P(ProcessStateTest, StateOneWorker)
   std::string process_id = "remote-process-1";
   std::array<std::string, 2> invocation_id = {"first_id", "second_id"};
 
-  runtime::internal::BufferQueue<char> buffers(10, 1024);
+  runtime::internal::BufferPool<char> buffers(10, 1024);
 
   reset();
 
@@ -242,7 +242,7 @@ TEST_P(ProcessStateTest, StateKeys)
   std::string process_id = "remote-process-1";
   std::array<std::string, 1> invocation_id = {"first_id"};
 
-  runtime::internal::BufferQueue<char> buffers(10, 1024);
+  runtime::internal::BufferPool<char> buffers(10, 1024);
 
   reset();
 
@@ -0,0 +1,112 @@
+#include <praas/process/runtime/internal/buffer.hpp>
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace praas::process::runtime::internal;
+
+TEST(BufferPoolTest, SizeClasses)
+{
+  BufferPool<char> pool;
+
+  auto buf = pool.retrieve_buffer(1);
+  EXPECT_EQ(buf.size, BufferPool<char>::MIN_CLASS_SIZE);
+  EXPECT_EQ(buf.len, 0);
+
+  buf = pool.retrieve_buffer(BufferPool<char>::MIN_CLASS_SIZE + 1);
+  EXPECT_EQ(buf.size, 2 * BufferPool<char>::MIN_CLASS_SIZE);
+
+  buf = pool.retrieve_buffer(1000);
+  EXPECT_EQ(buf.size, 1024);
+
+  buf = pool.retrieve_buffer(1024);
+  EXPECT_EQ(buf.size, 1024);
+
+  // Above the largest class - heap allocation that is never cached.
+  size_t large_size = BufferPool<char>::MAX_CLASS_SIZE + 1;
+  buf = pool.retrieve_buffer(large_size);
+  EXPECT_EQ(buf.size, large_size);
+  EXPECT_FALSE(buf.shared());
+
+  buf = Buffer<char>{};
+  EXPECT_EQ(pool.stats().misses, 5);
+  EXPECT_EQ(pool.stats().hits, 0);
+}
+
+TEST(BufferPoolTest, ReturnOnDestruction)
+{
+  BufferPool<char> pool{2, 1024};
+
+  auto stats = pool.stats();
+  EXPECT_EQ(stats.allocated_bytes, 2 * 1024);
+  EXPECT_EQ(stats.cached_bytes, 2 * 1024);
+
+  char* ptr = nullptr;
+  {
+    auto buf = pool.retrieve_buffer(1024);
+    ptr = buf.data();
+    EXPECT_EQ(pool.stats().cached_bytes, 1024);
+  }
+  EXPECT_EQ(pool.stats().cached_bytes, 2 * 1024);
+
+  // The buffer returns to the pool also after conversion.
+  {
+    Buffer<std::byte> buf = pool.retrieve_buffer(1024);
+    // NOLINTNEXTLINE
+    EXPECT_EQ(reinterpret_cast<char*>(buf.data()), ptr);
+  }
+
+  stats = pool.stats();
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_EQ(stats.misses, 0);
+  EXPECT_EQ(stats.allocated_bytes, 2 * 1024);
+  EXPECT_EQ(stats.cached_bytes, 2 * 1024);
+
+  // Pool might be destroyed before its buffers.
+  Buffer<char> buf;
+  {
+    BufferPool<char> temp_pool;
+    buf = temp_pool.retrieve_buffer(64);
+  }
+  buf = Buffer<char>{};
+}
+
+TEST(BufferPoolTest, CacheLimit)
+{
+  BufferPool<char> pool;
+  pool.max_cached_bytes(1024);
+
+  {
+    auto first = pool.retrieve_buffer(1024);
+    auto second = pool.retrieve_buffer(1024);
+    EXPECT_EQ(pool.stats().allocated_bytes, 2 * 1024);
+  }
+
+  // Only one of the buffers fits in the cache.
+  auto stats = pool.stats();
+  EXPECT_EQ(stats.allocated_bytes, 1024);
+  EXPECT_EQ(stats.cached_bytes, 1024);
+}
+
+TEST(BufferPoolTest, ReleaseFromAnotherThread)
+{
+  constexpr int BUFFERS = 1000;
+  BufferPool<char> pool;
+
+  std::vector<Buffer<char>> buffers;
+  for (int i = 0; i < BUFFERS; ++i) {
+    buffers.emplace_back(pool.retrieve_buffer(128));
+  }
+
+  std::thread releaser{[&]() { buffers.clear(); }};
+  for (int i = 0; i < BUFFERS; ++i) {
+    auto buf = pool.retrieve_buffer(256);
+  }
+  releaser.join();
+
+  auto stats = pool.stats();
+  EXPECT_EQ(stats.allocated_bytes, stats.cached_bytes);
+  EXPECT_EQ(stats.hits + stats.misses, 2 * BUFFERS);
+}
@@ -1,5 +1,6 @@
 
 #include <praas/common/exceptions.hpp>
+#include <praas/process/controller/config.hpp>
 #include <praas/process/runtime/internal/functions.hpp>
 
 #include <sstream>
@@ -8,6 +9,33 @@
 
 using namespace praas::process::runtime::internal;
 
+// Configuration of the controller with the required keys, followed by the keys of a test.
+std::string controller_config(
+    const std::string& extra = "", const std::string& language = "cpp",
+    const std::string& ipc_mode = "posix_mq"
+)
+{
+  std::string config = R"(
+    {
+      "port": 8000,
+      "verbose": false,
+      "function_workers": 1,
+      "ipc-mode": ")" + ipc_mode + R"(",
+      "ipc-message-size": 4096,
+      "process_id": "test-id",
+      "code": {
+        "language": ")" + language + R"(",
+        "location": "/function/",
+        "configuration-location": "functions.json"
+      }
+  )";
+
+  if (!extra.empty()) {
+    config += ", " + extra;
+  }
+  return config + "}";
+}
+
 TEST(ProcessFunctionsConfig, TriggerDirect)
 {
   std::string config = R"(
@@ -43,3 +71,724 @@ TEST(ProcessFunctionsConfig, TriggerDirect)
   EXPECT_EQ(func_ptr->function_name, "test");
   EXPECT_EQ(func_ptr->module_name, "libtest.so");
 }
+
+TEST(ProcessFunctionsConfig, TriggerBatch)
+{
+  std::string config = R"(
+    {
+      "functions": {
+        "cpp": {
+          "test": {
+            "code": {
+              "module": "libtest.so",
+              "function": "test"
+            },
+            "trigger": {
+              "type": "batch",
+              "size": 8,
+              "max-wait-us": 500
+            }
+          },
+          "test2": {
+            "code": {
+              "module": "libtest.so",
+              "function": "test2"
+            },
+            "trigger": {
+              "type": "batch",
+              "size": 4
+            }
+          }
+        }
+      }
+    }
+  )";
+
+  std::stringstream stream{config};
+
+  Functions functions;
+  functions.initialize(stream, Language::CPP);
+
+  auto ptr = functions.get_trigger("test");
+  ASSERT_NE(ptr, nullptr);
+  ASSERT_EQ(ptr->type(), Trigger::Type::BATCH);
+  auto batch = static_cast<const BatchTrigger*>(ptr);
+  EXPECT_EQ(batch->size(), 8);
+  EXPECT_EQ(batch->max_wait(), std::chrono::microseconds{500});
+
+  ptr = functions.get_trigger("test2");
+  ASSERT_NE(ptr, nullptr);
+  ASSERT_EQ(ptr->type(), Trigger::Type::BATCH);
+  batch = static_cast<const BatchTrigger*>(ptr);
+  EXPECT_EQ(batch->size(), 4);
+  EXPECT_EQ(batch->max_wait(), std::chrono::microseconds{BatchTrigger::DEFAULT_MAX_WAIT_US});
+
+  std::string incorrect = R"(
+    {
+      "functions": {
+        "cpp": {
+          "test": {
+            "code": { "module": "libtest.so", "function": "test" },
+            "trigger": { "type": "batch", "size": 0 }
+          }
+        }
+      }
+    }
+  )";
+  std::stringstream incorrect_stream{incorrect};
+  Functions incorrect_functions;
+  EXPECT_THROW(
+      incorrect_functions.initialize(incorrect_stream, Language::CPP),
+      praas::common::InvalidJSON
+  );
+}
+
+TEST(ProcessFunctionsConfig, TriggerMultiSource)
+{
+  std::string config = R"(
+    {
+      "functions": {
+        "cpp": {
+          "named": {
+            "code": { "module": "libtest.so", "function": "named" },
+            "trigger": { "type": "multi-source", "sources": ["first", "second", "third"] }
+          },
+          "any": {
+            "code": { "module": "libtest.so", "function": "any" },
+            "trigger": { "type": "multi-source", "nargs": 2 }
+          }
+        }
+      }
+    }
+  )";
+
+  std::stringstream stream{config};
+
+  Functions functions;
+  functions.initialize(stream, Language::CPP);
+
+  auto ptr = functions.get_trigger("named");
+  ASSERT_NE(ptr, nullptr);
+  ASSERT_EQ(ptr->type(), Trigger::Type::MULTI_SOURCE);
+  auto trigger = static_cast<const MultiSourceTrigger*>(ptr);
+  EXPECT_TRUE(trigger->named());
+  EXPECT_EQ(trigger->nargs(), 3);
+  EXPECT_EQ(trigger->source_index("first"), 0);
+  EXPECT_EQ(trigger->source_index("third"), 2);
+  EXPECT_EQ(trigger->source_index("fourth"), -1);
+
+  ptr = functions.get_trigger("any");
+  ASSERT_NE(ptr, nullptr);
+  ASSERT_EQ(ptr->type(), Trigger::Type::MULTI_SOURCE);
+  trigger = static_cast<const MultiSourceTrigger*>(ptr);
+  EXPECT_FALSE(trigger->named());
+  EXPECT_EQ(trigger->nargs(), 2);
+
+  // Sources must be unique.
+  std::string incorrect = R"(
+    {
+      "functions": {
+        "cpp": {
+          "test": {
+            "code": { "module": "libtest.so", "function": "test" },
+            "trigger": { "type": "multi-source", "sources": ["first", "first"] }
+          }
+        }
+      }
+    }
+  )";
+  std::stringstream incorrect_stream{incorrect};
+  Functions incorrect_functions;
+  EXPECT_THROW(
+      incorrect_functions.initialize(incorrect_stream, Language::CPP),
+      praas::common::InvalidJSON
+  );
+}
+
+TEST(ProcessFunctionsConfig, TriggerPipeline)
+{
+  std::string config = R"(
+    {
+      "functions": {
+        "cpp": {
+          "first": {
+            "code": { "module": "libtest.so", "function": "first" },
+            "trigger": { "type": "pipeline", "next": "second" }
+          },
+          "second": {
+            "code": { "module": "libtest.so", "function": "second" },
+            "trigger": { "type": "direct", "nargs": 1 }
+          }
+        }
+      }
+    }
+  )";
+
+  std::stringstream stream{config};
+
+  Functions functions;
+  functions.initialize(stream, Language::CPP);
+
+  auto ptr = functions.get_trigger("first");
+  ASSERT_NE(ptr, nullptr);
+  ASSERT_EQ(ptr->type(), Trigger::Type::PIPELINE);
+  EXPECT_EQ(static_cast<const PipelineTrigger*>(ptr)->next(), "second");
+
+  // Unknown stage and a pipeline without the end.
+  for (std::string next : {"unknown", "first"}) {
+
+    std::string incorrect = R"(
+      {
+        "functions": {
+          "cpp": {
+            "first": {
+              "code": { "module": "libtest.so", "function": "first" },
+              "trigger": { "type": "pipeline", "next": ")" +
+                            next + R"(" }
+            }
+          }
+        }
+      }
+    )";
+    std::stringstream incorrect_stream{incorrect};
+    Functions incorrect_functions;
+    EXPECT_THROW(
+        incorrect_functions.initialize(incorrect_stream, Language::CPP),
+        praas::common::InvalidJSON
+    );
+  }
+}
+
+TEST(ProcessFunctionsConfig, TriggerDependency)
+{
+  std::string config = R"(
+    {
+      "functions": {
+        "cpp": {
+          "first": {
+            "code": { "module": "libtest.so", "function": "first" },
+            "trigger": { "type": "direct", "nargs": 1 }
+          },
+          "second": {
+            "code": { "module": "libtest.so", "function": "second" },
+            "trigger": { "type": "dependency", "functions": ["first"], "max-outputs": 8 }
+          },
+          "third": {
+            "code": { "module": "libtest.so", "function": "third" },
+            "trigger": { "type": "dependency", "functions": ["first", "second"], "state": ["key"] }
+          }
+        }
+      }
+    }
+  )";
+
+  std::stringstream stream{config};
+
+  Functions functions;
+  functions.initialize(stream, Language::CPP);
+
+  auto ptr = functions.get_trigger("third");
+  ASSERT_NE(ptr, nullptr);
+  ASSERT_EQ(ptr->type(), Trigger::Type::DEPENDENCY);
+  auto trigger = static_cast<const DependencyTrigger*>(ptr);
+  EXPECT_EQ(trigger->functions(), (std::vector<std::string>{"first", "second"}));
+  EXPECT_EQ(trigger->state(), (std::vector<std::string>{"key"}));
+  EXPECT_EQ(trigger->max_outputs(), DependencyTrigger::DEFAULT_MAX_OUTPUTS);
+  EXPECT_EQ(
+      static_cast<const DependencyTrigger*>(functions.get_trigger("second"))->max_outputs(), 8
+  );
+
+  EXPECT_EQ(functions.function_dependents("first").size(), 2U);
+  EXPECT_EQ(functions.function_dependents("second"), (std::vector<std::string>{"third"}));
+  EXPECT_TRUE(functions.function_dependents("third").empty());
+  EXPECT_EQ(functions.state_dependents("key"), (std::vector<std::string>{"third"}));
+  EXPECT_TRUE(functions.state_dependents("other").empty());
+
+  // Functions cannot wait for their own output.
+  std::string incorrect = R"(
+    {
+      "functions": {
+        "cpp": {
+          "first": {
+            "code": { "module": "libtest.so", "function": "first" },
+            "trigger": { "type": "dependency", "functions": ["second"] }
+          },
+          "second": {
+            "code": { "module": "libtest.so", "function": "second" },
+            "trigger": { "type": "dependency", "functions": ["first"] }
+          }
+        }
+      }
+    }
+  )";
+  std::stringstream incorrect_stream{incorrect};
+  Functions incorrect_functions;
+  EXPECT_THROW(
+      incorrect_functions.initialize(incorrect_stream, Language::CPP),
+      praas::common::InvalidJSON
+  );
+
+  std::string negative = R"(
+    {
+      "functions": {
+        "cpp": {
+          "first": {
+            "code": { "module": "libtest.so", "function": "first" },
+            "trigger": { "type": "dependency", "state": ["key"], "max-outputs": -1 }
+          }
+        }
+      }
+    }
+  )";
+  std::stringstream negative_stream{negative};
+  Functions negative_functions;
+  EXPECT_THROW(
+      negative_functions.initialize(negative_stream, Language::CPP), praas::common::InvalidJSON
+  );
+}
+
+TEST(ProcessFunctionsConfig, Limits)
+{
+  std::string config = R"(
+    {
+      "functions": {
+        "cpp": {
+          "limited": {
+            "code": { "module": "libtest.so", "function": "limited" },
+            "trigger": { "type": "direct", "nargs": 1 },
+            "max-concurrency": 4,
+            "reserved-workers": 2,
+            "timeout-ms": 500
+          },
+          "reserved": {
+            "code": { "module": "libtest.so", "function": "reserved" },
+            "trigger": { "type": "direct", "nargs": 1 },
+            "reserved-workers": 1
+          },
+          "default": {
+            "code": { "module": "libtest.so", "function": "default" },
+            "trigger": { "type": "direct", "nargs": 1 }
+          }
+        }
+      }
+    }
+  )";
+
+  std::stringstream stream{config};
+
+  Functions functions;
+  functions.initialize(stream, Language::CPP);
+
+  auto ptr = functions.get_function("limited");
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(ptr->max_concurrency, 4);
+  EXPECT_EQ(ptr->reserved_workers, 2);
+  EXPECT_EQ(ptr->timeout_ms, 500);
+
+  ptr = functions.get_function("default");
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(ptr->max_concurrency, 0);
+  EXPECT_EQ(ptr->reserved_workers, 0);
+  EXPECT_EQ(ptr->timeout_ms, 0);
+
+  EXPECT_EQ(functions.reserved_workers(), 3);
+
+  // Negative limit, more reserved workers than the function can use, and a malformed timeout.
+  for (std::string limits : {R"("max-concurrency": -1)",
+                             R"("max-concurrency": 1, "reserved-workers": 2)",
+                             R"("timeout-ms": "fast")"}) {
+
+    std::string incorrect = R"(
+      {
+        "functions": {
+          "cpp": {
+            "first": {
+              "code": { "module": "libtest.so", "function": "first" },
+              "trigger": { "type": "direct", "nargs": 1 },
+              )" + limits +
+                            R"(
+            }
+          }
+        }
+      }
+    )";
+    std::stringstream incorrect_stream{incorrect};
+    Functions incorrect_functions;
+    EXPECT_THROW(
+        incorrect_functions.initialize(incorrect_stream, Language::CPP),
+        praas::common::InvalidJSON
+    );
+  }
+}
+
+TEST(ProcessFunctionsConfig, Execution)
+{
+  std::string config = R"(
+    {
+      "functions": {
+        "cpp": {
+          "thread": {
+            "code": { "module": "libtest.so", "function": "thread" },
+            "trigger": { "type": "direct", "nargs": 1 },
+            "execution": "thread",
+            "max-concurrency": 2
+          },
+          "process": {
+            "code": { "module": "libtest.so", "function": "process" },
+            "trigger": { "type": "direct", "nargs": 1 },
+            "execution": "process"
+          },
+          "default": {
+            "code": { "module": "libtest.so", "function": "default" },
+            "trigger": { "type": "direct", "nargs": 1 }
+          }
+        }
+      }
+    }
+  )";
+
+  std::stringstream stream{config};
+
+  Functions functions;
+  functions.initialize(stream, Language::CPP);
+
+  auto ptr = functions.get_function("thread");
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(ptr->execution, Execution::THREAD);
+  EXPECT_EQ(ptr->max_concurrency, 2);
+
+  ptr = functions.get_function("process");
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(ptr->execution, Execution::PROCESS);
+
+  ptr = functions.get_function("default");
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(ptr->execution, Execution::PROCESS);
+
+  EXPECT_EQ(functions.thread_functions(), 1);
+
+  // Unknown mode, and threads that would have to be reserved or stopped.
+  for (std::string execution : {R"("execution": "fiber")", R"("execution": 1)",
+                                R"("execution": "thread", "reserved-workers": 1)",
+                                R"("execution": "thread", "timeout-ms": 100)"}) {
+
+    std::string incorrect = R"(
+      {
+        "functions": {
+          "cpp": {
+            "first": {
+              "code": { "module": "libtest.so", "function": "first" },
+              "trigger": { "type": "direct", "nargs": 1 },
+              )" + execution +
+                            R"(
+            }
+          }
+        }
+      }
+    )";
+    std::stringstream incorrect_stream{incorrect};
+    Functions incorrect_functions;
+    EXPECT_THROW(
+        incorrect_functions.initialize(incorrect_stream, Language::CPP),
+        praas::common::InvalidJSON
+    );
+  }
+
+  // Python code cannot be loaded into the controller.
+  std::string python = R"(
+    {
+      "functions": {
+        "python": {
+          "first": {
+            "code": { "module": "test.py", "function": "first" },
+            "trigger": { "type": "direct", "nargs": 1 },
+            "execution": "thread"
+          }
+        }
+      }
+    }
+  )";
+  std::stringstream python_stream{python};
+  Functions python_functions;
+  EXPECT_THROW(
+      python_functions.initialize(python_stream, Language::PYTHON), praas::common::InvalidJSON
+  );
+}
+
+TEST(ProcessControllerConfig, Polling)
+{
+  {
+    std::stringstream stream{controller_config()};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(
+        cfg.polling.controller_spin_us,
+        praas::process::config::Polling::DEFAULT_CONTROLLER_SPIN_US
+    );
+    EXPECT_EQ(cfg.polling.worker_spin_us, praas::process::config::Polling::DEFAULT_WORKER_SPIN_US);
+  }
+
+  {
+    std::stringstream stream{controller_config(R"("polling": { "worker-spin-us": 20 })")};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(
+        cfg.polling.controller_spin_us,
+        praas::process::config::Polling::DEFAULT_CONTROLLER_SPIN_US
+    );
+    EXPECT_EQ(cfg.polling.worker_spin_us, 20);
+  }
+}
+
+TEST(ProcessControllerConfig, Scaling)
+{
+  {
+    std::stringstream stream{controller_config()};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_FALSE(cfg.scaling.enabled());
+  }
+
+  {
+    std::stringstream stream{controller_config(R"("scaling": { "max-workers": 8 })")};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_TRUE(cfg.scaling.enabled());
+    EXPECT_EQ(cfg.scaling.min_workers, 0);
+    EXPECT_EQ(cfg.scaling.max_workers, 8);
+    EXPECT_EQ(
+        cfg.scaling.scale_up_backlog, praas::process::config::Scaling::DEFAULT_SCALE_UP_BACKLOG
+    );
+    EXPECT_EQ(
+        cfg.scaling.scale_up_delay_ms, praas::process::config::Scaling::DEFAULT_SCALE_UP_DELAY_MS
+    );
+    EXPECT_EQ(
+        cfg.scaling.idle_timeout_ms, praas::process::config::Scaling::DEFAULT_IDLE_TIMEOUT_MS
+    );
+  }
+
+  {
+    std::stringstream stream{
+        controller_config(R"("scaling": { "min-workers": 4, "max-workers": 2 })")};
+    EXPECT_THROW(
+        praas::process::config::Controller::deserialize(stream),
+        praas::common::InvalidConfigurationError
+    );
+  }
+}
+
+TEST(ProcessControllerConfig, IOThreads)
+{
+  {
+    std::stringstream stream{controller_config()};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(cfg.io_threads, praas::process::config::Controller::DEFAULT_IO_THREADS);
+  }
+
+  {
+    std::stringstream stream{controller_config(R"("io-threads": 4)")};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(cfg.io_threads, 4);
+  }
+
+  {
+    std::stringstream stream{controller_config(R"("io-threads": 0)")};
+    EXPECT_THROW(
+        praas::process::config::Controller::deserialize(stream),
+        praas::common::InvalidConfigurationError
+    );
+  }
+}
+
+TEST(ProcessControllerConfig, Zygote)
+{
+  {
+    std::stringstream stream{controller_config()};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_FALSE(cfg.zygote);
+  }
+
+  {
+    std::stringstream stream{controller_config(R"("zygote": true)")};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_TRUE(cfg.zygote);
+  }
+
+  // Forks of the zygote do not inherit shared-memory channels.
+  {
+    std::stringstream stream{controller_config("", "cpp", "shm")};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(cfg.ipc_mode, praas::process::runtime::internal::ipc::IPCMode::SHM);
+  }
+
+  {
+    std::stringstream stream{controller_config(R"("zygote": true)", "cpp", "shm")};
+    EXPECT_THROW(
+        praas::process::config::Controller::deserialize(stream),
+        praas::common::InvalidConfigurationError
+    );
+  }
+}
+
+TEST(ProcessControllerConfig, ThreadWorkers)
+{
+  {
+    std::stringstream stream{controller_config()};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(cfg.thread_workers, praas::process::config::Controller::DEFAULT_THREAD_WORKERS);
+  }
+
+  {
+    std::stringstream stream{controller_config(R"("thread-workers": 4)")};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(cfg.thread_workers, 4);
+  }
+
+  {
+    std::stringstream stream{controller_config(R"("thread-workers": -1)")};
+    EXPECT_THROW(
+        praas::process::config::Controller::deserialize(stream),
+        praas::common::InvalidConfigurationError
+    );
+  }
+}
+
+TEST(ProcessControllerConfig, InvokerThreads)
+{
+  {
+    std::stringstream stream{controller_config()};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(cfg.invoker_threads, praas::process::config::Controller::DEFAULT_INVOKER_THREADS);
+  }
+
+  {
+    std::stringstream stream{controller_config(R"("invoker-threads": 4)")};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(cfg.invoker_threads, 4);
+  }
+
+  {
+    std::stringstream stream{controller_config(R"("invoker-threads": 0)")};
+    EXPECT_THROW(
+        praas::process::config::Controller::deserialize(stream),
+        praas::common::InvalidConfigurationError
+    );
+  }
+
+  // Python functions run on one thread of the invoker.
+  {
+    std::stringstream stream{controller_config(R"("invoker-threads": 2)", "python")};
+    EXPECT_THROW(
+        praas::process::config::Controller::deserialize(stream),
+        praas::common::InvalidConfigurationError
+    );
+  }
+}
+
+TEST(ProcessControllerConfig, Dispatch)
+{
+  {
+    std::stringstream stream{controller_config()};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(cfg.dispatch.policy, praas::process::config::Dispatch::Policy::AFFINITY);
+    EXPECT_EQ(
+        cfg.dispatch.affinity_wait_us, praas::process::config::Dispatch::DEFAULT_AFFINITY_WAIT_US
+    );
+    EXPECT_EQ(cfg.dispatch.aging_us, praas::process::config::Dispatch::DEFAULT_AGING_US);
+  }
+
+  {
+    std::stringstream stream{
+        controller_config(R"("dispatch": { "policy": "any", "affinity-wait-us": 50 })")};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(cfg.dispatch.policy, praas::process::config::Dispatch::Policy::ANY);
+    EXPECT_EQ(cfg.dispatch.affinity_wait_us, 50);
+    EXPECT_EQ(cfg.dispatch.aging_us, praas::process::config::Dispatch::DEFAULT_AGING_US);
+  }
+
+  {
+    std::stringstream stream{controller_config(
+        R"("dispatch": { "policy": "any", "affinity-wait-us": 50, "aging-us": 2000 })"
+    )};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(cfg.dispatch.aging_us, 2000);
+  }
+
+  {
+    std::stringstream stream{controller_config(R"("dispatch": { "aging-us": 2000 })")};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(cfg.dispatch.policy, praas::process::config::Dispatch::Policy::AFFINITY);
+    EXPECT_EQ(
+        cfg.dispatch.affinity_wait_us, praas::process::config::Dispatch::DEFAULT_AFFINITY_WAIT_US
+    );
+    EXPECT_EQ(cfg.dispatch.aging_us, 2000);
+  }
+
+  {
+    std::stringstream stream{
+        controller_config(R"("dispatch": { "policy": "random", "affinity-wait-us": 50 })")};
+    EXPECT_THROW(
+        praas::process::config::Controller::deserialize(stream),
+        praas::common::InvalidConfigurationError
+    );
+  }
+}
+
+TEST(ProcessControllerConfig, Admission)
+{
+  {
+    std::stringstream stream{controller_config()};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(cfg.admission.max_queued_invocations, 0);
+    EXPECT_EQ(cfg.admission.max_queued_bytes, 0);
+    EXPECT_EQ(cfg.admission.max_wait_ms, 0);
+  }
+
+  {
+    std::stringstream stream{controller_config(
+        R"("admission": { "max-queued-invocations": 64, "max-queued-bytes": 1048576 })"
+    )};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(cfg.admission.max_queued_invocations, 64);
+    EXPECT_EQ(cfg.admission.max_queued_bytes, 1048576);
+    EXPECT_EQ(cfg.admission.max_wait_ms, 0);
+  }
+
+  {
+    std::stringstream stream{controller_config(R"("admission": { "max-wait-ms": -1 })")};
+    EXPECT_THROW(
+        praas::process::config::Controller::deserialize(stream),
+        praas::common::InvalidConfigurationError
+    );
+  }
+}
+
+TEST(ProcessControllerConfig, Placement)
+{
+  {
+    std::stringstream stream{controller_config()};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_TRUE(cfg.placement.controller_cpus.empty());
+    EXPECT_TRUE(cfg.placement.io_cpus.empty());
+    EXPECT_TRUE(cfg.placement.worker_cpus.empty());
+    EXPECT_FALSE(cfg.placement.local_memory);
+  }
+
+  {
+    std::stringstream stream{
+        controller_config(R"("placement": { "controller-cpus": "0", "io-cpus": "1,3",
+                   "worker-cpus": "8-10,4-5,9", "local-memory": true })")};
+    auto cfg = praas::process::config::Controller::deserialize(stream);
+    EXPECT_EQ(cfg.placement.controller_cpus.cpus, std::vector<int>{0});
+    EXPECT_EQ(cfg.placement.io_cpus.cpus, (std::vector<int>{1, 3}));
+    EXPECT_EQ(cfg.placement.worker_cpus.cpus, (std::vector<int>{4, 5, 8, 9, 10}));
+    EXPECT_EQ(cfg.placement.worker_cpus.str(), "4-5,8-10");
+    EXPECT_EQ(cfg.placement.worker_cpus.select(6).cpus, std::vector<int>{5});
+    EXPECT_TRUE(cfg.placement.local_memory);
+  }
+
+  for (const std::string& cpus : {"1-", "3-1", "a", "1,,2", "-1"}) {
+    std::stringstream stream{
+        controller_config(R"("placement": { "worker-cpus": ")" + cpus + R"(" })")};
+    EXPECT_THROW(
+        praas::process::config::Controller::deserialize(stream),
+        praas::common::InvalidConfigurationError
+    );
+  }
+}
@@ -0,0 +1,530 @@
+#include <praas/common/exceptions.hpp>
+#include <praas/process/runtime/internal/buffer.hpp>
+#include <praas/process/runtime/internal/ipc/ipc.hpp>
+#include <praas/process/runtime/internal/ipc/messages.hpp>
+
+#include <numeric>
+#include <thread>
+
+#include <csignal>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+using namespace praas::process::runtime::internal;
+
+class SHMChannelTest : public testing::Test {
+protected:
+  void SetUp() override
+  {
+    name = fmt::format("/praas_test_shm_{}", getpid());
+  }
+
+  std::string name;
+};
+
+TEST_F(SHMChannelTest, EmptyChannel)
+{
+  // Controller side never blocks.
+  ipc::SHMChannel reader{name, ipc::IPCDirection::READ, true};
+
+  auto [read, buf] = reader.receive();
+  EXPECT_FALSE(read);
+  EXPECT_TRUE(buf.null());
+}
+
+TEST_F(SHMChannelTest, Descriptors)
+{
+  auto arena = ipc::SHMArena::create(4 * ipc::SHMArena::PAGE_SIZE);
+  ipc::SHMChannel channel{name, ipc::IPCDirection::READ, true, ipc::SHMChannel::RING_SIZE, arena};
+
+  // Doorbells and the arena are passed explicitly to the worker of the channel.
+  auto fds = channel.descriptors();
+  ASSERT_EQ(fds.size(), 3);
+  EXPECT_EQ(fds[2], arena->fd());
+  for (int fd : fds) {
+    EXPECT_TRUE(fcntl(fd, F_GETFD) & FD_CLOEXEC);
+  }
+}
+
+TEST_F(SHMChannelTest, SendReceive)
+{
+  ipc::SHMChannel reader{name, ipc::IPCDirection::READ, true};
+  ipc::SHMChannel writer{name, ipc::IPCDirection::WRITE, false};
+
+  std::string payload{"test-payload"};
+
+  ipc::InvocationResult msg;
+  msg.invocation_id("id");
+  msg.return_code(42);
+  msg.buffer_length(payload.length());
+  writer.send(msg, BufferAccessor<const char>{payload.data(), payload.length()});
+
+  ipc::InvocationResult empty_msg;
+  empty_msg.invocation_id("id2");
+  writer.send(empty_msg);
+
+  {
+    auto [read, buf] = reader.receive();
+    ASSERT_TRUE(read);
+    EXPECT_EQ(buf.len, payload.length());
+    EXPECT_EQ(std::string_view(buf.data(), buf.len), payload);
+
+    auto parsed = reader.message().parse();
+    ASSERT_TRUE(std::holds_alternative<ipc::InvocationResultParsed>(parsed));
+    EXPECT_EQ(std::get<ipc::InvocationResultParsed>(parsed).invocation_id(), "id");
+    EXPECT_EQ(std::get<ipc::InvocationResultParsed>(parsed).return_code(), 42);
+  }
+
+  {
+    auto [read, buf] = reader.receive();
+    ASSERT_TRUE(read);
+    EXPECT_EQ(buf.len, 0);
+    EXPECT_EQ(reader.message().total_length(), 0);
+  }
+
+  {
+    auto [read, buf] = reader.receive();
+    EXPECT_FALSE(read);
+  }
+}
+
+TEST_F(SHMChannelTest, PayloadLargerThanRing)
+{
+  // Writer and reader must progress concurrently - the message wraps around the ring.
+  constexpr size_t RING_SIZE = 1024;
+  constexpr size_t PAYLOAD_SIZE = 64 * 1024 + 13;
+
+  ipc::SHMChannel writer{name, ipc::IPCDirection::WRITE, true, RING_SIZE};
+  ipc::SHMChannel reader{name, ipc::IPCDirection::READ, false};
+
+  std::vector<char> payload(PAYLOAD_SIZE);
+  std::iota(payload.begin(), payload.end(), 0);
+
+  // Controller side defers the data that does not fit into the ring.
+  std::thread sender{[&]() {
+    for (int i = 0; i < 3; ++i) {
+      ipc::PutRequest msg;
+      msg.name(fmt::format("msg-{}", i));
+      msg.data_len(payload.size());
+      writer.send(msg, BufferAccessor<const char>{payload.data(), payload.size()});
+    }
+    EXPECT_GT(writer.queued_bytes(), 0);
+    while (!writer.flush()) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    EXPECT_EQ(writer.queued_bytes(), 0);
+  }};
+
+  Buffer<std::byte> buf;
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(reader.blocking_receive(buf));
+    ASSERT_EQ(buf.len, PAYLOAD_SIZE);
+    // NOLINTNEXTLINE
+    EXPECT_TRUE(std::equal(payload.begin(), payload.end(), reinterpret_cast<char*>(buf.data())));
+
+    auto parsed = reader.message().parse();
+    ASSERT_TRUE(std::holds_alternative<ipc::PutRequestParsed>(parsed));
+    EXPECT_EQ(std::get<ipc::PutRequestParsed>(parsed).name(), fmt::format("msg-{}", i));
+  }
+
+  sender.join();
+}
+
+TEST_F(SHMChannelTest, PartialMessage)
+{
+  // Controller receives the message in parts, and never waits for the rest.
+  constexpr size_t RING_SIZE = 1024;
+  constexpr size_t PAYLOAD_SIZE = 16 * 1024 + 13;
+
+  ipc::SHMChannel reader{name, ipc::IPCDirection::READ, true, RING_SIZE};
+  ipc::SHMChannel writer{name, ipc::IPCDirection::WRITE, false};
+
+  std::vector<char> payload(PAYLOAD_SIZE);
+  std::iota(payload.begin(), payload.end(), 0);
+
+  ipc::PutRequest msg;
+  msg.name("partial");
+  msg.data_len(payload.size());
+
+  std::thread sender{[&]() {
+    writer.send(msg, BufferAccessor<const char>{payload.data(), payload.size()});
+  }};
+
+  int partial_reads = 0;
+  while (true) {
+    auto [read, buf] = reader.receive();
+    if (!read) {
+      ++partial_reads;
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      continue;
+    }
+
+    ASSERT_EQ(buf.len, PAYLOAD_SIZE);
+    EXPECT_TRUE(std::equal(payload.begin(), payload.end(), buf.data()));
+
+    auto parsed = reader.message().parse();
+    ASSERT_TRUE(std::holds_alternative<ipc::PutRequestParsed>(parsed));
+    EXPECT_EQ(std::get<ipc::PutRequestParsed>(parsed).name(), "partial");
+    break;
+  }
+  EXPECT_GT(partial_reads, 0);
+
+  sender.join();
+
+  auto [read, buf] = reader.receive();
+  EXPECT_FALSE(read);
+}
+
+TEST(SHMArenaTest, AllocateRelease)
+{
+  auto arena = ipc::SHMArena::create(4 * ipc::SHMArena::PAGE_SIZE);
+  EXPECT_EQ(arena->used_pages(), 0);
+
+  {
+    auto first = arena->allocate<char>(ipc::SHMArena::PAGE_SIZE + 1);
+    ASSERT_FALSE(first.null());
+    EXPECT_TRUE(first.shared());
+    EXPECT_TRUE(arena->contains(first.data()));
+    EXPECT_EQ(arena->used_pages(), 2);
+
+    auto second = arena->allocate<char>(2 * ipc::SHMArena::PAGE_SIZE);
+    ASSERT_FALSE(second.null());
+    EXPECT_EQ(arena->used_pages(), 4);
+
+    // Arena is full - caller falls back to the heap.
+    auto third = arena->allocate<char>(1);
+    EXPECT_TRUE(third.null());
+
+    // Reference passed to the other side.
+    char* second_ptr = second.data();
+    arena->acquire(second_ptr);
+    second = Buffer<char>{};
+    EXPECT_EQ(arena->used_pages(), 4);
+
+    arena->adopt<char>(arena->offset(second_ptr), 0);
+    EXPECT_EQ(arena->used_pages(), 2);
+  }
+
+  EXPECT_EQ(arena->used_pages(), 0);
+}
+
+TEST(SHMArenaTest, RetainedPages)
+{
+  // Up to two free pages stay backed by memory.
+  auto arena = ipc::SHMArena::create(8 * ipc::SHMArena::PAGE_SIZE, 2 * ipc::SHMArena::PAGE_SIZE);
+
+  auto resident = [&]() {
+    struct stat attributes {};
+    fstat(arena->fd(), &attributes);
+    return static_cast<size_t>(attributes.st_blocks) * 512;
+  };
+  size_t initial = resident();
+
+  {
+    auto small = arena->allocate<char>(ipc::SHMArena::PAGE_SIZE);
+    ASSERT_FALSE(small.null());
+  }
+  // Kept for the next allocation.
+  EXPECT_EQ(arena->used_pages(), 0);
+  EXPECT_EQ(arena->reserved_pages(), 1);
+
+  {
+    auto large = arena->allocate<char>(4 * ipc::SHMArena::PAGE_SIZE);
+    ASSERT_FALSE(large.null());
+    EXPECT_EQ(arena->reserved_pages(), 4);
+    EXPECT_GE(resident(), initial + 4 * ipc::SHMArena::PAGE_SIZE);
+  }
+  // Too many free pages - the memory is returned to the system.
+  EXPECT_EQ(arena->used_pages(), 0);
+  EXPECT_EQ(arena->reserved_pages(), 0);
+  EXPECT_EQ(resident(), initial);
+}
+
+TEST_F(SHMChannelTest, SharedBuffer)
+{
+  auto arena = ipc::SHMArena::create(16 * ipc::SHMArena::PAGE_SIZE);
+
+  ipc::SHMChannel writer{name, ipc::IPCDirection::WRITE, true, ipc::SHMChannel::RING_SIZE, arena};
+  // Maps the arena announced by the creator.
+  ipc::SHMChannel reader{name, ipc::IPCDirection::READ, false};
+  ASSERT_TRUE(reader.arena());
+
+  std::string payload{"shared-payload"};
+  auto buf = arena->allocate<char>(payload.length());
+  std::copy(payload.begin(), payload.end(), buf.data());
+  buf.len = payload.length();
+
+  ipc::PutRequest msg;
+  msg.name("shared");
+  msg.data_len(buf.len);
+  writer.send(msg, buf.accessor<const char>());
+
+  // Heap buffers are still copied.
+  writer.send(msg, BufferAccessor<const char>{payload.data(), payload.length()});
+
+  Buffer<std::byte> received;
+  ASSERT_TRUE(reader.blocking_receive(received));
+  ASSERT_EQ(received.len, payload.length());
+  EXPECT_TRUE(received.shared());
+
+  // Both sides see the same memory.
+  buf.data()[0] = 'S';
+  // NOLINTNEXTLINE
+  EXPECT_EQ(reinterpret_cast<char*>(received.data())[0], 'S');
+
+  // The shared block must not be overwritten by the next message.
+  ASSERT_TRUE(reader.blocking_receive(received));
+  EXPECT_FALSE(received.shared());
+  // NOLINTNEXTLINE
+  EXPECT_EQ(std::string_view(reinterpret_cast<char*>(received.data()), received.len), payload);
+  EXPECT_EQ(buf.data()[0], 'S');
+
+  EXPECT_EQ(arena->used_pages(), 1);
+  buf = Buffer<char>{};
+  EXPECT_EQ(arena->used_pages(), 0);
+}
+
+TEST(SHMArenaTest, InvalidLocation)
+{
+  auto arena = ipc::SHMArena::create(4 * ipc::SHMArena::PAGE_SIZE);
+
+  auto buf = arena->allocate<char>(ipc::SHMArena::PAGE_SIZE);
+  ASSERT_FALSE(buf.null());
+  size_t offset = arena->offset(buf.data());
+
+  // Outside of the arena, inside of a block, in a free page, and beyond the block.
+  EXPECT_THROW(arena->adopt<char>(arena->size(), 1), praas::common::InvalidMessage);
+  EXPECT_THROW(arena->adopt<char>(offset + 1, 1), praas::common::InvalidMessage);
+  EXPECT_THROW(
+      arena->adopt<char>(offset + ipc::SHMArena::PAGE_SIZE, 1), praas::common::InvalidMessage
+  );
+  EXPECT_THROW(
+      arena->adopt<char>(offset, ipc::SHMArena::PAGE_SIZE + 1), praas::common::InvalidMessage
+  );
+  EXPECT_THROW(arena->adopt<char>(offset, SIZE_MAX), praas::common::InvalidMessage);
+
+  // Rejected locations do not change the references.
+  EXPECT_EQ(arena->used_pages(), 1);
+  buf = Buffer<char>{};
+  EXPECT_EQ(arena->used_pages(), 0);
+}
+
+TEST_F(SHMChannelTest, InvalidSharedBuffer)
+{
+  auto arena = ipc::SHMArena::create(4 * ipc::SHMArena::PAGE_SIZE);
+
+  ipc::SHMChannel writer{name, ipc::IPCDirection::WRITE, true, ipc::SHMChannel::RING_SIZE, arena};
+  ipc::SHMChannel reader{name, ipc::IPCDirection::READ, false};
+
+  auto buf = arena->allocate<char>(ipc::SHMArena::PAGE_SIZE);
+  ASSERT_FALSE(buf.null());
+
+  // The peer announces a location in the middle of the block, and a length beyond it.
+  ipc::PutRequest msg;
+  msg.name("shared");
+  writer.send(msg, BufferAccessor<const char>{buf.data() + 1, 1});
+  writer.send(msg, BufferAccessor<const char>{buf.data(), 2 * ipc::SHMArena::PAGE_SIZE});
+
+  Buffer<std::byte> received;
+  EXPECT_THROW(reader.blocking_receive(received), praas::common::InvalidMessage);
+  EXPECT_THROW(reader.blocking_receive(received), praas::common::InvalidMessage);
+  EXPECT_TRUE(received.null());
+}
+
+TEST(POSIXMQChannelTest, DeferredSend)
+{
+  std::string name = fmt::format("/praas_test_mq_{}", getpid());
+  constexpr int MSG_SIZE = 1024;
+  // The queue holds POSIXMQChannel::MAX_MSGS messages - the rest must be deferred.
+  constexpr size_t PAYLOAD_SIZE = 16 * MSG_SIZE + 13;
+
+  ipc::POSIXMQChannel writer{name, ipc::IPCDirection::WRITE, false, true, MSG_SIZE};
+  ipc::POSIXMQChannel reader{name, ipc::IPCDirection::READ, true, false};
+
+  std::vector<char> payload(PAYLOAD_SIZE);
+  std::iota(payload.begin(), payload.end(), 0);
+
+  for (int i = 0; i < 2; ++i) {
+    ipc::PutRequest msg;
+    msg.name(fmt::format("msg-{}", i));
+    msg.data_len(payload.size());
+    writer.send(msg, BufferAccessor<const char>{payload.data(), payload.size()});
+  }
+
+  size_t total_size = 2 * (ipc::Message::BUF_SIZE + PAYLOAD_SIZE);
+  // Header is sent as a separate queue message.
+  size_t delivered = ipc::Message::BUF_SIZE + (ipc::POSIXMQChannel::MAX_MSGS - 1) * MSG_SIZE;
+  EXPECT_EQ(writer.queued_bytes(), total_size - delivered);
+  EXPECT_EQ(writer.max_queued_bytes(), writer.queued_bytes());
+  EXPECT_FALSE(writer.flush());
+
+  std::thread receiver{[&]() {
+    Buffer<std::byte> buf;
+    for (int i = 0; i < 2; ++i) {
+      ASSERT_TRUE(reader.blocking_receive(buf));
+      ASSERT_EQ(buf.len, PAYLOAD_SIZE);
+      // NOLINTNEXTLINE
+      EXPECT_TRUE(std::equal(payload.begin(), payload.end(), reinterpret_cast<char*>(buf.data())));
+
+      auto parsed = reader.message().parse();
+      ASSERT_TRUE(std::holds_alternative<ipc::PutRequestParsed>(parsed));
+      EXPECT_EQ(std::get<ipc::PutRequestParsed>(parsed).name(), fmt::format("msg-{}", i));
+    }
+  }};
+
+  while (!writer.flush()) {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  receiver.join();
+
+  EXPECT_EQ(writer.queued_bytes(), 0);
+  EXPECT_EQ(writer.max_queued_bytes(), total_size - delivered);
+}
+
+TEST(POSIXMQChannelTest, InlinePayload)
+{
+  std::string name = fmt::format("/praas_test_mq_{}", getpid());
+  constexpr int MSG_SIZE = 1024;
+
+  ipc::POSIXMQChannel writer{name, ipc::IPCDirection::WRITE, false, true, MSG_SIZE};
+  ipc::POSIXMQChannel reader{name, ipc::IPCDirection::READ, true, false};
+
+  // Header and payload are coalesced only if they fit in a single queue message.
+  std::string small_payload(MSG_SIZE - ipc::Message::BUF_SIZE, 'a');
+  std::string large_payload(MSG_SIZE, 'b');
+
+  ipc::InvocationResult msg;
+  msg.invocation_id("id");
+  writer.send(msg, BufferAccessor<const char>{small_payload.data(), small_payload.length()});
+
+  mq_attr attributes{};
+  ASSERT_EQ(mq_getattr(reader.fd(), &attributes), 0);
+  EXPECT_EQ(attributes.mq_curmsgs, 1);
+
+  writer.send(msg, BufferAccessor<const char>{large_payload.data(), large_payload.length()});
+  ASSERT_EQ(mq_getattr(reader.fd(), &attributes), 0);
+  EXPECT_EQ(attributes.mq_curmsgs, 3);
+
+  Buffer<std::byte> buf;
+  for (const std::string& payload : {small_payload, large_payload}) {
+    ASSERT_TRUE(reader.blocking_receive(buf));
+    ASSERT_EQ(buf.len, payload.length());
+    // NOLINTNEXTLINE
+    EXPECT_EQ(std::string_view(reinterpret_cast<char*>(buf.data()), buf.len), payload);
+  }
+
+  // Controller side receives the coalesced message in a single step.
+  ipc::POSIXMQChannel inline_writer{name + "_2", ipc::IPCDirection::WRITE, false, true, MSG_SIZE};
+  ipc::POSIXMQChannel inline_reader{name + "_2", ipc::IPCDirection::READ, false, false};
+
+  inline_writer.send(msg, BufferAccessor<const char>{small_payload.data(), small_payload.length()});
+
+  auto [read, recv_buf] = inline_reader.receive();
+  ASSERT_TRUE(read);
+  ASSERT_EQ(recv_buf.len, small_payload.length());
+  EXPECT_EQ(std::string_view(recv_buf.data(), recv_buf.len), small_payload);
+  EXPECT_EQ(inline_reader.message().total_length(), small_payload.length());
+}
+
+TEST_F(SHMChannelTest, SpinReceive)
+{
+  ipc::SHMChannel writer{name, ipc::IPCDirection::WRITE, true};
+  ipc::SHMChannel reader{name, ipc::IPCDirection::READ, false};
+  reader.spin_time(std::chrono::microseconds{1000});
+
+  // One message arrives while spinning, the other one after falling back to blocking.
+  std::thread sender{[&]() {
+    for (int delay : {100, 5000}) {
+      std::this_thread::sleep_for(std::chrono::microseconds{delay});
+      ipc::PutRequest msg;
+      msg.name(fmt::format("msg-{}", delay));
+      writer.send(msg);
+    }
+  }};
+
+  Buffer<std::byte> buf;
+  for (int delay : {100, 5000}) {
+    ASSERT_TRUE(reader.blocking_receive(buf));
+    auto parsed = reader.message().parse();
+    ASSERT_TRUE(std::holds_alternative<ipc::PutRequestParsed>(parsed));
+    EXPECT_EQ(std::get<ipc::PutRequestParsed>(parsed).name(), fmt::format("msg-{}", delay));
+  }
+
+  sender.join();
+}
+
+TEST_F(SHMChannelTest, SignalDuringReceive)
+{
+  ipc::SHMChannel writer{name, ipc::IPCDirection::WRITE, true};
+  ipc::SHMChannel reader{name, ipc::IPCDirection::READ, false};
+
+  // Without SA_RESTART, the signal interrupts the wait for the doorbell.
+  struct sigaction action{};
+  struct sigaction old_action{};
+  action.sa_handler = [](int) {};
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = 0;
+  sigaction(SIGUSR1, &action, &old_action);
+
+  pthread_t receiver = pthread_self();
+  std::thread sender{[&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    pthread_kill(receiver, SIGUSR1);
+    std::this_thread::sleep_for(std::chrono::milliseconds{5});
+
+    ipc::PutRequest msg;
+    msg.name("msg");
+    writer.send(msg);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    reader.interrupt();
+  }};
+
+  Buffer<std::byte> buf;
+  ASSERT_TRUE(reader.blocking_receive(buf));
+  auto parsed = reader.message().parse();
+  ASSERT_TRUE(std::holds_alternative<ipc::PutRequestParsed>(parsed));
+  EXPECT_EQ(std::get<ipc::PutRequestParsed>(parsed).name(), "msg");
+
+  // Only an explicit interrupt stops the receive.
+  EXPECT_THROW(reader.blocking_receive(buf), praas::common::PraaSException);
+
+  sender.join();
+  sigaction(SIGUSR1, &old_action, nullptr);
+}
+
+TEST(POSIXMQChannelTest, SpinReceive)
+{
+  std::string name = fmt::format("/praas_test_mq_{}", getpid());
+
+  ipc::POSIXMQChannel writer{name, ipc::IPCDirection::WRITE, false, true};
+  ipc::POSIXMQChannel reader{name, ipc::IPCDirection::READ, true, false};
+  reader.spin_time(std::chrono::microseconds{1000});
+
+  std::string payload{"test-payload"};
+
+  std::thread sender{[&]() {
+    for (int delay : {100, 5000}) {
+      std::this_thread::sleep_for(std::chrono::microseconds{delay});
+      ipc::PutRequest msg;
+      msg.name(fmt::format("msg-{}", delay));
+      writer.send(msg, BufferAccessor<const char>{payload.data(), payload.length()});
+    }
+  }};
+
+  Buffer<std::byte> buf;
+  for (int delay : {100, 5000}) {
+    ASSERT_TRUE(reader.blocking_receive(buf));
+    ASSERT_EQ(buf.len, payload.length());
+    auto parsed = reader.message().parse();
+    ASSERT_TRUE(std::holds_alternative<ipc::PutRequestParsed>(parsed));
+    EXPECT_EQ(std::get<ipc::PutRequestParsed>(parsed).name(), fmt::format("msg-{}", delay));
+  }
+
+  sender.join();
+}
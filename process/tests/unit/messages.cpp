@@ -131,12 +131,14 @@ TEST(IPCMessagesInvocTest, InvocMessage)
     std::string proc_id(GetRequest::ID_LENGTH, 'x');
     std::string invoc_id(GetRequest::ID_LENGTH, 't');
     std::string func_name(GetRequest::NAME_LENGTH, 's');
-    std::array<int, 5> buffers = {5, 42, 0, 1, 32};
+    std::string caller_id(GetRequest::ID_LENGTH, 'c');
+    std::array<int, InvocationRequest::MAX_BUFFERS> buffers = {5, 42, 0, 1, 32, 7, 8, 9};
 
     InvocationRequest req;
     req.process_id(proc_id);
     req.invocation_id(invoc_id);
     req.function_name(func_name);
+    req.caller_id(caller_id);
     req.buffers(buffers.begin(), buffers.end());
     req.total_length(42);
 
@@ -146,6 +148,7 @@ TEST(IPCMessagesInvocTest, InvocMessage)
     EXPECT_EQ(req.function_name(), func_name);
     EXPECT_EQ(req.buffers(), buffers.size());
     EXPECT_EQ(req.total_length(), 42);
+    EXPECT_EQ(req.caller_id(), caller_id);
     EXPECT_THAT(buffers, testing::ElementsAreArray(req.buffers_lengths(), req.buffers()));
   }
 }
@@ -158,6 +161,7 @@ TEST(IPCMessagesInvocTest, InvocMessageIncorrect)
 
   InvocationRequest req;
   EXPECT_THROW(req.invocation_id(invoc_id), praas::common::InvalidArgument);
+  EXPECT_THROW(req.caller_id(invoc_id), praas::common::InvalidArgument);
   EXPECT_THROW(req.function_name(func_name), praas::common::InvalidArgument);
   EXPECT_THROW(req.buffers(buffers.begin(), buffers.end()), praas::common::InvalidArgument);
 }
@@ -173,6 +177,7 @@ TEST(IPCMessagesInvocTest, InvocMessageParse)
   req.process_id(proc_id);
   req.invocation_id(invoc_id);
   req.function_name(func_name);
+  req.caller_id("caller-id");
   req.buffers(buffers.begin(), buffers.end());
   req.total_length(42);
 
@@ -189,6 +194,7 @@ TEST(IPCMessagesInvocTest, InvocMessageParse)
             EXPECT_EQ(req.process_id(), proc_id);
             EXPECT_EQ(req.invocation_id(), invoc_id);
             EXPECT_EQ(req.function_name(), func_name);
+            EXPECT_EQ(req.caller_id(), "caller-id");
             EXPECT_EQ(req.buffers(), buffers.size());
             EXPECT_THAT(buffers, testing::ElementsAreArray(req.buffers_lengths(), req.buffers()));
 
@@ -0,0 +1,129 @@
+#include <praas/process/controller/mpsc_queue.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace praas::process;
+
+TEST(MPSCQueue, PushPop)
+{
+  MPSCQueue<int> queue{3};
+  EXPECT_EQ(queue.capacity(), 4U);
+
+  int value = 0;
+  EXPECT_FALSE(queue.try_pop(value));
+
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.try_push(i));
+  }
+  // Full queue
+  EXPECT_FALSE(queue.try_push(4));
+
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(queue.try_pop(value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_FALSE(queue.try_pop(value));
+
+  // Cells are reused in the next round.
+  EXPECT_TRUE(queue.try_push(5));
+  ASSERT_TRUE(queue.try_pop(value));
+  EXPECT_EQ(value, 5);
+}
+
+TEST(MPSCQueue, ManyProducers)
+{
+  constexpr int PRODUCERS = 4;
+  constexpr int MESSAGES = 10000;
+
+  MPSCQueue<std::pair<int, int>> queue{64};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < PRODUCERS; ++i) {
+    threads.emplace_back([&queue, i]() {
+      for (int j = 0; j < MESSAGES; ++j) {
+        while (!queue.try_push(i, j)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  // Messages of each producer arrive in order.
+  std::vector<int> expected(PRODUCERS, 0);
+  int received = 0;
+  std::pair<int, int> value;
+  while (received < PRODUCERS * MESSAGES) {
+    if (queue.try_pop(value)) {
+      EXPECT_EQ(value.second, expected[value.first]);
+      expected[value.first]++;
+      received++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int i = 0; i < PRODUCERS; ++i) {
+    EXPECT_EQ(expected[i], MESSAGES);
+  }
+}
+
+TEST(MPSCQueue, BlockingPush)
+{
+  MPSCQueue<int> queue{2};
+  EXPECT_TRUE(queue.push(0));
+  EXPECT_TRUE(queue.push(1));
+
+  // Full queue - the producer waits until the consumer makes space.
+  std::atomic<bool> pushed{};
+  std::thread producer{[&]() {
+    EXPECT_TRUE(queue.push(2));
+    pushed = true;
+  }};
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(pushed);
+
+  int value = 0;
+  ASSERT_TRUE(queue.try_pop(value));
+  EXPECT_EQ(value, 0);
+  queue.wake_producers();
+  producer.join();
+  EXPECT_TRUE(pushed);
+
+  for (int i = 1; i < 3; ++i) {
+    ASSERT_TRUE(queue.try_pop(value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_FALSE(queue.try_pop(value));
+}
+
+TEST(MPSCQueue, CloseReleasesProducers)
+{
+  MPSCQueue<int> queue{2};
+  EXPECT_TRUE(queue.push(0));
+  EXPECT_TRUE(queue.push(1));
+
+  std::thread producer{[&]() { EXPECT_FALSE(queue.push(2)); }};
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  queue.close();
+  producer.join();
+
+  // Closed queue does not block, and it is still consumed.
+  EXPECT_FALSE(queue.push(3));
+
+  int value = 0;
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_TRUE(queue.try_pop(value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_FALSE(queue.try_pop(value));
+}
@@ -0,0 +1,569 @@
+#include <praas/process/controller/workers.hpp>
+#include <praas/process/runtime/internal/functions.hpp>
+
+#include <sstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using namespace praas::process;
+using namespace praas::process::runtime::internal;
+using praas::common::message::Priority;
+
+class WorkQueueTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    std::string config = R"(
+      {
+        "functions": {
+          "cpp": {
+            "first": {
+              "code": { "module": "libtest.so", "function": "first" },
+              "trigger": { "type": "direct", "nargs": 1 }
+            },
+            "second": {
+              "code": { "module": "libtest.so", "function": "second" },
+              "trigger": { "type": "direct", "nargs": 1 },
+              "timeout-ms": 500
+            },
+            "batched": {
+              "code": { "module": "libtest.so", "function": "batched" },
+              "trigger": { "type": "batch", "size": 3, "max-wait-us": 1000000 }
+            },
+            "reduce": {
+              "code": { "module": "libtest.so", "function": "reduce" },
+              "trigger": { "type": "multi-source", "sources": ["map_1", "map_2"] }
+            },
+            "reduce_any": {
+              "code": { "module": "libtest.so", "function": "reduce_any" },
+              "trigger": { "type": "multi-source", "nargs": 2 }
+            },
+            "dependent": {
+              "code": { "module": "libtest.so", "function": "dependent" },
+              "trigger": { "type": "dependency", "functions": ["first"], "state": ["key"] }
+            },
+            "bounded": {
+              "code": { "module": "libtest.so", "function": "bounded" },
+              "trigger": { "type": "dependency", "functions": ["first"], "max-outputs": 1 }
+            },
+            "limited": {
+              "code": { "module": "libtest.so", "function": "limited" },
+              "trigger": { "type": "direct", "nargs": 1 },
+              "max-concurrency": 2
+            },
+            "reserved": {
+              "code": { "module": "libtest.so", "function": "reserved" },
+              "trigger": { "type": "direct", "nargs": 1 },
+              "reserved-workers": 1
+            }
+          }
+        }
+      }
+    )";
+    std::stringstream stream{config};
+    functions.initialize(stream, Language::CPP);
+  }
+
+  void add(const std::string& fname, const std::string& key)
+  {
+    auto res = queue.add_payload(
+        fname, key, Buffer<char>{new char[1], 1, 1}, InvocationSource::from_local()
+    );
+    ASSERT_FALSE(res.has_value());
+  }
+
+  void add_scheduled(const std::string& fname, const std::string& key, InvocationScheduling sched)
+  {
+    auto res = queue.add_payload(
+        fname, key, Buffer<char>{new char[1], 1, 1}, InvocationSource::from_local(), sched
+    );
+    ASSERT_FALSE(res.has_value());
+  }
+
+  void expect_order(const std::vector<std::string>& expected)
+  {
+    for (const auto& key : expected) {
+      Invocation* invoc = queue.next();
+      ASSERT_NE(invoc, nullptr);
+      EXPECT_EQ(invoc->req.invocation_id(), key);
+    }
+    EXPECT_TRUE(queue.empty());
+  }
+
+  std::optional<std::string> add_from(
+      const std::string& fname, const std::string& key, char value, InvocationSource source
+  )
+  {
+    Buffer<char> buf{new char[1], 1, 1};
+    buf.data()[0] = value;
+    return queue.add_payload(fname, key, std::move(buf), std::move(source));
+  }
+
+  Functions functions;
+  WorkQueue queue{functions};
+};
+
+TEST_F(WorkQueueTest, UnknownFunction)
+{
+  auto res = queue.add_payload("unknown", "key", Buffer<char>{}, InvocationSource::from_local());
+  EXPECT_TRUE(res.has_value());
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(queue.next(), nullptr);
+}
+
+TEST_F(WorkQueueTest, RoundRobin)
+{
+  add("first", "1");
+  add("first", "2");
+  add("first", "3");
+  add("second", "4");
+  EXPECT_EQ(queue.ready_invocations(), 4U);
+
+  // Functions take turns, invocations of one function stay in order.
+  std::vector<std::string> expected{"1", "4", "2", "3"};
+  for (const auto& key : expected) {
+    Invocation* invoc = queue.next();
+    ASSERT_NE(invoc, nullptr);
+    EXPECT_EQ(invoc->req.invocation_id(), key);
+    invoc->active = true;
+  }
+  EXPECT_EQ(queue.next(), nullptr);
+  EXPECT_TRUE(queue.empty());
+
+  for (const auto& key : expected) {
+    auto invoc = queue.finish(key);
+    ASSERT_TRUE(invoc.has_value());
+    EXPECT_EQ(invoc->payload.size(), 1U);
+  }
+  EXPECT_FALSE(queue.finish("1").has_value());
+}
+
+TEST_F(WorkQueueTest, FinishPending)
+{
+  add("first", "1");
+
+  // Not dispatched yet.
+  EXPECT_FALSE(queue.finish("1").has_value());
+
+  Invocation* invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  invoc->active = true;
+  EXPECT_TRUE(queue.finish("1").has_value());
+
+  // The function can be scheduled again.
+  add("first", "2");
+  invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "2");
+}
+
+TEST_F(WorkQueueTest, Defer)
+{
+  add("first", "1");
+  add("first", "2");
+  add("second", "3");
+
+  // The deferred invocation stays first for its function, but other functions go before it.
+  Invocation* invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "1");
+  queue.defer(*invoc);
+  EXPECT_EQ(queue.ready_invocations(), 3U);
+  EXPECT_EQ(queue.ready_functions(), 2U);
+
+  std::vector<std::string> expected{"3", "1", "2"};
+  for (const auto& key : expected) {
+    invoc = queue.next();
+    ASSERT_NE(invoc, nullptr);
+    EXPECT_EQ(invoc->req.invocation_id(), key);
+  }
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(queue.ready_invocations(), 0U);
+}
+
+TEST_F(WorkQueueTest, Batch)
+{
+  // Incomplete batch waits for more invocations.
+  add("batched", "1");
+  add("batched", "2");
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(queue.ready_invocations(), 0U);
+  EXPECT_EQ(queue.next(), nullptr);
+  EXPECT_TRUE(queue.next_batch_deadline().has_value());
+
+  add("batched", "3");
+  add("batched", "4");
+  EXPECT_EQ(queue.ready_invocations(), 4U);
+  EXPECT_FALSE(queue.next_batch_deadline().has_value());
+
+  Invocation* invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "1");
+  ASSERT_EQ(invoc->batch.size(), 2U);
+  EXPECT_EQ(invoc->batch[0]->req.invocation_id(), "2");
+  EXPECT_EQ(invoc->batch[1]->req.invocation_id(), "3");
+
+  // The remaining invocation waits for the deadline.
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(queue.ready_invocations(), 0U);
+
+  // The whole batch returns to the queue.
+  queue.defer(*invoc);
+  EXPECT_TRUE(invoc->batch.empty());
+  EXPECT_EQ(queue.ready_invocations(), 4U);
+
+  invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "1");
+  EXPECT_EQ(invoc->batch.size(), 2U);
+  invoc->active = true;
+  for (Invocation* batched : invoc->batch) {
+    batched->active = true;
+  }
+
+  // Waiting for too long dispatches an incomplete batch.
+  auto deadline = queue.next_batch_deadline();
+  ASSERT_TRUE(deadline.has_value());
+  queue.schedule_batches(deadline.value());
+  EXPECT_EQ(queue.ready_invocations(), 1U);
+
+  Invocation* last = queue.next();
+  ASSERT_NE(last, nullptr);
+  EXPECT_EQ(last->req.invocation_id(), "4");
+  EXPECT_TRUE(last->batch.empty());
+  EXPECT_TRUE(queue.empty());
+
+  for (const auto& key : {"1", "2", "3"}) {
+    EXPECT_TRUE(queue.finish(key).has_value());
+  }
+}
+
+TEST_F(WorkQueueTest, MultiSource)
+{
+  // Arguments follow the order of sources, not of arrival.
+  EXPECT_FALSE(add_from("reduce", "1", 'b', InvocationSource::from_process("map_2")).has_value());
+  EXPECT_TRUE(queue.empty());
+
+  // Unknown and repeated sources are rejected.
+  EXPECT_TRUE(add_from("reduce", "1", 'x', InvocationSource::from_local("other")).has_value());
+  EXPECT_TRUE(add_from("reduce", "1", 'x', InvocationSource::from_dataplane()).has_value());
+  EXPECT_TRUE(add_from("reduce", "1", 'x', InvocationSource::from_process("map_2")).has_value());
+  EXPECT_TRUE(add_from("reduce", "2", 'x', InvocationSource::from_local()).has_value());
+  EXPECT_TRUE(queue.empty());
+
+  EXPECT_FALSE(add_from("reduce", "1", 'a', InvocationSource::from_local("map_1")).has_value());
+  EXPECT_EQ(queue.ready_invocations(), 1U);
+
+  Invocation* invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "1");
+  ASSERT_EQ(invoc->payload.size(), 2U);
+  EXPECT_EQ(invoc->payload[0].data()[0], 'a');
+  EXPECT_EQ(invoc->payload[1].data()[0], 'b');
+
+  // The remote caller receives the result too.
+  EXPECT_EQ(invoc->source.remote_process, "map_2");
+  EXPECT_TRUE(invoc->remote_callers.empty());
+
+  // Any sources.
+  EXPECT_FALSE(add_from("reduce_any", "3", 'a', InvocationSource::from_dataplane()).has_value());
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(add_from("reduce_any", "3", 'b', InvocationSource::from_process("p")).has_value());
+
+  invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "3");
+  ASSERT_EQ(invoc->payload.size(), 2U);
+  EXPECT_EQ(invoc->payload[0].data()[0], 'a');
+  EXPECT_EQ(invoc->payload[1].data()[0], 'b');
+  ASSERT_EQ(invoc->remote_callers.size(), 1U);
+  EXPECT_EQ(invoc->remote_callers[0].remote_process, "p");
+}
+
+TEST_F(WorkQueueTest, Dependency)
+{
+  add("dependent", "1");
+  add("dependent", "2");
+  EXPECT_TRUE(queue.empty());
+
+  // Each invocation consumes one output of the upstream function.
+  char output = 'a';
+  queue.function_produced("first", BufferAccessor<const char>{&output, 1});
+  EXPECT_TRUE(queue.empty());
+
+  queue.state_produced("other");
+  EXPECT_TRUE(queue.empty());
+
+  queue.state_produced("key");
+  EXPECT_EQ(queue.ready_invocations(), 1U);
+
+  Invocation* invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "1");
+  ASSERT_EQ(invoc->payload.size(), 2U);
+  EXPECT_EQ(invoc->payload[1].data()[0], 'a');
+  EXPECT_TRUE(queue.empty());
+
+  // Outputs produced before the invocation are kept for it.
+  output = 'b';
+  queue.function_produced("first", BufferAccessor<const char>{&output, 1});
+  output = 'c';
+  queue.function_produced("first", BufferAccessor<const char>{&output, 1});
+
+  invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "2");
+  EXPECT_EQ(invoc->payload[1].data()[0], 'b');
+
+  add("dependent", "3");
+  invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "3");
+  EXPECT_EQ(invoc->payload[1].data()[0], 'c');
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(WorkQueueTest, DependencyBacklog)
+{
+  // Outputs needed by waiting invocations are kept.
+  add("bounded", "1");
+  add("bounded", "2");
+  queue.state_produced("key");
+
+  char output = 'a';
+  queue.function_produced("first", BufferAccessor<const char>{&output, 1});
+  output = 'b';
+  queue.function_produced("first", BufferAccessor<const char>{&output, 1});
+  EXPECT_EQ(queue.ready_invocations(), 2U);
+
+  Invocation* invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->payload[1].data()[0], 'a');
+  invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->payload[1].data()[0], 'b');
+
+  // Without waiting invocations, only the newest output is kept.
+  for (char c : {'c', 'd', 'e'}) {
+    output = c;
+    queue.function_produced("first", BufferAccessor<const char>{&output, 1});
+  }
+
+  add("bounded", "3");
+  invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->payload[1].data()[0], 'e');
+
+  add("bounded", "4");
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(WorkQueueTest, Priority)
+{
+  add_scheduled("first", "1", {Priority::LOW});
+  add_scheduled("second", "2", {Priority::NORMAL});
+  add_scheduled("first", "3", {Priority::HIGH});
+  add("second", "4");
+  EXPECT_EQ(queue.ready_invocations(), 4U);
+  EXPECT_EQ(queue.ready_functions(), 3U);
+
+  // Higher classes go first, the same function can wait in many classes.
+  expect_order({"3", "2", "4", "1"});
+  EXPECT_EQ(queue.ready_invocations(), 0U);
+}
+
+TEST_F(WorkQueueTest, Aging)
+{
+  add_scheduled("first", "1", {Priority::LOW});
+  auto low_added = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds{2});
+  add("second", "2");
+  add("second", "3");
+
+  // Nothing waited long enough.
+  queue.age(low_added);
+  EXPECT_EQ(queue.ready_functions(), 2U);
+
+  // Only the low invocation waited for the aging period - it joins the normal class.
+  queue.age(low_added + WorkQueue::DEFAULT_AGING + std::chrono::milliseconds{1});
+  EXPECT_EQ(queue.ready_invocations(), 3U);
+  expect_order({"2", "1", "3"});
+}
+
+TEST_F(WorkQueueTest, Deadline)
+{
+  auto now = std::chrono::steady_clock::now();
+
+  // Deadline closer than the aging period - starts in the highest class.
+  add("second", "1");
+  add_scheduled("first", "2", {Priority::LOW, now + WorkQueue::DEFAULT_AGING / 2});
+  expect_order({"2", "1"});
+
+  // Distant deadline - the invocation moves to the highest class when it gets close.
+  auto deadline = now + std::chrono::seconds{10};
+  add_scheduled("first", "3", {Priority::LOW, deadline});
+  add_scheduled("second", "4", {Priority::HIGH});
+  add("second", "5");
+
+  queue.age(now);
+  queue.age(deadline - WorkQueue::DEFAULT_AGING / 2);
+  expect_order({"4", "3", "5"});
+}
+
+TEST_F(WorkQueueTest, DeadlineBehindHead)
+{
+  auto now = std::chrono::steady_clock::now();
+  auto deadline = now + WorkQueue::DEFAULT_AGING * 3 / 2;
+
+  // The invocation approaching its deadline waits behind another one of the same class.
+  add_scheduled("first", "1", {Priority::LOW});
+  add_scheduled("first", "2", {Priority::LOW, deadline});
+  add("second", "3");
+  auto urgent = queue.next_urgent_deadline();
+  ASSERT_TRUE(urgent.has_value());
+  EXPECT_EQ(urgent.value(), deadline - WorkQueue::DEFAULT_AGING);
+
+  // Neither waited for the aging period, but the deadline is already close.
+  queue.age(now + WorkQueue::DEFAULT_AGING * 3 / 4);
+  EXPECT_FALSE(queue.next_urgent_deadline().has_value());
+  EXPECT_EQ(queue.ready_invocations(), 3U);
+  expect_order({"2", "3", "1"});
+}
+
+TEST_F(WorkQueueTest, ConcurrencyLimit)
+{
+  add("limited", "1");
+  add("limited", "2");
+  add("limited", "3");
+  add("first", "4");
+
+  std::vector<std::string> expected{"1", "4", "2"};
+  for (const auto& key : expected) {
+    Invocation* invoc = queue.next();
+    ASSERT_NE(invoc, nullptr);
+    EXPECT_EQ(invoc->req.invocation_id(), key);
+    invoc->active = true;
+  }
+
+  // Two invocations are running - the third one waits.
+  EXPECT_EQ(queue.ready_invocations(), 0U);
+  EXPECT_EQ(queue.next(), nullptr);
+
+  EXPECT_TRUE(queue.finish("1").has_value());
+  EXPECT_EQ(queue.ready_invocations(), 1U);
+
+  Invocation* invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "3");
+
+  // A deferred invocation does not take a slot.
+  queue.defer(*invoc);
+  invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "3");
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(WorkQueueTest, ReservedWorkers)
+{
+  add("first", "1");
+  add("first", "2");
+
+  // The last idle worker is kept for the function with a reservation.
+  Invocation* invoc = queue.next(2);
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "1");
+  EXPECT_EQ(queue.next(1), nullptr);
+  EXPECT_EQ(queue.ready_invocations(), 1U);
+
+  add("reserved", "3");
+  invoc = queue.next(1);
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "3");
+
+  // The reservation is used - other functions can take the remaining workers.
+  invoc = queue.next(1);
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "2");
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(WorkQueueTest, Timeout)
+{
+  add("first", "1");
+  add("second", "2");
+  InvocationScheduling sched{Priority::NORMAL, std::nullopt, std::chrono::milliseconds{100}};
+  add_scheduled("second", "3", sched);
+
+  // Requested timeout overrides the one of the function.
+  std::vector<std::pair<std::string, int>> expected{{"1", 0}, {"2", 500}, {"3", 100}};
+  for (const auto& [key, timeout] : expected) {
+    Invocation* invoc = queue.next();
+    ASSERT_NE(invoc, nullptr);
+    EXPECT_EQ(invoc->req.invocation_id(), key);
+    EXPECT_EQ(invoc->timeout.count(), timeout);
+  }
+}
+
+TEST_F(WorkQueueTest, Cancel)
+{
+  add("first", "1");
+  add("first", "2");
+  add("second", "3");
+  add("dependent", "4");
+  EXPECT_EQ(queue.ready_invocations(), 3U);
+
+  // Ready invocations - the second function has no other ones and leaves the round-robin.
+  EXPECT_TRUE(queue.cancel("2").has_value());
+  EXPECT_TRUE(queue.cancel("3").has_value());
+  EXPECT_EQ(queue.ready_invocations(), 1U);
+
+  // Invocation waiting for its dependencies.
+  EXPECT_TRUE(queue.cancel("4").has_value());
+  EXPECT_FALSE(queue.cancel("4").has_value());
+
+  Invocation* invoc = queue.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "1");
+  invoc->active = true;
+  EXPECT_TRUE(queue.empty());
+
+  // Running invocations are stopped with their worker.
+  EXPECT_FALSE(queue.cancel("1").has_value());
+  EXPECT_TRUE(queue.finish("1").has_value());
+}
+
+TEST_F(WorkQueueTest, Admission)
+{
+  praas::process::config::Admission admission{3, 5, 150};
+  WorkQueue limited{functions, WorkQueue::DEFAULT_AGING, admission};
+  auto add_to = [&](const std::string& fname, const std::string& key) {
+    Buffer<char> buf{new char[1], 1, 1};
+    return limited.add_payload(fname, key, std::move(buf), InvocationSource::from_local());
+  };
+
+  EXPECT_FALSE(add_to("first", "1").has_value());
+  EXPECT_FALSE(add_to("reduce_any", "2").has_value());
+  EXPECT_FALSE(add_to("first", "3").has_value());
+  EXPECT_EQ(limited.queued_invocations(), 3U);
+  EXPECT_EQ(limited.queued_bytes(), 3U);
+
+  // New invocations are rejected, but the pending one can receive payload within the bytes.
+  EXPECT_TRUE(limited.admit("4", 1, 0, 1).has_value());
+  EXPECT_FALSE(limited.admit("2", 1, 0, 1).has_value());
+  EXPECT_TRUE(limited.admit("2", 1, 2, 1).has_value());
+
+  Invocation* invoc = limited.next();
+  ASSERT_NE(invoc, nullptr);
+  EXPECT_EQ(invoc->req.invocation_id(), "1");
+  invoc->active = true;
+  invoc->dispatched = std::chrono::steady_clock::now() - std::chrono::milliseconds{100};
+  EXPECT_EQ(limited.queued_invocations(), 2U);
+  EXPECT_TRUE(limited.finish("1").has_value());
+  EXPECT_EQ(limited.queued_bytes(), 2U);
+
+  // Two invocations of 100 ms wait for one worker, or for two of them.
+  EXPECT_TRUE(limited.admit("4", 1, 0, 1).has_value());
+  EXPECT_FALSE(limited.admit("4", 1, 0, 2).has_value());
+}
@@ -16,6 +16,9 @@ namespace praas::sdk {
     size_t payload_len;
 
     std::string error_message{};
+
+    // The process rejected the invocation without running it - it can be retried later.
+    bool overloaded{};
   };
 
   struct ControlPlaneInvocationResult {
@@ -27,6 +30,9 @@ namespace praas::sdk {
     std::string response;
 
     std::string error_message{};
+
+    // The process rejected the invocation without running it - it can be retried later.
+    bool overloaded{};
   };
 
 } // namespace praas::sdk
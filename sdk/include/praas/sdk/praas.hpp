@@ -23,7 +23,10 @@ namespace praas::sdk {
 
     ControlPlaneInvocationResult invoke(
         const std::string& app_name, const std::string& function_name,
-        const std::string& invocation_data
+        const std::string& invocation_data,
+        common::message::Priority priority = common::message::Priority::NORMAL,
+        std::chrono::milliseconds deadline = std::chrono::milliseconds{0},
+        std::chrono::milliseconds timeout = std::chrono::milliseconds{0}
     );
 
     std::string_view last_error() const;
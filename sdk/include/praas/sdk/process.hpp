@@ -1,8 +1,13 @@
 #ifndef PRAAS_SDK_PROCESS_HPP
 #define PRAAS_SDK_PROCESS_HPP
 
+#include <praas/common/messages.hpp>
 #include <praas/sdk/invocation.hpp>
 
+#include <chrono>
+#include <memory>
+#include <mutex>
+
 #include <sockpp/stream_socket.h>
 #include <sockpp/tcp_connector.h>
 
@@ -25,7 +30,18 @@ namespace praas::sdk {
 
     void disconnect();
 
-    InvocationResult invoke(std::string_view function_name, std::string invocation_id, char* ptr, size_t len);
+    // A deadline of zero means that the invocation has none.
+    // A timeout of zero uses the timeout of the function.
+    InvocationResult invoke(
+        std::string_view function_name, std::string invocation_id, char* ptr, size_t len,
+        common::message::Priority priority = common::message::Priority::NORMAL,
+        std::chrono::milliseconds deadline = std::chrono::milliseconds{0},
+        std::chrono::milliseconds timeout = std::chrono::milliseconds{0}
+    );
+
+    // The invocation returns an error. Can be called from another thread
+    // while invoke waits for the result.
+    void cancel(std::string_view invocation_id);
 
     sockpp::tcp_connector& connection()
     {
@@ -40,6 +56,10 @@ namespace praas::sdk {
 
     sockpp::tcp_connector _dataplane;
 
+    // Serializes messages written by invoke and cancel - a message can be written in parts.
+    // Behind a pointer to keep the process movable.
+    std::unique_ptr<std::mutex> _write_lock = std::make_unique<std::mutex>();
+
   };
 
 }
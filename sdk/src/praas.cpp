@@ -74,7 +74,8 @@ namespace praas::sdk {
 
   ControlPlaneInvocationResult PraaS::invoke(
       const std::string& app_name, const std::string& function_name,
-      const std::string& invocation_data
+      const std::string& invocation_data, common::message::Priority priority,
+      std::chrono::milliseconds deadline, std::chrono::milliseconds timeout
   )
   {
     std::promise<void> p;
@@ -85,10 +86,31 @@ namespace praas::sdk {
     req->setPath(fmt::format("/apps/{}/invoke/{}", app_name, function_name));
     req->setBody(invocation_data);
     req->setContentTypeCode(drogon::ContentType::CT_APPLICATION_JSON);
+    if (priority != common::message::Priority::NORMAL) {
+      req->setParameter("priority", std::string{common::message::priority_name(priority)});
+    }
+    if (deadline.count() > 0) {
+      req->setParameter("deadline", std::to_string(deadline.count()));
+    }
+    if (timeout.count() > 0) {
+      req->setParameter("timeout", std::to_string(timeout.count()));
+    }
 
     _http_client->sendRequest(
         req,
         [&](drogon::ReqResult result, const drogon::HttpResponsePtr& response) {
+          if (result == drogon::ReqResult::Ok &&
+              response->getStatusCode() == drogon::k503ServiceUnavailable) {
+            auto json = response->getJsonObject();
+            res.invocation_id = (*json)["invocation_id"].asString();
+            res.return_code = (*json)["return_code"].asInt();
+            res.error_message = (*json)["result"].asString();
+            res.overloaded = true;
+
+            p.set_value();
+            return;
+          }
+
           if (result != drogon::ReqResult::Ok || response->getStatusCode() != drogon::k200OK) {
             res.return_code = 1;
             auto json = response->getJsonObject();
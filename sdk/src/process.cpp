@@ -55,8 +55,11 @@ namespace praas::sdk {
     return result.process_name() == "CORRECT";
   }
 
-  InvocationResult
-  Process::invoke(std::string_view function_name, std::string invocation_id, char* ptr, size_t len)
+  InvocationResult Process::invoke(
+      std::string_view function_name, std::string invocation_id, char* ptr, size_t len,
+      common::message::Priority priority, std::chrono::milliseconds deadline,
+      std::chrono::milliseconds timeout
+  )
   {
     if (!_dataplane.is_connected()) {
       throw common::InvalidProcessState("Not connected!");
@@ -65,10 +68,17 @@ namespace praas::sdk {
     msg.function_name(function_name);
     msg.invocation_id(invocation_id);
     msg.payload_size(len);
-
-    _dataplane.write_n(msg.bytes(), msg.BUF_SIZE);
-    if (len > 0) {
-      _dataplane.write_n(ptr, len);
+    msg.priority(priority);
+    msg.deadline_ms(static_cast<int32_t>(deadline.count()));
+    msg.timeout_ms(static_cast<int32_t>(timeout.count()));
+
+    {
+      std::unique_lock<std::mutex> lock{*_write_lock};
+      if (!common::sockets::write_message(
+              _dataplane.handle(), msg.bytes(), msg.BUF_SIZE, ptr, len
+          )) {
+        throw common::InvalidProcessState("Failed to send the invocation!");
+      }
     }
 
     praas::common::message::MessageData response;
@@ -90,10 +100,28 @@ namespace praas::sdk {
 
     if (result.return_code() < 0) {
       // We failed - the payload contains the error message
-      return {result.return_code() * -1, nullptr, 0, std::string{payload.get(), payload_bytes}};
+      return {
+          result.return_code() * -1, nullptr, 0, std::string{payload.get(), payload_bytes},
+          result.return_code() == common::message::InvocationResultData::OVERLOADED};
     }
 
     return {result.return_code(), std::move(payload), payload_bytes};
   }
 
+  void Process::cancel(std::string_view invocation_id)
+  {
+    if (!_dataplane.is_connected()) {
+      throw common::InvalidProcessState("Not connected!");
+    }
+    praas::common::message::InvocationCancelData msg;
+    msg.invocation_id(invocation_id);
+
+    std::unique_lock<std::mutex> lock{*_write_lock};
+    if (!common::sockets::write_message(
+            _dataplane.handle(), msg.bytes(), msg.BUF_SIZE, nullptr, 0
+        )) {
+      throw common::InvalidProcessState("Failed to send the cancellation!");
+    }
+  }
+
 }; // namespace praas::sdk